@@ -12,6 +12,7 @@
 #include "logger.h"
 #include "rtc_common.h"
 #include "maths.h"
+#include "utilities.h"
 
 //List of logger field names. This must be in the same order and length as logger_updateLogdataCSV()
 constexpr char header_0[] PROGMEM = "secl";
@@ -105,21 +106,21 @@ constexpr char header_87[] PROGMEM = "EMAP";
 constexpr char header_88[] PROGMEM = "Fan Duty";
 constexpr char header_89[] PROGMEM = "AirConStatus";
 constexpr char header_90[] PROGMEM = "Dwell Actual";
+constexpr char header_91[] PROGMEM = "Comms Time";
+constexpr char header_92[] PROGMEM = "Comms Time Max";
+constexpr char header_93[] PROGMEM = "Sensors Time";
+constexpr char header_94[] PROGMEM = "Sensors Time Max";
+constexpr char header_95[] PROGMEM = "Corrections Time";
+constexpr char header_96[] PROGMEM = "Corrections Time Max";
+constexpr char header_97[] PROGMEM = "PW Calc Time";
+constexpr char header_98[] PROGMEM = "PW Calc Time Max";
+constexpr char header_99[] PROGMEM = "Scheduling Time";
+constexpr char header_100[] PROGMEM = "Scheduling Time Max";
+constexpr char header_101[] PROGMEM = "Aux Time";
+constexpr char header_102[] PROGMEM = "Aux Time Max";
+constexpr char header_103[] PROGMEM = "SD Time";
+constexpr char header_104[] PROGMEM = "SD Time Max";
 /*
-constexpr char header_91[] PROGMEM = "";
-constexpr char header_92[] PROGMEM = "";
-constexpr char header_93[] PROGMEM = "";
-constexpr char header_94[] PROGMEM = "";
-constexpr char header_95[] PROGMEM = "";
-constexpr char header_96[] PROGMEM = "";
-constexpr char header_97[] PROGMEM = "";
-constexpr char header_98[] PROGMEM = "";
-constexpr char header_99[] PROGMEM = "";
-constexpr char header_100[] PROGMEM = "";
-constexpr char header_101[] PROGMEM = "";
-constexpr char header_102[] PROGMEM = "";
-constexpr char header_103[] PROGMEM = "";
-constexpr char header_104[] PROGMEM = "";
 constexpr char header_105[] PROGMEM = "";
 constexpr char header_106[] PROGMEM = "";
 constexpr char header_107[] PROGMEM = "";
@@ -230,7 +231,6 @@ constexpr const char* header_table[] PROGMEM = {  header_0,\
                                               header_88,\
                                               header_89,\
                                               header_90,\
-                                              /*
                                               header_91,\
                                               header_92,\
                                               header_93,\
@@ -245,6 +245,7 @@ constexpr const char* header_table[] PROGMEM = {  header_0,\
                                               header_102,\
                                               header_103,\
                                               header_104,\
+                                              /*
                                               header_105,\
                                               header_106,\
                                               header_107,\
@@ -264,10 +265,253 @@ constexpr const char* header_table[] PROGMEM = {  header_0,\
                                               header_121,\
                                               */
                                             };
-#define SD_LOG_NUM_FIELDS   91 /**< The number of fields that are in the log. This is always smaller than the entry size due to some fields being 2 bytes */
+#define SD_LOG_NUM_FIELDS   105 /**< The number of fields that are in the log. This is always smaller than the entry size due to some fields being 2 bytes */
 
 static_assert(sizeof(header_table) == (sizeof(char*) * SD_LOG_NUM_FIELDS), "Number of header table titles must match number of log fields");
 
+//Binary log field descriptors. These must be in the same order and length as header_table
+//The scale matches the divisor used by getReadableFloatLogEntry() for the same field
+constexpr uint8_t field_descriptor_table[] PROGMEM = {
+  SD_LOG_FIELD(SD_LOG_TYPE_U08, SD_LOG_SCALE_1),    //secl
+  SD_LOG_FIELD(SD_LOG_TYPE_U08, SD_LOG_SCALE_1),    //status1
+  SD_LOG_FIELD(SD_LOG_TYPE_U08, SD_LOG_SCALE_1),    //engine
+  SD_LOG_FIELD(SD_LOG_TYPE_U08, SD_LOG_SCALE_1),    //Sync Loss #
+  SD_LOG_FIELD(SD_LOG_TYPE_U16, SD_LOG_SCALE_1),    //MAP
+  SD_LOG_FIELD(SD_LOG_TYPE_S16, SD_LOG_SCALE_1),    //IAT(C)
+  SD_LOG_FIELD(SD_LOG_TYPE_S16, SD_LOG_SCALE_1),    //CLT(C)
+  SD_LOG_FIELD(SD_LOG_TYPE_U08, SD_LOG_SCALE_1),    //Battery Correction
+  SD_LOG_FIELD(SD_LOG_TYPE_U08, SD_LOG_SCALE_10),   //Battery V
+  SD_LOG_FIELD(SD_LOG_TYPE_U08, SD_LOG_SCALE_10),   //AFR
+  SD_LOG_FIELD(SD_LOG_TYPE_U08, SD_LOG_SCALE_1),    //EGO Correction
+  SD_LOG_FIELD(SD_LOG_TYPE_U08, SD_LOG_SCALE_1),    //IAT Correction
+  SD_LOG_FIELD(SD_LOG_TYPE_U08, SD_LOG_SCALE_1),    //WUE Correction
+  SD_LOG_FIELD(SD_LOG_TYPE_U16, SD_LOG_SCALE_1),    //RPM
+  SD_LOG_FIELD(SD_LOG_TYPE_U16, SD_LOG_SCALE_1),    //Accel. Correction
+  SD_LOG_FIELD(SD_LOG_TYPE_U16, SD_LOG_SCALE_1),    //Gamma Correction
+  SD_LOG_FIELD(SD_LOG_TYPE_U08, SD_LOG_SCALE_1),    //VE1
+  SD_LOG_FIELD(SD_LOG_TYPE_U08, SD_LOG_SCALE_1),    //VE2
+  SD_LOG_FIELD(SD_LOG_TYPE_U08, SD_LOG_SCALE_10),   //AFR Target
+  SD_LOG_FIELD(SD_LOG_TYPE_S16, SD_LOG_SCALE_1),    //TPSdot
+  SD_LOG_FIELD(SD_LOG_TYPE_S08, SD_LOG_SCALE_1),    //Advance Current
+  SD_LOG_FIELD(SD_LOG_TYPE_U08, SD_LOG_SCALE_2),    //TPS
+  SD_LOG_FIELD(SD_LOG_TYPE_U16, SD_LOG_SCALE_1),    //Loops/S
+  SD_LOG_FIELD(SD_LOG_TYPE_U16, SD_LOG_SCALE_1),    //Free RAM
+  SD_LOG_FIELD(SD_LOG_TYPE_U16, SD_LOG_SCALE_1),    //Boost Target
+  SD_LOG_FIELD(SD_LOG_TYPE_U16, SD_LOG_SCALE_1),    //Boost Duty
+  SD_LOG_FIELD(SD_LOG_TYPE_U08, SD_LOG_SCALE_1),    //status2
+  SD_LOG_FIELD(SD_LOG_TYPE_S16, SD_LOG_SCALE_1),    //rpmDOT
+  SD_LOG_FIELD(SD_LOG_TYPE_U08, SD_LOG_SCALE_1),    //Eth%
+  SD_LOG_FIELD(SD_LOG_TYPE_U08, SD_LOG_SCALE_1),    //Flex Fuel Correction
+  SD_LOG_FIELD(SD_LOG_TYPE_S08, SD_LOG_SCALE_1),    //Flex Adv Correction
+  SD_LOG_FIELD(SD_LOG_TYPE_U08, SD_LOG_SCALE_1),    //IAC Steps/Duty
+  SD_LOG_FIELD(SD_LOG_TYPE_U08, SD_LOG_SCALE_1),    //testoutputs
+  SD_LOG_FIELD(SD_LOG_TYPE_U08, SD_LOG_SCALE_10),   //AFR2
+  SD_LOG_FIELD(SD_LOG_TYPE_U08, SD_LOG_SCALE_1),    //Baro
+  SD_LOG_FIELD(SD_LOG_TYPE_U16, SD_LOG_SCALE_1),    //AUX_IN 0
+  SD_LOG_FIELD(SD_LOG_TYPE_U16, SD_LOG_SCALE_1),    //AUX_IN 1
+  SD_LOG_FIELD(SD_LOG_TYPE_U16, SD_LOG_SCALE_1),    //AUX_IN 2
+  SD_LOG_FIELD(SD_LOG_TYPE_U16, SD_LOG_SCALE_1),    //AUX_IN 3
+  SD_LOG_FIELD(SD_LOG_TYPE_U16, SD_LOG_SCALE_1),    //AUX_IN 4
+  SD_LOG_FIELD(SD_LOG_TYPE_U16, SD_LOG_SCALE_1),    //AUX_IN 5
+  SD_LOG_FIELD(SD_LOG_TYPE_U16, SD_LOG_SCALE_1),    //AUX_IN 6
+  SD_LOG_FIELD(SD_LOG_TYPE_U16, SD_LOG_SCALE_1),    //AUX_IN 7
+  SD_LOG_FIELD(SD_LOG_TYPE_U16, SD_LOG_SCALE_1),    //AUX_IN 8
+  SD_LOG_FIELD(SD_LOG_TYPE_U16, SD_LOG_SCALE_1),    //AUX_IN 9
+  SD_LOG_FIELD(SD_LOG_TYPE_U16, SD_LOG_SCALE_1),    //AUX_IN 10
+  SD_LOG_FIELD(SD_LOG_TYPE_U16, SD_LOG_SCALE_1),    //AUX_IN 11
+  SD_LOG_FIELD(SD_LOG_TYPE_U16, SD_LOG_SCALE_1),    //AUX_IN 12
+  SD_LOG_FIELD(SD_LOG_TYPE_U16, SD_LOG_SCALE_1),    //AUX_IN 13
+  SD_LOG_FIELD(SD_LOG_TYPE_U16, SD_LOG_SCALE_1),    //AUX_IN 14
+  SD_LOG_FIELD(SD_LOG_TYPE_U16, SD_LOG_SCALE_1),    //AUX_IN 15
+  SD_LOG_FIELD(SD_LOG_TYPE_U08, SD_LOG_SCALE_1),    //TPS ADC
+  SD_LOG_FIELD(SD_LOG_TYPE_U08, SD_LOG_SCALE_1),    //Errors
+  SD_LOG_FIELD(SD_LOG_TYPE_U16, SD_LOG_SCALE_1000), //PW
+  SD_LOG_FIELD(SD_LOG_TYPE_U16, SD_LOG_SCALE_1000), //PW2
+  SD_LOG_FIELD(SD_LOG_TYPE_U16, SD_LOG_SCALE_1000), //PW3
+  SD_LOG_FIELD(SD_LOG_TYPE_U16, SD_LOG_SCALE_1000), //PW4
+  SD_LOG_FIELD(SD_LOG_TYPE_U08, SD_LOG_SCALE_1),    //status3
+  SD_LOG_FIELD(SD_LOG_TYPE_U08, SD_LOG_SCALE_1),    //Engine Protect
+  SD_LOG_FIELD(SD_LOG_TYPE_U08, SD_LOG_SCALE_1),    //Unused
+  SD_LOG_FIELD(SD_LOG_TYPE_S16, SD_LOG_SCALE_1),    //Fuel Load
+  SD_LOG_FIELD(SD_LOG_TYPE_S16, SD_LOG_SCALE_1),    //Ign Load
+  SD_LOG_FIELD(SD_LOG_TYPE_U16, SD_LOG_SCALE_1),    //Dwell Requested
+  SD_LOG_FIELD(SD_LOG_TYPE_U08, SD_LOG_SCALE_1),    //Idle Target (RPM)
+  SD_LOG_FIELD(SD_LOG_TYPE_S16, SD_LOG_SCALE_1),    //MAP DOT
+  SD_LOG_FIELD(SD_LOG_TYPE_S16, SD_LOG_SCALE_1),    //VVT1 Angle
+  SD_LOG_FIELD(SD_LOG_TYPE_U08, SD_LOG_SCALE_1),    //VVT1 Target
+  SD_LOG_FIELD(SD_LOG_TYPE_U16, SD_LOG_SCALE_1),    //VVT1 Duty
+  SD_LOG_FIELD(SD_LOG_TYPE_S16, SD_LOG_SCALE_1),    //Flex Boost Adj
+  SD_LOG_FIELD(SD_LOG_TYPE_U08, SD_LOG_SCALE_1),    //Baro Correction
+  SD_LOG_FIELD(SD_LOG_TYPE_U08, SD_LOG_SCALE_1),    //VE Current
+  SD_LOG_FIELD(SD_LOG_TYPE_U08, SD_LOG_SCALE_1),    //ASE Correction
+  SD_LOG_FIELD(SD_LOG_TYPE_U16, SD_LOG_SCALE_1),    //Vehicle Speed
+  SD_LOG_FIELD(SD_LOG_TYPE_U08, SD_LOG_SCALE_1),    //Gear
+  SD_LOG_FIELD(SD_LOG_TYPE_U08, SD_LOG_SCALE_1),    //Fuel Pressure
+  SD_LOG_FIELD(SD_LOG_TYPE_U08, SD_LOG_SCALE_1),    //Oil Pressure
+  SD_LOG_FIELD(SD_LOG_TYPE_U08, SD_LOG_SCALE_1),    //WMI PW
+  SD_LOG_FIELD(SD_LOG_TYPE_U08, SD_LOG_SCALE_1),    //status4
+  SD_LOG_FIELD(SD_LOG_TYPE_S16, SD_LOG_SCALE_1),    //VVT2 Angle
+  SD_LOG_FIELD(SD_LOG_TYPE_U08, SD_LOG_SCALE_1),    //VVT2 Target
+  SD_LOG_FIELD(SD_LOG_TYPE_U16, SD_LOG_SCALE_1),    //VVT2 Duty
+  SD_LOG_FIELD(SD_LOG_TYPE_U08, SD_LOG_SCALE_1),    //outputs
+  SD_LOG_FIELD(SD_LOG_TYPE_S08, SD_LOG_SCALE_1),    //Fuel Temp
+  SD_LOG_FIELD(SD_LOG_TYPE_U08, SD_LOG_SCALE_1),    //Fuel Temp Correction
+  SD_LOG_FIELD(SD_LOG_TYPE_S08, SD_LOG_SCALE_1),    //Advance 1
+  SD_LOG_FIELD(SD_LOG_TYPE_S08, SD_LOG_SCALE_1),    //Advance 2
+  SD_LOG_FIELD(SD_LOG_TYPE_U08, SD_LOG_SCALE_1),    //SD Status
+  SD_LOG_FIELD(SD_LOG_TYPE_S16, SD_LOG_SCALE_1),    //EMAP
+  SD_LOG_FIELD(SD_LOG_TYPE_U08, SD_LOG_SCALE_1),    //Fan Duty
+  SD_LOG_FIELD(SD_LOG_TYPE_U08, SD_LOG_SCALE_1),    //AirConStatus
+  SD_LOG_FIELD(SD_LOG_TYPE_U16, SD_LOG_SCALE_1),    //Dwell Actual
+  SD_LOG_FIELD(SD_LOG_TYPE_U16, SD_LOG_SCALE_1),    //Comms Time
+  SD_LOG_FIELD(SD_LOG_TYPE_U16, SD_LOG_SCALE_1),    //Comms Time Max
+  SD_LOG_FIELD(SD_LOG_TYPE_U16, SD_LOG_SCALE_1),    //Sensors Time
+  SD_LOG_FIELD(SD_LOG_TYPE_U16, SD_LOG_SCALE_1),    //Sensors Time Max
+  SD_LOG_FIELD(SD_LOG_TYPE_U16, SD_LOG_SCALE_1),    //Corrections Time
+  SD_LOG_FIELD(SD_LOG_TYPE_U16, SD_LOG_SCALE_1),    //Corrections Time Max
+  SD_LOG_FIELD(SD_LOG_TYPE_U16, SD_LOG_SCALE_1),    //PW Calc Time
+  SD_LOG_FIELD(SD_LOG_TYPE_U16, SD_LOG_SCALE_1),    //PW Calc Time Max
+  SD_LOG_FIELD(SD_LOG_TYPE_U16, SD_LOG_SCALE_1),    //Scheduling Time
+  SD_LOG_FIELD(SD_LOG_TYPE_U16, SD_LOG_SCALE_1),    //Scheduling Time Max
+  SD_LOG_FIELD(SD_LOG_TYPE_U16, SD_LOG_SCALE_1),    //Aux Time
+  SD_LOG_FIELD(SD_LOG_TYPE_U16, SD_LOG_SCALE_1),    //Aux Time Max
+  SD_LOG_FIELD(SD_LOG_TYPE_U16, SD_LOG_SCALE_1),    //SD Time
+  SD_LOG_FIELD(SD_LOG_TYPE_U16, SD_LOG_SCALE_1),    //SD Time Max
+};
+static_assert(sizeof(field_descriptor_table) == SD_LOG_NUM_FIELDS, "Number of binary field descriptors must match number of log fields");
+
+/**
+ * Describes how a field of the getTSLogEntry() block is written into the MLG header.
+ * The human readable value is (raw + transform) * scale, which matches the scale and translate values of the OutputChannels in the ini file
+ */
+struct mlg_field_t
+{
+  uint8_t type;
+  uint8_t style;
+  int8_t transform;
+  int8_t digits;
+  float scale;
+  char units[6];
+};
+
+//MLG field descriptors. These must be in the same order as the getTSLogEntry() block. Field names are taken from header_table, skipping the unused entry 59
+constexpr mlg_field_t mlg_field_table[] PROGMEM = {
+  { MLG_TYPE_U08, MLG_STYLE_FLOAT,   0, 0,   1.0F, "sec" },   //secl
+  { MLG_TYPE_U08, MLG_STYLE_HEX,     0, 0,   1.0F, "bits" },  //status1
+  { MLG_TYPE_U08, MLG_STYLE_HEX,     0, 0,   1.0F, "bits" },  //engine
+  { MLG_TYPE_U08, MLG_STYLE_FLOAT,   0, 0,   1.0F, "" },      //Sync Loss #
+  { MLG_TYPE_U16, MLG_STYLE_FLOAT,   0, 0,   1.0F, "kPa" },   //MAP
+  { MLG_TYPE_U08, MLG_STYLE_FLOAT, -40, 0,   1.0F, "C" },     //IAT(C)
+  { MLG_TYPE_U08, MLG_STYLE_FLOAT, -40, 0,   1.0F, "C" },     //CLT(C)
+  { MLG_TYPE_U08, MLG_STYLE_FLOAT,   0, 0,   1.0F, "%" },     //Battery Correction
+  { MLG_TYPE_U08, MLG_STYLE_FLOAT,   0, 1,   0.1F, "V" },     //Battery V
+  { MLG_TYPE_U08, MLG_STYLE_FLOAT,   0, 1,   0.1F, "O2" },    //AFR
+  { MLG_TYPE_U08, MLG_STYLE_FLOAT,   0, 0,   1.0F, "%" },     //EGO Correction
+  { MLG_TYPE_U08, MLG_STYLE_FLOAT,   0, 0,   1.0F, "%" },     //IAT Correction
+  { MLG_TYPE_U08, MLG_STYLE_FLOAT,   0, 0,   1.0F, "%" },     //WUE Correction
+  { MLG_TYPE_U16, MLG_STYLE_FLOAT,   0, 0,   1.0F, "rpm" },   //RPM
+  { MLG_TYPE_U08, MLG_STYLE_FLOAT,   0, 0,   2.0F, "%" },     //Accel. Correction
+  { MLG_TYPE_U16, MLG_STYLE_FLOAT,   0, 0,   1.0F, "%" },     //Gamma Correction
+  { MLG_TYPE_U08, MLG_STYLE_FLOAT,   0, 0,   1.0F, "%" },     //VE1
+  { MLG_TYPE_U08, MLG_STYLE_FLOAT,   0, 0,   1.0F, "%" },     //VE2
+  { MLG_TYPE_U08, MLG_STYLE_FLOAT,   0, 1,   0.1F, "O2" },    //AFR Target
+  { MLG_TYPE_S16, MLG_STYLE_FLOAT,   0, 0,   1.0F, "%/s" },   //TPSdot
+  { MLG_TYPE_S08, MLG_STYLE_FLOAT,   0, 0,   1.0F, "deg" },   //Advance Current
+  { MLG_TYPE_U08, MLG_STYLE_FLOAT,   0, 1,   0.5F, "%" },     //TPS
+  { MLG_TYPE_U16, MLG_STYLE_FLOAT,   0, 0,   1.0F, "loops" }, //Loops/S
+  { MLG_TYPE_U16, MLG_STYLE_FLOAT,   0, 0,   1.0F, "bytes" }, //Free RAM
+  { MLG_TYPE_U08, MLG_STYLE_FLOAT,   0, 0,   2.0F, "kPa" },   //Boost Target
+  { MLG_TYPE_U08, MLG_STYLE_FLOAT,   0, 0,   1.0F, "%" },     //Boost Duty
+  { MLG_TYPE_U08, MLG_STYLE_HEX,     0, 0,   1.0F, "bits" },  //status2
+  { MLG_TYPE_S16, MLG_STYLE_FLOAT,   0, 0,   1.0F, "rpm/s" }, //rpmDOT
+  { MLG_TYPE_U08, MLG_STYLE_FLOAT,   0, 0,   1.0F, "%" },     //Eth%
+  { MLG_TYPE_U08, MLG_STYLE_FLOAT,   0, 0,   1.0F, "%" },     //Flex Fuel Correction
+  { MLG_TYPE_S08, MLG_STYLE_FLOAT,   0, 0,   1.0F, "deg" },   //Flex Adv Correction
+  { MLG_TYPE_U08, MLG_STYLE_FLOAT,   0, 0,   1.0F, "" },      //IAC Steps/Duty
+  { MLG_TYPE_U08, MLG_STYLE_HEX,     0, 0,   1.0F, "bits" },  //testoutputs
+  { MLG_TYPE_U08, MLG_STYLE_FLOAT,   0, 1,   0.1F, "O2" },    //AFR2
+  { MLG_TYPE_U08, MLG_STYLE_FLOAT,   0, 0,   1.0F, "kPa" },   //Baro
+  { MLG_TYPE_U16, MLG_STYLE_FLOAT,   0, 0,   1.0F, "" },      //AUX_IN 0
+  { MLG_TYPE_U16, MLG_STYLE_FLOAT,   0, 0,   1.0F, "" },      //AUX_IN 1
+  { MLG_TYPE_U16, MLG_STYLE_FLOAT,   0, 0,   1.0F, "" },      //AUX_IN 2
+  { MLG_TYPE_U16, MLG_STYLE_FLOAT,   0, 0,   1.0F, "" },      //AUX_IN 3
+  { MLG_TYPE_U16, MLG_STYLE_FLOAT,   0, 0,   1.0F, "" },      //AUX_IN 4
+  { MLG_TYPE_U16, MLG_STYLE_FLOAT,   0, 0,   1.0F, "" },      //AUX_IN 5
+  { MLG_TYPE_U16, MLG_STYLE_FLOAT,   0, 0,   1.0F, "" },      //AUX_IN 6
+  { MLG_TYPE_U16, MLG_STYLE_FLOAT,   0, 0,   1.0F, "" },      //AUX_IN 7
+  { MLG_TYPE_U16, MLG_STYLE_FLOAT,   0, 0,   1.0F, "" },      //AUX_IN 8
+  { MLG_TYPE_U16, MLG_STYLE_FLOAT,   0, 0,   1.0F, "" },      //AUX_IN 9
+  { MLG_TYPE_U16, MLG_STYLE_FLOAT,   0, 0,   1.0F, "" },      //AUX_IN 10
+  { MLG_TYPE_U16, MLG_STYLE_FLOAT,   0, 0,   1.0F, "" },      //AUX_IN 11
+  { MLG_TYPE_U16, MLG_STYLE_FLOAT,   0, 0,   1.0F, "" },      //AUX_IN 12
+  { MLG_TYPE_U16, MLG_STYLE_FLOAT,   0, 0,   1.0F, "" },      //AUX_IN 13
+  { MLG_TYPE_U16, MLG_STYLE_FLOAT,   0, 0,   1.0F, "" },      //AUX_IN 14
+  { MLG_TYPE_U16, MLG_STYLE_FLOAT,   0, 0,   1.0F, "" },      //AUX_IN 15
+  { MLG_TYPE_U08, MLG_STYLE_FLOAT,   0, 0,   1.0F, "ADC" },   //TPS ADC
+  { MLG_TYPE_U08, MLG_STYLE_HEX,     0, 0,   1.0F, "bits" },  //Errors
+  { MLG_TYPE_U16, MLG_STYLE_FLOAT,   0, 3, 0.001F, "ms" },    //PW
+  { MLG_TYPE_U16, MLG_STYLE_FLOAT,   0, 3, 0.001F, "ms" },    //PW2
+  { MLG_TYPE_U16, MLG_STYLE_FLOAT,   0, 3, 0.001F, "ms" },    //PW3
+  { MLG_TYPE_U16, MLG_STYLE_FLOAT,   0, 3, 0.001F, "ms" },    //PW4
+  { MLG_TYPE_U08, MLG_STYLE_HEX,     0, 0,   1.0F, "bits" },  //status3
+  { MLG_TYPE_U08, MLG_STYLE_HEX,     0, 0,   1.0F, "bits" },  //Engine Protect
+  { MLG_TYPE_S16, MLG_STYLE_FLOAT,   0, 0,   1.0F, "" },      //Fuel Load
+  { MLG_TYPE_S16, MLG_STYLE_FLOAT,   0, 0,   1.0F, "" },      //Ign Load
+  { MLG_TYPE_U16, MLG_STYLE_FLOAT,   0, 3, 0.001F, "ms" },    //Dwell Requested
+  { MLG_TYPE_U08, MLG_STYLE_FLOAT,   0, 0,  10.0F, "rpm" },   //Idle Target (RPM)
+  { MLG_TYPE_S16, MLG_STYLE_FLOAT,   0, 0,   1.0F, "kPa/s" }, //MAP DOT
+  { MLG_TYPE_S16, MLG_STYLE_FLOAT,   0, 1,   0.5F, "deg" },   //VVT1 Angle
+  { MLG_TYPE_U08, MLG_STYLE_FLOAT,   0, 1,   0.5F, "deg" },   //VVT1 Target
+  { MLG_TYPE_U08, MLG_STYLE_FLOAT,   0, 1,   0.5F, "%" },     //VVT1 Duty
+  { MLG_TYPE_S16, MLG_STYLE_FLOAT,   0, 0,   1.0F, "kPa" },   //Flex Boost Adj
+  { MLG_TYPE_U08, MLG_STYLE_FLOAT,   0, 0,   1.0F, "%" },     //Baro Correction
+  { MLG_TYPE_U08, MLG_STYLE_FLOAT,   0, 0,   1.0F, "%" },     //VE Current
+  { MLG_TYPE_U08, MLG_STYLE_FLOAT,   0, 0,   1.0F, "%" },     //ASE Correction
+  { MLG_TYPE_U16, MLG_STYLE_FLOAT,   0, 0,   1.0F, "km/h" },  //Vehicle Speed
+  { MLG_TYPE_U08, MLG_STYLE_FLOAT,   0, 0,   1.0F, "" },      //Gear
+  { MLG_TYPE_U08, MLG_STYLE_FLOAT,   0, 0,   1.0F, "PSI" },   //Fuel Pressure
+  { MLG_TYPE_U08, MLG_STYLE_FLOAT,   0, 0,   1.0F, "PSI" },   //Oil Pressure
+  { MLG_TYPE_U08, MLG_STYLE_FLOAT,   0, 0,   1.0F, "%" },     //WMI PW
+  { MLG_TYPE_U08, MLG_STYLE_HEX,     0, 0,   1.0F, "bits" },  //status4
+  { MLG_TYPE_S16, MLG_STYLE_FLOAT,   0, 1,   0.5F, "deg" },   //VVT2 Angle
+  { MLG_TYPE_U08, MLG_STYLE_FLOAT,   0, 1,   0.5F, "deg" },   //VVT2 Target
+  { MLG_TYPE_U08, MLG_STYLE_FLOAT,   0, 1,   0.5F, "%" },     //VVT2 Duty
+  { MLG_TYPE_U08, MLG_STYLE_HEX,     0, 0,   1.0F, "bits" },  //outputs
+  { MLG_TYPE_U08, MLG_STYLE_FLOAT, -40, 0,   1.0F, "C" },     //Fuel Temp
+  { MLG_TYPE_U08, MLG_STYLE_FLOAT,   0, 0,   1.0F, "%" },     //Fuel Temp Correction
+  { MLG_TYPE_S08, MLG_STYLE_FLOAT,   0, 0,   1.0F, "deg" },   //Advance 1
+  { MLG_TYPE_S08, MLG_STYLE_FLOAT,   0, 0,   1.0F, "deg" },   //Advance 2
+  { MLG_TYPE_U08, MLG_STYLE_HEX,     0, 0,   1.0F, "bits" },  //SD Status
+  { MLG_TYPE_U16, MLG_STYLE_FLOAT,   0, 0,   1.0F, "kPa" },   //EMAP
+  { MLG_TYPE_U08, MLG_STYLE_FLOAT,   0, 1,   0.5F, "%" },     //Fan Duty
+  { MLG_TYPE_U08, MLG_STYLE_HEX,     0, 0,   1.0F, "bits" },  //AirConStatus
+  { MLG_TYPE_U16, MLG_STYLE_FLOAT,   0, 3, 0.001F, "ms" },    //Dwell Actual
+  { MLG_TYPE_U16, MLG_STYLE_FLOAT,   0, 0,   1.0F, "us" },    //Comms Time
+  { MLG_TYPE_U16, MLG_STYLE_FLOAT,   0, 0,   1.0F, "us" },    //Comms Time Max
+  { MLG_TYPE_U16, MLG_STYLE_FLOAT,   0, 0,   1.0F, "us" },    //Sensors Time
+  { MLG_TYPE_U16, MLG_STYLE_FLOAT,   0, 0,   1.0F, "us" },    //Sensors Time Max
+  { MLG_TYPE_U16, MLG_STYLE_FLOAT,   0, 0,   1.0F, "us" },    //Corrections Time
+  { MLG_TYPE_U16, MLG_STYLE_FLOAT,   0, 0,   1.0F, "us" },    //Corrections Time Max
+  { MLG_TYPE_U16, MLG_STYLE_FLOAT,   0, 0,   1.0F, "us" },    //PW Calc Time
+  { MLG_TYPE_U16, MLG_STYLE_FLOAT,   0, 0,   1.0F, "us" },    //PW Calc Time Max
+  { MLG_TYPE_U16, MLG_STYLE_FLOAT,   0, 0,   1.0F, "us" },    //Scheduling Time
+  { MLG_TYPE_U16, MLG_STYLE_FLOAT,   0, 0,   1.0F, "us" },    //Scheduling Time Max
+  { MLG_TYPE_U16, MLG_STYLE_FLOAT,   0, 0,   1.0F, "us" },    //Aux Time
+  { MLG_TYPE_U16, MLG_STYLE_FLOAT,   0, 0,   1.0F, "us" },    //Aux Time Max
+  { MLG_TYPE_U16, MLG_STYLE_FLOAT,   0, 0,   1.0F, "us" },    //SD Time
+  { MLG_TYPE_U16, MLG_STYLE_FLOAT,   0, 0,   1.0F, "us" },    //SD Time Max
+};
+#define MLG_NUM_FIELDS      _countof(mlg_field_table)
+#define MLG_UNUSED_HEADER   59 /**< header_table entry that has no equivalent in the getTSLogEntry() block */
+
+static constexpr uint16_t mlgFieldSize(uint8_t type) { return (type >= MLG_TYPE_U16) ? 2U : 1U; }
+static constexpr uint16_t mlgBlockSize(uint8_t index) { return (index >= MLG_NUM_FIELDS) ? 0U : (mlgFieldSize(mlg_field_table[index].type) + mlgBlockSize(index + 1U)); }
+#ifndef UNIT_TEST
+static_assert(mlgBlockSize(0) == LOG_ENTRY_SIZE, "MLG field descriptors must cover the whole log entry block");
+#endif
+static_assert(MLG_NUM_FIELDS == (SD_LOG_NUM_FIELDS - 1U), "Every MLG field requires a header_table name");
+#define MLG_RECORD_LENGTH   (4U + LOG_ENTRY_SIZE) /**< Time field + the getTSLogEntry() block */
+
 SdExFat sd;
 ExFile logFile;
 RingBuf<ExFile, RING_BUF_CAPACITY> rb;
@@ -275,6 +519,43 @@ uint8_t SD_status = SD_STATUS_OFF;
 uint16_t currentLogFileNumber;
 bool manualLogActive = false;
 uint32_t logStartTime = 0; //In ms
+uint32_t lastLogEntryTime = 0; //In ms. Used to pace the fast log rates
+uint8_t binaryRecordLength = 0; //Length in bytes of each binary log record. Calculated when the header is written
+uint8_t binaryRecordCounter = 0;
+
+static ExFile toothLogFile;
+static uint8_t toothSectorBuffer[SD_SECTOR_SIZE + SD_TOOTH_LOG_RECORD_SIZE]; //1 sector plus room for 1 more record
+static uint16_t toothSectorLength = 0;
+static uint16_t lastToothRingOverflows = 0;
+
+static const char* const logFileExtensions[] = { LOG_FILE_EXTENSION, LOG_FILE_EXTENSION_BINARY, LOG_FILE_EXTENSION_MLG }; //Every extension that a log file may have. Used when searching for existing log files
+
+/**
+ * @brief Returns the extension used for log files of the currently selected file style
+ */
+static const char* getLogFileExtension(void)
+{
+  if(configPage13.onboard_log_file_style == LOGGER_BINARY) { return LOG_FILE_EXTENSION_BINARY; }
+  if(configPage13.onboard_log_file_style == LOGGER_MLG) { return LOG_FILE_EXTENSION_MLG; }
+  return LOG_FILE_EXTENSION;
+}
+
+/**
+ * @brief Checks whether a log file with the given number exists with any of the known extensions
+ * 
+ * @param filenameBuffer Buffer of at least 13 bytes. If the file exists, this is filled with its name
+ * @param logNumber The number of the log file
+ * @return True if a log file with this number exists
+ */
+static bool findLogFile(char* filenameBuffer, uint16_t logNumber)
+{
+  for(uint8_t x = 0; x < _countof(logFileExtensions); x++)
+  {
+    snprintf(filenameBuffer, 13, "%s%04d.%s", LOG_FILE_PREFIX, logNumber, logFileExtensions[x]);
+    if(sd.exists(filenameBuffer)) { return true; }
+  }
+  return false;
+}
 
 void initSD()
 {
@@ -332,7 +613,7 @@ bool createLogFile()
   //Create the filename
   //sprintf(filenameBuffer, "%s%04d.%s", LOG_FILE_PREFIX, currentLogFileNumber, LOG_FILE_EXTENSION);
   if(currentLogFileNumber > MAX_LOG_FILES) { currentLogFileNumber = 1; } //If we've run out of file numbers, start again from 1
-  snprintf(filenameBuffer, 13, "%s%04d.%s", LOG_FILE_PREFIX, currentLogFileNumber, LOG_FILE_EXTENSION);
+  snprintf(filenameBuffer, 13, "%s%04d.%s", LOG_FILE_PREFIX, currentLogFileNumber, getLogFileExtension());
 
   logFile.close();
   if (logFile.open(filenameBuffer, O_RDWR | O_CREAT | O_TRUNC)) 
@@ -347,13 +628,11 @@ uint16_t getNextSDLogFileNumber()
 {
   uint16_t nextFileNumber = 1;
   char filenameBuffer[13]; //8 + 1 + 3 + 1
-  sprintf(filenameBuffer, "%s%04d.%s", LOG_FILE_PREFIX, nextFileNumber, LOG_FILE_EXTENSION);
 
-  //Lookup the next available file number
-  while( (nextFileNumber < MAX_LOG_FILES) && (sd.exists(filenameBuffer)) )
+  //Lookup the next available file number. Numbers are shared between all log file styles
+  while( (nextFileNumber < MAX_LOG_FILES) && (findLogFile(filenameBuffer, nextFileNumber)) )
   {
     nextFileNumber++;
-    sprintf(filenameBuffer, "%s%04d.%s", LOG_FILE_PREFIX, nextFileNumber, LOG_FILE_EXTENSION);
   }
 
   return nextFileNumber;
@@ -367,9 +646,8 @@ bool getSDLogFileDetails(uint8_t* buffer, uint16_t logNumber)
 
   char filenameBuffer[13]; //8 + 1 + 3 + 1
   if(logNumber > MAX_LOG_FILES) { logNumber = MAX_LOG_FILES; } //If we've run out of file numbers, start again from 1
-  snprintf(filenameBuffer, 13, "%s%04d.%s", LOG_FILE_PREFIX, logNumber, LOG_FILE_EXTENSION);
   
-  if(sd.exists(filenameBuffer))
+  if(findLogFile(filenameBuffer, logNumber))
   {
     fileFound = true;
 
@@ -435,8 +713,113 @@ void readSDSectors(uint8_t* buffer, uint32_t sectorNumber, uint16_t sectorCount)
   sd.card()->readSectors(sectorNumber, buffer, sectorCount);
 }
 
+/**
+ * Creates the tooth log file that accompanies the main log file and starts the SD tooth logger
+ * A failure here does not stop the main log from being written
+ */
+static void beginSDToothLog(void)
+{
+  char filenameBuffer[13]; //8 + 1 + 3 + 1
+  snprintf(filenameBuffer, 13, "%s%04d.%s", TOOTH_LOG_FILE_PREFIX, currentLogFileNumber, LOG_FILE_EXTENSION_BINARY);
+
+  toothLogFile.close();
+  if(toothLogFile.open(filenameBuffer, O_RDWR | O_CREAT | O_TRUNC) == false) { return; }
+  if(toothLogFile.preAllocate(SD_LOG_FILE_SIZE) == false)
+  {
+    toothLogFile.close();
+    return;
+  }
+
+  //Header is built directly in the sector buffer
+  memcpy(toothSectorBuffer, SD_TOOTH_LOG_MAGIC, 6);
+  toothSectorBuffer[6] = SD_TOOTH_LOG_VERSION;
+  toothSectorBuffer[7] = SD_TOOTH_LOG_RECORD_SIZE;
+  toothSectorLength = 8;
+  lastToothRingOverflows = 0;
+
+  startSDToothLogger();
+}
+
+static void addToothLogRecord(uint32_t time, uint8_t flags)
+{
+  toothSectorBuffer[toothSectorLength++] = (uint8_t)(time);
+  toothSectorBuffer[toothSectorLength++] = (uint8_t)(time >> 8);
+  toothSectorBuffer[toothSectorLength++] = (uint8_t)(time >> 16);
+  toothSectorBuffer[toothSectorLength++] = (uint8_t)(time >> 24);
+  toothSectorBuffer[toothSectorLength++] = flags;
+}
+
+/**
+ * Moves entries from the tooth ring (Filled by the trigger ISRs) into the sector buffer until it holds at least 1 full sector or the ring is empty
+ */
+static void fillToothSectorBuffer(void)
+{
+  uint16_t overflows = toothRingOverflows;
+  if( (overflows != lastToothRingOverflows) && (toothSectorLength < SD_SECTOR_SIZE) )
+  {
+    addToothLogRecord((uint16_t)(overflows - lastToothRingOverflows), SD_TOOTH_LOG_OVERFLOW);
+    lastToothRingOverflows = overflows;
+  }
+
+  uint16_t tail = toothRingTail;
+  uint16_t head = toothRingHead;
+  while( (tail != head) && (toothSectorLength < SD_SECTOR_SIZE) )
+  {
+    addToothLogRecord(toothRingTimes[tail], toothRingFlags[tail]);
+    tail = (tail + 1U) & TOOTH_RING_MASK;
+  }
+  toothRingTail = tail; //Frees the entries for the ISRs to reuse
+}
+
+static void writeToothSector(void)
+{
+  if(toothLogFile.write(toothSectorBuffer, SD_SECTOR_SIZE) != SD_SECTOR_SIZE) { SD_status = SD_STATUS_ERROR_WRITE_FAIL; }
+  toothSectorLength -= SD_SECTOR_SIZE;
+  memmove(toothSectorBuffer, &toothSectorBuffer[SD_SECTOR_SIZE], toothSectorLength);
+}
+
+static void endSDToothLog(void)
+{
+  if(toothSDLogActive == true) { stopSDToothLogger(); }
+  if(toothLogFile.isOpen() == false) { return; }
+
+  //Write out anything still in the ring, then whatever is left in the sector buffer
+  fillToothSectorBuffer();
+  while(toothSectorLength >= SD_SECTOR_SIZE)
+  {
+    writeToothSector();
+    fillToothSectorBuffer();
+  }
+  if(toothSectorLength > 0U) { toothLogFile.write(toothSectorBuffer, toothSectorLength); }
+  toothSectorLength = 0;
+
+  toothLogFile.truncate();
+  toothLogFile.close();
+}
+
+/**
+ * Moves entries from the tooth ring to the tooth log file. Called every 1ms from the main loop
+ * At most 1 sector is written on each call
+ */
+void writeSDToothLog()
+{
+  if(toothLogFile.isOpen() == false) { return; }
+
+  //The tooth log fills much faster than the main log. Once it is full it is closed, the main log continues until it is full as well
+  if( (toothLogFile.dataLength() - toothLogFile.curPosition()) < (2U * SD_SECTOR_SIZE) )
+  {
+    endSDToothLog();
+    return;
+  }
+
+  fillToothSectorBuffer();
+  if( (toothSectorLength >= SD_SECTOR_SIZE) && !toothLogFile.isBusy() ) { writeToothSector(); }
+}
+
 // Forward declare
 void writeSDLogHeader();
+void writeSDLogHeaderBinary();
+void writeSDLogHeaderMLG();
 
 void beginSDLogging()
 {
@@ -464,7 +847,11 @@ void beginSDLogging()
     rb.begin(&logFile);
 
     //Write a header row
-    writeSDLogHeader();
+    if(configPage13.onboard_log_file_style == LOGGER_BINARY) { writeSDLogHeaderBinary(); }
+    else if(configPage13.onboard_log_file_style == LOGGER_MLG) { writeSDLogHeaderMLG(); }
+    else { writeSDLogHeader(); }
+
+    if(configPage13.onboard_log_tooth != LOGGER_TOOTH_OFF) { beginSDToothLog(); }
 
     //Note the start time
     logStartTime = millis();
@@ -475,6 +862,8 @@ void endSDLogging()
 {
   if(SD_status == SD_STATUS_ACTIVE)
   {
+    endSDToothLog();
+
     // Write any RingBuf data to file.
     rb.sync();
     logFile.truncate();
@@ -491,6 +880,120 @@ void endSDLogging()
 void checkForSDStart();
 void checkForSDStop();
 
+/**
+ * Writes the current log entry to the ring buffer as a line of comma separated values
+ */
+static void writeSDLogEntryCSV(void)
+{
+  //Write the timestamp (x.yyy seconds format)
+  uint32_t duration = lastLogEntryTime - logStartTime;
+  uint32_t seconds = duration / 1000;
+  uint32_t milliseconds = duration % 1000;
+  rb.print(seconds);
+  rb.print('.');
+  if (milliseconds < 100) { rb.print("0"); }
+  if (milliseconds < 10) { rb.print("0"); }
+  rb.print(milliseconds);
+  rb.print(',');
+
+  //Write the line to the ring buffer
+  for(byte x=0; x<SD_LOG_NUM_FIELDS; x++)
+  {
+    #if FPU_MAX_SIZE >= 32
+      float entryValue = getReadableFloatLogEntry(x);
+      if(IS_INTEGER(entryValue)) { rb.print((uint16_t)entryValue); }
+      else { rb.print(entryValue); }
+    #else
+      rb.print(getReadableLogEntry(x));
+    #endif
+    if(x < (SD_LOG_NUM_FIELDS - 1)) { rb.print(","); }
+  }
+  rb.println("");
+}
+
+/**
+ * Writes the current log entry to the ring buffer as a single binary record. See SD_logger.h for the record layout
+ * No text formatting is performed, so this is considerably cheaper than the CSV version and produces roughly a quarter of the data
+ */
+static void writeSDLogEntryBinary(void)
+{
+  uint8_t record[SD_LOG_BINARY_RECORD_OVERHEAD + (SD_LOG_NUM_FIELDS * 2U)];
+  uint32_t duration = lastLogEntryTime - logStartTime;
+  uint8_t index = 0;
+
+  //If the card has fallen behind, drop the record rather than writing a partial one
+  if(rb.bytesFree() < binaryRecordLength) { return; }
+
+  record[index++] = SD_LOG_BINARY_RECORD_MARKER;
+  record[index++] = binaryRecordCounter++;
+  record[index++] = (uint8_t)(duration);
+  record[index++] = (uint8_t)(duration >> 8);
+  record[index++] = (uint8_t)(duration >> 16);
+  record[index++] = (uint8_t)(duration >> 24);
+
+  for(byte x=0; x<SD_LOG_NUM_FIELDS; x++)
+  {
+    int16_t entryValue = getReadableLogEntry(x);
+    record[index++] = lowByte(entryValue);
+    if(SD_LOG_FIELD_SIZE(pgm_read_byte(&field_descriptor_table[x])) == 2U) { record[index++] = highByte(entryValue); }
+  }
+
+  uint8_t checksum = 0;
+  for(uint8_t x=0; x<index; x++) { checksum += record[x]; }
+  record[index++] = checksum;
+
+  rb.write(record, index);
+}
+
+/**
+ * Writes the current log entry to the ring buffer as a single MLG data block. See SD_logger.h for the block layout
+ * The getTSLogEntry() block is used as is, so no per field conversion is needed beyond swapping the byte order of the 2 byte fields
+ */
+static void writeSDLogEntryMLG(void)
+{
+  uint8_t block[MLG_BLOCK_OVERHEAD + MLG_RECORD_LENGTH];
+  uint32_t duration = lastLogEntryTime - logStartTime;
+  uint16_t timestamp = (uint16_t)(micros() / 10U);
+  uint8_t index = 0;
+
+  //If the card has fallen behind, drop the block rather than writing a partial one
+  if(rb.bytesFree() < sizeof(block)) { return; }
+
+  block[index++] = MLG_BLOCK_TYPE_DATA;
+  block[index++] = binaryRecordCounter++;
+  block[index++] = highByte(timestamp);
+  block[index++] = lowByte(timestamp);
+
+  block[index++] = (uint8_t)(duration >> 24);
+  block[index++] = (uint8_t)(duration >> 16);
+  block[index++] = (uint8_t)(duration >> 8);
+  block[index++] = (uint8_t)(duration);
+
+  uint16_t byteNum = 0;
+  for(uint8_t x=0; x<MLG_NUM_FIELDS; x++)
+  {
+    if(mlgFieldSize(pgm_read_byte(&mlg_field_table[x].type)) == 2U)
+    {
+      //TS block is little endian, MLG is big endian
+      byte lowValue = getTSLogEntry(byteNum);
+      block[index++] = getTSLogEntry(byteNum + 1U);
+      block[index++] = lowValue;
+      byteNum += 2U;
+    }
+    else
+    {
+      block[index++] = getTSLogEntry(byteNum);
+      byteNum++;
+    }
+  }
+
+  uint8_t crc = 0;
+  for(uint8_t x=4; x<index; x++) { crc += block[x]; }
+  block[index++] = crc;
+
+  rb.write(block, index);
+}
+
 void writeSDLogEntry()
 {
   //Check if we're already running a log
@@ -502,30 +1005,10 @@ void writeSDLogEntry()
 
   if(SD_status == SD_STATUS_ACTIVE)
   {
-    //Write the timestamp (x.yyy seconds format)
-    uint32_t duration = millis() - logStartTime;
-    uint32_t seconds = duration / 1000;
-    uint32_t milliseconds = duration % 1000;
-    rb.print(seconds);
-    rb.print('.');
-    if (milliseconds < 100) { rb.print("0"); }
-    if (milliseconds < 10) { rb.print("0"); }
-    rb.print(milliseconds);
-    rb.print(',');
-
-    //Write the line to the ring buffer
-    for(byte x=0; x<SD_LOG_NUM_FIELDS; x++)
-    {
-      #if FPU_MAX_SIZE >= 32
-        float entryValue = getReadableFloatLogEntry(x);
-        if(IS_INTEGER(entryValue)) { rb.print((uint16_t)entryValue); }
-        else { rb.print(entryValue); }
-      #else
-        rb.print(getReadableLogEntry(x));
-      #endif
-      if(x < (SD_LOG_NUM_FIELDS - 1)) { rb.print(","); }
-    }
-    rb.println("");
+    lastLogEntryTime = millis();
+    if(configPage13.onboard_log_file_style == LOGGER_BINARY) { writeSDLogEntryBinary(); }
+    else if(configPage13.onboard_log_file_style == LOGGER_MLG) { writeSDLogEntryMLG(); }
+    else { writeSDLogEntryCSV(); }
 
     //Check if write to SD from ringbuffer is needed
     //We write to SD when there is more than 1 sector worth of data in the ringbuffer and there is not already a write being performed
@@ -574,6 +1057,126 @@ void writeSDLogHeader()
   rb.println("");
 }
 
+/**
+ * Writes the self describing header of the binary log format. See SD_logger.h for the layout
+ * Also calculates the length of the data records that will follow
+ */
+void writeSDLogHeaderBinary()
+{
+  binaryRecordLength = SD_LOG_BINARY_RECORD_OVERHEAD;
+  binaryRecordCounter = 0;
+  for(byte x=0; x<SD_LOG_NUM_FIELDS; x++) { binaryRecordLength += SD_LOG_FIELD_SIZE(pgm_read_byte(&field_descriptor_table[x])); }
+
+  rb.print(SD_LOG_BINARY_MAGIC);
+  rb.write((uint8_t)SD_LOG_BINARY_VERSION);
+  rb.write((uint8_t)SD_LOG_NUM_FIELDS);
+  rb.write(lowByte(binaryRecordLength));
+  rb.write(highByte(binaryRecordLength));
+
+  for(byte x=0; x<SD_LOG_NUM_FIELDS; x++)
+  {
+    char buffer[30];
+    #ifdef CORE_AVR
+      strcpy_P(buffer, (char *)pgm_read_word(&(header_table[x])));
+    #else
+      strcpy(buffer, header_table[x]);
+    #endif
+    uint8_t nameLength = strlen(buffer);
+    rb.write(pgm_read_byte(&field_descriptor_table[x]));
+    rb.write(nameLength);
+    rb.write((const uint8_t*)buffer, nameLength);
+  }
+}
+
+static void writeMLGBigEndian16(uint16_t value)
+{
+  rb.write(highByte(value));
+  rb.write(lowByte(value));
+}
+
+static void writeMLGBigEndian32(uint32_t value)
+{
+  writeMLGBigEndian16((uint16_t)(value >> 16));
+  writeMLGBigEndian16((uint16_t)value);
+}
+
+static void writeMLGString(const char *value, uint8_t length)
+{
+  //Strings are fixed length and zero padded. At least 1 terminator is always written
+  uint8_t valueLength = strlen(value);
+  if(valueLength >= length) { valueLength = length - 1U; }
+  rb.write((const uint8_t*)value, valueLength);
+  for(uint8_t x=valueLength; x<length; x++) { rb.write((uint8_t)0); }
+}
+
+static void writeMLGFieldHeader(const char *name, const char *units, uint8_t type, uint8_t style, float scale, float transform, int8_t digits)
+{
+  uint32_t floatBits;
+  rb.write(type);
+  writeMLGString(name, MLG_FIELD_NAME_LENGTH);
+  writeMLGString(units, MLG_FIELD_UNITS_LENGTH);
+  rb.write(style);
+  memcpy(&floatBits, &scale, sizeof(floatBits));
+  writeMLGBigEndian32(floatBits);
+  memcpy(&floatBits, &transform, sizeof(floatBits));
+  writeMLGBigEndian32(floatBits);
+  rb.write((uint8_t)digits);
+}
+
+/**
+ * Writes the MLG file header and the field descriptors. See SD_logger.h for the layout
+ * The first field is always the log time in ms, followed by one field for each entry in mlg_field_table
+ */
+void writeSDLogHeaderMLG()
+{
+  const uint16_t numFields = MLG_NUM_FIELDS + 1U;
+  binaryRecordCounter = 0;
+
+  rb.print("MLVLG");
+  rb.write((uint8_t)0);
+  writeMLGBigEndian16(MLG_FORMAT_VERSION);
+  writeMLGBigEndian32(0); //Timestamp. Unused
+  writeMLGBigEndian16(0); //No info data
+  writeMLGBigEndian32(MLG_HEADER_SIZE + (MLG_FIELD_HEADER_SIZE * numFields)); //Data begins immediately after the field headers
+  writeMLGBigEndian16(MLG_RECORD_LENGTH);
+  writeMLGBigEndian16(numFields);
+
+  writeMLGFieldHeader("Time", "s", MLG_TYPE_U32, MLG_STYLE_FLOAT, 0.001F, 0.0F, 3);
+
+  for(uint8_t x=0; x<MLG_NUM_FIELDS; x++)
+  {
+    mlg_field_t field;
+    char buffer[30];
+    uint8_t headerIndex = (x < MLG_UNUSED_HEADER) ? x : (x + 1U);
+
+    memcpy_P(&field, &mlg_field_table[x], sizeof(field));
+    #ifdef CORE_AVR
+      strcpy_P(buffer, (char *)pgm_read_word(&(header_table[headerIndex])));
+    #else
+      strcpy(buffer, header_table[headerIndex]);
+    #endif
+    writeMLGFieldHeader(buffer, field.units, field.type, field.style, field.scale, (float)field.transform, field.digits);
+  }
+}
+
+/**
+ * Called from the 1kHz section of the main loop. When a fast log rate is selected, this writes a log entry each time the logging interval has elapsed
+ */
+void writeSDLogEntryFast()
+{
+  if(isSDLogFastRateActive() == false) { return; }
+
+  uint8_t logInterval = 20; //50Hz
+  if(configPage13.onboard_log_fast_rate == LOGGER_FAST_RATE_100HZ) { logInterval = 10; }
+  else if(configPage13.onboard_log_fast_rate == LOGGER_FAST_RATE_200HZ) { logInterval = 5; }
+
+  if( (millis() - lastLogEntryTime) >= logInterval )
+  {
+    lastLogEntryTime = millis(); //Advanced in every state so that the start checks while the card is READY are also only run at the log rate
+    writeSDLogEntry();
+  }
+}
+
 //Sets the status variable for TunerStudio
 void setTS_SD_status()
 {
@@ -767,13 +1370,21 @@ void deleteLogFile(char log1, char log2, char log3, char log4)
   logFileName[6] = log3;
   logFileName[7] = log4;
   logFileName[8] = '.';
-  strcpy(logFileName + 9, LOG_FILE_EXTENSION);
-  //logFileName[8] = '\0';
 
-  if(sd.exists(logFileName))
+  //The file may have been created with any of the log file styles
+  for(uint8_t x = 0; x < _countof(logFileExtensions); x++)
   {
-    sd.remove(logFileName);
+    strcpy(logFileName + 9, logFileExtensions[x]);
+    if(sd.exists(logFileName))
+    {
+      sd.remove(logFileName);
+    }
   }
+
+  //Remove the matching tooth log, if there is one
+  memcpy(logFileName, TOOTH_LOG_FILE_PREFIX, 4);
+  strcpy(logFileName + 9, LOG_FILE_EXTENSION_BINARY);
+  if(sd.exists(logFileName)) { sd.remove(logFileName); }
 }
 
 // Call back for file timestamps.  Only called for file create and sync().
@@ -1,6 +1,8 @@
 #ifndef SD_LOGGER_H
 #define SD_LOGGER_H
 
+#include "globals.h"
+
 #ifdef SD_LOGGING
 
 #ifdef __SD_H__
@@ -42,7 +44,7 @@
 #endif
 
 #ifndef UNIT_TEST // Scope guard for unit testing
-  #define SD_LOG_ENTRY_SIZE   127 /**< The size of the live data packet used by the SD card.*/
+  #define SD_LOG_ENTRY_SIZE   155 /**< The size of the live data packet used by the SD card.*/
 #else
   #define SD_LOG_ENTRY_SIZE   1 /**< The size of the live data packet used by the SD card.*/
 #endif
@@ -52,7 +54,93 @@
 #define MAX_LOG_FILES     9999
 #define LOG_FILE_PREFIX "SPD_"
 #define LOG_FILE_EXTENSION "csv"
-#define RING_BUF_CAPACITY (SD_LOG_ENTRY_SIZE * 10) //Allow for 10 entries in the ringbuffer. Will need tuning
+#define LOG_FILE_EXTENSION_BINARY "bin"
+#define LOG_FILE_EXTENSION_MLG "mlg"
+#define RING_BUF_CAPACITY (SD_SECTOR_SIZE * 4) //Allow for 4 sectors in the ringbuffer. This gives the card time to complete a write while the fast (Binary) log rates keep adding entries
+
+/*
+Binary log format (onboard_log_file_style == LOGGER_BINARY)
+All multi-byte values are little endian. The file begins with a self describing header:
+  6 bytes  - Magic string "SPDLOG" (No terminator)
+  1 byte   - Format version (SD_LOG_BINARY_VERSION)
+  1 byte   - Number of fields (N)
+  2 bytes  - Length of each data record in bytes
+  N times  - 1 byte field descriptor (See SD_LOG_FIELD()), 1 byte name length and then the name characters from header_table (No terminator)
+Every data record that follows the header is:
+  1 byte   - SD_LOG_BINARY_RECORD_MARKER
+  1 byte   - Rolling record counter. Used to detect dropped records
+  4 bytes  - Time since the log was started in ms
+  x bytes  - The field values, 1 or 2 bytes each depending on the field descriptor
+  1 byte   - Checksum. The 8-bit sum of all preceding bytes in the record
+tools/sdlog_convert.py converts these files to CSV or MLG on the PC
+*/
+#define SD_LOG_BINARY_MAGIC         "SPDLOG"
+#define SD_LOG_BINARY_VERSION       1
+#define SD_LOG_BINARY_RECORD_MARKER 0xA5
+#define SD_LOG_BINARY_RECORD_OVERHEAD 7 /**< Marker, counter, timestamp and checksum bytes */
+
+#define SD_LOG_TYPE_U08   0
+#define SD_LOG_TYPE_S08   1
+#define SD_LOG_TYPE_U16   2
+#define SD_LOG_TYPE_S16   3
+
+#define SD_LOG_SCALE_1    0 //Value is stored as is
+#define SD_LOG_SCALE_2    1 //Stored value is divided by 2 to get the human readable value
+#define SD_LOG_SCALE_10   2 //Stored value is divided by 10 to get the human readable value
+#define SD_LOG_SCALE_1000 3 //Stored value is divided by 1000 to get the human readable value
+
+#define SD_LOG_FIELD(type, scale) ( ((type) << 4) | (scale) ) //Builds a field descriptor byte. Upper nibble is the type, lower nibble is the scale
+#define SD_LOG_FIELD_TYPE(desc)   ((desc) >> 4)
+#define SD_LOG_FIELD_SIZE(desc)   ((SD_LOG_FIELD_TYPE(desc) >= SD_LOG_TYPE_U16) ? 2U : 1U)
+
+/*
+MLG log format (onboard_log_file_style == LOGGER_MLG)
+This is the MegaLogViewer binary format (Version 1) and can be opened directly by MegaLogViewer and TunerStudio. All multi-byte values are big endian
+The header is generated once when the log starts:
+  22 bytes - "MLVLG\0", format version (U16), timestamp (U32), info data start (U16), data begin index (U32), record length (U16), number of fields (U16)
+  55 bytes per field - type (U8), name (34 chars), units (10 chars), display style (U8), scale (F32), transform (F32), digits (S8)
+Every data block that follows the header is:
+  1 byte   - Block type (MLG_BLOCK_TYPE_DATA)
+  1 byte   - Rolling block counter
+  2 bytes  - Timestamp in 10uS units (Wraps)
+  4 bytes  - Time since the log was started in ms (The "Time" field)
+  x bytes  - The getTSLogEntry() block, with 2 byte fields swapped to big endian
+  1 byte   - CRC. The 8-bit sum of the data bytes (Time field and log entry block)
+tools/mlg_validate.py can be used to check the output
+*/
+#define MLG_FORMAT_VERSION          1
+#define MLG_HEADER_SIZE             22
+#define MLG_FIELD_HEADER_SIZE       55
+#define MLG_FIELD_NAME_LENGTH       34
+#define MLG_FIELD_UNITS_LENGTH      10
+#define MLG_BLOCK_TYPE_DATA         0
+#define MLG_BLOCK_OVERHEAD          5 /**< Block type, counter, timestamp and CRC bytes */
+
+#define MLG_TYPE_U08    0
+#define MLG_TYPE_S08    1
+#define MLG_TYPE_U16    2
+#define MLG_TYPE_S16    3
+#define MLG_TYPE_U32    4
+
+#define MLG_STYLE_FLOAT 0
+#define MLG_STYLE_HEX   1
+
+/*
+Tooth log format (onboard_log_tooth != LOGGER_TOOTH_OFF)
+Written to TOOTH_LOG_FILE_PREFIX with the same number as the main log file. All multi-byte values are little endian
+  6 bytes  - Magic string "SPDTTH" (No terminator)
+  1 byte   - Format version (SD_TOOTH_LOG_VERSION)
+  1 byte   - Record size (SD_TOOTH_LOG_RECORD_SIZE)
+Every record that follows the header is:
+  4 bytes  - micros() when the edge occurred
+  1 byte   - Flags. Bits 0-5 are the same as the composite logger (COMPOSITE_LOG_*), bits 6-7 are the input the edge occurred on (TOOTH_CRANK etc)
+If the tooth ring overflowed, a record with flags of SD_TOOTH_LOG_OVERFLOW is written where the time value is the number of edges that were lost
+*/
+#define TOOTH_LOG_FILE_PREFIX       "TTH_"
+#define SD_TOOTH_LOG_MAGIC          "SPDTTH"
+#define SD_TOOTH_LOG_VERSION        1
+#define SD_TOOTH_LOG_RECORD_SIZE    5
+#define SD_TOOTH_LOG_OVERFLOW       0xFF
 
 /*
 Standard FAT16/32
@@ -71,6 +159,8 @@ extern bool manualLogActive;
 
 void initSD();
 void writeSDLogEntry();
+void writeSDLogEntryFast();
+void writeSDToothLog();
 void writetSDLogHeader();
 void beginSDLogging();
 void endSDLogging();
@@ -85,6 +175,13 @@ bool getSDLogFileDetails(uint8_t* , uint16_t);
 void readSDSectors(uint8_t*, uint32_t, uint16_t);
 uint32_t sectorCount();
 
+/**
+ * @brief Whether one of the fast log rates is selected and usable with the current file style (Binary or MLG, CSV is too slow to format). When true, entries are written by writeSDLogEntryFast() rather than at the onboard_log_file_rate
+ */
+static inline bool isSDLogFastRateActive(void)
+{
+  return (configPage13.onboard_log_fast_rate != LOGGER_FAST_RATE_OFF) && ( (configPage13.onboard_log_file_style == LOGGER_BINARY) || (configPage13.onboard_log_file_style == LOGGER_MLG) );
+}
 
 
 #endif //SD_LOGGING
@@ -302,7 +302,7 @@ bool TS_CommandButtonsHandler(uint16_t buttonCommand)
         else
         {
           //Calibrate the actual pulses per distance
-          uint32_t calibrationGap = vssGetPulseGap(0);
+          uint32_t calibrationGap = vssGetPulseGap();
           if( calibrationGap > 0 )
           {
             configPage2.vssPulsesPerKm = MICROS_PER_MIN / calibrationGap;
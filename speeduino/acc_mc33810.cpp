@@ -1,6 +1,7 @@
 #include "acc_mc33810.h"
 #include "globals.h"
 #include <SPI.h>
+#include <util/atomic.h>
 
 uint8_t MC33810_BIT_INJ1 = 1;
 uint8_t MC33810_BIT_INJ2 = 2;
@@ -25,6 +26,18 @@ volatile PINMASK_TYPE mc33810_1_pin_mask;
 volatile PORT_TYPE *mc33810_2_pin_port;
 volatile PINMASK_TYPE mc33810_2_pin_mask;
 
+volatile uint8_t mc33810_1_requestedState;
+volatile uint8_t mc33810_2_requestedState;
+volatile uint8_t mc33810_1_returnState;
+volatile uint8_t mc33810_2_returnState;
+
+static volatile uint8_t mc33810_sentState[2]; //The last state sent to each IC
+#if defined(MC33810_ASYNC)
+#define MC33810_IDLE 0xFFU
+static volatile uint8_t mc33810_activeIC = MC33810_IDLE; //The IC that the transfer in progress is for
+static volatile uint8_t mc33810_pendingICs; //Bit per IC that has had its requested state changed while the bus was busy
+#endif
+
 void initMC33810(void)
 {
     //Set pin port/masks
@@ -38,6 +51,8 @@ void initMC33810(void)
     mc33810_2_requestedState = 0;
     mc33810_1_returnState = 0;
     mc33810_2_returnState = 0;
+    mc33810_sentState[MC33810_IC1] = 0;
+    mc33810_sentState[MC33810_IC2] = 0;
 
     pinMode(pinMC33810_1_CS, OUTPUT);
     pinMode(pinMC33810_2_CS, OUTPUT);
@@ -62,5 +77,97 @@ void initMC33810(void)
     MC33810_2_ACTIVE();
     SPI.transfer16(cmd);
     MC33810_2_INACTIVE();
-    
-}
\ No newline at end of file
+
+#if defined(MC33810_ASYNC)
+    mc33810_activeIC = MC33810_IDLE;
+    mc33810_pendingICs = 0;
+    boardMC33810Init(); //From here on the ON/OFF commands are sent from the SPI interrupt
+#endif
+}
+
+static inline uint8_t mc33810RequestedState(uint8_t ic)
+{
+  return (ic == MC33810_IC1) ? mc33810_1_requestedState : mc33810_2_requestedState;
+}
+
+#if defined(MC33810_ASYNC)
+/*
+Starts the transfer of the next pending IC, if there is one whose requested state differs from what was last sent to it.
+The search starts from the IC after the one that was just sent so that one IC changing continuously cannot hold off the other.
+Must be called with interrupts disabled or from the SPI interrupt
+*/
+static void mc33810StartNext(void)
+{
+  uint8_t ic = (mc33810_activeIC == MC33810_IC1) ? MC33810_IC2 : MC33810_IC1;
+  mc33810_activeIC = MC33810_IDLE;
+
+  for(uint8_t x = 0; x < 2U; x++)
+  {
+    if(BIT_CHECK(mc33810_pendingICs, ic))
+    {
+      BIT_CLEAR(mc33810_pendingICs, ic);
+      uint8_t state = mc33810RequestedState(ic);
+      if(state != mc33810_sentState[ic])
+      {
+        mc33810_sentState[ic] = state;
+        mc33810_activeIC = ic;
+        if(ic == MC33810_IC1) { MC33810_1_ACTIVE(); }
+        else { MC33810_2_ACTIVE(); }
+        boardMC33810Transfer(word(MC33810_ONOFF_CMD, state));
+        return;
+      }
+    }
+    ic = (ic == MC33810_IC1) ? MC33810_IC2 : MC33810_IC1;
+  }
+}
+
+void mc33810Write(uint8_t ic)
+{
+  ATOMIC_BLOCK(ATOMIC_RESTORESTATE)
+  {
+    BIT_SET(mc33810_pendingICs, ic);
+    if(mc33810_activeIC == MC33810_IDLE) { mc33810StartNext(); }
+  }
+}
+
+void mc33810TransferComplete(uint16_t reply)
+{
+  if(mc33810_activeIC == MC33810_IC1)
+  {
+    MC33810_1_INACTIVE();
+    mc33810_1_returnState = lowByte(reply);
+  }
+  else
+  {
+    MC33810_2_INACTIVE();
+    mc33810_2_returnState = lowByte(reply);
+  }
+  mc33810StartNext();
+}
+
+#else
+void mc33810Write(uint8_t ic)
+{
+  //The outputs are switched from both the schedule interrupts and the main loop. An interrupt between the read of the requested state and the transfer
+  //would send its own state and then have it overwritten with the older one, so the whole write is done with interrupts off
+  ATOMIC_BLOCK(ATOMIC_RESTORESTATE)
+  {
+    uint8_t state = mc33810RequestedState(ic);
+    if(state == mc33810_sentState[ic]) { return; } //Eg closing an injector that is already closed
+    mc33810_sentState[ic] = state;
+
+    if(ic == MC33810_IC1)
+    {
+      MC33810_1_ACTIVE();
+      mc33810_1_returnState = lowByte(SPI.transfer16(word(MC33810_ONOFF_CMD, state)));
+      MC33810_1_INACTIVE();
+    }
+    else
+    {
+      MC33810_2_ACTIVE();
+      mc33810_2_returnState = lowByte(SPI.transfer16(word(MC33810_ONOFF_CMD, state)));
+      MC33810_2_INACTIVE();
+    }
+  }
+}
+#endif
@@ -12,12 +12,24 @@ extern volatile PINMASK_TYPE mc33810_2_pin_mask;
 
 //#define MC33810_ONOFF_CMD   3
 static const uint8_t MC33810_ONOFF_CMD = 0x30; //48 in decimal
-static volatile uint8_t mc33810_1_requestedState; //Current binary state of the 1st ICs IGN and INJ values
-static volatile uint8_t mc33810_2_requestedState; //Current binary state of the 2nd ICs IGN and INJ values
-static volatile uint8_t mc33810_1_returnState; //Current binary state of the 1st ICs IGN and INJ values
-static volatile uint8_t mc33810_2_returnState; //Current binary state of the 2nd ICs IGN and INJ values
+extern volatile uint8_t mc33810_1_requestedState; //Current binary state of the 1st ICs IGN and INJ values
+extern volatile uint8_t mc33810_2_requestedState; //Current binary state of the 2nd ICs IGN and INJ values
+extern volatile uint8_t mc33810_1_returnState; //Current binary state of the 1st ICs IGN and INJ values
+extern volatile uint8_t mc33810_2_returnState; //Current binary state of the 2nd ICs IGN and INJ values
+
+#define MC33810_IC1 0U
+#define MC33810_IC2 1U
 
 void initMC33810(void);
+/*
+Send the requested state of an IC to it. Nothing is sent if the IC already has that state.
+On boards that define MC33810_ASYNC the transfer does not block. If a transfer is already in progress the IC is marked as pending and is sent once the bus is free,
+with all of the changes that have been made to its requested state by then merged into the one transfer
+*/
+void mc33810Write(uint8_t ic);
+#if defined(MC33810_ASYNC)
+void mc33810TransferComplete(uint16_t reply); //Called by the board from the SPI interrupt when the transfer started by boardMC33810Transfer() has finished
+#endif
 
 #define MC33810_1_ACTIVE() (*mc33810_1_pin_port &= ~(mc33810_1_pin_mask))
 #define MC33810_1_INACTIVE() (*mc33810_1_pin_port |= (mc33810_1_pin_mask))
@@ -44,60 +56,60 @@ extern uint8_t MC33810_BIT_IGN6;
 extern uint8_t MC33810_BIT_IGN7;
 extern uint8_t MC33810_BIT_IGN8;
 
-#define openInjector1_MC33810() MC33810_1_ACTIVE(); BIT_SET(mc33810_1_requestedState, MC33810_BIT_INJ1); mc33810_1_returnState = SPI.transfer16(word(MC33810_ONOFF_CMD, mc33810_1_requestedState)); MC33810_1_INACTIVE()
-#define openInjector2_MC33810() MC33810_1_ACTIVE(); BIT_SET(mc33810_1_requestedState, MC33810_BIT_INJ2); mc33810_1_returnState = SPI.transfer16(word(MC33810_ONOFF_CMD, mc33810_1_requestedState)); MC33810_1_INACTIVE()
-#define openInjector3_MC33810() MC33810_1_ACTIVE(); BIT_SET(mc33810_1_requestedState, MC33810_BIT_INJ3); mc33810_1_returnState = SPI.transfer16(word(MC33810_ONOFF_CMD, mc33810_1_requestedState)); MC33810_1_INACTIVE()
-#define openInjector4_MC33810() MC33810_1_ACTIVE(); BIT_SET(mc33810_1_requestedState, MC33810_BIT_INJ4); mc33810_1_returnState = SPI.transfer16(word(MC33810_ONOFF_CMD, mc33810_1_requestedState)); MC33810_1_INACTIVE()
-#define openInjector5_MC33810() MC33810_2_ACTIVE(); BIT_SET(mc33810_2_requestedState, MC33810_BIT_INJ5); mc33810_2_returnState = SPI.transfer16(word(MC33810_ONOFF_CMD, mc33810_2_requestedState)); MC33810_2_INACTIVE()
-#define openInjector6_MC33810() MC33810_2_ACTIVE(); BIT_SET(mc33810_2_requestedState, MC33810_BIT_INJ6); mc33810_2_returnState = SPI.transfer16(word(MC33810_ONOFF_CMD, mc33810_2_requestedState)); MC33810_2_INACTIVE()
-#define openInjector7_MC33810() MC33810_2_ACTIVE(); BIT_SET(mc33810_2_requestedState, MC33810_BIT_INJ7); mc33810_2_returnState = SPI.transfer16(word(MC33810_ONOFF_CMD, mc33810_2_requestedState)); MC33810_2_INACTIVE()
-#define openInjector8_MC33810() MC33810_2_ACTIVE(); BIT_SET(mc33810_2_requestedState, MC33810_BIT_INJ8); mc33810_2_returnState = SPI.transfer16(word(MC33810_ONOFF_CMD, mc33810_2_requestedState)); MC33810_2_INACTIVE()
+#define openInjector1_MC33810() BIT_SET(mc33810_1_requestedState, MC33810_BIT_INJ1); mc33810Write(MC33810_IC1)
+#define openInjector2_MC33810() BIT_SET(mc33810_1_requestedState, MC33810_BIT_INJ2); mc33810Write(MC33810_IC1)
+#define openInjector3_MC33810() BIT_SET(mc33810_1_requestedState, MC33810_BIT_INJ3); mc33810Write(MC33810_IC1)
+#define openInjector4_MC33810() BIT_SET(mc33810_1_requestedState, MC33810_BIT_INJ4); mc33810Write(MC33810_IC1)
+#define openInjector5_MC33810() BIT_SET(mc33810_2_requestedState, MC33810_BIT_INJ5); mc33810Write(MC33810_IC2)
+#define openInjector6_MC33810() BIT_SET(mc33810_2_requestedState, MC33810_BIT_INJ6); mc33810Write(MC33810_IC2)
+#define openInjector7_MC33810() BIT_SET(mc33810_2_requestedState, MC33810_BIT_INJ7); mc33810Write(MC33810_IC2)
+#define openInjector8_MC33810() BIT_SET(mc33810_2_requestedState, MC33810_BIT_INJ8); mc33810Write(MC33810_IC2)
 
-#define closeInjector1_MC33810() MC33810_1_ACTIVE(); BIT_CLEAR(mc33810_1_requestedState, MC33810_BIT_INJ1); mc33810_1_returnState = SPI.transfer16(word(MC33810_ONOFF_CMD, mc33810_1_requestedState)); MC33810_1_INACTIVE()
-#define closeInjector2_MC33810() MC33810_1_ACTIVE(); BIT_CLEAR(mc33810_1_requestedState, MC33810_BIT_INJ2); mc33810_1_returnState = SPI.transfer16(word(MC33810_ONOFF_CMD, mc33810_1_requestedState)); MC33810_1_INACTIVE()
-#define closeInjector3_MC33810() MC33810_1_ACTIVE(); BIT_CLEAR(mc33810_1_requestedState, MC33810_BIT_INJ3); mc33810_1_returnState = SPI.transfer16(word(MC33810_ONOFF_CMD, mc33810_1_requestedState)); MC33810_1_INACTIVE()
-#define closeInjector4_MC33810() MC33810_1_ACTIVE(); BIT_CLEAR(mc33810_1_requestedState, MC33810_BIT_INJ4); mc33810_1_returnState = SPI.transfer16(word(MC33810_ONOFF_CMD, mc33810_1_requestedState)); MC33810_1_INACTIVE()
-#define closeInjector5_MC33810() MC33810_2_ACTIVE(); BIT_CLEAR(mc33810_2_requestedState, MC33810_BIT_INJ5); mc33810_2_returnState = SPI.transfer16(word(MC33810_ONOFF_CMD, mc33810_2_requestedState)); MC33810_2_INACTIVE()
-#define closeInjector6_MC33810() MC33810_2_ACTIVE(); BIT_CLEAR(mc33810_2_requestedState, MC33810_BIT_INJ6); mc33810_2_returnState = SPI.transfer16(word(MC33810_ONOFF_CMD, mc33810_2_requestedState)); MC33810_2_INACTIVE()
-#define closeInjector7_MC33810() MC33810_2_ACTIVE(); BIT_CLEAR(mc33810_2_requestedState, MC33810_BIT_INJ7); mc33810_2_returnState = SPI.transfer16(word(MC33810_ONOFF_CMD, mc33810_2_requestedState)); MC33810_2_INACTIVE()
-#define closeInjector8_MC33810() MC33810_2_ACTIVE(); BIT_CLEAR(mc33810_2_requestedState, MC33810_BIT_INJ8); mc33810_2_returnState = SPI.transfer16(word(MC33810_ONOFF_CMD, mc33810_2_requestedState)); MC33810_2_INACTIVE()
+#define closeInjector1_MC33810() BIT_CLEAR(mc33810_1_requestedState, MC33810_BIT_INJ1); mc33810Write(MC33810_IC1)
+#define closeInjector2_MC33810() BIT_CLEAR(mc33810_1_requestedState, MC33810_BIT_INJ2); mc33810Write(MC33810_IC1)
+#define closeInjector3_MC33810() BIT_CLEAR(mc33810_1_requestedState, MC33810_BIT_INJ3); mc33810Write(MC33810_IC1)
+#define closeInjector4_MC33810() BIT_CLEAR(mc33810_1_requestedState, MC33810_BIT_INJ4); mc33810Write(MC33810_IC1)
+#define closeInjector5_MC33810() BIT_CLEAR(mc33810_2_requestedState, MC33810_BIT_INJ5); mc33810Write(MC33810_IC2)
+#define closeInjector6_MC33810() BIT_CLEAR(mc33810_2_requestedState, MC33810_BIT_INJ6); mc33810Write(MC33810_IC2)
+#define closeInjector7_MC33810() BIT_CLEAR(mc33810_2_requestedState, MC33810_BIT_INJ7); mc33810Write(MC33810_IC2)
+#define closeInjector8_MC33810() BIT_CLEAR(mc33810_2_requestedState, MC33810_BIT_INJ8); mc33810Write(MC33810_IC2)
 
-#define injector1Toggle_MC33810() MC33810_1_ACTIVE(); BIT_TOGGLE(mc33810_1_requestedState, MC33810_BIT_INJ1); mc33810_1_returnState = SPI.transfer16(word(MC33810_ONOFF_CMD, mc33810_1_requestedState)); MC33810_1_INACTIVE()
-#define injector2Toggle_MC33810() MC33810_1_ACTIVE(); BIT_TOGGLE(mc33810_1_requestedState, MC33810_BIT_INJ2); mc33810_1_returnState = SPI.transfer16(word(MC33810_ONOFF_CMD, mc33810_1_requestedState)); MC33810_1_INACTIVE()
-#define injector3Toggle_MC33810() MC33810_1_ACTIVE(); BIT_TOGGLE(mc33810_1_requestedState, MC33810_BIT_INJ3); mc33810_1_returnState = SPI.transfer16(word(MC33810_ONOFF_CMD, mc33810_1_requestedState)); MC33810_1_INACTIVE()
-#define injector4Toggle_MC33810() MC33810_1_ACTIVE(); BIT_TOGGLE(mc33810_1_requestedState, MC33810_BIT_INJ4); mc33810_1_returnState = SPI.transfer16(word(MC33810_ONOFF_CMD, mc33810_1_requestedState)); MC33810_1_INACTIVE()
-#define injector5Toggle_MC33810() MC33810_2_ACTIVE(); BIT_TOGGLE(mc33810_2_requestedState, MC33810_BIT_INJ5); mc33810_2_returnState = SPI.transfer16(word(MC33810_ONOFF_CMD, mc33810_2_requestedState)); MC33810_2_INACTIVE()
-#define injector6Toggle_MC33810() MC33810_2_ACTIVE(); BIT_TOGGLE(mc33810_2_requestedState, MC33810_BIT_INJ6); mc33810_2_returnState = SPI.transfer16(word(MC33810_ONOFF_CMD, mc33810_2_requestedState)); MC33810_2_INACTIVE()
-#define injector7Toggle_MC33810() MC33810_2_ACTIVE(); BIT_TOGGLE(mc33810_2_requestedState, MC33810_BIT_INJ7); mc33810_2_returnState = SPI.transfer16(word(MC33810_ONOFF_CMD, mc33810_2_requestedState)); MC33810_2_INACTIVE()
-#define injector8Toggle_MC33810() MC33810_2_ACTIVE(); BIT_TOGGLE(mc33810_2_requestedState, MC33810_BIT_INJ8); mc33810_2_returnState = SPI.transfer16(word(MC33810_ONOFF_CMD, mc33810_2_requestedState)); MC33810_2_INACTIVE()
+#define injector1Toggle_MC33810() BIT_TOGGLE(mc33810_1_requestedState, MC33810_BIT_INJ1); mc33810Write(MC33810_IC1)
+#define injector2Toggle_MC33810() BIT_TOGGLE(mc33810_1_requestedState, MC33810_BIT_INJ2); mc33810Write(MC33810_IC1)
+#define injector3Toggle_MC33810() BIT_TOGGLE(mc33810_1_requestedState, MC33810_BIT_INJ3); mc33810Write(MC33810_IC1)
+#define injector4Toggle_MC33810() BIT_TOGGLE(mc33810_1_requestedState, MC33810_BIT_INJ4); mc33810Write(MC33810_IC1)
+#define injector5Toggle_MC33810() BIT_TOGGLE(mc33810_2_requestedState, MC33810_BIT_INJ5); mc33810Write(MC33810_IC2)
+#define injector6Toggle_MC33810() BIT_TOGGLE(mc33810_2_requestedState, MC33810_BIT_INJ6); mc33810Write(MC33810_IC2)
+#define injector7Toggle_MC33810() BIT_TOGGLE(mc33810_2_requestedState, MC33810_BIT_INJ7); mc33810Write(MC33810_IC2)
+#define injector8Toggle_MC33810() BIT_TOGGLE(mc33810_2_requestedState, MC33810_BIT_INJ8); mc33810Write(MC33810_IC2)
 
-#define coil1High_MC33810() MC33810_1_ACTIVE(); BIT_SET(mc33810_1_requestedState, MC33810_BIT_IGN1); mc33810_1_returnState = SPI.transfer16(word(MC33810_ONOFF_CMD, mc33810_1_requestedState)); MC33810_1_INACTIVE()
-#define coil2High_MC33810() MC33810_1_ACTIVE(); BIT_SET(mc33810_1_requestedState, MC33810_BIT_IGN2); mc33810_1_returnState = SPI.transfer16(word(MC33810_ONOFF_CMD, mc33810_1_requestedState)); MC33810_1_INACTIVE()
+#define coil1High_MC33810() BIT_SET(mc33810_1_requestedState, MC33810_BIT_IGN1); mc33810Write(MC33810_IC1)
+#define coil2High_MC33810() BIT_SET(mc33810_1_requestedState, MC33810_BIT_IGN2); mc33810Write(MC33810_IC1)
 //#define coil1High_MC33810() MC33810_1_ACTIVE(); BIT_SET(mc33810_1_requestedState, MC33810_BIT_IGN1); MC33810_1_INACTIVE()
 //#define coil2High_MC33810() MC33810_1_ACTIVE(); BIT_SET(mc33810_1_requestedState, MC33810_BIT_IGN2); MC33810_1_INACTIVE()
-#define coil3High_MC33810() MC33810_1_ACTIVE(); BIT_SET(mc33810_1_requestedState, MC33810_BIT_IGN3); mc33810_1_returnState = SPI.transfer16(word(MC33810_ONOFF_CMD, mc33810_1_requestedState)); MC33810_1_INACTIVE()
-#define coil4High_MC33810() MC33810_1_ACTIVE(); BIT_SET(mc33810_1_requestedState, MC33810_BIT_IGN4); mc33810_1_returnState = SPI.transfer16(word(MC33810_ONOFF_CMD, mc33810_1_requestedState)); MC33810_1_INACTIVE()
-#define coil5High_MC33810() MC33810_2_ACTIVE(); BIT_SET(mc33810_2_requestedState, MC33810_BIT_IGN5); mc33810_2_returnState = SPI.transfer16(word(MC33810_ONOFF_CMD, mc33810_2_requestedState)); MC33810_2_INACTIVE()
-#define coil6High_MC33810() MC33810_2_ACTIVE(); BIT_SET(mc33810_2_requestedState, MC33810_BIT_IGN6); mc33810_2_returnState = SPI.transfer16(word(MC33810_ONOFF_CMD, mc33810_2_requestedState)); MC33810_2_INACTIVE()
-#define coil7High_MC33810() MC33810_2_ACTIVE(); BIT_SET(mc33810_2_requestedState, MC33810_BIT_IGN7); mc33810_2_returnState = SPI.transfer16(word(MC33810_ONOFF_CMD, mc33810_2_requestedState)); MC33810_2_INACTIVE()
-#define coil8High_MC33810() MC33810_2_ACTIVE(); BIT_SET(mc33810_2_requestedState, MC33810_BIT_IGN8); mc33810_2_returnState = SPI.transfer16(word(MC33810_ONOFF_CMD, mc33810_2_requestedState)); MC33810_2_INACTIVE()
+#define coil3High_MC33810() BIT_SET(mc33810_1_requestedState, MC33810_BIT_IGN3); mc33810Write(MC33810_IC1)
+#define coil4High_MC33810() BIT_SET(mc33810_1_requestedState, MC33810_BIT_IGN4); mc33810Write(MC33810_IC1)
+#define coil5High_MC33810() BIT_SET(mc33810_2_requestedState, MC33810_BIT_IGN5); mc33810Write(MC33810_IC2)
+#define coil6High_MC33810() BIT_SET(mc33810_2_requestedState, MC33810_BIT_IGN6); mc33810Write(MC33810_IC2)
+#define coil7High_MC33810() BIT_SET(mc33810_2_requestedState, MC33810_BIT_IGN7); mc33810Write(MC33810_IC2)
+#define coil8High_MC33810() BIT_SET(mc33810_2_requestedState, MC33810_BIT_IGN8); mc33810Write(MC33810_IC2)
 
-#define coil1Low_MC33810() MC33810_1_ACTIVE(); BIT_CLEAR(mc33810_1_requestedState, MC33810_BIT_IGN1); mc33810_1_returnState = SPI.transfer16(word(MC33810_ONOFF_CMD, mc33810_1_requestedState)); MC33810_1_INACTIVE()
-#define coil2Low_MC33810() MC33810_1_ACTIVE(); BIT_CLEAR(mc33810_1_requestedState, MC33810_BIT_IGN2); mc33810_1_returnState = SPI.transfer16(word(MC33810_ONOFF_CMD, mc33810_1_requestedState)); MC33810_1_INACTIVE()
-#define coil3Low_MC33810() MC33810_1_ACTIVE(); BIT_CLEAR(mc33810_1_requestedState, MC33810_BIT_IGN3); mc33810_1_returnState = SPI.transfer16(word(MC33810_ONOFF_CMD, mc33810_1_requestedState)); MC33810_1_INACTIVE()
-#define coil4Low_MC33810() MC33810_1_ACTIVE(); BIT_CLEAR(mc33810_1_requestedState, MC33810_BIT_IGN4); mc33810_1_returnState = SPI.transfer16(word(MC33810_ONOFF_CMD, mc33810_1_requestedState)); MC33810_1_INACTIVE()
-#define coil5Low_MC33810() MC33810_2_ACTIVE(); BIT_CLEAR(mc33810_2_requestedState, MC33810_BIT_IGN5); mc33810_2_returnState = SPI.transfer16(word(MC33810_ONOFF_CMD, mc33810_2_requestedState)); MC33810_2_INACTIVE()
-#define coil6Low_MC33810() MC33810_2_ACTIVE(); BIT_CLEAR(mc33810_2_requestedState, MC33810_BIT_IGN6); mc33810_2_returnState = SPI.transfer16(word(MC33810_ONOFF_CMD, mc33810_2_requestedState)); MC33810_2_INACTIVE()
-#define coil7Low_MC33810() MC33810_2_ACTIVE(); BIT_CLEAR(mc33810_2_requestedState, MC33810_BIT_IGN7); mc33810_2_returnState = SPI.transfer16(word(MC33810_ONOFF_CMD, mc33810_2_requestedState)); MC33810_2_INACTIVE()
-#define coil8Low_MC33810() MC33810_2_ACTIVE(); BIT_CLEAR(mc33810_2_requestedState, MC33810_BIT_IGN8); mc33810_2_returnState = SPI.transfer16(word(MC33810_ONOFF_CMD, mc33810_2_requestedState)); MC33810_2_INACTIVE()
+#define coil1Low_MC33810() BIT_CLEAR(mc33810_1_requestedState, MC33810_BIT_IGN1); mc33810Write(MC33810_IC1)
+#define coil2Low_MC33810() BIT_CLEAR(mc33810_1_requestedState, MC33810_BIT_IGN2); mc33810Write(MC33810_IC1)
+#define coil3Low_MC33810() BIT_CLEAR(mc33810_1_requestedState, MC33810_BIT_IGN3); mc33810Write(MC33810_IC1)
+#define coil4Low_MC33810() BIT_CLEAR(mc33810_1_requestedState, MC33810_BIT_IGN4); mc33810Write(MC33810_IC1)
+#define coil5Low_MC33810() BIT_CLEAR(mc33810_2_requestedState, MC33810_BIT_IGN5); mc33810Write(MC33810_IC2)
+#define coil6Low_MC33810() BIT_CLEAR(mc33810_2_requestedState, MC33810_BIT_IGN6); mc33810Write(MC33810_IC2)
+#define coil7Low_MC33810() BIT_CLEAR(mc33810_2_requestedState, MC33810_BIT_IGN7); mc33810Write(MC33810_IC2)
+#define coil8Low_MC33810() BIT_CLEAR(mc33810_2_requestedState, MC33810_BIT_IGN8); mc33810Write(MC33810_IC2)
 
-#define coil1Toggle_MC33810() MC33810_1_ACTIVE(); BIT_TOGGLE(mc33810_1_requestedState, MC33810_BIT_IGN1); mc33810_1_returnState = SPI.transfer16(word(MC33810_ONOFF_CMD, mc33810_1_requestedState)); MC33810_1_INACTIVE()
-#define coil2Toggle_MC33810() MC33810_1_ACTIVE(); BIT_TOGGLE(mc33810_1_requestedState, MC33810_BIT_IGN2); mc33810_1_returnState = SPI.transfer16(word(MC33810_ONOFF_CMD, mc33810_1_requestedState)); MC33810_1_INACTIVE()
-#define coil3Toggle_MC33810() MC33810_1_ACTIVE(); BIT_TOGGLE(mc33810_1_requestedState, MC33810_BIT_IGN3); mc33810_1_returnState = SPI.transfer16(word(MC33810_ONOFF_CMD, mc33810_1_requestedState)); MC33810_1_INACTIVE()
-#define coil4Toggle_MC33810() MC33810_1_ACTIVE(); BIT_TOGGLE(mc33810_1_requestedState, MC33810_BIT_IGN4); mc33810_1_returnState = SPI.transfer16(word(MC33810_ONOFF_CMD, mc33810_1_requestedState)); MC33810_1_INACTIVE()
-#define coil5Toggle_MC33810() MC33810_2_ACTIVE(); BIT_TOGGLE(mc33810_2_requestedState, MC33810_BIT_IGN5); mc33810_2_returnState = SPI.transfer16(word(MC33810_ONOFF_CMD, mc33810_2_requestedState)); MC33810_2_INACTIVE()
-#define coil6Toggle_MC33810() MC33810_2_ACTIVE(); BIT_TOGGLE(mc33810_2_requestedState, MC33810_BIT_IGN6); mc33810_2_returnState = SPI.transfer16(word(MC33810_ONOFF_CMD, mc33810_2_requestedState)); MC33810_2_INACTIVE()
-#define coil7Toggle_MC33810() MC33810_2_ACTIVE(); BIT_TOGGLE(mc33810_2_requestedState, MC33810_BIT_IGN7); mc33810_2_returnState = SPI.transfer16(word(MC33810_ONOFF_CMD, mc33810_2_requestedState)); MC33810_2_INACTIVE()
-#define coil8Toggle_MC33810() MC33810_2_ACTIVE(); BIT_TOGGLE(mc33810_2_requestedState, MC33810_BIT_IGN8); mc33810_2_returnState = SPI.transfer16(word(MC33810_ONOFF_CMD, mc33810_2_requestedState)); MC33810_2_INACTIVE()
+#define coil1Toggle_MC33810() BIT_TOGGLE(mc33810_1_requestedState, MC33810_BIT_IGN1); mc33810Write(MC33810_IC1)
+#define coil2Toggle_MC33810() BIT_TOGGLE(mc33810_1_requestedState, MC33810_BIT_IGN2); mc33810Write(MC33810_IC1)
+#define coil3Toggle_MC33810() BIT_TOGGLE(mc33810_1_requestedState, MC33810_BIT_IGN3); mc33810Write(MC33810_IC1)
+#define coil4Toggle_MC33810() BIT_TOGGLE(mc33810_1_requestedState, MC33810_BIT_IGN4); mc33810Write(MC33810_IC1)
+#define coil5Toggle_MC33810() BIT_TOGGLE(mc33810_2_requestedState, MC33810_BIT_IGN5); mc33810Write(MC33810_IC2)
+#define coil6Toggle_MC33810() BIT_TOGGLE(mc33810_2_requestedState, MC33810_BIT_IGN6); mc33810Write(MC33810_IC2)
+#define coil7Toggle_MC33810() BIT_TOGGLE(mc33810_2_requestedState, MC33810_BIT_IGN7); mc33810Write(MC33810_IC2)
+#define coil8Toggle_MC33810() BIT_TOGGLE(mc33810_2_requestedState, MC33810_BIT_IGN8); mc33810Write(MC33810_IC2)
 
 #endif
\ No newline at end of file
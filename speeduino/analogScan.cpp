@@ -0,0 +1,106 @@
+/*
+Speeduino - Simple engine management for the Arduino Mega 2560 platform
+Copyright (C) Josh Stewart
+A full copy of the license may be found in the projects root directory
+*/
+/** @file
+ * Board independent part of the DMA analog scan, see analogScan.h
+ */
+#include "globals.h"
+#include "analogScan.h"
+#include BOARD_H
+
+#if defined(ANALOG_DMA)
+
+static uint8_t scanPins[ANALOG_SCAN_MAX_CHANNELS];
+static uint8_t scanShifts[ANALOG_SCAN_MAX_CHANNELS];
+static uint8_t scanChannels = 0;
+//Both halves of the DMA buffer. The samples are in scan order, ie channel 0 to scanChannels-1 of the 1st scan, then of the 2nd scan and so on
+static volatile uint16_t scanBuffer[2U * ANALOG_SCAN_OVERSAMPLE * ANALOG_SCAN_MAX_CHANNELS];
+static volatile uint16_t scanResults[ANALOG_SCAN_MAX_CHANNELS];
+
+/** Remove all of the inputs from the scan. The scan must be restarted with analogScanBegin() */
+void analogScanReset(void)
+{
+  scanChannels = 0;
+}
+
+/**
+ * Add an analog input to the scan. Must be called before analogScanBegin(). Adding a pin that is already in the scan only updates its oversampling
+ * @param pin
+ * @param oversampleShift log2 of the number of scans that are averaged for this input, from 0 to ANALOG_SCAN_OVERSAMPLE_SHIFT
+ * @return false if the scan is full (The pin then reads as 0) or the pin cannot be scanned (The pin is then read with analogRead() by analogScanRead())
+ */
+bool analogScanAttach(uint8_t pin, uint8_t oversampleShift)
+{
+  if(boardADCScanPinValid(pin) == false) { return false; }
+  if(oversampleShift > ANALOG_SCAN_OVERSAMPLE_SHIFT) { oversampleShift = ANALOG_SCAN_OVERSAMPLE_SHIFT; }
+  for(uint8_t x = 0; x < scanChannels; x++)
+  {
+    if(scanPins[x] == pin)
+    {
+      scanShifts[x] = oversampleShift;
+      return true;
+    }
+  }
+  if(scanChannels >= ANALOG_SCAN_MAX_CHANNELS) { return false; }
+
+  scanPins[scanChannels] = pin;
+  scanShifts[scanChannels] = oversampleShift;
+  scanResults[scanChannels] = 0;
+  scanChannels++;
+  return true;
+}
+
+/**
+ * Start the scan of all the attached inputs. The first results are available after the first half of the buffer has been filled (Under 1ms)
+ * @return false if the board could not start the scan ). The sensors will read 0 in this case
+ */
+bool analogScanBegin(void)
+{
+  if(scanChannels == 0U) { return false; }
+  return boardADCScanStart(scanPins, scanChannels, scanBuffer, 2U * ANALOG_SCAN_OVERSAMPLE * scanChannels);
+}
+
+/**
+ * The latest result of an input, scaled to ANALOG_SCAN_RESULT_BITS.
+ * Pins that the board cannot scan (eg they are only on ADC2/3) are read with analogRead(), which uses an ADC that the scan does not.
+ * Returns 0 for a scannable pin that is not in the scan (The scan was full)
+ */
+uint16_t analogScanRead(uint8_t pin)
+{
+  for(uint8_t x = 0; x < scanChannels; x++)
+  {
+    if(scanPins[x] == pin) { return scanResults[x]; }
+  }
+  if(boardADCScanPinValid(pin) == false)
+  {
+    analogRead(pin); //Discard the first reading after switching channel, as the direct reads in sensors.cpp do
+    return analogRead(pin);
+  }
+  return 0;
+}
+
+/**
+ * Called by the board from the DMA interrupt each time half of the buffer has been filled.
+ * Each channel is the average of its most recent (1 << oversampleShift) samples in the half
+ * @param samples Start of the half of the buffer that has just been filled
+ */
+void analogScanProcess(const volatile uint16_t *samples)
+{
+  for(uint8_t channel = 0; channel < scanChannels; channel++)
+  {
+    uint8_t shift = scanShifts[channel];
+    uint8_t count = (uint8_t)(1U << shift);
+    const volatile uint16_t *sample = samples + ((ANALOG_SCAN_OVERSAMPLE - count) * scanChannels) + channel;
+    uint32_t sum = 0;
+    for(uint8_t x = 0; x < count; x++)
+    {
+      sum += *sample;
+      sample += scanChannels;
+    }
+    scanResults[channel] = (uint16_t)(sum >> (shift + (ANALOG_SCAN_ADC_BITS - ANALOG_SCAN_RESULT_BITS)));
+  }
+}
+
+#endif
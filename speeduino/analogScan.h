@@ -0,0 +1,40 @@
+/** \file analogScan.h
+ * @brief Continuous DMA scan of the analog inputs on the 32 bit boards
+ *
+ * All of the analog inputs in use are added with analogScanAttach() and then the board's ADC converts them continuously in scan mode,
+ * with DMA into a circular buffer that holds 2 halves of ANALOG_SCAN_OVERSAMPLE scans each. Each time the DMA finishes a half the board calls analogScanProcess()
+ * with it (While the DMA fills the other half), which averages the most recent scans of each channel in one pass and stores the result.
+ * The number of scans averaged (Oversampling / decimation) is set per channel, so that MAP can stay fast while the slow sensors get more noise reduction.
+ *
+ * Reading a sensor (analogScanRead()) is then just a memory read instead of 1 or 2 blocking analogRead() calls.
+ * The results are scaled to 10 bits so that all of the existing calibrations and filters work unchanged.
+ *
+ * Enabled by the board defining ANALOG_DMA and providing boardADCScanPinValid() and boardADCScanStart(). No other code may use the scanned ADC while the scan is running,
+ * inputs that are on other ADCs only are read with analogRead() instead. On the STM32F4 boards this is opt in with the USE_ANALOG_DMA build flag (See the black_F407VE-analogdma env).
+ */
+#ifndef ANALOGSCAN_H
+#define ANALOGSCAN_H
+
+#include "globals.h"
+
+#if defined(ANALOG_DMA)
+
+#define ANALOG_SCAN_MAX_CHANNELS      16U
+#define ANALOG_SCAN_OVERSAMPLE_SHIFT  3U /**< log2 of the number of scans in each half of the buffer */
+#define ANALOG_SCAN_OVERSAMPLE        (1U << ANALOG_SCAN_OVERSAMPLE_SHIFT)
+#define ANALOG_SCAN_ADC_BITS          12U /**< Resolution of the board's ADC */
+#define ANALOG_SCAN_RESULT_BITS       10U /**< Resolution of the results, which is what the sensor code expects */
+
+#define ANALOG_SCAN_FAST              1U /**< Oversampling shift for inputs that need to respond quickly (MAP) */
+#define ANALOG_SCAN_MEDIUM            2U /**< TPS */
+#define ANALOG_SCAN_SLOW              ANALOG_SCAN_OVERSAMPLE_SHIFT /**< Temperatures, battery, pressures etc. Averages every scan in the half buffer */
+
+void analogScanReset(void);
+bool analogScanAttach(uint8_t pin, uint8_t oversampleShift);
+bool analogScanBegin(void);
+uint16_t analogScanRead(uint8_t pin);
+void analogScanProcess(const volatile uint16_t *samples);
+
+#endif
+
+#endif
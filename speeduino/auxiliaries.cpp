@@ -6,9 +6,12 @@ A full copy of the license may be found in the projects root directory
 #include "globals.h"
 #include "auxiliaries.h"
 #include "maths.h"
-#include "src/PID_v1/PID_v1.h"
+#include "src/PID/fixedPID.h"
 #include "decoders.h"
 #include "timers.h"
+#include "softPWM.h"
+#include "utilities.h"
+#include "camSamples.h"
 
 static long vvt1_pwm_value;
 static long vvt2_pwm_value;
@@ -18,6 +21,8 @@ static long vvt_pid_target_angle;
 static long vvt2_pid_target_angle;
 static long vvt_pid_current_angle;
 static long vvt2_pid_current_angle;
+static long boost_pid_target; //The boost target and duty are not longs, so are copied to/from these for the PID
+static long boost_pid_duty;
 volatile bool vvt1_pwm_state;
 volatile bool vvt2_pwm_state;
 volatile bool vvt1_max_pwm;
@@ -25,6 +30,9 @@ volatile bool vvt2_max_pwm;
 volatile char nextVVT;
 byte boostCounter;
 byte vvtCounter;
+static bool vvt1EdgeRun; //Set by vvtControl() when the VVT1 PID is to be computed by vvtEdgeControl()
+static bool vvt2EdgeRun;
+static uint32_t vvtLastSampleTime[CAM_SAMPLE_CAMS]; //micros() at the last cam edge a PID step was run for, 0 if the last edge was not used
 
 volatile PORT_TYPE *boost_pin_port;
 volatile PINMASK_TYPE boost_pin_mask;
@@ -72,15 +80,20 @@ bool vvtTimeHold;
 uint16_t vvt_pwm_max_count; //Used for variable PWM frequency
 uint16_t boost_pwm_max_count; //Used for variable PWM frequency
 
-//Old PID method. Retained in case the new one has issues
-//integerPID boostPID(&MAPx100, &boost_pwm_target_value, &boostTargetx100, configPage6.boostKP, configPage6.boostKI, configPage6.boostKD, DIRECT);
-integerPID_ideal boostPID(&currentStatus.MAP, &currentStatus.boostDuty , &currentStatus.boostTarget, &configPage10.boostSens, &configPage10.boostIntv, configPage6.boostKP, configPage6.boostKI, configPage6.boostKD, DIRECT); //This is the PID object if that algorithm is used. Needs to be global as it maintains state outside of each function call
-integerPID vvtPID(&vvt_pid_current_angle, &currentStatus.vvt1Duty, &vvt_pid_target_angle, configPage10.vvtCLKP, configPage10.vvtCLKI, configPage10.vvtCLKD, configPage6.vvtPWMdir); //This is the PID object if that algorithm is used. Needs to be global as it maintains state outside of each function call
-integerPID vvt2PID(&vvt2_pid_current_angle, &currentStatus.vvt2Duty, &vvt2_pid_target_angle, configPage10.vvtCLKP, configPage10.vvtCLKI, configPage10.vvtCLKD, configPage4.vvt2PWMdir); //This is the PID object if that algorithm is used. Needs to be global as it maintains state outside of each function call
+uint8_t hwPWMOutputs = 0;
+#if defined(HW_PWM_AVAILABLE)
+static uint8_t hwPWMInverted = 0;
+static uint16_t hwPWMDuty[AUX_PWM_CHANNELS]; //Last duty written to each hardware PWM output
+#endif
+
+fixedPID<PID_SHIFTS> boostPID(&currentStatus.MAP, &boost_pid_duty, &boost_pid_target, DIRECT); //This is the PID object if that algorithm is used. Needs to be global as it maintains state outside of each function call
+fixedPID<PID_SHIFTS> vvtPID(&vvt_pid_current_angle, &currentStatus.vvt1Duty, &vvt_pid_target_angle, DIRECT); //This is the PID object if that algorithm is used. Needs to be global as it maintains state outside of each function call
+fixedPID<PID_SHIFTS> vvt2PID(&vvt2_pid_current_angle, &currentStatus.vvt2Duty, &vvt2_pid_target_angle, DIRECT); //This is the PID object if that algorithm is used. Needs to be global as it maintains state outside of each function call
 
 static inline void checkAirConCoolantLockout(void);
 static inline void checkAirConTPSLockout(void);
 static inline void checkAirConRPMLockout(void);
+static void setBoostPIDTunings(void);
 
 /*
 Air Conditioning Control
@@ -328,6 +341,8 @@ void initialiseFan(void)
         fan_pwm_max_count = (uint16_t)(MICROS_PER_SEC / (32U * configPage6.fanFreq * 2U)); //Converts the frequency in Hz to the number of ticks (at 16uS) it takes to complete 1 cycle. Note that the frequency is divided by 2 coming from TS to allow for up to 512hz
       #endif
       fan_pwm_value = 0;
+      auxPWMAttach(AUX_PWM_FAN, pinFan, configPage6.fanFreq * 2U, configPage6.fanInv);
+      auxPWMSetDuty(AUX_PWM_FAN, 0, fan_pwm_max_count);
     }
   #endif
 }
@@ -428,6 +443,7 @@ void fanControl(void)
         BIT_SET(currentStatus.status4, BIT_STATUS4_FAN);
         DISABLE_FAN_TIMER();
       }
+      auxPWMSetDuty(AUX_PWM_FAN, ((currentStatus.fanDuty == 0U) ? 0U : fan_pwm_value), fan_pwm_max_count);
     #else //Just in case if user still has selected PWM fan in TS, even though it warns that it doesn't work on mega.
       if(currentStatus.fanDuty == 0)
       {
@@ -453,6 +469,9 @@ void initialiseAuxPWM(void)
   vvt1_pin_mask = digitalPinToBitMask(pinVVT_1);
   vvt2_pin_port = portOutputRegister(digitalPinToPort(pinVVT_2));
   vvt2_pin_mask = digitalPinToBitMask(pinVVT_2);
+  if(configPage6.boostEnabled == 1) { auxPWMAttach(AUX_PWM_BOOST, pinBoost, configPage6.boostFreq * 2U, false); }
+  if(configPage6.vvtEnabled > 0) { auxPWMAttach(AUX_PWM_VVT1, pinVVT_1, configPage6.vvtFreq * 2U, false); }
+  if( ((configPage6.vvtEnabled > 0) && (configPage10.vvt2Enabled == 1)) || (configPage10.wmiEnabled >= 1) ) { auxPWMAttach(AUX_PWM_VVT2, pinVVT_2, configPage6.vvtFreq * 2U, false); }
   n2o_stage1_pin_port = portOutputRegister(digitalPinToPort(configPage10.n2o_stage1_pin));
   n2o_stage1_pin_mask = digitalPinToBitMask(configPage10.n2o_stage1_pin);
   n2o_stage2_pin_port = portOutputRegister(digitalPinToPort(configPage10.n2o_stage2_pin));
@@ -471,9 +490,11 @@ void initialiseAuxPWM(void)
     else { pinMode(configPage10.n2o_arming_pin, INPUT); }
   }
 
-  boostPID.SetOutputLimits(configPage2.boostMinDuty, configPage2.boostMaxDuty);
-  if(configPage6.boostMode == BOOST_MODE_SIMPLE) { boostPID.SetTunings(SIMPLE_BOOST_P, SIMPLE_BOOST_I, SIMPLE_BOOST_D); }
-  else { boostPID.SetTunings(configPage6.boostKP, configPage6.boostKI, configPage6.boostKD); }
+  boost_pid_duty = 0;
+  setBoostPIDTunings();
+  boostPID.SetDerivativeFilter(1); //MAP is noisy under boost
+  boostPID.SetBackCalculation(2);
+  boostPID.SetMode(AUTOMATIC);
 
   if( configPage6.vvtEnabled > 0)
   {
@@ -493,12 +514,14 @@ void initialiseAuxPWM(void)
       vvtPID.SetOutputLimits(configPage10.vvtCLminDuty, configPage10.vvtCLmaxDuty);
       vvtPID.SetTunings(configPage10.vvtCLKP, configPage10.vvtCLKI, configPage10.vvtCLKD);
       vvtPID.SetSampleTime(33); //30Hz is 33,33ms
+      vvtPID.SetControllerDirection(configPage6.vvtPWMdir);
       vvtPID.SetMode(AUTOMATIC); //Turn PID on
       if (configPage10.vvt2Enabled == 1) // same for VVT2 if it's enabled
       {
         vvt2PID.SetOutputLimits(configPage10.vvtCLminDuty, configPage10.vvtCLmaxDuty);
         vvt2PID.SetTunings(configPage10.vvtCLKP, configPage10.vvtCLKI, configPage10.vvtCLKD);
         vvt2PID.SetSampleTime(33); //30Hz is 33,33ms
+        vvt2PID.SetControllerDirection(configPage4.vvt2PWMdir);
         vvt2PID.SetMode(AUTOMATIC); //Turn PID on
       }
     }
@@ -509,6 +532,7 @@ void initialiseAuxPWM(void)
     BIT_CLEAR(currentStatus.status4, BIT_STATUS4_VVT1_ERROR);
     BIT_CLEAR(currentStatus.status4, BIT_STATUS4_VVT2_ERROR);
     vvtTimeHold = false;
+    vvtEdgeReset();
     if (currentStatus.coolant >= (int)(configPage4.vvtMinClt - CALIBRATION_TEMPERATURE_OFFSET)) { vvtIsHot = true; } //Checks to see if coolant's already at operating temperature
   }
   
@@ -679,6 +703,21 @@ void boostByGear(void)
   }
 }
 
+/**
+ * The boost PID works in duty % * 100 and its gains are scaled by the boost sensitivity setting.
+ * At the default sensitivity a gain of 1 is 0.001% duty per kPa of error (Per sample for Ki)
+ */
+static void setBoostPIDTunings(void)
+{
+  boostPID.SetOutputLimits(configPage2.boostMinDuty * 100L, configPage2.boostMaxDuty * 100L);
+  boostPID.SetSampleTime(configPage10.boostIntv);
+
+  int32_t sensitivity = 10001L - (configPage10.boostSens * 2L);
+  if(sensitivity < 200L) { sensitivity = 200L; } //The top of the sensitivity range would give gains large enough for (gain * kPa of error) to overflow 32 bits in the PID
+  if(configPage6.boostMode == BOOST_MODE_SIMPLE) { boostPID.SetTunings(SIMPLE_BOOST_P, SIMPLE_BOOST_I, SIMPLE_BOOST_D, 1000, sensitivity); }
+  else { boostPID.SetTunings(configPage6.boostKP, configPage6.boostKI, configPage6.boostKD, 1000, sensitivity); }
+}
+
 void boostControl(void)
 {
   if( configPage6.boostEnabled==1 )
@@ -720,13 +759,12 @@ void boostControl(void)
           //This only needs to be run very infrequently, once every 16 calls to boostControl(). This is approx. once per second
           if( (boostCounter & 15) == 1)
           {
-            boostPID.SetOutputLimits(configPage2.boostMinDuty, configPage2.boostMaxDuty);
-
-            if(configPage6.boostMode == BOOST_MODE_SIMPLE) { boostPID.SetTunings(SIMPLE_BOOST_P, SIMPLE_BOOST_I, SIMPLE_BOOST_D); }
-            else { boostPID.SetTunings(configPage6.boostKP, configPage6.boostKI, configPage6.boostKD); }
+            setBoostPIDTunings();
           }
 
+          boost_pid_target = currentStatus.boostTarget;
           bool PIDcomputed = boostPID.Compute(get3DTableValue(&boostTableLookupDuty, currentStatus.boostTarget, currentStatus.RPM) * 100/2); //Compute() returns false if the required interval has not yet passed.
+          if(PIDcomputed == true) { currentStatus.boostDuty = boost_pid_duty; }
           if(currentStatus.boostDuty == 0) { DISABLE_BOOST_TIMER(); BOOST_PIN_LOW(); } //If boost duty is 0, shut everything down
           else
           {
@@ -744,7 +782,7 @@ void boostControl(void)
       }
       else
       {
-        boostPID.Initialize(); //This resets the ITerm value to prevent rubber banding
+        boostPID.ResetIntegral(); //This resets the ITerm value to prevent rubber banding
         //Boost control needs to have a high duty cycle if control is below threshold (baro or fixed value). This ensures the waste gate is closed as much as possible, this build boost as fast as possible.
         currentStatus.boostDuty = configPage15.boostDCWhenDisabled*100;
         boost_pwm_target_value = ((unsigned long)(currentStatus.boostDuty) * boost_pwm_max_count) / 10000; //Convert boost duty (Which is a % multiplied by 100) to a pwm count
@@ -770,11 +808,17 @@ void boostControl(void)
     currentStatus.flexBoostCorrection = 0;
   }
 
+  auxPWMSetDuty(AUX_PWM_BOOST, ((currentStatus.boostDuty == 0U) ? 0U : boost_pwm_target_value), boost_pwm_max_count);
   boostCounter++;
 }
 
 void vvtControl(void)
 {
+  //The Miata cam angle is calculated here rather than on the cam edge, so its PID can only be computed here
+  bool edgeRate = (configPage15.vvtCLEdgeRate == 1) && (configPage4.TrigPattern != DECODER_MIATA_9905);
+  vvt1EdgeRun = false;
+  vvt2EdgeRun = false;
+
   if( (configPage6.vvtEnabled == 1) && (currentStatus.coolant >= (int)(configPage4.vvtMinClt - CALIBRATION_TEMPERATURE_OFFSET)) && (BIT_CHECK(currentStatus.engine, BIT_ENGINE_RUN)))
   {
     if(vvtTimeHold == false) 
@@ -843,14 +887,17 @@ void vvtControl(void)
         {
           //This is dumb, but need to convert the current angle into a long pointer.
           vvt_pid_target_angle = (unsigned long)currentStatus.vvt1TargetAngle;
-          vvt_pid_current_angle = (long)currentStatus.vvt1Angle;
-
-          //If not already at target angle, calculate new value from PID
-          bool PID_compute = vvtPID.Compute(true);
-          //vvtPID.Compute2(currentStatus.vvt1TargetAngle, currentStatus.vvt1Angle, false);
-          //vvt_pwm_target_value = percentage(40, vvt_pwm_max_count);
-          //if (currentStatus.vvt1Angle > currentStatus.vvt1TargetAngle) { vvt_pwm_target_value = 0; }
-          if(PID_compute == true) { vvt1_pwm_value = halfPercentage(currentStatus.vvt1Duty, vvt_pwm_max_count); }
+          if(edgeRate == true) { vvt1EdgeRun = true; } //Computed by vvtEdgeControl() on each cam edge
+          else
+          {
+            vvt_pid_current_angle = (long)currentStatus.vvt1Angle;
+
+            //If not already at target angle, calculate new value from PID
+            bool PID_compute = vvtPID.Compute();
+            //vvt_pwm_target_value = percentage(40, vvt_pwm_max_count);
+            //if (currentStatus.vvt1Angle > currentStatus.vvt1TargetAngle) { vvt_pwm_target_value = 0; }
+            if(PID_compute == true) { vvt1_pwm_value = halfPercentage(currentStatus.vvt1Duty, vvt_pwm_max_count); }
+          }
           BIT_CLEAR(currentStatus.status4, BIT_STATUS4_VVT1_ERROR);
         }
 
@@ -882,10 +929,14 @@ void vvtControl(void)
           {
             //This is dumb, but need to convert the current angle into a long pointer.
             vvt2_pid_target_angle = (unsigned long)currentStatus.vvt2TargetAngle;
-            vvt2_pid_current_angle = (long)currentStatus.vvt2Angle;
-            //If not already at target angle, calculate new value from PID
-            bool PID_compute = vvt2PID.Compute(true);
-            if(PID_compute == true) { vvt2_pwm_value = halfPercentage(currentStatus.vvt2Duty, vvt_pwm_max_count); }
+            if(edgeRate == true) { vvt2EdgeRun = true; } //Computed by vvtEdgeControl() on each cam edge
+            else
+            {
+              vvt2_pid_current_angle = (long)currentStatus.vvt2Angle;
+              //If not already at target angle, calculate new value from PID
+              bool PID_compute = vvt2PID.Compute();
+              if(PID_compute == true) { vvt2_pwm_value = halfPercentage(currentStatus.vvt2Duty, vvt_pwm_max_count); }
+            }
             BIT_CLEAR(currentStatus.status4, BIT_STATUS4_VVT2_ERROR);
           }
         }
@@ -967,6 +1018,72 @@ void vvtControl(void)
     vvt1_max_pwm = false;
     vvtTimeHold = false;
   } 
+
+  auxPWMSetDuty(AUX_PWM_VVT1, vvt1_pwm_value, vvt_pwm_max_count);
+  if( configPage10.wmiEnabled == 0 ) { auxPWMSetDuty(AUX_PWM_VVT2, vvt2_pwm_value, vvt_pwm_max_count); }
+}
+
+/**
+ * Runs a PID step for one VVT output for every cam angle measurement the decoder has queued since the last call.
+ * The time between the cam edges is used as the sample time of the step. Measurements outside the cam angle limits are left to vvtControl() to deal with
+ * @return true if the duty of the output changed
+ */
+static bool vvtEdgeStep(uint8_t cam, bool run, fixedPID<PID_SHIFTS> &pid, long &pidAngle, const long &duty, long &pwmValue)
+{
+  bool changed = false;
+  camSample_t sample;
+  while(camSamplePop(cam, sample) == true)
+  {
+    if( (run == false) || (sample.angle <= configPage10.vvtCLMinAng) || (sample.angle > configPage10.vvtCLMaxAng) )
+    {
+      vvtLastSampleTime[cam] = 0;
+      continue;
+    }
+
+    //The first edge only gives the start time of the next step
+    if(vvtLastSampleTime[cam] != 0UL)
+    {
+      pidAngle = sample.angle;
+      if(pid.ComputeDt(sample.time - vvtLastSampleTime[cam]) == true)
+      {
+        pwmValue = halfPercentage(duty, vvt_pwm_max_count);
+        changed = true;
+      }
+    }
+    vvtLastSampleTime[cam] = (sample.time == 0UL) ? 1UL : sample.time;
+  }
+  return changed;
+}
+
+/**
+ * Drops any cam angle measurements still queued and makes the next edge of each cam only a start time for the PID steps.
+ * Called when VVT is initialised and when sync is lost, so that no step is run with measurements or a sample time from before then
+ */
+void vvtEdgeReset(void)
+{
+  for(uint8_t cam = 0; cam < CAM_SAMPLE_CAMS; cam++)
+  {
+    camSampleReset(cam);
+    vvtLastSampleTime[cam] = 0;
+  }
+}
+
+/**
+ * Closed loop VVT at the cam edge rate. Called on every pass of the main loop.
+ * vvtControl() still looks up the targets and checks the cam angle limits at 30Hz, and only when it would have computed the PID of an output is it computed here instead
+ * for each new cam angle measurement (See camSamples.h). On engines with several cam teeth per cycle or at high RPM, this is many more PID steps than 30Hz and
+ * each of them uses the newest angle, which settles the cam on its target much faster.
+ */
+void vvtEdgeControl(void)
+{
+  if(vvtEdgeStep(CAM_SAMPLE_VVT1, vvt1EdgeRun, vvtPID, vvt_pid_current_angle, currentStatus.vvt1Duty, vvt1_pwm_value) == true)
+  {
+    auxPWMSetDuty(AUX_PWM_VVT1, vvt1_pwm_value, vvt_pwm_max_count);
+  }
+  if(vvtEdgeStep(CAM_SAMPLE_VVT2, vvt2EdgeRun, vvt2PID, vvt2_pid_current_angle, currentStatus.vvt2Duty, vvt2_pwm_value) == true)
+  {
+    if( configPage10.wmiEnabled == 0 ) { auxPWMSetDuty(AUX_PWM_VVT2, vvt2_pwm_value, vvt_pwm_max_count); }
+  }
 }
 
 void nitrousControl(void)
@@ -1068,6 +1185,7 @@ void wmiControl(void)
 
     currentStatus.wmiPW = wmiPW;
     vvt2_pwm_value = halfPercentage(currentStatus.wmiPW, vvt_pwm_max_count);
+    auxPWMSetDuty(AUX_PWM_VVT2, vvt2_pwm_value, vvt_pwm_max_count);
 
     if(wmiPW == 0)
     {
@@ -1098,14 +1216,84 @@ void wmiControl(void)
   }
 }
 
+/**
+ * Set the output pin of an auxiliary PWM channel.
+ * If the board can drive the pin from a hardware PWM, that is used and the channel needs no interrupts at all.
+ * Otherwise the soft PWM engine (If enabled) or the output's own timer interrupt runs it.
+ * Changing the pin or frequency of a hardware PWM output requires a restart, the same as the software outputs
+ * @param channel One of the AUX_PWM_ channels
+ * @param pin
+ * @param frequency PWM frequency in Hz. 0 forces the software PWM (Eg when a complementary output is needed)
+ * @param inverted If true the pin is low during the on part of the period
+ */
+void auxPWMAttach(uint8_t channel, uint8_t pin, uint16_t frequency, bool inverted)
+{
+#if defined(HW_PWM_AVAILABLE)
+  BIT_CLEAR(hwPWMOutputs, channel);
+  if( (frequency > 0U) && (boardPWMAttach(channel, pin, frequency) == true) )
+  {
+    #if defined(USE_SOFT_PWM)
+      softPWMDetach(channel);
+    #endif
+    BIT_SET(hwPWMOutputs, channel);
+    BIT_WRITE(hwPWMInverted, channel, inverted);
+    hwPWMDuty[channel] = UINT16_MAX; //Forces the first write
+    auxPWMSetDuty(channel, 0, 1); //Start with the output off
+    return;
+  }
+#endif
+#if defined(USE_SOFT_PWM)
+  softPWMAttach(channel, pin, inverted);
+#endif
+  UNUSED(channel);
+  UNUSED(pin);
+  UNUSED(frequency);
+  UNUSED(inverted);
+}
+
+/**
+ * Pass the latest duty of an auxiliary PWM output to whichever PWM is running it.
+ * For a hardware PWM this is a single register write when the duty has changed, for the soft PWM engine it takes effect at the start of the next period.
+ * With neither, the output's timer interrupt reads the duty directly and this does nothing
+ * @param channel One of the AUX_PWM_ channels
+ * @param onTicks On time in timer ticks
+ * @param periodTicks Period in timer ticks
+ */
+void auxPWMSetDuty(uint8_t channel, uint16_t onTicks, uint16_t periodTicks)
+{
+#if defined(HW_PWM_AVAILABLE)
+  if(BIT_CHECK(hwPWMOutputs, channel))
+  {
+    if(periodTicks == 0U) { return; }
+    uint16_t duty = HW_PWM_FULL_DUTY;
+    if(onTicks < periodTicks) { duty = (uint16_t)(((uint32_t)onTicks * HW_PWM_FULL_DUTY) / periodTicks); }
+    if(BIT_CHECK(hwPWMInverted, channel)) { duty = HW_PWM_FULL_DUTY - duty; }
+    if(duty != hwPWMDuty[channel])
+    {
+      boardPWMWrite(channel, duty);
+      hwPWMDuty[channel] = duty;
+    }
+    return;
+  }
+#endif
+#if defined(USE_SOFT_PWM)
+  softPWMSetDuty(channel, onTicks, periodTicks);
+#endif
+  UNUSED(channel);
+  UNUSED(onTicks);
+  UNUSED(periodTicks);
+}
+
 void boostDisable(void)
 {
-  boostPID.Initialize(); //This resets the ITerm value to prevent rubber banding
+  boostPID.ResetIntegral(); //This resets the ITerm value to prevent rubber banding
   currentStatus.boostDuty = 0;
   DISABLE_BOOST_TIMER(); //Turn off timer
   BOOST_PIN_LOW(); //Make sure solenoid is off (0% duty)
+  auxPWMSetDuty(AUX_PWM_BOOST, 0, boost_pwm_max_count);
 }
 
+#if !defined(USE_SOFT_PWM) //The soft PWM engine replaces all of the below interrupts
 //The interrupt to control the Boost PWM
 #if defined(CORE_AVR)
   ISR(TIMER1_COMPA_vect) //cppcheck-suppress misra-c2012-8.2
@@ -1274,3 +1462,4 @@ void boostDisable(void)
   }
 }
 #endif
+#endif //USE_SOFT_PWM
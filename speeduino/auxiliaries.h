@@ -12,6 +12,8 @@ void boostControl(void);
 void boostDisable(void);
 void boostByGear(void);
 void vvtControl(void);
+void vvtEdgeControl(void);
+void vvtEdgeReset(void);
 void initialiseFan(void);
 void initialiseAirCon(void);
 void nitrousControl(void);
@@ -20,6 +22,24 @@ void airConControl(void);
 bool READ_AIRCON_REQUEST(void);
 void wmiControl(void);
 
+//Auxiliary PWM outputs. Depending on the board and pin these are run by a hardware PWM output, the soft PWM engine (softPWM.h) or their own timer ISRs
+#define AUX_PWM_BOOST      0
+#define AUX_PWM_VVT1       1
+#define AUX_PWM_VVT2       2 /**< Also used by WMI */
+#define AUX_PWM_IDLE       3 /**< Idle2 is driven as the complement of this channel when 2 idle outputs are used */
+#define AUX_PWM_FAN        4
+#define AUX_PWM_TACHO      5 /**< Soft PWM engine only. Run as single pulses by softPWMPulse() rather than a continuous PWM */
+#define AUX_PWM_CHANNELS   6
+
+#define HW_PWM_FULL_DUTY   4096U /**< 100% duty value for boardPWMWrite(). 12 bit resolution */
+
+extern uint8_t hwPWMOutputs; //Bit for each AUX_PWM_ channel that is running on a hardware PWM output
+#define AUX_PWM_ON_HW(channel) BIT_CHECK(hwPWMOutputs, (channel))
+//The VVT interrupt runs both VVT outputs, so it is only unneeded when neither of them is a software output
+#define VVT_PWM_ON_HW() ( AUX_PWM_ON_HW(AUX_PWM_VVT1) && (AUX_PWM_ON_HW(AUX_PWM_VVT2) || ((configPage10.vvt2Enabled == 0) && (configPage10.wmiEnabled == 0))) )
+void auxPWMAttach(uint8_t channel, uint8_t pin, uint16_t frequency, bool inverted);
+void auxPWMSetDuty(uint8_t channel, uint16_t onTicks, uint16_t periodTicks);
+
 #define SIMPLE_BOOST_P  1
 #define SIMPLE_BOOST_I  1
 #define SIMPLE_BOOST_D  1
@@ -134,6 +134,19 @@ static inline void IGN8_TIMER_DISABLE(void) { TIMSK3 &= ~(1 << OCIE3B); } //Repl
 ***********************************************************************************************************
 * Auxiliaries
 */
+#if defined(USE_SOFT_PWM)
+  //All auxiliary PWM outputs run from compare A of Timer1 (See softPWM.h). Compare B and C are free
+  #define ENABLE_SOFT_PWM_TIMER()  TIMSK1 |= (1 << OCIE1A)
+  #define DISABLE_SOFT_PWM_TIMER() TIMSK1 &= ~(1 << OCIE1A)
+  #define SOFT_PWM_COMPARE      OCR1A
+  #define SOFT_PWM_COUNTER      TCNT1
+  #define uS_TO_SOFT_PWM_TICKS(uS) ((uS) >> 4) //Timer1 ticks every 16uS
+
+  #define ENABLE_BOOST_TIMER()  softPWMStart(AUX_PWM_BOOST)
+  #define DISABLE_BOOST_TIMER() softPWMStop(AUX_PWM_BOOST)
+  #define ENABLE_VVT_TIMER()    (softPWMStart(AUX_PWM_VVT1), softPWMStart(AUX_PWM_VVT2))
+  #define DISABLE_VVT_TIMER()   (softPWMStop(AUX_PWM_VVT1), softPWMStop(AUX_PWM_VVT2))
+#else
   #define ENABLE_BOOST_TIMER()  TIMSK1 |= (1 << OCIE1A)
   #define DISABLE_BOOST_TIMER() TIMSK1 &= ~(1 << OCIE1A)
   #define ENABLE_VVT_TIMER()    TIMSK1 |= (1 << OCIE1B)
@@ -143,16 +156,22 @@ static inline void IGN8_TIMER_DISABLE(void) { TIMSK3 &= ~(1 << OCIE3B); } //Repl
   #define BOOST_TIMER_COUNTER   TCNT1
   #define VVT_TIMER_COMPARE     OCR1B
   #define VVT_TIMER_COUNTER     TCNT1
+#endif
 
 /*
 ***********************************************************************************************************
 * Idle
 */
+#if defined(USE_SOFT_PWM)
+  #define IDLE_TIMER_ENABLE() softPWMStart(AUX_PWM_IDLE)
+  #define IDLE_TIMER_DISABLE() softPWMStop(AUX_PWM_IDLE)
+#else
   #define IDLE_COUNTER TCNT1
   #define IDLE_COMPARE OCR1C
 
   #define IDLE_TIMER_ENABLE() TIMSK1 |= (1 << OCIE1C)
   #define IDLE_TIMER_DISABLE() TIMSK1 &= ~(1 << OCIE1C)
+#endif
 
 /*
 ***********************************************************************************************************
@@ -7,7 +7,9 @@
 #include "scheduler.h"
 #include "HardwareTimer.h"
 #include "timers.h"
+#include "softPWM.h"
 #include "comms_secondary.h"
+#include "analogScan.h"
 
 #if HAL_CAN_MODULE_ENABLED
 //This activates CAN1 interface on STM32, but it's named as Can0, because that's how Teensy implementation is done
@@ -33,10 +35,16 @@ Default CAN3 pins are PA8 & PA15. Alternative (ALT) pins are PB3 & PB4.
       SPIClass SPI_for_flash(PB15, PB14, PB13);
     #endif
  
+    Flash_SPI_Config SPIconfig{USE_SPI_EEPROM, SPI_for_flash};
+  #if defined(FLASH_JOURNAL_AS_EEPROM)
+    //2 banks of 16 4kb sectors at the start of the SPI flash
+    FlashJournal_Config FlashJournalConfig{16UL, 4096UL, 0x00000000UL};
+    SPI_Journal_EEPROM_Class EEPROM(FlashJournalConfig, SPIconfig);
+  #else
     //winbond W25Q16 SPI flash EEPROM emulation
     EEPROM_Emulation_Config EmulatedEEPROMMconfig{255UL, 4096UL, 31, 0x00100000UL};
-    Flash_SPI_Config SPIconfig{USE_SPI_EEPROM, SPI_for_flash};
     SPI_EEPROM_Class EEPROM(EmulatedEEPROMMconfig, SPIconfig);
+  #endif
 #elif defined(FRAM_AS_EEPROM) //https://github.com/VitorBoss/FRAM
     #if defined(STM32F407xx)
       SPIClass SPI_for_FRAM(PB5, PB4, PB3); //SPI1_MOSI, SPI1_MISO, SPI1_SCK
@@ -55,9 +63,15 @@ Default CAN3 pins are PA8 & PA15. Alternative (ALT) pins are PB3 & PB4.
 #elif defined(STM32F401xC)
     EEPROM_Emulation_Config EmulatedEEPROMMconfig{1UL, 131072UL, 4095UL, 0x08020000UL};
     InternalSTM32F4_EEPROM_Class EEPROM(EmulatedEEPROMMconfig);
+#elif defined(STM32F411xE) && defined(FLASH_JOURNAL_AS_EEPROM)
+    FlashJournal_Config FlashJournalConfig{1UL, 131072UL, 0x08040000UL}; //Sectors 6 and 7
+    InternalSTM32F4_Journal_EEPROM_Class EEPROM(FlashJournalConfig);
 #elif defined(STM32F411xE)
     EEPROM_Emulation_Config EmulatedEEPROMMconfig{2UL, 131072UL, 4095UL, 0x08040000UL};
     InternalSTM32F4_EEPROM_Class EEPROM(EmulatedEEPROMMconfig);
+#elif defined(FLASH_JOURNAL_AS_EEPROM)
+    FlashJournal_Config FlashJournalConfig{1UL, 131072UL, 0x08080000UL}; //Sectors 8 and 9
+    InternalSTM32F4_Journal_EEPROM_Class EEPROM(FlashJournalConfig);
 #else //default case, internal flash as EEPROM for STM32F4
     EEPROM_Emulation_Config EmulatedEEPROMMconfig{4UL, 131072UL, 2047UL, 0x08080000UL};
     InternalSTM32F4_EEPROM_Class EEPROM(EmulatedEEPROMMconfig);
@@ -118,12 +132,14 @@ STM32RTC& rtc = STM32RTC::getInstance();
     } 
 
     //This must happen at the end of the idle init
+    #if !defined(USE_SOFT_PWM) //Idle is run by the soft PWM engine on channel 2
     #if ( STM32_CORE_VERSION_MAJOR < 2 )
     Timer1.setMode(4, TIMER_OUTPUT_COMPARE);
     #else
     Timer1.setMode(4, TIMER_OUTPUT_COMPARE_TOGGLE);
     #endif
     Timer1.attachInterrupt(4, idleInterrupt);  //on first flash the configPage4.iacAlgorithm is invalid
+    #endif
 
 
     /*
@@ -161,6 +177,15 @@ STM32RTC& rtc = STM32RTC::getInstance();
     fan_pwm_max_count = (uint16_t)(MICROS_PER_SEC / (TIMER_RESOLUTION * configPage6.fanFreq * 2U)); //Converts the frequency in Hz to the number of ticks (at 4uS) it takes to complete 1 cycle
 
     //Need to be initialised last due to instant interrupt
+    #if defined(USE_SOFT_PWM)
+    //All auxiliary PWM outputs are run from channel 2. Channels 1, 3 and 4 are not used
+    #if ( STM32_CORE_VERSION_MAJOR < 2 )
+    Timer1.setMode(2, TIMER_OUTPUT_COMPARE);
+    #else //2.0 forward
+    Timer1.setMode(2, TIMER_OUTPUT_COMPARE_TOGGLE);
+    #endif
+    Timer1.attachInterrupt(2, softPWMInterrupt);
+    #else
     #if ( STM32_CORE_VERSION_MAJOR < 2 )
     Timer1.setMode(1, TIMER_OUTPUT_COMPARE);
     Timer1.setMode(2, TIMER_OUTPUT_COMPARE);
@@ -173,6 +198,7 @@ STM32RTC& rtc = STM32RTC::getInstance();
     Timer1.attachInterrupt(1, fanInterrupt);
     Timer1.attachInterrupt(2, boostInterrupt);
     Timer1.attachInterrupt(3, vvtInterrupt);
+    #endif
 
     /*
     ***********************************************************************************************************
@@ -291,6 +317,224 @@ STM32RTC& rtc = STM32RTC::getInstance();
 
   }
 
+  #if defined(HW_PWM_AVAILABLE)
+  /*
+  Hardware PWM for the auxiliary outputs (See auxPWMAttach()).
+  A pin can only be used if its timer is not one of those used by the firmware. All outputs on the same timer share the same frequency
+  */
+  static HardwareTimer *hwPWMTimers[AUX_PWM_CHANNELS];
+  static uint32_t hwPWMTimerChannels[AUX_PWM_CHANNELS];
+  static bool captureTimerInUse(const TIM_TypeDef *instance);
+
+  static inline bool timerIsReserved(const TIM_TypeDef *instance)
+  {
+    if( (instance == TIM1) || (instance == TIM2) || (instance == TIM3) || (instance == TIM4) ) { return true; }
+    #if defined(TIM5)
+    if(instance == TIM5) { return true; }
+    #endif
+    #if defined(TIM11)
+    if(instance == TIM11) { return true; }
+    #elif defined(TIM7)
+    if(instance == TIM7) { return true; }
+    #endif
+    return false;
+  }
+
+  bool boardPWMAttach(uint8_t channel, uint8_t pin, uint16_t frequency)
+  {
+    PinName pinName = digitalPinToPinName(pin);
+    TIM_TypeDef *instance = (TIM_TypeDef *)pinmap_peripheral(pinName, PinMap_PWM);
+    if( (instance == NP) || timerIsReserved(instance) || captureTimerInUse(instance) ) { return false; }
+
+    //Outputs on the same timer share the HardwareTimer object
+    HardwareTimer *timer = nullptr;
+    for(uint8_t x = 0; x < AUX_PWM_CHANNELS; x++)
+    {
+      if( (hwPWMTimers[x] != nullptr) && (hwPWMTimers[x]->getHandle()->Instance == instance) ) { timer = hwPWMTimers[x]; }
+    }
+    if(timer == nullptr) { timer = new HardwareTimer(instance); }
+
+    hwPWMTimers[channel] = timer;
+    hwPWMTimerChannels[channel] = STM_PIN_CHANNEL(pinmap_function(pinName, PinMap_PWM));
+    timer->setPWM(hwPWMTimerChannels[channel], pin, frequency, 0);
+    return true;
+  }
+
+  void boardPWMWrite(uint8_t channel, uint16_t duty)
+  {
+    hwPWMTimers[channel]->setCaptureCompare(hwPWMTimerChannels[channel], duty, RESOLUTION_12B_COMPARE_FORMAT);
+  }
+
+  /*
+  Hardware input capture for the VSS and flex inputs. The timer latches its counter at the edge, so the edge time is not affected by the interrupt latency.
+  The capture timers count at 1MHz. The interrupt works out how long ago the edge was from the current counter and takes that off micros()
+  */
+  #define HW_CAPTURE_CHANNELS 2U
+  struct hwCaptureChannel
+  {
+    HardwareTimer *timer;
+    uint32_t timerChannel;
+    void (*handler)(uint32_t edgeTime);
+  };
+  static hwCaptureChannel hwCaptures[HW_CAPTURE_CHANNELS];
+  static uint8_t hwCaptureCount = 0;
+
+  static bool captureTimerInUse(const TIM_TypeDef *instance)
+  {
+    for(uint8_t x = 0; x < hwCaptureCount; x++)
+    {
+      if(hwCaptures[x].timer->getHandle()->Instance == instance) { return true; }
+    }
+    return false;
+  }
+
+  static inline void hwCaptureInterrupt(const hwCaptureChannel &capture)
+  {
+    uint16_t age = (uint16_t)(capture.timer->getCount() - capture.timer->getCaptureCompare(capture.timerChannel));
+    capture.handler(micros() - age);
+  }
+  static void hwCapture1Interrupt(void) { hwCaptureInterrupt(hwCaptures[0]); }
+  static void hwCapture2Interrupt(void) { hwCaptureInterrupt(hwCaptures[1]); }
+
+  /**
+   * Timestamp the edges of an input with a timer input capture instead of a pin interrupt
+   * @param pin
+   * @param bothEdges Capture both edges rather than only the rising edge. The handler can read the pin to tell which edge it was
+   * @param handler Called from the capture interrupt with the time of the edge in uS
+   * @return false if the pin has no timer channel, its timer is used by the firmware or a hardware PWM, or all of the capture slots are in use. An interrupt must be used instead
+   */
+  bool boardCaptureAttach(uint8_t pin, bool bothEdges, void (*handler)(uint32_t edgeTime))
+  {
+    if(hwCaptureCount >= HW_CAPTURE_CHANNELS) { return false; }
+    PinName pinName = digitalPinToPinName(pin);
+    TIM_TypeDef *instance = (TIM_TypeDef *)pinmap_peripheral(pinName, PinMap_TIM);
+    if( (instance == NP) || timerIsReserved(instance) ) { return false; }
+
+    HardwareTimer *timer = nullptr;
+    for(uint8_t x = 0; x < AUX_PWM_CHANNELS; x++)
+    {
+      if( (hwPWMTimers[x] != nullptr) && (hwPWMTimers[x]->getHandle()->Instance == instance) ) { return false; } //PWM timers run at the output frequency
+    }
+    //Inputs on the same timer share the HardwareTimer object
+    for(uint8_t x = 0; x < hwCaptureCount; x++)
+    {
+      if(hwCaptures[x].timer->getHandle()->Instance == instance) { timer = hwCaptures[x].timer; }
+    }
+    if(timer == nullptr)
+    {
+      timer = new HardwareTimer(instance);
+      timer->setPrescaleFactor(timer->getTimerClkFreq() / 1000000U);
+      timer->setOverflow(0x10000U, TICK_FORMAT);
+    }
+
+    hwCaptureChannel &capture = hwCaptures[hwCaptureCount];
+    capture.timer = timer;
+    capture.timerChannel = STM_PIN_CHANNEL(pinmap_function(pinName, PinMap_TIM));
+    capture.handler = handler;
+    timer->setMode(capture.timerChannel, (bothEdges == true) ? TIMER_INPUT_CAPTURE_BOTHEDGE : TIMER_INPUT_CAPTURE_RISING, pin);
+    timer->attachInterrupt(capture.timerChannel, (hwCaptureCount == 0U) ? hwCapture1Interrupt : hwCapture2Interrupt);
+    timer->resume();
+    hwCaptureCount++;
+    return true;
+  }
+  #endif
+
+  #if defined(ANALOG_DMA)
+  /*
+  ADC1 converts all of the analog inputs in scan + continuous mode and DMA2 stream 0 writes them into a circular buffer.
+  The half and complete interrupts of the DMA each hand the half of the buffer that has just been filled to analogScanProcess() while the other half is being filled
+  */
+  static ADC_HandleTypeDef hadcScan;
+  static DMA_HandleTypeDef hdmaScan;
+  static volatile uint16_t *adcScanBuffer;
+  static uint16_t adcScanHalfLength;
+
+  extern "C" void DMA2_Stream0_IRQHandler(void) { HAL_DMA_IRQHandler(&hdmaScan); }
+  extern "C" void HAL_ADC_ConvHalfCpltCallback(ADC_HandleTypeDef *hadc) { if(hadc == &hadcScan) { analogScanProcess(adcScanBuffer); } }
+  extern "C" void HAL_ADC_ConvCpltCallback(ADC_HandleTypeDef *hadc) { if(hadc == &hadcScan) { analogScanProcess(adcScanBuffer + adcScanHalfLength); } }
+
+  /** Whether a pin can be in the scan, ie it is an ADC1 input */
+  bool boardADCScanPinValid(uint8_t pin)
+  {
+    return (pinmap_peripheral(digitalPinToPinName(pin), PinMap_ADC) == ADC1);
+  }
+
+  /**
+   * Start the continuous scan of the analog inputs
+   * @param pins Analog inputs in scan order
+   * @param count Number of inputs
+   * @param buffer DMA buffer, both halves
+   * @param length Number of samples in the buffer (Both halves)
+   * @return false if any of the pins is not on ADC1
+   */
+  bool boardADCScanStart(const uint8_t *pins, uint8_t count, volatile uint16_t *buffer, uint16_t length)
+  {
+    uint32_t channels[ANALOG_SCAN_MAX_CHANNELS];
+    if(count > ANALOG_SCAN_MAX_CHANNELS) { return false; }
+    for(uint8_t x = 0; x < count; x++)
+    {
+      if(boardADCScanPinValid(pins[x]) == false) { return false; }
+      PinName pinName = digitalPinToPinName(pins[x]);
+      channels[x] = STM_PIN_CHANNEL(pinmap_function(pinName, PinMap_ADC)); //ADC_CHANNEL_n is n on the F4
+      pinmap_pinout(pinName, PinMap_ADC); //Analog mode
+    }
+
+    //Restarting (Eg after the inputs have changed)
+    if(hadcScan.Instance == ADC1)
+    {
+      HAL_ADC_Stop_DMA(&hadcScan);
+      HAL_DMA_DeInit(&hdmaScan);
+      HAL_ADC_DeInit(&hadcScan);
+    }
+    adcScanBuffer = buffer;
+    adcScanHalfLength = length / 2U;
+
+    __HAL_RCC_ADC1_CLK_ENABLE();
+    __HAL_RCC_DMA2_CLK_ENABLE();
+
+    hdmaScan.Instance = DMA2_Stream0;
+    hdmaScan.Init.Channel = DMA_CHANNEL_0;
+    hdmaScan.Init.Direction = DMA_PERIPH_TO_MEMORY;
+    hdmaScan.Init.PeriphInc = DMA_PINC_DISABLE;
+    hdmaScan.Init.MemInc = DMA_MINC_ENABLE;
+    hdmaScan.Init.PeriphDataAlignment = DMA_PDATAALIGN_HALFWORD;
+    hdmaScan.Init.MemDataAlignment = DMA_MDATAALIGN_HALFWORD;
+    hdmaScan.Init.Mode = DMA_CIRCULAR;
+    hdmaScan.Init.Priority = DMA_PRIORITY_LOW;
+    hdmaScan.Init.FIFOMode = DMA_FIFOMODE_DISABLE;
+    if(HAL_DMA_Init(&hdmaScan) != HAL_OK) { return false; }
+    __HAL_LINKDMA(&hadcScan, DMA_Handle, hdmaScan);
+
+    hadcScan.Instance = ADC1;
+    hadcScan.Init.ClockPrescaler = ADC_CLOCK_SYNC_PCLK_DIV4;
+    hadcScan.Init.Resolution = ADC_RESOLUTION_12B;
+    hadcScan.Init.ScanConvMode = ENABLE;
+    hadcScan.Init.ContinuousConvMode = ENABLE;
+    hadcScan.Init.DiscontinuousConvMode = DISABLE;
+    hadcScan.Init.ExternalTrigConvEdge = ADC_EXTERNALTRIGCONVEDGE_NONE;
+    hadcScan.Init.ExternalTrigConv = ADC_SOFTWARE_START;
+    hadcScan.Init.DataAlign = ADC_DATAALIGN_RIGHT;
+    hadcScan.Init.NbrOfConversion = count;
+    hadcScan.Init.DMAContinuousRequests = ENABLE;
+    hadcScan.Init.EOCSelection = ADC_EOC_SEQ_CONV;
+    if(HAL_ADC_Init(&hadcScan) != HAL_OK) { return false; }
+
+    for(uint8_t x = 0; x < count; x++)
+    {
+      ADC_ChannelConfTypeDef channelConfig = {};
+      channelConfig.Channel = channels[x];
+      channelConfig.Rank = x + 1U;
+      channelConfig.SamplingTime = ADC_SAMPLETIME_144CYCLES; //Allows for the source impedance of the sensor dividers. ~7uS per conversion at 21MHz
+      if(HAL_ADC_ConfigChannel(&hadcScan, &channelConfig) != HAL_OK) { return false; }
+    }
+
+    //Lowest priority so that processing the samples never delays the schedules
+    HAL_NVIC_SetPriority(DMA2_Stream0_IRQn, 15, 0);
+    HAL_NVIC_EnableIRQ(DMA2_Stream0_IRQn);
+    return (HAL_ADC_Start_DMA(&hadcScan, (uint32_t *)buffer, length) == HAL_OK);
+  }
+  #endif
+
   uint16_t freeRam()
   {
     uint32_t freeRam;
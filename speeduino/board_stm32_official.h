@@ -40,11 +40,27 @@
 #define FPU_MAX_SIZE 32 //Size of the FPU buffer. 0 means no FPU.
 #define micros_safe() micros() //timer5 method is not used on anything but AVR, the micros_safe() macro is simply an alias for the normal micros()
 #define TIMER_RESOLUTION 4
+#if (STM32_CORE_VERSION_MAJOR >= 2)
+  #define HW_PWM_AVAILABLE //Auxiliary outputs on pins of the timers not used by the firmware can run from a hardware PWM, see boardPWMAttach()
+  bool boardPWMAttach(uint8_t channel, uint8_t pin, uint16_t frequency);
+  void boardPWMWrite(uint8_t channel, uint16_t duty);
+  #define HW_CAPTURE_AVAILABLE //VSS and flex inputs on pins of the timers not used by the firmware are timestamped by the timer input capture, see boardCaptureAttach()
+  bool boardCaptureAttach(uint8_t pin, bool bothEdges, void (*handler)(uint32_t edgeTime));
+  #if defined(STM32F4)
+    #if defined(USE_ANALOG_DMA)
+      #define ANALOG_DMA //The analog inputs on ADC1 pins are scanned continuously with DMA, see analogScan.h. Opt in with the USE_ANALOG_DMA build flag
+      bool boardADCScanPinValid(uint8_t pin);
+      bool boardADCScanStart(const uint8_t *pins, uint8_t count, volatile uint16_t *buffer, uint16_t length);
+    #endif
+    #define CALIBRATION_LUT //The CLT, IAT and O2 calibrations are expanded to a lookup table with an entry per ADC value (5kB of RAM), see updateCalibrationLUT()
+  #endif
+#endif
 
 //Select one for EEPROM,the default is EEPROM emulation on internal flash.
 //#define SRAM_AS_EEPROM /*Use 4K battery backed SRAM, requires a 3V continuous source (like battery) connected to Vbat pin */
 //#define USE_SPI_EEPROM PB0 /*Use M25Qxx SPI flash on BlackF407VE*/
 //#define FRAM_AS_EEPROM /*Use FRAM like FM25xxx, MB85RSxxx or any SPI compatible */
+//#define FLASH_JOURNAL_AS_EEPROM /*Use journaled storage instead of the byte emulation on the internal flash (Or the SPI flash if USE_SPI_EEPROM is also set). Much faster burns and less flash wear. Not available on the STM32F401. The flash is formatted on the first start, so the tune must be reloaded*/
 
 #ifndef word
   #define word(h, l) ((h << 8) | l) //word() function not defined for this platform in the main library
@@ -156,10 +172,16 @@ void jumpToBootloader();
     #include EEPROM_LIB_H
     extern SPIClass SPI_for_flash; //SPI1_MOSI, SPI1_MISO, SPI1_SCK
  
+    extern Flash_SPI_Config SPIconfig;
+  #if defined(FLASH_JOURNAL_AS_EEPROM)
+    #define EEPROM_IS_JOURNAL //EEPROM writes are held in RAM until they are committed. See storage.cpp
+    extern FlashJournal_Config FlashJournalConfig;
+    extern SPI_Journal_EEPROM_Class EEPROM;
+  #else
     //windbond W25Q16 SPI flash EEPROM emulation
     extern EEPROM_Emulation_Config EmulatedEEPROMMconfig;
-    extern Flash_SPI_Config SPIconfig;
     extern SPI_EEPROM_Class EEPROM;
+  #endif
 
 #elif defined(FRAM_AS_EEPROM) //https://github.com/VitorBoss/FRAM
     #define EEPROM_LIB_H "src/FRAM/Fram.h"
@@ -175,7 +197,12 @@ void jumpToBootloader();
   #define EEPROM_LIB_H "src/SPIAsEEPROM/SPIAsEEPROM.h"
   typedef uint16_t eeprom_address_t;
   #include EEPROM_LIB_H
+  #if defined(FLASH_JOURNAL_AS_EEPROM) && defined(STM32F4) && !defined(STM32F401xC)
+    #define EEPROM_IS_JOURNAL //EEPROM writes are held in RAM until they are committed. See storage.cpp
+    extern InternalSTM32F4_Journal_EEPROM_Class EEPROM;
+  #else
     extern InternalSTM32F4_EEPROM_Class EEPROM;
+  #endif
   #if defined(STM32F401xC)
     #define SMALL_FLASH_MODE
   #endif
@@ -293,13 +320,31 @@ static inline void FUEL8_TIMER_DISABLE(void) {(TIM5)->DIER &= ~TIM_DIER_CC4IE;}
 ***********************************************************************************************************
 * Auxiliaries
 */
-#define ENABLE_BOOST_TIMER()  (TIM1)->SR = ~TIM_FLAG_CC2; (TIM1)->DIER |= TIM_DIER_CC2IE; (TIM1)->CR1 |= TIM_CR1_CEN;  
+#if defined(USE_SOFT_PWM)
+//All auxiliary PWM outputs run from channel 2 of TIM1 (See softPWM.h). Channels 1, 3 and 4 are free
+#define ENABLE_SOFT_PWM_TIMER()  (TIM1)->SR = ~TIM_FLAG_CC2; (TIM1)->DIER |= TIM_DIER_CC2IE; (TIM1)->CR1 |= TIM_CR1_CEN;
+#define DISABLE_SOFT_PWM_TIMER() (TIM1)->DIER &= ~TIM_DIER_CC2IE
+#define SOFT_PWM_COMPARE      (TIM1)->CCR2
+#define SOFT_PWM_COUNTER      (TIM1)->CNT
+#define uS_TO_SOFT_PWM_TICKS(uS) ((uS) / TIMER_RESOLUTION)
+
+#define ENABLE_BOOST_TIMER()  softPWMStart(AUX_PWM_BOOST)
+#define DISABLE_BOOST_TIMER() softPWMStop(AUX_PWM_BOOST)
+#define ENABLE_VVT_TIMER()    (softPWMStart(AUX_PWM_VVT1), softPWMStart(AUX_PWM_VVT2))
+#define DISABLE_VVT_TIMER()   (softPWMStop(AUX_PWM_VVT1), softPWMStop(AUX_PWM_VVT2))
+#define ENABLE_FAN_TIMER()    softPWMStart(AUX_PWM_FAN)
+#define DISABLE_FAN_TIMER()   softPWMStop(AUX_PWM_FAN)
+#define IDLE_TIMER_ENABLE()   softPWMStart(AUX_PWM_IDLE)
+#define IDLE_TIMER_DISABLE()  softPWMStop(AUX_PWM_IDLE)
+#else
+//Outputs that are on a hardware PWM (See auxPWMAttach()) never need their compare interrupt
+#define ENABLE_BOOST_TIMER()  if(!AUX_PWM_ON_HW(AUX_PWM_BOOST)) { (TIM1)->SR = ~TIM_FLAG_CC2; (TIM1)->DIER |= TIM_DIER_CC2IE; (TIM1)->CR1 |= TIM_CR1_CEN; }
 #define DISABLE_BOOST_TIMER() (TIM1)->DIER &= ~TIM_DIER_CC2IE
 
-#define ENABLE_VVT_TIMER()    (TIM1)->SR = ~TIM_FLAG_CC3; (TIM1)->DIER |= TIM_DIER_CC3IE; (TIM1)->CR1 |= TIM_CR1_CEN;  
+#define ENABLE_VVT_TIMER()    if(!VVT_PWM_ON_HW()) { (TIM1)->SR = ~TIM_FLAG_CC3; (TIM1)->DIER |= TIM_DIER_CC3IE; (TIM1)->CR1 |= TIM_CR1_CEN; }
 #define DISABLE_VVT_TIMER()   (TIM1)->DIER &= ~TIM_DIER_CC3IE
 
-#define ENABLE_FAN_TIMER()  (TIM1)->SR = ~TIM_FLAG_CC1; (TIM1)->DIER |= TIM_DIER_CC1IE; (TIM1)->CR1 |= TIM_CR1_CEN;  
+#define ENABLE_FAN_TIMER()  if(!AUX_PWM_ON_HW(AUX_PWM_FAN)) { (TIM1)->SR = ~TIM_FLAG_CC1; (TIM1)->DIER |= TIM_DIER_CC1IE; (TIM1)->CR1 |= TIM_CR1_CEN; }
 #define DISABLE_FAN_TIMER() (TIM1)->DIER &= ~TIM_DIER_CC1IE
 
 #define BOOST_TIMER_COMPARE   (TIM1)->CCR2
@@ -316,8 +361,9 @@ static inline void FUEL8_TIMER_DISABLE(void) {(TIM5)->DIER &= ~TIM_DIER_CC4IE;}
 #define IDLE_COUNTER   (TIM1)->CNT
 #define IDLE_COMPARE   (TIM1)->CCR4
 
-#define IDLE_TIMER_ENABLE()  (TIM1)->SR = ~TIM_FLAG_CC4; (TIM1)->DIER |= TIM_DIER_CC4IE; (TIM1)->CR1 |= TIM_CR1_CEN;
+#define IDLE_TIMER_ENABLE()  if(!AUX_PWM_ON_HW(AUX_PWM_IDLE)) { (TIM1)->SR = ~TIM_FLAG_CC4; (TIM1)->DIER |= TIM_DIER_CC4IE; (TIM1)->CR1 |= TIM_CR1_CEN; }
 #define IDLE_TIMER_DISABLE() (TIM1)->DIER &= ~TIM_DIER_CC4IE
+#endif
 
 /*
 ***********************************************************************************************************
@@ -359,6 +405,7 @@ void fuelSchedule8Interrupt(HardwareTimer*);
 void idleInterrupt(HardwareTimer*);
 void vvtInterrupt(HardwareTimer*);
 void fanInterrupt(HardwareTimer*);
+void softPWMInterrupt(HardwareTimer*);
 void ignitionSchedule1Interrupt(HardwareTimer*);
 void ignitionSchedule2Interrupt(HardwareTimer*);
 void ignitionSchedule3Interrupt(HardwareTimer*);
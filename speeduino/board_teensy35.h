@@ -18,6 +18,7 @@
   #define SERIAL_BUFFER_SIZE 517 //Size of the serial buffer used by new comms protocol. For SD transfers this must be at least 512 + 1 (flag) + 4 (sector)
   #define FPU_MAX_SIZE 32 //Size of the FPU buffer. 0 means no FPU.
   #define SD_LOGGING //SD logging enabled by default for Teensy 3.5 as it has the slot built in
+  #define CALIBRATION_LUT //The CLT, IAT and O2 calibrations are expanded to a lookup table with an entry per ADC value (5kB of RAM), see updateCalibrationLUT()
   #define BOARD_MAX_DIGITAL_PINS 34
   #define BOARD_MAX_IO_PINS 34 //digital pins + analog channels + 1
   #ifdef USE_SPI_EEPROM
@@ -6,6 +6,7 @@
 #include "scheduler.h"
 #include "timers.h"
 #include "comms_secondary.h"
+#include "acc_mc33810.h"
 
 /*
   //These are declared locally in comms_CAN now due to this issue: https://github.com/tonton81/FlexCAN_T4/issues/67
@@ -279,6 +280,71 @@ void TMR4_isr(void)
   else if(interrupt4) { TMR4_CSCTRL3 &= ~TMR_CSCTRL_TCF1; ignitionSchedule8Interrupt(); }
 }
 
+/*
+Hardware PWM for the auxiliary outputs (See auxPWMAttach()).
+Only the FlexPWM pins are used as the quad timers are all taken by the schedules. Pins on the same FlexPWM submodule share the same frequency
+*/
+static uint8_t hwPWMPins[AUX_PWM_CHANNELS];
+
+static inline bool pinHasFlexPWM(uint8_t pin)
+{
+  return ( (pin <= 9U) || ((pin >= 22U) && (pin <= 25U)) || (pin == 28U) || (pin == 29U) || (pin == 33U) || (pin == 36U) || (pin == 37U) );
+}
+
+/*
+The slowest FlexPWM period is 65536 counts of the bus clock with the largest prescaler (128), ~18Hz at the 150MHz bus.
+analogWriteFrequency() cannot go below this, so slower outputs (Boost, VVT and idle can be set down to 10Hz) are left to the PIT based software PWM
+*/
+static inline uint16_t flexPWMMinFrequency(void)
+{
+  return (uint16_t)((F_BUS_ACTUAL / (128UL * 65536UL)) + 1UL);
+}
+
+bool boardPWMAttach(uint8_t channel, uint8_t pin, uint16_t frequency)
+{
+  if( (pinHasFlexPWM(pin) == false) || pinIsReserved(pin) ) { return false; }
+  if(frequency < flexPWMMinFrequency()) { return false; }
+
+  hwPWMPins[channel] = pin;
+  analogWriteResolution(12); //Matches HW_PWM_FULL_DUTY
+  analogWriteFrequency(pin, frequency);
+  return true;
+}
+
+void boardPWMWrite(uint8_t channel, uint16_t duty)
+{
+  analogWrite(hwPWMPins[channel], duty);
+}
+
+/*
+Non-blocking 16 bit transfers on LPSPI4 (The SPI object) for the MC33810 drivers. The SPI settings are the ones set by initMC33810(), only the frame size is changed for the transfer.
+The receive data interrupt fires once the whole frame has been clocked out, which is when the CS line can be raised
+*/
+static uint32_t mc33810SavedTCR;
+
+static void LPSPI4_isr(void)
+{
+  uint16_t reply = (uint16_t)LPSPI4_RDR;
+  LPSPI4_IER = 0;
+  LPSPI4_TCR = mc33810SavedTCR;
+  mc33810TransferComplete(reply);
+}
+
+void boardMC33810Init(void)
+{
+  LPSPI4_IER = 0;
+  attachInterruptVector(IRQ_LPSPI4, LPSPI4_isr);
+  NVIC_ENABLE_IRQ(IRQ_LPSPI4);
+}
+
+void boardMC33810Transfer(uint16_t command)
+{
+  mc33810SavedTCR = LPSPI4_TCR;
+  LPSPI4_TCR = (mc33810SavedTCR & 0xFFFFF000UL) | LPSPI_TCR_FRAMESZ(15);
+  LPSPI4_TDR = command;
+  LPSPI4_IER = LPSPI_IER_RDIE;
+}
+
 uint16_t freeRam()
 {
     uint32_t stackTop;
@@ -25,11 +25,18 @@
   typedef int eeprom_address_t;
   #define RTC_ENABLED
   #define SD_LOGGING //SD logging enabled by default for Teensy 4.1 as it has the slot built in
+  #define CALIBRATION_LUT //The CLT, IAT and O2 calibrations are expanded to a lookup table with an entry per ADC value (5kB of RAM), see updateCalibrationLUT()
   #define RTC_LIB_H "TimeLib.h"
   #define SD_CONFIG  SdioConfig(FIFO_SDIO) //Set Teensy to use SDIO in FIFO mode. This is the fastest SD mode on Teensy as it offloads most of the writes
 
   #define micros_safe() micros() //timer5 method is not used on anything but AVR, the micros_safe() macro is simply an alias for the normal micros()
   //#define PWM_FAN_AVAILABLE
+  #define HW_PWM_AVAILABLE //Boost, VVT and idle above ~18Hz can be run by the FlexPWM modules, see boardPWMAttach()
+  bool boardPWMAttach(uint8_t channel, uint8_t pin, uint16_t frequency);
+  void boardPWMWrite(uint8_t channel, uint16_t duty);
+  #define MC33810_ASYNC //The MC33810 ON/OFF commands are sent from the LPSPI4 interrupt rather than waiting on the transfer, see mc33810Write()
+  void boardMC33810Init(void);
+  void boardMC33810Transfer(uint16_t command);
   #define pinIsReserved(pin)  ( ((pin) == 0) || ((pin) == 42) || ((pin) == 43) || ((pin) == 44) || ((pin) == 45) || ((pin) == 46) || ((pin) == 47) ) //Forbidden pins like USB
 
 
@@ -134,10 +141,11 @@
 ***********************************************************************************************************
 * Auxiliaries
 */
-  #define ENABLE_BOOST_TIMER()  PIT_TCTRL1 |= PIT_TCTRL_TEN
+  //Outputs that are on a hardware PWM (See auxPWMAttach()) never need their timer
+  #define ENABLE_BOOST_TIMER()  if(!AUX_PWM_ON_HW(AUX_PWM_BOOST)) { PIT_TCTRL1 |= PIT_TCTRL_TEN; }
   #define DISABLE_BOOST_TIMER() PIT_TCTRL1 &= ~PIT_TCTRL_TEN
 
-  #define ENABLE_VVT_TIMER()    PIT_TCTRL2 |= PIT_TCTRL_TEN
+  #define ENABLE_VVT_TIMER()    if(!VVT_PWM_ON_HW()) { PIT_TCTRL2 |= PIT_TCTRL_TEN; }
   #define DISABLE_VVT_TIMER()   PIT_TCTRL2 &= ~PIT_TCTRL_TEN
 
   //Ran out of timers, this most likely won't work. This should be possible to implement with the GPT timer. 
@@ -160,7 +168,7 @@
   #define IDLE_COUNTER 0
   #define IDLE_COMPARE PIT_LDVAL0
 
-  #define IDLE_TIMER_ENABLE() PIT_TCTRL0 |= PIT_TCTRL_TEN
+  #define IDLE_TIMER_ENABLE() if(!AUX_PWM_ON_HW(AUX_PWM_IDLE)) { PIT_TCTRL0 |= PIT_TCTRL_TEN; }
   #define IDLE_TIMER_DISABLE() PIT_TCTRL0 &= ~PIT_TCTRL_TEN
 
 /*
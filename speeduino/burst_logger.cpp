@@ -0,0 +1,238 @@
+/** \file burst_logger.cpp
+ * @brief Triggered high rate logging to RAM. See burst_logger.h
+ */
+#include "globals.h"
+#include BOARD_H
+
+#ifdef SD_LOGGING
+#include "burst_logger.h"
+#include "SD_logger.h"
+
+static burst_sample_t burstSamples[BURST_LOG_SIZE];
+static uint16_t burstHead = 0; //Index that the next sample will be written to
+static uint16_t burstSampleCount = 0; //Number of valid samples in the buffer (Saturates at BURST_LOG_SIZE)
+static uint16_t burstPostRemaining = 0; //Number of post trigger samples still to be recorded
+static uint16_t burstTriggerIndex = 0;
+static uint16_t burstPreSamples = 0; //Number of pre trigger samples that will be written for the current capture
+static uint16_t burstPostSamples = 0; //Number of post trigger samples that will be written for the current capture
+static uint8_t burstTriggerReason = 0;
+
+//Previous states, used to only trigger on the rising edge of each condition
+static uint8_t lastSyncLossCounter = 0;
+static bool lastKnockActive = false;
+static bool lastRevLimit = false;
+static bool lastProtect = false;
+static bool lastOutput = false;
+
+//Flush state
+static ExFile burstFile;
+static uint16_t burstFlushIndex = 0; //Index of the next sample to be written
+static uint16_t burstFlushRemaining = 0; //Number of samples still to be written
+static char burstSectorBuffer[SD_SECTOR_SIZE + 96U]; //1 sector plus room for a full row
+static uint16_t burstSectorBufferLength = 0;
+
+uint8_t burstLogState = BURST_STATE_OFF;
+
+static const char burstTriggerNames[][10] = { "Sync loss", "Knock", "Rev limit", "Protect", "Output" };
+
+#define BURST_PROTECT_MASK ( (1U << ENGINE_PROTECT_BIT_MAP) | (1U << ENGINE_PROTECT_BIT_OIL) | (1U << ENGINE_PROTECT_BIT_AFR) | (1U << ENGINE_PROTECT_BIT_COOLANT) )
+
+/**
+ * Checks each of the enabled triggers for a rising edge
+ * @return The BURST_TRIGGER_* value of the trigger that fired, or 0xFF if none did
+ */
+static uint8_t checkBurstTriggers(void)
+{
+  uint8_t trigger = 0xFF;
+
+  bool syncLoss = (currentStatus.syncLossCounter != lastSyncLossCounter);
+  bool knock = currentStatus.knockActive;
+  bool revLimit = BIT_CHECK(currentStatus.spark, BIT_SPARK_HRDLIM);
+  bool protect = ((currentStatus.engineProtectStatus & BURST_PROTECT_MASK) != 0U);
+  bool output = BIT_CHECK(currentStatus.outputsStatus, configPage15.burstLogOutput);
+
+  if( (configPage15.burstLogTrigSync == true) && (syncLoss == true) ) { trigger = BURST_TRIGGER_SYNC; }
+  else if( (configPage15.burstLogTrigKnock == true) && (knock == true) && (lastKnockActive == false) ) { trigger = BURST_TRIGGER_KNOCK; }
+  else if( (configPage15.burstLogTrigRevLimit == true) && (revLimit == true) && (lastRevLimit == false) ) { trigger = BURST_TRIGGER_REVLIMIT; }
+  else if( (configPage15.burstLogTrigProtect == true) && (protect == true) && (lastProtect == false) ) { trigger = BURST_TRIGGER_PROTECT; }
+  else if( (configPage15.burstLogTrigOutput == true) && (output == true) && (lastOutput == false) ) { trigger = BURST_TRIGGER_OUTPUT; }
+
+  lastSyncLossCounter = currentStatus.syncLossCounter;
+  lastKnockActive = knock;
+  lastRevLimit = revLimit;
+  lastProtect = protect;
+  lastOutput = output;
+
+  return trigger;
+}
+
+/**
+ * Freezes the current capture and sets up the flush of the pre and post trigger samples
+ */
+static void beginBurstFlush(void)
+{
+  burstFlushIndex = (burstTriggerIndex - burstPreSamples) & BURST_LOG_SIZE_MASK;
+  burstFlushRemaining = burstPreSamples + 1U + burstPostSamples;
+  burstSectorBufferLength = 0;
+  burstLogState = BURST_STATE_FLUSHING;
+}
+
+/**
+ * Records the current values into the ring buffer and checks the triggers. Called on every main loop
+ * This must be kept as light as possible as it runs at the full loop rate
+ */
+void burstLoggerSample(void)
+{
+  if(configPage15.burstLogEnable == false)
+  {
+    if(burstLogState != BURST_STATE_FLUSHING) { burstLogState = BURST_STATE_OFF; } //Allow any capture that is being written to finish
+    return;
+  }
+  if(burstLogState == BURST_STATE_FLUSHING) { return; } //Buffer is frozen until the capture has been written
+  if(burstLogState == BURST_STATE_OFF)
+  {
+    burstSampleCount = 0;
+    lastSyncLossCounter = currentStatus.syncLossCounter;
+    burstLogState = BURST_STATE_ARMED;
+  }
+
+  burst_sample_t &sample = burstSamples[burstHead];
+  sample.time = micros();
+  sample.RPM = currentStatus.RPM;
+  sample.MAP = (uint16_t)currentStatus.MAP;
+  sample.PW1 = currentStatus.PW1;
+  sample.dwell = currentStatus.dwell;
+  sample.TPS = currentStatus.TPS;
+  sample.advance = currentStatus.advance;
+  sample.syncLossCounter = currentStatus.syncLossCounter;
+  sample.knockRetard = currentStatus.knockRetard;
+  sample.engine = currentStatus.engine;
+  sample.spark = currentStatus.spark;
+  sample.engineProtectStatus = currentStatus.engineProtectStatus;
+  sample.O2 = currentStatus.O2;
+
+  uint16_t sampleIndex = burstHead;
+  burstHead = (burstHead + 1U) & BURST_LOG_SIZE_MASK;
+  if(burstSampleCount < BURST_LOG_SIZE) { burstSampleCount++; }
+
+  if(burstLogState == BURST_STATE_ARMED)
+  {
+    uint8_t trigger = checkBurstTriggers();
+    if(trigger != 0xFF)
+    {
+      burstTriggerReason = trigger;
+      burstTriggerIndex = sampleIndex;
+
+      //The pre and post trigger samples (Plus the trigger sample itself) must fit within the buffer
+      burstPostSamples = configPage15.burstLogPostSamples * 4U;
+      if(burstPostSamples > (BURST_LOG_SIZE - 1U)) { burstPostSamples = BURST_LOG_SIZE - 1U; }
+      burstPreSamples = configPage15.burstLogPreSamples * 4U;
+      if(burstPreSamples > (BURST_LOG_SIZE - 1U - burstPostSamples)) { burstPreSamples = BURST_LOG_SIZE - 1U - burstPostSamples; }
+      if(burstPreSamples > (burstSampleCount - 1U)) { burstPreSamples = burstSampleCount - 1U; } //Trigger occurred before the buffer was filled
+
+      burstPostRemaining = burstPostSamples;
+      burstLogState = BURST_STATE_TRIGGERED;
+      if(burstPostRemaining == 0U) { beginBurstFlush(); }
+    }
+  }
+  else if(burstLogState == BURST_STATE_TRIGGERED)
+  {
+    burstPostRemaining--;
+    if(burstPostRemaining == 0U) { beginBurstFlush(); }
+  }
+}
+
+/**
+ * Formats a single sample as a CSV row into the sector buffer
+ */
+static void appendBurstRow(const burst_sample_t &sample, uint32_t triggerTime)
+{
+  int length = snprintf(&burstSectorBuffer[burstSectorBufferLength], sizeof(burstSectorBuffer) - burstSectorBufferLength,
+            "%ld,%u,%u,%u.%u,%d,%u,%u,%u.%u,%u,%u,%u,%u,%u\r\n",
+            (long)(int32_t)(sample.time - triggerTime),
+            sample.RPM,
+            sample.MAP,
+            (sample.TPS >> 1), ((sample.TPS & 1U) * 5U),
+            sample.advance,
+            sample.PW1,
+            sample.dwell,
+            (sample.O2 / 10U), (sample.O2 % 10U),
+            sample.syncLossCounter,
+            sample.knockRetard,
+            sample.engine,
+            sample.spark,
+            sample.engineProtectStatus);
+  if(length > 0) { burstSectorBufferLength += length; }
+}
+
+/**
+ * Opens the next available burst log file and writes the header rows
+ * @return True if the file was created
+ */
+static bool openBurstFile(void)
+{
+  char filenameBuffer[13]; //8 + 1 + 3 + 1
+  uint16_t fileNumber = 1;
+
+  snprintf(filenameBuffer, sizeof(filenameBuffer), "%s%04d.%s", BURST_LOG_PREFIX, fileNumber, BURST_LOG_EXTENSION);
+  while( (fileNumber < MAX_LOG_FILES) && (sd.exists(filenameBuffer)) )
+  {
+    fileNumber++;
+    snprintf(filenameBuffer, sizeof(filenameBuffer), "%s%04d.%s", BURST_LOG_PREFIX, fileNumber, BURST_LOG_EXTENSION);
+  }
+
+  if(burstFile.open(filenameBuffer, O_RDWR | O_CREAT | O_TRUNC) == false) { return false; }
+
+  burstSectorBufferLength = snprintf(burstSectorBuffer, sizeof(burstSectorBuffer), "Trigger,%s\r\nTime(us),RPM,MAP,TPS,Advance,PW,Dwell,AFR,Sync Loss #,Knock Retard,engine,status2,Engine Protect\r\n", burstTriggerNames[burstTriggerReason]);
+  return true;
+}
+
+/**
+ * Writes the frozen capture to the SD card. Called every 1ms from the main loop
+ * At most 1 sector is written on each call so that the main loop is not held up by the card
+ */
+void burstLoggerFlush(void)
+{
+  if(burstLogState != BURST_STATE_FLUSHING) { return; }
+
+  //Captures cannot be saved without a card. Discard it and re-arm
+  if( (SD_status != SD_STATUS_READY) && (SD_status != SD_STATUS_ACTIVE) )
+  {
+    burstLogState = BURST_STATE_OFF;
+    return;
+  }
+  if(sd.isBusy() || (logFile.isOpen() && logFile.isBusy())) { return; }
+
+  if(burstFile.isOpen() == false)
+  {
+    if(openBurstFile() == false)
+    {
+      burstLogState = BURST_STATE_OFF;
+      return;
+    }
+  }
+
+  uint32_t triggerTime = burstSamples[burstTriggerIndex].time;
+  while( (burstSectorBufferLength < SD_SECTOR_SIZE) && (burstFlushRemaining > 0U) )
+  {
+    appendBurstRow(burstSamples[burstFlushIndex], triggerTime);
+    burstFlushIndex = (burstFlushIndex + 1U) & BURST_LOG_SIZE_MASK;
+    burstFlushRemaining--;
+  }
+
+  if(burstSectorBufferLength >= SD_SECTOR_SIZE)
+  {
+    burstFile.write(burstSectorBuffer, SD_SECTOR_SIZE);
+    burstSectorBufferLength -= SD_SECTOR_SIZE;
+    memmove(burstSectorBuffer, &burstSectorBuffer[SD_SECTOR_SIZE], burstSectorBufferLength);
+  }
+  else
+  {
+    //All samples have been formatted and the remaining data is less than 1 sector
+    burstFile.write(burstSectorBuffer, burstSectorBufferLength);
+    burstFile.close();
+    burstLogState = BURST_STATE_OFF; //Will be re-armed with an empty buffer on the next sample
+  }
+}
+
+#endif //SD_LOGGING
@@ -0,0 +1,56 @@
+/** \file burst_logger.h
+ * @brief Triggered high rate logging to RAM
+ *
+ * The burst logger records a small set of channels into a RAM ring buffer on every main loop. When one of the configured triggers occurs
+ * (Sync loss, knock, rev limiter, engine protection or a programmable output) the samples from before and after the trigger are frozen and
+ * written to a BST_xxxx.csv file on the SD card in the background.
+ * This gives loop resolution captures of short events that are not possible with the normal SD log rates
+ */
+#ifndef BURST_LOGGER_H
+#define BURST_LOGGER_H
+
+#include "globals.h"
+
+#ifdef SD_LOGGING
+
+#define BURST_LOG_SIZE          1024U /**< Number of samples held in RAM. Must be a power of 2 */
+#define BURST_LOG_SIZE_MASK     (BURST_LOG_SIZE - 1U)
+#define BURST_LOG_PREFIX        "BST_"
+#define BURST_LOG_EXTENSION     "csv"
+
+#define BURST_STATE_OFF         0 /**< Burst logger is disabled */
+#define BURST_STATE_ARMED       1 /**< Samples are being recorded and the triggers are being checked */
+#define BURST_STATE_TRIGGERED   2 /**< A trigger has occurred and the post trigger samples are being recorded */
+#define BURST_STATE_FLUSHING    3 /**< The capture is frozen and is being written to the SD card */
+
+#define BURST_TRIGGER_SYNC      0
+#define BURST_TRIGGER_KNOCK     1
+#define BURST_TRIGGER_REVLIMIT  2
+#define BURST_TRIGGER_PROTECT   3
+#define BURST_TRIGGER_OUTPUT    4
+
+/** A single burst logger sample. Kept small as BURST_LOG_SIZE of these are held in RAM */
+struct burst_sample_t
+{
+  uint32_t time; /**< micros() when the sample was taken */
+  uint16_t RPM;
+  uint16_t MAP;
+  uint16_t PW1;
+  uint16_t dwell;
+  uint8_t TPS;
+  int8_t advance;
+  uint8_t syncLossCounter;
+  uint8_t knockRetard;
+  uint8_t engine;
+  uint8_t spark;
+  uint8_t engineProtectStatus;
+  uint8_t O2;
+};
+
+extern uint8_t burstLogState;
+
+void burstLoggerSample(void);
+void burstLoggerFlush(void);
+
+#endif //SD_LOGGING
+#endif //BURST_LOGGER_H
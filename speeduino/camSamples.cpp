@@ -0,0 +1,58 @@
+/*
+Speeduino - Simple engine management for the Arduino Mega 2560 platform
+Copyright (C) Josh Stewart
+A full copy of the license may be found in the projects root directory
+*/
+/** @file
+ * Queue of the cam angles measured on each cam edge, see camSamples.h
+ */
+#include "camSamples.h"
+
+#define CAM_SAMPLE_MASK (CAM_SAMPLE_QUEUE_SIZE - 1U)
+
+static_assert( (CAM_SAMPLE_QUEUE_SIZE & CAM_SAMPLE_MASK) == 0U, "CAM_SAMPLE_QUEUE_SIZE must be a power of 2");
+
+static volatile int16_t sampleAngles[CAM_SAMPLE_CAMS][CAM_SAMPLE_QUEUE_SIZE];
+static volatile uint32_t sampleTimes[CAM_SAMPLE_CAMS][CAM_SAMPLE_QUEUE_SIZE];
+static volatile uint8_t sampleHead[CAM_SAMPLE_CAMS]; //Next slot to write, only changed by camSamplePush()
+static volatile uint8_t sampleTail[CAM_SAMPLE_CAMS]; //Next slot to read, only changed by camSamplePop() and camSampleReset()
+
+/**
+ * Adds a measurement to the queue of a cam. Called from the cam trigger interrupts
+ * @param cam CAM_SAMPLE_VVT1 or CAM_SAMPLE_VVT2
+ * @param angle The cam angle
+ * @param time micros() at the cam edge the angle was measured on
+ */
+void camSamplePush(uint8_t cam, int16_t angle, uint32_t time)
+{
+  uint8_t head = sampleHead[cam];
+  uint8_t next = (head + 1U) & CAM_SAMPLE_MASK;
+  if(next == sampleTail[cam]) { return; } //Full
+
+  sampleAngles[cam][head] = angle;
+  sampleTimes[cam][head] = time;
+  sampleHead[cam] = next; //The sample is only visible to the reader once it has been written
+}
+
+/**
+ * Takes the oldest measurement off the queue of a cam
+ * @param cam CAM_SAMPLE_VVT1 or CAM_SAMPLE_VVT2
+ * @param sample Set to the measurement
+ * @return false if the queue was empty
+ */
+bool camSamplePop(uint8_t cam, camSample_t &sample)
+{
+  uint8_t tail = sampleTail[cam];
+  if(tail == sampleHead[cam]) { return false; }
+
+  sample.angle = sampleAngles[cam][tail];
+  sample.time = sampleTimes[cam][tail];
+  sampleTail[cam] = (tail + 1U) & CAM_SAMPLE_MASK;
+  return true;
+}
+
+/** Discards all the measurements in the queue of a cam. Must only be called by the reader (The main loop) */
+void camSampleReset(uint8_t cam)
+{
+  sampleTail[cam] = sampleHead[cam];
+}
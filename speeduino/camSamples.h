@@ -0,0 +1,31 @@
+/** \file camSamples.h
+ * @brief Queue of the cam angles measured on each cam edge
+ *
+ * The decoders measure the VVT cam angles in the cam trigger interrupts, but the closed loop VVT PIDs run in the main loop. Rather than the main loop sampling
+ * whatever the last angle was at a fixed rate, every measurement is pushed onto a small queue along with the time of the cam edge it was measured on. The main loop
+ * then runs a PID step for every measurement, using the time between the edges as the sample time (See vvtEdgeControl()).
+ *
+ * There is one queue per cam. Each queue only has one writer (The cam trigger interrupt) and one reader (The main loop), and the indexes are single bytes,
+ * so no interrupt locking is needed. When a queue is full the new measurement is dropped, which only happens if the main loop stops reading it.
+ */
+#ifndef CAMSAMPLES_H
+#define CAMSAMPLES_H
+
+#include <stdint.h>
+
+#define CAM_SAMPLE_VVT1       0U
+#define CAM_SAMPLE_VVT2       1U
+#define CAM_SAMPLE_CAMS       2U
+#define CAM_SAMPLE_QUEUE_SIZE 8U /**< Must be a power of 2 */
+
+struct camSample_t
+{
+  int16_t angle; /**< The cam angle, the same as currentStatus.vvt1Angle/vvt2Angle */
+  uint32_t time; /**< micros() at the cam edge */
+};
+
+void camSamplePush(uint8_t cam, int16_t angle, uint32_t time);
+bool camSamplePop(uint8_t cam, camSample_t &sample);
+void camSampleReset(uint8_t cam);
+
+#endif
@@ -18,6 +18,7 @@ A full copy of the license may be found in the projects root directory
 #include "pages.h"
 #include "page_crc.h"
 #include "logger.h"
+#include "sensors.h"
 #include "comms_legacy.h"
 #include "src/FastCRC/FastCRC.h"
 #include <avr/pgmspace.h>
@@ -388,6 +389,9 @@ static void loadO2CalibrationChunk(uint16_t offset, uint16_t chunkSize)
     //All chunks have been received (1024 values). Finalise the CRC and burn to EEPROM
     storeCalibrationCRC32(O2_CALIBRATION_PAGE, ~calibrationCRC);
     writeCalibrationPage(O2_CALIBRATION_PAGE);
+    #if defined(CALIBRATION_LUT)
+      updateCalibrationLUT(O2_CALIBRATION_PAGE);
+    #endif
   }
 }
 
@@ -424,6 +428,9 @@ static void processTemperatureCalibrationTableUpdate(uint16_t calibrationLength,
     }
     storeCalibrationCRC32(calibrationPage, CRC32_serial.crc32(&serialPayload[7], 64));
     writeCalibrationPage(calibrationPage);
+    #if defined(CALIBRATION_LUT)
+      updateCalibrationLUT(calibrationPage);
+    #endif
     sendReturnCodeMsg(SERIAL_RC_OK);
   }
   else 
@@ -19,6 +19,8 @@ A full copy of the license may be found in the projects root directory
 #include "page_crc.h"
 #include "logger.h"
 #include "table3d_axis_io.h"
+#include "taskScheduler.h"
+#include "sensors.h"
 #include BOARD_H
 #ifdef RTC_ENABLED
   #include "rtc_common.h"
@@ -447,6 +449,10 @@ void legacySerialCommand(void)
     #endif
       break;
 
+    case 'y': //Send the task scheduler stats to a terminal emulator
+      sendTaskStats();
+      break;
+
     case 'z': //Send 256 tooth log entries to a terminal emulator
       sendToothLog_legacy(0); //Sends tooth log values as chars
       break;
@@ -489,6 +495,7 @@ void legacySerialCommand(void)
          "T - Displays 256 tooth log entries in binary\n"
          "r - Displays 256 tooth log entries\n"
          "U - Prepare for firmware update. The next byte received will cause the Arduino to reset.\n"
+         "y - Displays the run time, jitter and overruns of each task since the last y command\n"
          "? - Displays this help page"
        ));
      #endif
@@ -1239,6 +1246,9 @@ void receiveCalibration(byte tableID)
   }
 
   writeCalibration();
+  #if defined(CALIBRATION_LUT)
+    updateCalibrationLUT(tableID);
+  #endif
 }
 
 /** Send 256 tooth log entries to serial.
@@ -1313,6 +1323,30 @@ void sendCompositeLog_legacy(byte startOffset) /* Non-blocking */
   } 
 }
 
+/** Send the stats of each task as text, one line per task. The maximums and overruns are then reset, so each call shows the worst case since the previous one.
+ * Times are in uS. The rate is the period of the task in ms, or 0 for a task that runs on every loop
+*/
+void sendTaskStats(void)
+{
+  Serial.println(F("Task\tRate\tAvg\tMax\tJitter\tOverruns"));
+  for(uint8_t x = 0; x < getTaskCount(); x++)
+  {
+    const task_t *task = getTask(x);
+    Serial.print(task->name);
+    Serial.print('\t');
+    Serial.print(taskPeriod(task->rate) / 1000UL);
+    Serial.print('\t');
+    Serial.print(task->runtimeAverage);
+    Serial.print('\t');
+    Serial.print(task->runtimeMax);
+    Serial.print('\t');
+    Serial.print(task->jitterMax);
+    Serial.print('\t');
+    Serial.println(task->overruns);
+  }
+  resetTaskStats();
+}
+
 void testComm(void)
 {
   Serial.write(1);
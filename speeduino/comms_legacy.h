@@ -83,6 +83,7 @@ void sendPageASCII(void);
 void receiveCalibration(byte tableID);
 void testComm(void);
 void sendToothLog_legacy(byte startOffset);
+void sendTaskStats(void);
 void sendCompositeLog_legacy(byte startOffset);
 
 #endif // COMMS_H
@@ -29,22 +29,22 @@ There are 2 top level functions that call more detailed corrections for Fuel and
 #include "timers.h"
 #include "maths.h"
 #include "sensors.h"
-#include "src/PID_v1/PID_v1.h"
+#include "src/PID/fixedPID.h"
+#include "knock.h"
+#include "crankMaths.h"
 
 long PID_O2, PID_output, PID_AFRTarget;
 /** Instance of the PID object in case that algorithm is used (Always instantiated).
 * Needs to be global as it maintains state outside of each function call.
-* Comes from Arduino (?) PID library.
+* The gains are small fractions of a % per AFR unit, so this uses more fractional bits than the other PIDs.
 */
-PID egoPID(&PID_O2, &PID_output, &PID_AFRTarget, configPage6.egoKP, configPage6.egoKI, configPage6.egoKD, REVERSE);
+fixedPID<16> egoPID(&PID_O2, &PID_output, &PID_AFRTarget, REVERSE);
 
 byte activateMAPDOT; //The mapDOT value seen when the MAE was activated. 
 byte activateTPSDOT; //The tpsDOT value seen when the MAE was activated.
 
 bool idleAdvActive = false;
 uint16_t AFRnextCycle;
-unsigned long knockStartTime;
-byte lastKnockCount;
 int16_t knockWindowMin; //The current minimum crank angle for a knock pulse to be valid
 int16_t knockWindowMax;//The current maximum crank angle for a knock pulse to be valid
 uint8_t aseTaper;
@@ -57,11 +57,15 @@ uint8_t dfcoTaper;
  */
 void initialiseCorrections(void)
 {
+  egoPID.SetSampleTime(0); //The O2 PID runs every egoCount ignition events rather than at a fixed time
+  egoPID.SetDerivativeFilter(1);
   egoPID.SetMode(AUTOMATIC); //Turn O2 PID on
   currentStatus.flexIgnCorrection = 0;
   currentStatus.egoCorrection = 100; //Default value of no adjustment must be set to avoid randomness on first correction cycle after startup
   AFRnextCycle = 0;
   currentStatus.knockActive = false;
+  currentStatus.knockRetard = 0;
+  knockReset();
   currentStatus.battery10 = 125; //Set battery voltage to sensible value for dwell correction for "flying start" (else ignition gets spurious pulses after boot)  
 }
 
@@ -649,7 +653,7 @@ byte correctionAFRClosedLoop(void)
           //*************************************************************************************************************************************
           //PID algorithm
           egoPID.SetOutputLimits((long)(-configPage6.egoLimit), (long)(configPage6.egoLimit)); //Set the limits again, just in case the user has changed them since the last loop. Note that these are sent to the PID library as (Eg:) -15 and +15
-          egoPID.SetTunings(configPage6.egoKP, configPage6.egoKI, configPage6.egoKD); //Set the PID values again, just in case the user has changed them since the last loop
+          egoPID.SetTunings(configPage6.egoKP, configPage6.egoKI, configPage6.egoKD * 10, 1, 1000); //Set the PID values again, just in case the user has changed them since the last loop. Kp and Ki are 0.001% per 0.1 AFR of error, Kd is 0.01%
           PID_O2 = (long)(currentStatus.O2);
           PID_AFRTarget = (long)(currentStatus.afrTarget);
 
@@ -886,40 +890,64 @@ int8_t correctionSoftFlatShift(int8_t advance)
   return ignSoftFlatValue;
 }
 /** Ignition knock (retard) correction.
+ * The knock retard is per ignition channel, so it is applied in calculateIgnitionAngles() rather than here (See knock.h).
+ * This sets the knock window for the scheduler and knock input interrupts and runs the retard / recovery of each channel.
+ * The advance is returned unchanged, currentStatus.knockRetard is the highest retard of any channel.
  */
 int8_t correctionKnock(int8_t advance)
 {
   byte knockRetard = 0;
 
-  //First check is to do the window calculations (Assuming knock is enabled)
-  if( configPage10.knock_mode != KNOCK_MODE_OFF )
+  if( configPage10.knock_mode == KNOCK_MODE_DIGITAL )
   {
-    knockWindowMin = table2D_getValue(&knockWindowStartTable, currentStatus.RPMdiv100);
+    //Window curves are degrees ATDC. The spark is 'advance' degrees BTDC, so the window opens (advance + window start) degrees after the spark
+    knockWindowMin = (int16_t)table2D_getValue(&knockWindowStartTable, currentStatus.RPMdiv100) - KNOCK_WINDOW_ANGLE_OFFSET;
     knockWindowMax = knockWindowMin + table2D_getValue(&knockWindowDurationTable, currentStatus.RPMdiv100);
-  }
-
 
-  if( (configPage10.knock_mode == KNOCK_MODE_DIGITAL)  )
-  {
-    //
-    if(knockCounter > configPage10.knock_count)
+    int16_t openAngle = knockWindowMin + advance;
+    int16_t closeAngle = knockWindowMax + advance;
+    if(openAngle < 0) { openAngle = 0; } //Window cannot open before the coil that arms it has fired
+    if(closeAngle < openAngle) { closeAngle = openAngle; }
+    uint32_t openDelay = angleToTimeMicroSecPerDegree((uint16_t)openAngle);
+    uint32_t closeDelay = angleToTimeMicroSecPerDegree((uint16_t)closeAngle);
+    if(openDelay > UINT16_MAX) { openDelay = UINT16_MAX; }
+    if(closeDelay > UINT16_MAX) { closeDelay = UINT16_MAX; }
+    noInterrupts();
+    knockSetWindow((uint16_t)openDelay, (uint16_t)closeDelay, configPage10.knock_count);
+    interrupts();
+
+    //Knock is only looked for below the max RPM and MAP
+    knockWindowsEnabled = (currentStatus.hasSync == true) && (currentStatus.RPMdiv100 < configPage10.knock_maxRPM) && (currentStatus.MAP < ((uint16_t)configPage10.knock_maxMAP * 2U));
+
+    //The retard and recovery carry on when above the max RPM or MAP, there will just not be any new knock events
+    knockRetardSettings_t settings;
+    settings.firstStep = configPage10.knock_firstStep;
+    settings.stepSize = configPage10.knock_stepSize;
+    settings.maxRetard = configPage10.knock_maxRetard;
+    settings.recoveryStep = configPage10.knock_recoveryStep;
+    settings.stepTime = configPage10.knock_stepTime * 100U;
+    settings.duration = configPage10.knock_duration * 100U;
+    settings.recoveryStepTime = configPage10.knock_recoveryStepTime * 100U;
+
+    uint32_t now = millis();
+    for(uint8_t channel = 0; (channel < maxIgnOutputs) && (channel < KNOCK_MAX_CHANNELS); channel++)
     {
-      if(currentStatus.knockActive == true)
-      {
-        //Knock retard is currently 
-      }
-      else
-      {
-        //Knock needs to be activated
-        lastKnockCount = knockCounter;
-        knockStartTime = micros();
-        knockRetard = configPage10.knock_firstStep;
-      }
+      uint8_t channelRetard = knockUpdateChannel(channel, now, settings);
+      if(channelRetard > knockRetard) { knockRetard = channelRetard; }
     }
-
   }
 
-  return advance - knockRetard;
+  currentStatus.knockRetard = knockRetard;
+  currentStatus.knockActive = (knockRetard > 0U);
+  return advance;
+}
+
+/** Called when page 10 is changed. correctionKnock() only updates knockWindowsEnabled while the knock mode is digital, so the windows are stopped here
+ * as soon as the mode is changed away from it rather than the scheduler carrying on arming them
+ */
+void knockConfigChanged(void)
+{
+  if(configPage10.knock_mode != KNOCK_MODE_DIGITAL) { knockWindowsEnabled = false; }
 }
 
 /** Ignition DFCO taper correction.
@@ -38,6 +38,7 @@ int8_t correctionNitrous(int8_t advance);
 int8_t correctionSoftLaunch(int8_t advance);
 int8_t correctionSoftFlatShift(int8_t advance);
 int8_t correctionKnock(int8_t advance);
+void knockConfigChanged(void);
 int8_t correctionDFCOignition(int8_t advance);
 
 uint16_t correctionsDwell(uint16_t dwell);
@@ -46,8 +47,6 @@ extern byte activateMAPDOT; //The mapDOT value seen when the MAE was activated.
 extern byte activateTPSDOT; //The tpsDOT value seen when the MAE was activated. 
 
 extern uint16_t AFRnextCycle;
-extern unsigned long knockStartTime;
-extern byte lastKnockCount;
 extern int16_t knockWindowMin; //The current minimum crank angle for a knock pulse to be valid
 extern int16_t knockWindowMax;//The current maximum crank angle for a knock pulse to be valid
 extern uint8_t aseTaper;
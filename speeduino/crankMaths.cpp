@@ -38,6 +38,8 @@ uint16_t timeToAngleDegPerMicroSec(uint32_t time) {
 }
 
 
+/* This is a plain division by the last tooth time. A cached (libdivide) divider is not used here as the divisor changes on every tooth,
+ * and generating a 32 bit divider needs a 64/32 division that costs more than the single 32/32 division it would replace. */
 uint16_t timeToAngleIntervalTooth(uint32_t time)
 {
     noInterrupts();
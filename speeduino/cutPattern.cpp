@@ -0,0 +1,56 @@
+/*
+Speeduino - Simple engine management for the Arduino Mega 2560 platform
+Copyright (C) Josh Stewart
+A full copy of the license may be found in the projects root directory
+*/
+/** @file
+ * Deterministic cut pattern for the rolling rev limiter, see cutPattern.h
+ */
+#include "cutPattern.h"
+
+static uint8_t pattern[(CUT_PATTERN_LENGTH + 7U) / 8U]; //1 bit per event, set if the event is cut
+static uint8_t patternPercent = 0; //The cut percentage the pattern was built for
+static uint8_t patternIndex = 0; //The next event
+
+static void buildPattern(uint8_t cutPercent)
+{
+  if(cutPercent > 100U) { cutPercent = 100U; }
+  uint8_t cuts = (uint8_t)((((uint16_t)cutPercent * CUT_PATTERN_LENGTH) + 50U) / 100U); //Number of cut events in the pattern
+
+  //Spread the cut events evenly through the pattern (Bresenham), so that no divisions are needed per event
+  uint8_t error = 0;
+  for(uint8_t x = 0; x < CUT_PATTERN_LENGTH; x++)
+  {
+    error += cuts;
+    if(error >= CUT_PATTERN_LENGTH)
+    {
+      error -= CUT_PATTERN_LENGTH;
+      pattern[x >> 3] |= (uint8_t)(1U << (x & 7U));
+    }
+    else { pattern[x >> 3] &= (uint8_t)~(1U << (x & 7U)); }
+  }
+  patternPercent = cutPercent;
+}
+
+/**
+ * Get whether the next event is cut
+ * @param cutPercent The percentage of events to cut (0-100). The pattern is rebuilt when this changes
+ * @return true if the event is to be cut
+ */
+bool cutPatternNext(uint8_t cutPercent)
+{
+  if(cutPercent >= 100U) { return true; }
+  if(cutPercent == 0U) { return false; }
+  if(cutPercent != patternPercent) { buildPattern(cutPercent); }
+
+  bool cut = (pattern[patternIndex >> 3] & (1U << (patternIndex & 7U))) != 0U;
+  patternIndex++;
+  if(patternIndex >= CUT_PATTERN_LENGTH) { patternIndex = 0; }
+  return cut;
+}
+
+/** Start again from the first event of the pattern */
+void cutPatternReset(void)
+{
+  patternIndex = 0;
+}
@@ -0,0 +1,21 @@
+/** \file cutPattern.h
+ * @brief Deterministic cut pattern for the rolling rev limiter
+ *
+ * The rolling cut asks cutPatternNext() whether each channel is cut for the next cut window, going through the channels in firing order.
+ * The answers come from a bitmap of CUT_PATTERN_LENGTH events that is built whenever the cut percentage changes. The cut events are spread
+ * as evenly as possible through the bitmap, so the cut percentage is met over any few cycles rather than only on average.
+ *
+ * CUT_PATTERN_LENGTH is prime, so it is never a multiple of the number of channels. Each pass through the bitmap starts on a different channel,
+ * which stops the same cylinders from always being the ones that are cut.
+ */
+#ifndef CUTPATTERN_H
+#define CUTPATTERN_H
+
+#include <stdint.h>
+
+#define CUT_PATTERN_LENGTH 101U /**< Events in the pattern. Must be prime */
+
+bool cutPatternNext(uint8_t cutPercent);
+void cutPatternReset(void);
+
+#endif
@@ -42,6 +42,12 @@ A full copy of the license may be found in the projects root directory
 #include "crankMaths.h"
 #include "timers.h"
 #include "schedule_calcs.h"
+#include "logger.h"
+#include "sensors.h"
+#include "engineProtection.h"
+#include "toothLimiter.h"
+#include "patternDecoder.h"
+#include "camSamples.h"
 
 void nullTriggerHandler (void){return;} //initialisation function for triggerhandlers, does exactly nothing
 uint16_t nullGetRPM(void){return 0;} //initialisation function for getRpm, returns safe value of 0
@@ -50,6 +56,7 @@ int nullGetCrankAngle(void){return 0;} //initialisation function for getCrankAng
 void (*triggerHandler)(void) = nullTriggerHandler; ///Pointer for the trigger function (Gets pointed to the relevant decoder)
 void (*triggerSecondaryHandler)(void) = nullTriggerHandler; ///Pointer for the secondary trigger function (Gets pointed to the relevant decoder)
 void (*triggerTertiaryHandler)(void) = nullTriggerHandler; ///Pointer for the tertiary trigger function (Gets pointed to the relevant decoder)
+void (*triggerDecoderHandler)(void) = nullTriggerHandler; ///Pointer to the decoder's primary trigger function when triggerHandler is wrapped by toothPrimaryISR()
 uint16_t (*getRPM)(void) = nullGetRPM; ///Pointer to the getRPM function (Gets pointed to the relevant decoder)
 int (*getCrankAngle)(void) = nullGetCrankAngle; ///Pointer to the getCrank Angle function (Gets pointed to the relevant decoder)
 void (*triggerSetEndTeeth)(void) = triggerSetEndTeeth_missingTooth; ///Pointer to the triggerSetEndTeeth function of each decoder
@@ -206,6 +213,47 @@ static inline void addToothLogEntry(unsigned long toothTime, byte whichTooth)
   } //Tooth/Composite log enabled
 }
 
+#ifdef SD_LOGGING
+/** Add an entry to the SD tooth log ring (See logger.h).
+ * Unlike the TS loggers this never stops when full, entries are simply dropped until the SD logger catches up
+ * @param whichTooth - 0 for Primary (Crank), 1 for Secondary (Cam) 2 for Tertiary (Cam)
+ */
+static inline void addToothRingEntry(byte whichTooth)
+{
+  uint16_t head = toothRingHead;
+  uint16_t nextHead = (head + 1U) & TOOTH_RING_MASK;
+  if(nextHead == toothRingTail) { toothRingOverflows++; return; }
+
+  uint8_t flags = (uint8_t)(whichTooth << TOOTH_RING_TOOTH_SHIFT);
+  if(READ_PRI_TRIGGER() == true) { BIT_SET(flags, COMPOSITE_LOG_PRI); }
+  if(READ_SEC_TRIGGER() == true) { BIT_SET(flags, COMPOSITE_LOG_SEC); }
+  if(READ_THIRD_TRIGGER() == true) { BIT_SET(flags, COMPOSITE_LOG_THIRD); }
+  if(whichTooth > TOOTH_CRANK) { BIT_SET(flags, COMPOSITE_LOG_TRIG); }
+  if(currentStatus.hasSync == true) { BIT_SET(flags, COMPOSITE_LOG_SYNC); }
+  if(revolutionOne == 1) { BIT_SET(flags, COMPOSITE_ENGINE_CYCLE); }
+
+  toothRingTimes[head] = micros();
+  toothRingFlags[head] = flags;
+  toothRingHead = nextHead; //Must be updated last so the main loop never reads a partially written entry
+}
+#endif
+
+/** Primary trigger handler that runs the per tooth work after the decoder.
+* If the tooth was valid, MAP is sampled (See mapSampleTooth()) and the tooth is checked against the rev limit (See toothLimiter.h)
+*/
+void toothPrimaryISR(void)
+{
+  BIT_CLEAR(decoderState, BIT_DECODER_VALID_TRIGGER);
+  triggerDecoderHandler();
+  if( BIT_CHECK(decoderState, BIT_DECODER_VALID_TRIGGER) )
+  {
+    #if defined(MAP_CRANK_SYNC)
+      mapSampleTooth();
+    #endif
+    if( BIT_CHECK(decoderState, BIT_DECODER_TOOTH_ANG_CORRECT) && (toothLimiterTooth(toothLastToothTime - toothLastMinusOneToothTime, triggerToothAngle) == true) ) { toothRevLimitCut(); }
+  }
+}
+
 /** Interrupt handler for primary trigger.
 * This function is called on both the rising and falling edges of the primary trigger, when either the 
 * composite or tooth loggers are turned on. 
@@ -239,6 +287,14 @@ void loggerPrimaryISR(void)
     //Composite logger adds an entry regardless of which edge it was
     addToothLogEntry(curGap, TOOTH_CRANK);
   }
+
+  #ifdef SD_LOGGING
+  if(toothSDLogActive == true)
+  {
+    //As above, crank only mode only logs valid edges while all edges are logged in crank and cams mode
+    if( (configPage13.onboard_log_tooth == LOGGER_TOOTH_ALL) || ( (validEdge == true) && (BIT_CHECK(decoderState, BIT_DECODER_VALID_TRIGGER)) ) ) { addToothRingEntry(TOOTH_CRANK); }
+  }
+  #endif
 }
 
 /** Interrupt handler for secondary trigger.
@@ -264,6 +320,10 @@ void loggerSecondaryISR(void)
     //Composite logger adds an entry regardless of which edge it was
     addToothLogEntry(curGap2, TOOTH_CAM_SECONDARY);
   }
+
+  #ifdef SD_LOGGING
+  if( (toothSDLogActive == true) && (configPage13.onboard_log_tooth == LOGGER_TOOTH_ALL) ) { addToothRingEntry(TOOTH_CAM_SECONDARY); }
+  #endif
 }
 
 /** Interrupt handler for third trigger.
@@ -291,6 +351,10 @@ void loggerTertiaryISR(void)
     //Composite logger adds an entry regardless of which edge it was
     addToothLogEntry(curGap3, TOOTH_CAM_TERTIARY);
   }  
+
+  #ifdef SD_LOGGING
+  if( (toothSDLogActive == true) && (configPage13.onboard_log_tooth == LOGGER_TOOTH_ALL) ) { addToothRingEntry(TOOTH_CAM_TERTIARY); }
+  #endif
 }
 
 static inline bool IsCranking(const statuses &status) {
@@ -675,6 +739,7 @@ static inline void triggerRecordVVT1Angle (void)
     if( configPage6.vvtMode == VVT_MODE_CLOSED_LOOP ) { curAngle -= configPage10.vvtCL0DutyAng; }
 
     currentStatus.vvt1Angle = ANGLE_FILTER( (curAngle << 1), configPage4.ANGLEFILTER_VVT, currentStatus.vvt1Angle);
+    camSamplePush(CAM_SAMPLE_VVT1, currentStatus.vvt1Angle, curTime2);
   }
 }
 
@@ -706,6 +771,7 @@ void triggerThird_missingTooth(void)
     if( configPage6.vvtMode == VVT_MODE_CLOSED_LOOP ) { curAngle -= configPage4.vvt2CL0DutyAng; }
     //currentStatus.vvt2Angle = int8_t (curAngle); //vvt1Angle is only int8, but +/-127 degrees is enough for VVT control
     currentStatus.vvt2Angle = ANGLE_FILTER( (curAngle << 1), configPage4.ANGLEFILTER_VVT, currentStatus.vvt2Angle);    
+    camSamplePush(CAM_SAMPLE_VVT2, currentStatus.vvt2Angle, curTime3);
 
     toothLastThirdToothTime = curTime3;
   } //Trigger filter
@@ -4183,6 +4249,7 @@ void triggerSec_FordST170(void)
       {
         curAngle = ANGLE_FILTER( (curAngle << 1), configPage4.ANGLEFILTER_VVT, curAngle);
         currentStatus.vvt1Angle = 360 - curAngle - configPage10.vvtCL0DutyAng;
+        camSamplePush(CAM_SAMPLE_VVT1, currentStatus.vvt1Angle, curTime2);
       }
     }
   } //Trigger filter
@@ -5271,6 +5338,7 @@ void triggerSec_RoverMEMS()
       if( configPage6.vvtMode == VVT_MODE_CLOSED_LOOP ) { curAngle -= configPage10.vvtCLMinAng; }
 
       currentStatus.vvt1Angle = curAngle;
+      camSamplePush(CAM_SAMPLE_VVT1, currentStatus.vvt1Angle, curTime2);
     }
 
     if(configPage4.trigPatternSec == SEC_TRIGGER_SINGLE)
@@ -5802,3 +5870,201 @@ void triggerSetEndTeeth_SuzukiK6A(void)
 }
 /** @} */
 
+
+/** Table driven decoder for any single wheel that has a unique gap, see patternDecoder.h.
+* The wheel is either one of the built in tables (configPage15.triggerTable) or a missing tooth wheel built from the same tooth count, missing teeth and trigger speed settings as the missing tooth decoder.
+* toothCurrentCount is the position on the wheel rather than the number of teeth seen, so that the crank angle of the last tooth is always (toothCurrentCount - 1) * triggerToothAngle.
+* The secondary and third inputs are handled by the missing tooth decoder functions.
+* @defgroup dec_pattern Pattern table
+* @{
+*/
+void triggerSetup_Pattern(void)
+{
+  uint16_t cycleAngle = 360U;
+  BIT_CLEAR(decoderState, BIT_DECODER_IS_SEQUENTIAL);
+  if(configPage4.TrigSpeed == CAM_SPEED)
+  {
+    cycleAngle = 720U;
+    BIT_SET(decoderState, BIT_DECODER_IS_SEQUENTIAL);
+  }
+
+  const triggerPattern_t *pattern = patternTable(configPage15.triggerTable);
+  if(pattern != nullptr)
+  {
+    patternCompile(*pattern);
+    if(pattern->cycleAngle == 720U) { BIT_SET(decoderState, BIT_DECODER_IS_SEQUENTIAL); }
+    else { BIT_CLEAR(decoderState, BIT_DECODER_IS_SEQUENTIAL); }
+  }
+  else { patternCompileMissingTooth(configPage4.triggerTeeth, configPage4.triggerMissingTeeth, cycleAngle); }
+
+  triggerToothAngle = patternPositionAngle(); //The number of degrees between the teeth where there is no gap
+  triggerActualTeeth = patternPositions();
+  triggerFilterTime = 0;
+  if(patternPositions() > 0U) { triggerFilterTime = (MICROS_PER_SEC / (MAX_RPM / 60U * patternPositions())); } //The shortest possible time between teeth at max RPM
+  triggerSecFilterTime = (MICROS_PER_SEC / (MAX_RPM / 60U));
+  if (configPage4.trigPatternSec == SEC_TRIGGER_4_1) { triggerSecFilterTime = MICROS_PER_MIN / MAX_RPM / 4U / 2U; }
+  BIT_CLEAR(decoderState, BIT_DECODER_2ND_DERIV);
+  toothLastMinusOneToothTime = 0;
+  toothCurrentCount = 0;
+  secondaryToothCount = 0;
+  thirdToothCount = 0;
+  toothOneTime = 0;
+  toothOneMinusOneTime = 0;
+  MAX_STALL_TIME = ((MICROS_PER_DEG_1_RPM/50U) * triggerToothAngle * patternLongestGap()); //Minimum 50rpm. (3333uS is the time per degree at 50rpm)
+
+  if( (BIT_CHECK(decoderState, BIT_DECODER_IS_SEQUENTIAL) == false) && ( (configPage4.sparkMode == IGN_MODE_SEQUENTIAL) || (configPage2.injLayout == INJ_SEQUENTIAL) ) ) { BIT_SET(decoderState, BIT_DECODER_HAS_SECONDARY); }
+  else { BIT_CLEAR(decoderState, BIT_DECODER_HAS_SECONDARY); }
+}
+
+void triggerPri_Pattern(void)
+{
+  curTime = micros();
+  curGap = curTime - toothLastToothTime;
+  if ( curGap >= triggerFilterTime )
+  {
+    BIT_SET(decoderState, BIT_DECODER_VALID_TRIGGER); //Flag this pulse as being a valid trigger (ie that it passed filters)
+
+    uint8_t toothEvents = 0;
+    if(toothLastToothTime == 0U) { patternReset(); } //First tooth after start up or a stall, the position has to be found again
+    else
+    {
+      uint32_t lastToothGap = 0;
+      if(toothLastMinusOneToothTime > 0U) { lastToothGap = toothLastToothTime - toothLastMinusOneToothTime; }
+      toothEvents = patternTooth(curGap, lastToothGap);
+    }
+    toothCurrentCount = patternPosition();
+
+    if(BIT_CHECK(toothEvents, PATTERN_EVENT_SYNC_LOST))
+    {
+      currentStatus.hasSync = false;
+      BIT_CLEAR(currentStatus.status3, BIT_STATUS3_HALFSYNC); //No sync at all, so also clear HalfSync bit.
+      currentStatus.syncLossCounter++;
+    }
+
+    if(BIT_CHECK(toothEvents, PATTERN_EVENT_CYCLE))
+    {
+      if((currentStatus.hasSync == true) || BIT_CHECK(currentStatus.status3, BIT_STATUS3_HALFSYNC))
+      {
+        currentStatus.startRevolutions++; //Counter
+        if ( BIT_CHECK(decoderState, BIT_DECODER_IS_SEQUENTIAL) ) { currentStatus.startRevolutions++; } //Add an extra revolution count if the wheel turns at cam speed
+      }
+      else { currentStatus.startRevolutions = 0; }
+
+      if (configPage4.trigPatternSec == SEC_TRIGGER_POLL) // at tooth one check if the cam sensor is high or low in poll level mode
+      {
+        if (configPage4.PollLevelPolarity == READ_SEC_TRIGGER()) { revolutionOne = 1; }
+        else { revolutionOne = 0; }
+      }
+      else { revolutionOne = !revolutionOne; } //Flip sequential revolution tracker if poll level is not used
+      toothOneMinusOneTime = toothOneTime;
+      toothOneTime = curTime;
+      if( (configPage4.trigPatternSec == SEC_TRIGGER_SINGLE) || (configPage4.trigPatternSec == SEC_TRIGGER_TOYOTA_3) ) { secondaryToothCount = 0; } //Reset the secondary tooth counter to prevent it overflowing
+    }
+
+    if(BIT_CHECK(toothEvents, PATTERN_EVENT_KEY))
+    {
+      //If either fuel or ignition is sequential on a crank wheel, only declare sync once the cam tooth has been seen
+      if( (BIT_CHECK(decoderState, BIT_DECODER_HAS_SECONDARY) == false) || (secondaryToothCount > 0) || (configPage4.trigPatternSec == SEC_TRIGGER_POLL) || (configPage2.strokes == TWO_STROKE) )
+      {
+        currentStatus.hasSync = true;
+        BIT_CLEAR(currentStatus.status3, BIT_STATUS3_HALFSYNC);
+      }
+      else if(currentStatus.hasSync != true) { BIT_SET(currentStatus.status3, BIT_STATUS3_HALFSYNC); } //If there is primary trigger but no secondary we only have half sync.
+      triggerFilterTime = 0; //This is used to prevent a condition where serious intermittent signals (Eg someone furiously plugging the sensor wire in and out) can leave the filter in an unrecoverable state
+    }
+
+    if(BIT_CHECK(toothEvents, PATTERN_EVENT_NORMAL_GAP))
+    {
+      setFilter(curGap); //Filter can only be recalculated for the regular teeth, not those after a gap
+      BIT_SET(decoderState, BIT_DECODER_TOOTH_ANG_CORRECT);
+    }
+    else { BIT_CLEAR(decoderState, BIT_DECODER_TOOTH_ANG_CORRECT); }
+
+    toothLastMinusOneToothTime = toothLastToothTime;
+    toothLastToothTime = curTime;
+
+    //NEW IGNITION MODE
+    if( (configPage2.perToothIgn == true) && (toothCurrentCount > 0U) && (!BIT_CHECK(currentStatus.engine, BIT_ENGINE_CRANK)) )
+    {
+      int16_t crankAngle = ( (toothCurrentCount-1) * triggerToothAngle ) + configPage4.triggerAngle;
+      if( (configPage4.sparkMode == IGN_MODE_SEQUENTIAL) && (revolutionOne == true) && (BIT_CHECK(decoderState, BIT_DECODER_IS_SEQUENTIAL) == false) && (configPage2.strokes == FOUR_STROKE) )
+      {
+        crankAngle += 360;
+        crankAngle = ignitionLimits(crankAngle);
+        checkPerToothTiming(crankAngle, (patternPositions() + toothCurrentCount));
+      }
+      else{ crankAngle = ignitionLimits(crankAngle); checkPerToothTiming(crankAngle, toothCurrentCount); }
+    }
+  }
+}
+
+uint16_t getRPM_Pattern(void)
+{
+  uint16_t tempRPM = currentStatus.RPM;
+  bool camSpeed = BIT_CHECK(decoderState, BIT_DECODER_IS_SEQUENTIAL);
+  if( currentStatus.RPM < currentStatus.crankRPM )
+  {
+    //Per tooth RPM can only be used when the last tooth was not after a gap
+    if( BIT_CHECK(decoderState, BIT_DECODER_TOOTH_ANG_CORRECT) ) { tempRPM = crankingGetRPM(patternPositions(), camSpeed); }
+  }
+  else { tempRPM = stdGetRPM(camSpeed); }
+  return tempRPM;
+}
+
+int getCrankAngle_Pattern(void)
+{
+  //Grab some variables that are used in the trigger code and assign them to temp variables.
+  noInterrupts();
+  int tempToothCurrentCount = toothCurrentCount;
+  bool tempRevolutionOne = revolutionOne;
+  unsigned long tempToothLastToothTime = toothLastToothTime;
+  interrupts();
+
+  if(tempToothCurrentCount == 0) { tempToothCurrentCount = 1; } //Position not known yet
+  int crankAngle = ((tempToothCurrentCount - 1) * triggerToothAngle) + configPage4.triggerAngle; //Angle of the last tooth position ATDC
+  if ( (tempRevolutionOne == true) && (BIT_CHECK(decoderState, BIT_DECODER_IS_SEQUENTIAL) == false) ) { crankAngle += 360; }
+
+  lastCrankAngleCalc = micros();
+  elapsedTime = (lastCrankAngleCalc - tempToothLastToothTime);
+  crankAngle += timeToAngleDegPerMicroSec(elapsedTime);
+
+  if (crankAngle >= 720) { crankAngle -= 720; }
+  if (crankAngle < 0) { crankAngle += CRANK_ANGLE_MAX; }
+
+  return crankAngle;
+}
+
+static uint16_t __attribute__((noinline)) calcEndTeeth_Pattern(int endAngle, uint16_t range)
+{
+  if(triggerToothAngle == 0U) { return 1; }
+  int16_t tempEndTooth = (endAngle - (int16_t)configPage4.triggerAngle) / (int16_t)triggerToothAngle;
+  //For higher tooth count triggers, add a 1 tooth margin to allow for calculation time.
+  if(patternPositions() > 12U) { tempEndTooth = tempEndTooth - 1; }
+
+  tempEndTooth = nudge(1, (int16_t)range, tempEndTooth, (int16_t)range);
+  return patternToothAtOrBefore((uint16_t)tempEndTooth, range);
+}
+
+void triggerSetEndTeeth_Pattern(void)
+{
+  uint16_t range = patternPositions();
+  if( (configPage4.sparkMode == IGN_MODE_SEQUENTIAL) && (BIT_CHECK(decoderState, BIT_DECODER_IS_SEQUENTIAL) == false) && (configPage2.strokes == FOUR_STROKE) ) { range = range * 2U; }
+
+  ignition1EndTooth = calcEndTeeth_Pattern(ignition1EndAngle, range);
+  ignition2EndTooth = calcEndTeeth_Pattern(ignition2EndAngle, range);
+  ignition3EndTooth = calcEndTeeth_Pattern(ignition3EndAngle, range);
+  ignition4EndTooth = calcEndTeeth_Pattern(ignition4EndAngle, range);
+#if IGN_CHANNELS >= 5
+  ignition5EndTooth = calcEndTeeth_Pattern(ignition5EndAngle, range);
+#endif
+#if IGN_CHANNELS >= 6
+  ignition6EndTooth = calcEndTeeth_Pattern(ignition6EndAngle, range);
+#endif
+#if IGN_CHANNELS >= 7
+  ignition7EndTooth = calcEndTeeth_Pattern(ignition7EndAngle, range);
+#endif
+#if IGN_CHANNELS >= 8
+  ignition8EndTooth = calcEndTeeth_Pattern(ignition8EndAngle, range);
+#endif
+}
+/** @} */
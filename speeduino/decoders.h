@@ -40,6 +40,7 @@
 #define DECODER_RENIX             24
 #define DECODER_ROVERMEMS		      25
 #define DECODER_SUZUKI_K6A        26
+#define DECODER_PATTERN           27
 
 #define BIT_DECODER_2ND_DERIV           0 //The use of the 2nd derivative calculation is limited to certain decoders. This is set to either true or false in each decoders setup routine
 #define BIT_DECODER_IS_SEQUENTIAL       1 //Whether or not the decoder supports sequential operation
@@ -67,6 +68,7 @@ extern bool decoderHasFixedCrankingTiming;
 void loggerPrimaryISR(void);
 void loggerSecondaryISR(void);
 void loggerTertiaryISR(void);
+void toothPrimaryISR(void);
 
 //All of the below are the 6 required functions for each decoder / pattern
 void triggerSetup_missingTooth(void);
@@ -249,11 +251,18 @@ uint16_t getRPM_SuzukiK6A(void);
 int getCrankAngle_SuzukiK6A(void);
 void triggerSetEndTeeth_SuzukiK6A(void);
 
+void triggerSetup_Pattern(void);
+void triggerPri_Pattern(void);
+uint16_t getRPM_Pattern(void);
+int getCrankAngle_Pattern(void);
+void triggerSetEndTeeth_Pattern(void);
+
 
 
 extern void (*triggerHandler)(void); //Pointer for the trigger function (Gets pointed to the relevant decoder)
 extern void (*triggerSecondaryHandler)(void); //Pointer for the secondary trigger function (Gets pointed to the relevant decoder)
 extern void (*triggerTertiaryHandler)(void); //Pointer for the tertiary trigger function (Gets pointed to the relevant decoder)
+extern void (*triggerDecoderHandler)(void); //Pointer to the decoder's primary trigger function when triggerHandler is wrapped by toothPrimaryISR()
 
 extern uint16_t (*getRPM)(void); //Pointer to the getRPM function (Gets pointed to the relevant decoder)
 extern int (*getCrankAngle)(void); //Pointer to the getCrank Angle function (Gets pointed to the relevant decoder)
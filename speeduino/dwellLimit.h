@@ -0,0 +1,46 @@
+/** \file dwellLimit.h
+ * @brief Overdwell protection of the ignition schedules
+ *
+ * The dwell limiter does not check the coils from the 1ms timer. Instead every place that sets the end compare of an ignition schedule caps it:
+ * - ignitionStartCharge() when a coil starts charging (PENDING to RUNNING), for both a fixed duration and an end set by the per tooth timing
+ * - ignitionRunningEndCompare() whenever the end of a coil that is already charging is moved, which is adjustCrankAngle() (Per tooth timing of every decoder)
+ *   and refreshIgnitionSchedule1() (Fixed cranking override)
+ * so the end compare of a charging coil is never later than the limit set when it started charging.
+ *
+ * The end of a charging coil is also never set closer to the counter than DWELL_END_MIN_TICKS. A compare that is set to a value the counter has already
+ * reached would not fire until the counter has wrapped all the way around (262ms on the Mega), which the 1ms check used to catch.
+ *
+ * These only work on timer ticks so that they can be tested natively. The wrappers that read the schedule are in schedule_calcs.hpp
+ */
+#ifndef DWELLLIMIT_H
+#define DWELLLIMIT_H
+
+#include <stdint.h>
+
+#define DWELL_END_MIN_TICKS 2U /**< Closest to the counter that the end of a charging coil is set */
+
+/**
+ * Ticks of charge for a coil that is starting to charge
+ * @param dwellTicks The requested dwell
+ * @param limitTicks The dwell limit. 0 when the dwell limiter is off
+ */
+static inline uint16_t dwellStartTicks(uint16_t dwellTicks, uint16_t limitTicks)
+{
+  if( (limitTicks != 0U) && (dwellTicks > limitTicks) ) { return limitTicks; }
+  return dwellTicks;
+}
+
+/**
+ * Ticks from now until the end of a coil that is already charging
+ * @param endTicks The requested time to the end
+ * @param ticksToLimit Time from now until the dwell limit of this charge (The limit compare minus the counter)
+ * @param limitOn false when the dwell limiter is off
+ */
+static inline uint16_t dwellRunningEndTicks(uint16_t endTicks, uint16_t ticksToLimit, bool limitOn)
+{
+  if( (limitOn == true) && (endTicks > ticksToLimit) ) { endTicks = ticksToLimit; }
+  if(endTicks < DWELL_END_MIN_TICKS) { endTicks = DWELL_END_MIN_TICKS; }
+  return endTicks;
+}
+
+#endif
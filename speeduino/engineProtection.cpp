@@ -2,6 +2,8 @@
 #include "globals.h"
 #include "engineProtection.h"
 #include "maths.h"
+#include "scheduler.h"
+#include "speeduino.h"
 
 byte oilProtStartTime = 0;
 
@@ -221,3 +223,33 @@ byte checkAFRLimit(void)
   return checkAFRLimitActive;
 }
 
+
+/**
+ * Cuts every channel and the events that are already scheduled, in the same way as the full hard cut in the main loop.
+ * Called from the primary trigger interrupt when toothLimiterTooth() starts a cut, so that the events of the next tooth are already stopped. The main loop holds the cut while toothLimiterActive() is true
+ */
+void toothRevLimitCut(void)
+{
+  for(uint8_t x = 0; x < max(maxIgnOutputs, maxInjOutputs); x++)
+  {
+    switch(configPage6.engineProtectType)
+    {
+      case PROTECT_CUT_IGN:
+        BIT_CLEAR(ignitionChannelsOn, x);
+        disablePendingIgnSchedule(x);
+        break;
+      case PROTECT_CUT_FUEL:
+        BIT_CLEAR(fuelChannelsOn, x);
+        disablePendingFuelSchedule(x);
+        break;
+      case PROTECT_CUT_BOTH:
+        BIT_CLEAR(ignitionChannelsOn, x);
+        BIT_CLEAR(fuelChannelsOn, x);
+        disablePendingIgnSchedule(x);
+        disablePendingFuelSchedule(x);
+        break;
+      default:
+        break;
+    }
+  }
+}
@@ -6,4 +6,5 @@ byte checkEngineProtect(void);
 byte checkRevLimit(void);
 byte checkBoostLimit(void);
 byte checkOilPressureLimit(void);
-byte checkAFRLimit(void);
\ No newline at end of file
+byte checkAFRLimit(void);
+void toothRevLimitCut(void);
\ No newline at end of file
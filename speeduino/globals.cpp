@@ -219,6 +219,7 @@ byte pinLaunch;
 byte pinIgnBypass; //The pin used for an ignition bypass (Optional)
 byte pinFlex; //Pin with the flex sensor attached
 byte pinVSS;  // VSS (Vehicle speed sensor) Pin
+byte pinKnock; //Digital input from a knock conditioner
 byte pinBaro; //Pin that an al barometric pressure sensor is attached to (If used)
 byte pinResetControl; // Output pin used control resetting the Arduino
 byte pinFuelPressure;
@@ -245,9 +246,11 @@ struct config10 configPage10;
 struct config13 configPage13;
 struct config15 configPage15;
 
-//byte cltCalibrationTable[CALIBRATION_TABLE_SIZE]; /**< An array containing the coolant sensor calibration values */
-//byte iatCalibrationTable[CALIBRATION_TABLE_SIZE]; /**< An array containing the inlet air temperature sensor calibration values */
-//byte o2CalibrationTable[CALIBRATION_TABLE_SIZE]; /**< An array containing the O2 sensor calibration values */
+#if defined(CALIBRATION_LUT)
+uint16_t cltCalibrationLUT[CALIBRATION_LUT_SIZE];
+uint16_t iatCalibrationLUT[CALIBRATION_LUT_SIZE];
+uint8_t o2CalibrationLUT[CALIBRATION_LUT_SIZE];
+#endif
 
 uint16_t cltCalibration_bins[32];
 uint16_t cltCalibration_values[32];
@@ -305,6 +305,10 @@
 #define KNOCK_MODE_DIGITAL  1
 #define KNOCK_MODE_ANALOG   2
 
+#define KNOCK_TRIGGER_HIGH  0
+#define KNOCK_TRIGGER_LOW   1
+#define KNOCK_WINDOW_ANGLE_OFFSET 50 //The knock window start angles are stored +50 degrees so that they can be BTDC
+
 #define FUEL2_MODE_OFF      0
 #define FUEL2_MODE_MULTIPLY 1
 #define FUEL2_MODE_ADD      2
@@ -383,6 +387,7 @@
 
 
 #define CALIBRATION_TABLE_SIZE 512 ///< Calibration table size for CLT, IAT, O2
+#define CALIBRATION_LUT_SIZE 1024 ///< Entries in the full resolution calibration lookup tables, one per 10-bit ADC value. See CALIBRATION_LUT
 #define CALIBRATION_TEMPERATURE_OFFSET 40 /**< All temperature measurements are stored offset by 40 degrees.
 This is so we can use an unsigned byte (0-255) to represent temperature ranges from -40 to 215 */
 #define OFFSET_FUELTRIM 127U ///< The fuel trim tables are offset by 128 to allow for -128 to +128 values
@@ -398,12 +403,22 @@ This is so we can use an unsigned byte (0-255) to represent temperature ranges f
 #define LOGGER_DISABLED                 0
 #define LOGGER_CSV                      1
 #define LOGGER_BINARY                   2
+#define LOGGER_MLG                      3
+
+#define LOGGER_TOOTH_OFF                0
+#define LOGGER_TOOTH_CRANK              1 //Valid crank edges only (Same as the TS tooth logger)
+#define LOGGER_TOOTH_ALL                2 //Every edge of the crank and both cam inputs (Same as the TS composite logger)
 
 #define LOGGER_RATE_1HZ                 0
 #define LOGGER_RATE_4HZ                 1
 #define LOGGER_RATE_10HZ                2
 #define LOGGER_RATE_30HZ                3
 
+#define LOGGER_FAST_RATE_OFF            0
+#define LOGGER_FAST_RATE_50HZ           1
+#define LOGGER_FAST_RATE_100HZ          2
+#define LOGGER_FAST_RATE_200HZ          3
+
 #define LOGGER_FILENAMING_OVERWRITE     0
 #define LOGGER_FILENAMING_DATETIME      1
 #define LOGGER_FILENAMING_SEQENTIAL     2
@@ -724,7 +739,7 @@ struct config2 {
   byte crankingPct;     ///< Cranking enrichment (See @ref config10, updates.ino)
   byte pinMapping;      ///< The board / ping mapping number / id to be used (See: @ref setPinMapping in init.ino)
   byte tachoPin : 6;    ///< Custom pin setting for tacho output (if != 0, override copied to pinTachOut, which defaults to board assigned tach pin)
-  byte tachoDiv : 2;    ///< Whether to change the tacho speed ("half speed tacho" ?)
+  byte tachoDiv : 2;    ///< Tacho speed. Normal, half or double (See TACHO_DIV_ in timers.h)
   byte tachoDuration;   //The duration of the tacho pulse in mS
   byte maeThresh;       /**< The MAPdot threshold that must be exceeded before AE is engaged */
   byte taeThresh;       /**< The TPSdot threshold that must be exceeded before AE is engaged */
@@ -1370,7 +1385,7 @@ struct config13 {
   byte unused12_106_116[10];
 
   byte onboard_log_csv_separator :2;  //";", ",", "tab", "space"  
-  byte onboard_log_file_style    :2;  // "Disabled", "CSV", "Binary", "INVALID" 
+  byte onboard_log_file_style    :2;  // "Disabled", "CSV", "Binary", "MLG"
   byte onboard_log_file_rate     :2;  // "1Hz", "4Hz", "10Hz", "30Hz" 
   byte onboard_log_filenaming    :2;  // "Overwrite", "Date-time", "Sequential", "INVALID" 
   byte onboard_log_storage       :2;  // "sd-card", "INVALID", "INVALID", "INVALID" ;In the future maybe an onboard spi flash can be used, or switch between SDIO vs SPI sd card interfaces.
@@ -1386,10 +1401,12 @@ struct config13 {
   byte onboard_log_tr3_thr_MAP   :1;  // "Disabled", "Enabled"
   byte onboard_log_tr3_thr_Oil   :1;  // "Disabled", "Enabled"
   byte onboard_log_tr3_thr_AFR   :1;  // "Disabled", "Enabled"     
+  byte onboard_log_tooth         :2;  // "Off", "Crank", "Crank and cams", "INVALID" ;Tooth/composite log written to the SD card alongside the main log
+  byte onboard_log_unused13_122  :2;
   byte onboard_log_tr4_thr_on;        // "V",        0.1,   0.0,  0.0,  15.90,      2 ; * (  1 byte)    
   byte onboard_log_tr4_thr_off;       // "V",        0.1,   0.0,  0.0,  15.90,      2 ; * (  1 byte)   
   byte onboard_log_tr5_Epin_pin  :6;        // "pin",      0,    0, 0,  1,    255,        0 ;  
-  byte unused13_125_2            :2;
+  byte onboard_log_fast_rate     :2;  // "Off", "50Hz", "100Hz", "200Hz" ;Overrides onboard_log_file_rate. Only used by the binary log formats
 
   byte hwTestIgnDuration;
   byte hwTestInjDuration;
@@ -1441,8 +1458,36 @@ struct config15 {
   int8_t rollingProtRPMDelta[4]; // Signed RPM value representing how much below the RPM limit. Divided by 10
   byte rollingProtCutPercent[4];
   
-  //Bytes 106-255
-  byte Unused15_106_255[150];
+  //Byte 106 - Burst logger
+  byte burstLogEnable : 1;
+  byte burstLogTrigSync : 1;    //Trigger on loss of sync
+  byte burstLogTrigKnock : 1;   //Trigger on knock
+  byte burstLogTrigRevLimit : 1; //Trigger on the hard rev limiter
+  byte burstLogTrigProtect : 1; //Trigger on any other engine protection
+  byte burstLogTrigOutput : 1;  //Trigger on a programmable output turning on
+  byte burstLogUnused : 2;
+  byte burstLogOutput : 3;      //Programmable output (0-7) used as the trigger when burstLogTrigOutput is on
+  byte burstLogUnused2 : 5;
+  byte burstLogPreSamples;      //Number of samples kept from before the trigger. Divided by 4
+  byte burstLogPostSamples;     //Number of samples recorded after the trigger. Divided by 4
+
+  //Byte 110 - Per tooth rev limiter
+  byte toothRevLimit : 1;       //The hard rev limit is also checked on every primary tooth, see toothLimiter.h
+  byte toothRevLimitUnused : 7;
+
+  //Byte 111 - Pattern table decoder
+  byte triggerTable : 4;        //Wheel used by the pattern table decoder (PATTERN_TABLE_*), see patternDecoder.h
+  byte triggerTableUnused : 4;
+
+  //Byte 112 - Closed loop VVT
+  byte vvtCLEdgeRate : 1;       //The VVT PIDs are computed on every cam edge rather than at 30Hz, see camSamples.h
+  byte vvtCLEdgeRateUnused : 7;
+
+  //Byte 113 - Stepper idle
+  byte iacStepRamp;             //Number of steps at each end of a stepper move that are slowed down, see stepGenerator.h
+
+  //Bytes 114-255
+  byte Unused15_114_255[142];
 
 #if defined(CORE_AVR)
   };
@@ -1516,6 +1561,7 @@ extern byte pinLaunch;
 extern byte pinIgnBypass; //The pin used for an ignition bypass (Optional)
 extern byte pinFlex; //Pin with the flex sensor attached
 extern byte pinVSS; 
+extern byte pinKnock; //Digital input from a knock conditioner
 extern byte pinBaro; //Pin that an external barometric pressure sensor is attached to (If used)
 extern byte pinResetControl; // Output pin used control resetting the Arduino
 extern byte pinFuelPressure;
@@ -1546,9 +1592,11 @@ extern struct config9 configPage9;
 extern struct config10 configPage10;
 extern struct config13 configPage13;
 extern struct config15 configPage15;
-//extern byte cltCalibrationTable[CALIBRATION_TABLE_SIZE]; /**< An array containing the coolant sensor calibration values */
-//extern byte iatCalibrationTable[CALIBRATION_TABLE_SIZE]; /**< An array containing the inlet air temperature sensor calibration values */
-//extern byte o2CalibrationTable[CALIBRATION_TABLE_SIZE]; /**< An array containing the O2 sensor calibration values */
+#if defined(CALIBRATION_LUT)
+extern uint16_t cltCalibrationLUT[CALIBRATION_LUT_SIZE]; /**< The coolant calibration curve expanded to one value per ADC value. See updateCalibrationLUT() */
+extern uint16_t iatCalibrationLUT[CALIBRATION_LUT_SIZE]; /**< The inlet air temperature calibration curve expanded to one value per ADC value */
+extern uint8_t  o2CalibrationLUT[CALIBRATION_LUT_SIZE]; /**< The O2 calibration curve expanded to one value per ADC value */
+#endif
 
 extern uint16_t cltCalibration_bins[32];
 extern uint16_t cltCalibration_values[32];
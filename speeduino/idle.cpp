@@ -6,10 +6,13 @@ A full copy of the license may be found in the projects root directory
 #include "idle.h"
 #include "maths.h"
 #include "timers.h"
-#include "src/PID_v1/PID_v1.h"
+#include "softPWM.h"
+#include "src/PID/fixedPID.h"
+#include "stepGenerator.h"
 
 #define STEPPER_LESS_AIR_DIRECTION() ((configPage9.iacStepperInv == 0) ? STEPPER_BACKWARD : STEPPER_FORWARD)
 #define STEPPER_MORE_AIR_DIRECTION() ((configPage9.iacStepperInv == 0) ? STEPPER_FORWARD : STEPPER_BACKWARD)
+#define STEPPER_STEP_LOW_US 2 //Minimum step pin low time when one step ends and the next starts in the same tick. 1.9uS for the DRV8825, 1uS for the A4988
 
 byte idleUpOutputHIGH = HIGH; // Used to invert the idle Up Output 
 byte idleUpOutputLOW = LOW;   // Used to invert the idle Up Output 
@@ -19,9 +22,8 @@ uint8_t idleTaper;
 struct StepperIdle idleStepper;
 bool idleOn; //Simply tracks whether idle was on last time around
 byte idleInitComplete = 99; //Tracks which idle method was initialised. 99 is a method that will never exist
-unsigned int iacStepTime_uS;
-unsigned int iacCoolTime_uS;
-unsigned int completedHomeSteps;
+static volatile bool stepperActive = false; //Whether the 1ms timer is running the stepper
+static bool stepperNeedsHoming = true;
 
 volatile bool idle_pwm_state;
 bool lastDFCOValue;
@@ -38,6 +40,12 @@ volatile PORT_TYPE *idle2_pin_port;
 volatile PINMASK_TYPE idle2_pin_mask;
 volatile PORT_TYPE *idleUpOutput_pin_port;
 volatile PINMASK_TYPE idleUpOutput_pin_mask;
+static volatile PORT_TYPE *stepper_step_pin_port;
+static volatile PINMASK_TYPE stepper_step_pin_mask;
+static volatile PORT_TYPE *stepper_dir_pin_port;
+static volatile PINMASK_TYPE stepper_dir_pin_mask;
+static volatile PORT_TYPE *stepper_enable_pin_port;
+static volatile PINMASK_TYPE stepper_enable_pin_mask;
 
 struct table2D iacPWMTable;
 struct table2D iacStepTable;
@@ -53,7 +61,9 @@ These functions cover the PWM and stepper idle control
 Idle Control
 Currently limited to on/off control and open loop PWM and stepper drive
 */
-integerPID idlePID(&currentStatus.longRPM, &idle_pid_target_value, &idle_cl_target_rpm, configPage6.idleKP, configPage6.idleKI, configPage6.idleKD, DIRECT); //This is the PID object if that algorithm is used. Needs to be global as it maintains state outside of each function call
+fixedPID<PID_SHIFTS> idlePID(&currentStatus.longRPM, &idle_pid_target_value, &idle_cl_target_rpm, DIRECT); //This is the PID object if that algorithm is used. Needs to be global as it maintains state outside of each function call
+
+static void initialiseStepper(bool forcehoming);
 
 //Any common functions associated with starting the Idle
 //Typically this is enabling the PWM interrupt
@@ -73,12 +83,21 @@ void initialiseIdle(bool forcehoming)
 {
   //By default, turn off the PWM interrupt (It gets turned on below if needed)
   IDLE_TIMER_DISABLE();
+  stepperActive = false;
 
   //Pin masks must always be initialised, regardless of whether PWM idle is used. This is required for STM32 to prevent issues if the IRQ function fires on restart/overflow
   idle_pin_port = portOutputRegister(digitalPinToPort(pinIdle1));
   idle_pin_mask = digitalPinToBitMask(pinIdle1);
   idle2_pin_port = portOutputRegister(digitalPinToPort(pinIdle2));
   idle2_pin_mask = digitalPinToBitMask(pinIdle2);
+  if( (configPage6.iacAlgorithm == IAC_ALGORITHM_PWM_OL) || (configPage6.iacAlgorithm == IAC_ALGORITHM_PWM_CL) || (configPage6.iacAlgorithm == IAC_ALGORITHM_PWM_OLCL) )
+  {
+    //A hardware PWM can't drive idle2 as the opposite of idle1, so 2 channel idle always uses the software PWM
+    auxPWMAttach(AUX_PWM_IDLE, pinIdle1, ((configPage6.iacChannels == 1) ? 0U : (configPage6.idleFreq * 2U)), (configPage6.iacPWMdir != 0));
+    #if defined(USE_SOFT_PWM)
+      if(configPage6.iacChannels == 1) { softPWMAttachComplement(AUX_PWM_IDLE, pinIdle2); } //If 2 idle channels are in use, idle2 is the opposite of idle1
+    #endif
+  }
 
   //Initialising comprises of setting the 2D tables with the relevant values from the config pages
   switch(configPage6.iacAlgorithm)
@@ -188,16 +207,7 @@ void initialiseIdle(bool forcehoming)
       iacCrankStepsTable.axisSize = SIZE_BYTE;
       iacCrankStepsTable.values = configPage6.iacCrankSteps;
       iacCrankStepsTable.axisX = configPage6.iacCrankBins;
-      iacStepTime_uS = configPage6.iacStepTime * 1000;
-      iacCoolTime_uS = configPage9.iacCoolTime * 1000;
-
-      if (forcehoming)
-      {
-        //Change between modes running make engine stall
-        completedHomeSteps = 0;
-        idleStepper.curIdleStep = 0;
-        idleStepper.stepperStatus = SOFF;
-      }
+      initialiseStepper(forcehoming);
 
       configPage6.iacPWMrun = false; // just in case. This needs to be false with stepper idle
       break;
@@ -209,16 +219,7 @@ void initialiseIdle(bool forcehoming)
       iacCrankStepsTable.axisSize = SIZE_BYTE;
       iacCrankStepsTable.values = configPage6.iacCrankSteps;
       iacCrankStepsTable.axisX = configPage6.iacCrankBins;
-      iacStepTime_uS = configPage6.iacStepTime * 1000;
-      iacCoolTime_uS = configPage9.iacCoolTime * 1000;
-
-      if (forcehoming)
-      {
-        //Change between modes running make engine stall
-        completedHomeSteps = 0;
-        idleStepper.curIdleStep = 0;
-        idleStepper.stepperStatus = SOFF;
-      }
+      initialiseStepper(forcehoming);
 
       idlePID.SetSampleTime(250); //4Hz means 250ms
       idlePID.SetOutputLimits((configPage2.iacCLminValue * 3)<<2, (configPage2.iacCLmaxValue * 3)<<2); //Maximum number of steps; always less than home steps count.
@@ -242,16 +243,7 @@ void initialiseIdle(bool forcehoming)
       iacCrankStepsTable.axisSize = SIZE_BYTE;
       iacCrankStepsTable.values = configPage6.iacCrankSteps;
       iacCrankStepsTable.axisX = configPage6.iacCrankBins;
-      iacStepTime_uS = configPage6.iacStepTime * 1000;
-      iacCoolTime_uS = configPage9.iacCoolTime * 1000;
-
-      if (forcehoming)
-      {
-        //Change between modes running make engine stall
-        completedHomeSteps = 0;
-        idleStepper.curIdleStep = 0;
-        idleStepper.stepperStatus = SOFF;
-      }
+      initialiseStepper(forcehoming);
 
       idlePID.SetSampleTime(250); //4Hz means 250ms
       idlePID.SetOutputLimits((configPage2.iacCLminValue * 3)<<2, (configPage2.iacCLmaxValue * 3)<<2); //Maximum number of steps; always less than home steps count.
@@ -285,123 +277,83 @@ void initialiseIdleUpOutput(void)
   idleUpOutput_pin_mask = digitalPinToBitMask(pinIdleUpOutput);
 }
 
+/** Passes the step and cool times to the step generator. They are re-read once per second so that changes take effect without a restart */
+static void configureStepper(void)
+{
+  noInterrupts();
+  stepperConfigure(configPage6.iacStepTime, configPage9.iacCoolTime, configPage15.iacStepRamp, configPage6.iacStepHyster, (configPage9.iacStepperPower == STEPPER_POWER_WHEN_ACTIVE));
+  interrupts();
+}
+
 /*
-Checks whether a step is currently underway or whether the motor is in 'cooling' state (ie whether it's ready to begin another step or not)
-Returns:
-True: If a step is underway or motor is 'cooling'
-False: If the motor is ready for another step
+Starts the step generator for one of the stepper idle modes. The motor is homed the first time and whenever homing is forced (Changing between modes while running can make the engine stall)
 */
-static inline byte checkForStepping(void)
+static void initialiseStepper(bool forcehoming)
 {
-  bool isStepping = false;
-  unsigned int timeCheck;
-  
-  if( (idleStepper.stepperStatus == STEPPING) || (idleStepper.stepperStatus == COOLING) )
+  stepper_step_pin_port = portOutputRegister(digitalPinToPort(pinStepperStep));
+  stepper_step_pin_mask = digitalPinToBitMask(pinStepperStep);
+  stepper_dir_pin_port = portOutputRegister(digitalPinToPort(pinStepperDir));
+  stepper_dir_pin_mask = digitalPinToBitMask(pinStepperDir);
+  stepper_enable_pin_port = portOutputRegister(digitalPinToPort(pinStepperEnable));
+  stepper_enable_pin_mask = digitalPinToBitMask(pinStepperEnable);
+
+  configureStepper();
+  if( (forcehoming == true) || (stepperNeedsHoming == true) )
   {
-    if (idleStepper.stepperStatus == STEPPING)
-    {
-      timeCheck = iacStepTime_uS;
-    }
-    else 
-    {
-      timeCheck = iacCoolTime_uS;
-    }
-
-    if(micros_safe() > (idleStepper.stepStartTime + timeCheck) )
-    {         
-      if(idleStepper.stepperStatus == STEPPING)
-      {
-        //Means we're currently in a step, but it needs to be turned off
-        digitalWrite(pinStepperStep, LOW); //Turn off the step
-        idleStepper.stepStartTime = micros_safe();
-        
-        // if there is no cool time we can miss that step out completely.
-        if (iacCoolTime_uS > 0)
-        {
-          idleStepper.stepperStatus = COOLING; //'Cooling' is the time the stepper needs to sit in LOW state before the next step can be made
-        }
-        else
-        {
-          idleStepper.stepperStatus = SOFF;  
-        }
-          
-        isStepping = true;
-      }
-      else
-      {
-        //Means we're in COOLING status but have been in this state long enough. Go into off state
-        idleStepper.stepperStatus = SOFF;
-        if(configPage9.iacStepperPower == STEPPER_POWER_WHEN_ACTIVE) 
-        { 
-          //Disable the DRV8825, but only if we're at the final step in this cycle. 
-          if(idleStepper.targetIdleStep == idleStepper.curIdleStep) { digitalWrite(pinStepperEnable, HIGH); } 
-        }
-      }
-    }
-    else
-    {
-      //Means we're in a step, but it doesn't need to turn off yet. No further action at this time
-      isStepping = true;
-    }
+    noInterrupts();
+    stepperHome(configPage6.iacStepHome * 3U); //Home steps are divided by 3 from TS
+    interrupts();
+    idleStepper.curIdleStep = 0;
+    stepperNeedsHoming = false;
   }
-  return isStepping;
+  stepperActive = true;
 }
 
 /*
-Performs a step
+Passes the new target to the step generator and reads back where the motor has got to. The steps themselves are made by the 1ms timer, see idleStepperInterrupt()
 */
-static inline void doStep(void)
+static void updateStepper(void)
 {
-  int16_t error = idleStepper.targetIdleStep - idleStepper.curIdleStep;
-  if ( (error < -((int8_t)configPage6.iacStepHyster)) || (error > configPage6.iacStepHyster) ) //Hysteresis check
-  {
-    // the home position for a stepper is pintle fully seated, i.e. no airflow.
-    if (error < 0)
-    {
-      // we are moving toward the home position (reducing air)
-      digitalWrite(pinStepperDir, STEPPER_LESS_AIR_DIRECTION() );
-      idleStepper.curIdleStep--;
-    }
-    else
-    {
-      // we are moving away from the home position (adding air).
-      digitalWrite(pinStepperDir, STEPPER_MORE_AIR_DIRECTION() );
-      idleStepper.curIdleStep++;
-    }
+  noInterrupts();
+  stepperSetTarget(idleStepper.targetIdleStep);
+  idleStepper.curIdleStep = stepperPosition();
+  interrupts();
 
-    digitalWrite(pinStepperEnable, LOW); //Enable the DRV8825
-    digitalWrite(pinStepperStep, HIGH);
-    idleStepper.stepStartTime = micros_safe();
-    idleStepper.stepperStatus = STEPPING;
+  if(stepperMoving() == true)
+  {
     idleOn = true;
-
     BIT_SET(currentStatus.spark, BIT_SPARK_IDLE);
   }
-  else
-    BIT_CLEAR(currentStatus.spark, BIT_SPARK_IDLE);
+  else { BIT_CLEAR(currentStatus.spark, BIT_SPARK_IDLE); }
+}
+
+static inline void writeStepperPin(volatile PORT_TYPE *port, PINMASK_TYPE mask, uint8_t level)
+{
+  if(level == HIGH) { *port |= mask; }
+  else { *port &= ~(mask); }
 }
 
 /*
-Checks whether the stepper has been homed yet. If it hasn't, will handle the next step
-Returns:
-True: If the system has been homed. No other action is taken
-False: If the motor has not yet been homed. Will also perform another homing step.
+Runs the step generator. Called from the 1ms timer interrupt
 */
-static inline byte isStepperHomed(void)
+void idleStepperInterrupt(void)
 {
-  bool isHomed = true; //As it's the most common scenario, default value is true
-  if( completedHomeSteps < (configPage6.iacStepHome * 3) ) //Home steps are divided by 3 from TS
+  if(stepperActive == false) { return; }
+
+  uint8_t pins = stepperTick();
+  if(pins == 0U) { return; }
+
+  if(BIT_CHECK(pins, STEPPER_PIN_STEP_OFF)) { writeStepperPin(stepper_step_pin_port, stepper_step_pin_mask, LOW); }
+  if(BIT_CHECK(pins, STEPPER_PIN_DISABLE)) { writeStepperPin(stepper_enable_pin_port, stepper_enable_pin_mask, HIGH); } //Disable the DRV8825
+  if(BIT_CHECK(pins, STEPPER_PIN_MORE_AIR)) { writeStepperPin(stepper_dir_pin_port, stepper_dir_pin_mask, STEPPER_MORE_AIR_DIRECTION()); } // moving away from the home position (adding air)
+  if(BIT_CHECK(pins, STEPPER_PIN_LESS_AIR)) { writeStepperPin(stepper_dir_pin_port, stepper_dir_pin_mask, STEPPER_LESS_AIR_DIRECTION()); } // moving toward the home position (reducing air)
+  if(BIT_CHECK(pins, STEPPER_PIN_ENABLE)) { writeStepperPin(stepper_enable_pin_port, stepper_enable_pin_mask, LOW); } //Enable the DRV8825
+  if(BIT_CHECK(pins, STEPPER_PIN_STEP_ON))
   {
-    digitalWrite(pinStepperDir, STEPPER_LESS_AIR_DIRECTION() ); //homing the stepper closes off the air bleed
-    digitalWrite(pinStepperEnable, LOW); //Enable the DRV8825
-    digitalWrite(pinStepperStep, HIGH);
-    idleStepper.stepStartTime = micros_safe();
-    idleStepper.stepperStatus = STEPPING;
-    completedHomeSteps++;
-    idleOn = true;
-    isHomed = false;
+    //The direction and enable pins are never changed in the same tick as a step, so they were set at least 1mS before this edge
+    if(BIT_CHECK(pins, STEPPER_PIN_STEP_OFF)) { delayMicroseconds(STEPPER_STEP_LOW_US); } //No cool time, the previous step ended in this tick
+    writeStepperPin(stepper_step_pin_port, stepper_step_pin_mask, HIGH);
   }
-  return isHomed;
 }
 
 void idleControl(void)
@@ -521,7 +473,7 @@ void idleControl(void)
         idle_cl_target_rpm = (uint16_t)currentStatus.CLIdleTarget * 10; //Multiply the byte target value back out by 10
         if( BIT_CHECK(LOOP_TIMER, BIT_TIMER_1HZ) ) { idlePID.SetTunings(configPage6.idleKP, configPage6.idleKI, configPage6.idleKD); } //Re-read the PID settings once per second
         
-        PID_computed = idlePID.Compute(true);
+        PID_computed = idlePID.Compute();
         long TEMP_idle_pwm_target_value;
         if(PID_computed == true)
         {
@@ -602,10 +554,10 @@ void idleControl(void)
         idle_cl_target_rpm = (uint16_t)currentStatus.CLIdleTarget * 10; //Multiply the byte target value back out by 10
         if( BIT_CHECK(LOOP_TIMER, BIT_TIMER_1HZ) ) { idlePID.SetTunings(configPage6.idleKP, configPage6.idleKI, configPage6.idleKD); } //Re-read the PID settings once per second
         if((currentStatus.RPM - idle_cl_target_rpm > configPage2.iacRPMlimitHysteresis*10) || (currentStatus.TPS > configPage2.iacTPSlimit)){ //reset integral to zero when TPS is bigger than set value in TS (opening throttle so not idle anymore). OR when RPM higher than Idle Target + RPM Histeresis (coming back from high rpm with throttle closed)
-          idlePID.ResetIntegeral();
+          idlePID.ResetIntegral();
         }
         
-        PID_computed = idlePID.Compute(true, FeedForwardTerm);
+        PID_computed = idlePID.Compute(FeedForwardTerm);
 
         if(PID_computed == true)
         {
@@ -619,8 +571,7 @@ void idleControl(void)
 
 
     case IAC_ALGORITHM_STEP_OL:    //Case 4 is open loop stepper control
-      //First thing to check is whether there is currently a step going on and if so, whether it needs to be turned off
-      if( (checkForStepping() == false) && (isStepperHomed() == true) ) //Check that homing is complete and that there's not currently a step already taking place. MUST BE IN THIS ORDER!
+      if(stepperHomed() == true) //The target is only set once homing is complete
       {
         //Check for cranking pulsewidth
         if( !BIT_CHECK(currentStatus.engine, BIT_ENGINE_RUN) ) //If ain't running it means off or cranking
@@ -653,8 +604,7 @@ void idleControl(void)
             // Add air conditioning idle-up - we only do this if the engine is running (A/C should never engage with engine off).
             if(configPage15.airConIdleSteps>0 && BIT_CHECK(currentStatus.airConStatus, BIT_AIRCON_TURNING_ON) == true) { idleStepper.targetIdleStep += configPage15.airConIdleSteps; }
             
-            iacStepTime_uS = configPage6.iacStepTime * 1000;
-            iacCoolTime_uS = configPage9.iacCoolTime * 1000;
+            configureStepper();
           }
         }
         //limit to the configured max steps. This must include any idle up adder, to prevent over-opening.
@@ -662,16 +612,15 @@ void idleControl(void)
         {
           idleStepper.targetIdleStep = configPage9.iacMaxSteps * 3;
         }
+        updateStepper();
         if( ((uint16_t)configPage9.iacMaxSteps * 3) > 255 ) { currentStatus.idleLoad = idleStepper.curIdleStep / 2; }//Current step count (Divided by 2 for byte)
         else { currentStatus.idleLoad = idleStepper.curIdleStep; }
-        doStep();
       }
       break;
 
     case IAC_ALGORITHM_STEP_OLCL:  //Case 7 is closed+open loop stepper control
     case IAC_ALGORITHM_STEP_CL:    //Case 5 is closed loop stepper control
-      //First thing to check is whether there is currently a step going on and if so, whether it needs to be turned off
-      if( (checkForStepping() == false) && (isStepperHomed() == true) ) //Check that homing is complete and that there's not currently a step already taking place. MUST BE IN THIS ORDER!
+      if(stepperHomed() == true) //The target is only set once homing is complete
       {
         if( !BIT_CHECK(currentStatus.engine, BIT_ENGINE_RUN) ) //If ain't running it means off or cranking
         {
@@ -687,7 +636,7 @@ void idleControl(void)
           
           idleTaper = 0;
           idle_pid_target_value = idleStepper.targetIdleStep << 2; //Resolution increased
-          idlePID.ResetIntegeral();
+          idlePID.ResetIntegral();
           FeedForwardTerm = idle_pid_target_value;
         }
         else 
@@ -714,13 +663,13 @@ void idleControl(void)
               //reset integral to zero when TPS is bigger than set value in TS (opening throttle so not idle anymore). OR when RPM higher than Idle Target + RPM Hysteresis (coming back from high rpm with throttle closed) 
               if (((currentStatus.RPM - idle_cl_target_rpm) > configPage2.iacRPMlimitHysteresis*10) || (currentStatus.TPS > configPage2.iacTPSlimit) || lastDFCOValue )
               {
-                idlePID.ResetIntegeral();
+                idlePID.ResetIntegral();
               }
             }
             else { FeedForwardTerm = idle_pid_target_value; }
           }
 
-          PID_computed = idlePID.Compute(true, FeedForwardTerm);
+          PID_computed = idlePID.Compute(FeedForwardTerm);
 
           //If DFCO conditions are met keep output from changing
           if( (currentStatus.TPS > configPage2.iacTPSlimit) || lastDFCOValue
@@ -741,16 +690,15 @@ void idleControl(void)
         {
           idleStepper.targetIdleStep = configPage9.iacMaxSteps * 3;
         }
+        updateStepper();
         if( ( (uint16_t)configPage9.iacMaxSteps * 3) > 255 ) { currentStatus.idleLoad = idleStepper.curIdleStep / 2; }//Current step count (Divided by 2 for byte)
         else { currentStatus.idleLoad = idleStepper.curIdleStep; }
-        doStep();
       }
       if (BIT_CHECK(LOOP_TIMER, BIT_TIMER_1HZ)) //Use timer flag instead idle count
       {
         //This only needs to be run very infrequently, once per second
         idlePID.SetTunings(configPage6.idleKP, configPage6.idleKI, configPage6.idleKD);
-        iacStepTime_uS = configPage6.iacStepTime * 1000;
-        iacCoolTime_uS = configPage9.iacCoolTime * 1000;
+        configureStepper();
       }
       break;
 
@@ -763,6 +711,7 @@ void idleControl(void)
   //Check for 100% and 0% DC on PWM idle
   if( (configPage6.iacAlgorithm == IAC_ALGORITHM_PWM_OL) || (configPage6.iacAlgorithm == IAC_ALGORITHM_PWM_CL) || (configPage6.iacAlgorithm == IAC_ALGORITHM_PWM_OLCL) )
   {
+    auxPWMSetDuty(AUX_PWM_IDLE, ((currentStatus.idleLoad == 0U) ? 0U : idle_pwm_target_value), idle_pwm_max_count);
     if(currentStatus.idleLoad >= 100)
     {
       BIT_SET(currentStatus.spark, BIT_SPARK_IDLE); //Turn the idle control flag on
@@ -799,6 +748,7 @@ void disableIdle(void)
   if( (configPage6.iacAlgorithm == IAC_ALGORITHM_PWM_CL) || (configPage6.iacAlgorithm == IAC_ALGORITHM_PWM_OL) )
   {
     IDLE_TIMER_DISABLE();
+    auxPWMSetDuty(AUX_PWM_IDLE, 0, idle_pwm_max_count);
     if (configPage6.iacPWMdir == 0)
     {
       //Normal direction
@@ -815,7 +765,7 @@ void disableIdle(void)
   else if( (configPage6.iacAlgorithm == IAC_ALGORITHM_STEP_OL) || (configPage6.iacAlgorithm == IAC_ALGORITHM_STEP_CL) || (configPage6.iacAlgorithm == IAC_ALGORITHM_STEP_OLCL) )
   {
     //Only disable the stepper motor if homing is completed
-    if( (checkForStepping() == false) && (isStepperHomed() == true) )
+    if(stepperHomed() == true)
     {
         /* for open loop stepper we should just move to the cranking position when
            disabling idle, since the only time this function is called in this scenario
@@ -836,6 +786,7 @@ void disableIdle(void)
   currentStatus.idleLoad = 0;
 }
 
+#if !defined(USE_SOFT_PWM) //The soft PWM engine replaces this interrupt
 #if defined(CORE_AVR) //AVR chips use the ISR for this
 ISR(TIMER1_COMPC_vect) //cppcheck-suppress misra-c2012-8.2
 #else
@@ -898,3 +849,4 @@ void idleInterrupt(void) //Most ARM chips can simply call a function
     idle_pwm_state = true;
   }
 }
+#endif //USE_SOFT_PWM
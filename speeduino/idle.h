@@ -24,14 +24,10 @@
 #define STEPPER_POWER_WHEN_ACTIVE 0
 #define IDLE_TABLE_SIZE 10
 
-enum StepperStatus {SOFF, STEPPING, COOLING}; //The 2 statuses that a stepper can have. STEPPING means that a high pulse is currently being sent and will need to be turned off at some point.
-
 struct StepperIdle
 {
-  int curIdleStep; //Tracks the current location of the stepper
+  int curIdleStep; //Tracks the current location of the stepper. Copied from the step generator, see stepGenerator.h
   int targetIdleStep; //What the targeted step is
-  volatile StepperStatus stepperStatus;
-  volatile unsigned long stepStartTime;
 };
 
 extern uint16_t idle_pwm_max_count; //Used for variable PWM frequency
@@ -42,5 +38,6 @@ void idleControl(void);
 void initialiseIdleUpOutput(void);
 void disableIdle(void);
 void idleInterrupt(void);
+void idleStepperInterrupt(void);
 
 #endif
@@ -20,6 +20,7 @@
 #include "idle.h"
 #include "table2d.h"
 #include "acc_mc33810.h"
+#include "softPWM.h"
 #include BOARD_H //Note that this is not a real file, it is defined in globals.h. 
 #if defined(EEPROM_RESET_PIN)
   #include EEPROM_LIB_H
@@ -291,6 +292,11 @@ void initialiseAll(void)
     
     //Setup the calibration tables
     loadCalibration();
+    #if defined(CALIBRATION_LUT)
+      updateCalibrationLUT(CLT_CALIBRATION_PAGE);
+      updateCalibrationLUT(IAT_CALIBRATION_PAGE);
+      updateCalibrationLUT(O2_CALIBRATION_PAGE);
+    #endif
 
     
 
@@ -359,16 +365,32 @@ void initialiseAll(void)
     initialiseADC();
     initialiseProgrammableIO();
 
-    //Check whether the flex sensor is enabled and if so, attach an interrupt for it
+    //Check whether the flex sensor is enabled and if so, attach an interrupt for it. The hardware input capture is used if the board has one on the pin (Not on the trigger inputs, which the decoder may need)
     if(configPage2.flexEnabled > 0)
     {
-      attachInterrupt(digitalPinToInterrupt(pinFlex), flexPulse, CHANGE);
+      #if defined(HW_CAPTURE_AVAILABLE)
+      if( pinIsTrigger(pinFlex) || (boardCaptureAttach(pinFlex, true, flexEdge) == false) )
+      #endif
+      {
+        attachInterrupt(digitalPinToInterrupt(pinFlex), flexPulse, CHANGE);
+      }
       currentStatus.ethanolPct = 0;
     }
     //Same as above, but for the VSS input
     if(configPage2.vssMode > 1) // VSS modes 2 and 3 are interrupt drive (Mode 1 is CAN)
     {
-      attachInterrupt(digitalPinToInterrupt(pinVSS), vssPulse, RISING);
+      #if defined(HW_CAPTURE_AVAILABLE)
+      if( pinIsTrigger(pinVSS) || (boardCaptureAttach(pinVSS, false, vssEdge) == false) )
+      #endif
+      {
+        attachInterrupt(digitalPinToInterrupt(pinVSS), vssPulse, RISING);
+      }
+    }
+
+    //Knock conditioner input. Pulses are only counted inside the knock windows that the ignition schedules arm
+    if( (configPage10.knock_mode == KNOCK_MODE_DIGITAL) && (pinKnock != 0) )
+    {
+      attachInterrupt(digitalPinToInterrupt(pinKnock), knockPulse, (configPage10.knock_trigger == KNOCK_TRIGGER_HIGH) ? RISING : FALLING);
     }
 
     //Once the configs have been loaded, a number of one time calculations can be completed
@@ -392,7 +414,7 @@ void initialiseAll(void)
     staged_req_fuel_mult_sec = (100 * totalInjector) / configPage10.stagedInjSizeSec;
     }
 
-    if (configPage4.trigPatternSec == SEC_TRIGGER_POLL && configPage4.TrigPattern == DECODER_MISSING_TOOTH)
+    if (configPage4.trigPatternSec == SEC_TRIGGER_POLL && ( (configPage4.TrigPattern == DECODER_MISSING_TOOTH) || (configPage4.TrigPattern == DECODER_PATTERN) ))
     { configPage4.TrigEdgeSec = configPage4.PollLevelPolarity; } // set the secondary trigger edge automatically to correct working value with poll level mode to enable cam angle detection in closed loop vvt.
     //Explanation: currently cam trigger for VVT is only captured when revolution one == 1. So we need to make sure that the edge trigger happens on the first revolution. So now when we set the poll level to be low
     //on revolution one and it's checked at tooth #1. This means that the cam signal needs to go high during the first revolution to be high on next revolution at tooth #1. So poll level low = cam trigger edge rising.
@@ -1353,6 +1375,7 @@ void initialiseAll(void)
     /* SweepMax is stored as a byte, RPM/100. divide by 60 to convert min to sec (net 5/3).  Multiply by ignition pulses per rev.
        tachoSweepIncr is also the number of tach pulses per second */
     tachoSweepIncr = configPage2.tachoSweepMaxRPM * maxIgnOutputs * 5 / 3;
+    updateTachoPulse();
     
     currentStatus.initialisationComplete = true;
     digitalWrite(LED_BUILTIN, HIGH);
@@ -2861,6 +2884,12 @@ void setPinMapping(byte boardID)
   //Setup any devices that are using selectable pins
 
   if ( (configPage6.launchPin != 0) && (configPage6.launchPin < BOARD_MAX_IO_PINS) ) { pinLaunch = pinTranslate(configPage6.launchPin); }
+  if ( (configPage10.knock_mode == KNOCK_MODE_DIGITAL) && (configPage10.knock_pin != 0) && (configPage10.knock_pin < BOARD_MAX_IO_PINS) )
+  {
+    //Knock pulses are counted by an external interrupt, so pins without one (Eg A8-A15 on the Mega, which only have pin change interrupts) are not used
+    pinKnock = pinTranslate(configPage10.knock_pin);
+    if(digitalPinToInterrupt(pinKnock) == NOT_AN_INTERRUPT) { pinKnock = 0; }
+  }
   if ( (configPage4.ignBypassPin != 0) && (configPage4.ignBypassPin < BOARD_MAX_IO_PINS) ) { pinIgnBypass = pinTranslate(configPage4.ignBypassPin); }
   if ( (configPage2.tachoPin != 0) && (configPage2.tachoPin < BOARD_MAX_IO_PINS) ) { pinTachOut = pinTranslate(configPage2.tachoPin); }
   if ( (configPage4.fuelPumpPin != 0) && (configPage4.fuelPumpPin < BOARD_MAX_IO_PINS) ) { pinFuelPump = pinTranslate(configPage4.fuelPumpPin); }
@@ -3017,6 +3046,9 @@ void setPinMapping(byte boardID)
 
   tach_pin_port = portOutputRegister(digitalPinToPort(pinTachOut));
   tach_pin_mask = digitalPinToBitMask(pinTachOut);
+#if defined(USE_SOFT_PWM)
+  softPWMAttach(AUX_PWM_TACHO, pinTachOut, true); //The tacho pulse is active low
+#endif
   pump_pin_port = portOutputRegister(digitalPinToPort(pinFuelPump));
   pump_pin_mask = digitalPinToBitMask(pinFuelPump);
 
@@ -3052,6 +3084,11 @@ void setPinMapping(byte boardID)
   {
     pinMode(pinVSS, INPUT);
   }
+  if( (configPage10.knock_mode == KNOCK_MODE_DIGITAL) && (pinKnock != 0) && (!pinIsOutput(pinKnock)) )
+  {
+    if (configPage10.knock_pullup == true) { pinMode(pinKnock, INPUT_PULLUP); }
+    else { pinMode(pinKnock, INPUT); }
+  }
   if( (configPage6.launchEnabled > 0) && (!pinIsOutput(pinLaunch)) )
   {
     if (configPage6.lnchPullRes == true) { pinMode(pinLaunch, INPUT_PULLUP); }
@@ -3685,6 +3722,28 @@ void initialiseTriggers(void)
       attachInterrupt(triggerInterrupt, triggerHandler, primaryTriggerEdge);
       break;
 
+    case DECODER_PATTERN:
+      //Table driven decoder
+      triggerSetup_Pattern();
+      triggerHandler = triggerPri_Pattern;
+      triggerSecondaryHandler = triggerSec_missingTooth; //The cam inputs are the same as the missing tooth decoder
+      triggerTertiaryHandler = triggerThird_missingTooth;
+      getRPM = getRPM_Pattern;
+      getCrankAngle = getCrankAngle_Pattern;
+      triggerSetEndTeeth = triggerSetEndTeeth_Pattern;
+
+      if(configPage4.TrigEdge == 0) { primaryTriggerEdge = RISING; } // Attach the crank trigger wheel interrupt (Hall sensor drags to ground when triggering)
+      else { primaryTriggerEdge = FALLING; }
+      if(configPage4.TrigEdgeSec == 0) { secondaryTriggerEdge = RISING; }
+      else { secondaryTriggerEdge = FALLING; }
+      if(configPage10.TrigEdgeThrd == 0) { tertiaryTriggerEdge = RISING; }
+      else { tertiaryTriggerEdge = FALLING; }
+
+      attachInterrupt(triggerInterrupt, triggerHandler, primaryTriggerEdge);
+
+      if(BIT_CHECK(decoderState, BIT_DECODER_HAS_SECONDARY)) { attachInterrupt(triggerInterrupt2, triggerSecondaryHandler, secondaryTriggerEdge); }
+      if(configPage10.vvt2Enabled > 0) { attachInterrupt(triggerInterrupt3, triggerTertiaryHandler, tertiaryTriggerEdge); } // we only need this for vvt2, so not really needed if it's not used
+      break;
 
     default:
       triggerHandler = triggerPri_missingTooth;
@@ -3696,6 +3755,20 @@ void initialiseTriggers(void)
       break;
   }
 
+  //Crank synchronous MAP sampling and the per tooth rev limiter run after the decoder on each primary tooth. The loggers call triggerHandler, so they pick this up too.
+  //The wrapper is only installed when one of them is in use so that the trigger interrupt is not made any longer otherwise
+  bool toothISRNeeded = (configPage15.toothRevLimit == true);
+  #if defined(MAP_CRANK_SYNC)
+    if( (configPage2.mapSample == 1U) || (configPage2.mapSample == 2U) ) { toothISRNeeded = true; } //Cycle average and cycle minimum
+  #endif
+  if( (primaryTriggerEdge != 0) && (toothISRNeeded == true) )
+  {
+    triggerDecoderHandler = triggerHandler;
+    triggerHandler = toothPrimaryISR;
+    detachInterrupt(triggerInterrupt);
+    attachInterrupt(triggerInterrupt, triggerHandler, primaryTriggerEdge);
+  }
+
   #if defined(CORE_TEENSY41)
     //Teensy 4 requires a HYSTERESIS flag to be set on the trigger pins to prevent false interrupts
     setTriggerHysteresis();
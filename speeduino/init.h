@@ -9,5 +9,6 @@ void changeFullToHalfSync(void);
 
 #define VSS_USES_RPM2() ((configPage2.vssMode > 1U) && (pinVSS == pinTrigger2) && !BIT_CHECK(decoderState, BIT_DECODER_HAS_SECONDARY)) // VSS is on the same pin as RPM2 and RPM2 is not used as part of the decoder
 #define FLEX_USES_RPM2() ((configPage2.flexEnabled > 0U) && (pinFlex == pinTrigger2) && !BIT_CHECK(decoderState, BIT_DECODER_HAS_SECONDARY)) // Same as above, but for Flex sensor
+#define pinIsTrigger(pin) ( ((pin) == pinTrigger) || ((pin) == pinTrigger2) || ((pin) == pinTrigger3) )
 
 #endif
\ No newline at end of file
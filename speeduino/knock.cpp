@@ -0,0 +1,159 @@
+/*
+Speeduino - Simple engine management for the Arduino Mega 2560 platform
+Copyright (C) Josh Stewart
+A full copy of the license may be found in the projects root directory
+*/
+/** @file
+ * Knock windows and per channel knock retard, see knock.h
+ */
+#include "knock.h"
+
+struct knockWindow_t
+{
+  uint8_t channel; /**< Ignition channel that armed the window, KNOCK_NO_CHANNEL if the slot is not in use */
+  uint8_t pulses; /**< Knock pulses seen inside the window */
+  uint32_t sparkTime;
+};
+
+struct knockChannelState_t
+{
+  uint8_t eventsSeen; /**< Value of knockEventCount when the channel was last updated */
+  bool knocking;
+  uint32_t lastKnockTime; /**< ms */
+  uint32_t lastStepTime; /**< ms */
+};
+
+volatile bool knockWindowsEnabled = false;
+uint8_t knockChannelRetard[KNOCK_MAX_CHANNELS];
+
+static volatile knockWindow_t windows[2];
+static volatile uint8_t newestWindow = 0;
+//Only ever incremented by the interrupts. The main loop compares it to its last seen value, so no critical section is needed to take the events
+static volatile uint8_t knockEventCount[KNOCK_MAX_CHANNELS];
+static knockChannelState_t channelStates[KNOCK_MAX_CHANNELS];
+
+//These are only changed with interrupts disabled
+static uint16_t windowOpenDelay = 0;
+static uint16_t windowCloseDelay = 0;
+static uint8_t windowPulsesRequired = 1;
+
+/** Clears all knock windows, events and retard */
+void knockReset(void)
+{
+  for(uint8_t x = 0; x < 2U; x++)
+  {
+    windows[x].channel = KNOCK_NO_CHANNEL;
+    windows[x].pulses = 0;
+  }
+  for(uint8_t x = 0; x < KNOCK_MAX_CHANNELS; x++)
+  {
+    knockChannelRetard[x] = 0;
+    channelStates[x].eventsSeen = knockEventCount[x];
+    channelStates[x].knocking = false;
+  }
+}
+
+/**
+ * Set the knock window. Must be called with interrupts disabled, or before any windows are armed
+ * @param openDelay Time from the spark to the start of the window in uS
+ * @param closeDelay Time from the spark to the end of the window in uS
+ * @param pulsesRequired Number of knock pulses in a window for it to count as a knock event
+ */
+void knockSetWindow(uint16_t openDelay, uint16_t closeDelay, uint8_t pulsesRequired)
+{
+  windowOpenDelay = openDelay;
+  windowCloseDelay = closeDelay;
+  windowPulsesRequired = (pulsesRequired == 0U) ? 1U : pulsesRequired;
+}
+
+/**
+ * Called by the ignition scheduler when a coil fires. The oldest window is finished and replaced by a new one for this channel
+ * @param channel Ignition channel, from 0
+ * @param sparkTime Time of the spark in uS
+ */
+void knockWindowArm(uint8_t channel, uint32_t sparkTime)
+{
+  uint8_t slot = newestWindow ^ 1U;
+  uint8_t oldChannel = windows[slot].channel;
+  if( (oldChannel < KNOCK_MAX_CHANNELS) && (windows[slot].pulses >= windowPulsesRequired) ) { knockEventCount[oldChannel]++; }
+
+  windows[slot].channel = channel;
+  windows[slot].pulses = 0;
+  windows[slot].sparkTime = sparkTime;
+  newestWindow = slot;
+}
+
+/**
+ * Called from the knock input interrupt. The pulse is counted against any window that it falls inside of
+ * @param pulseTime Time of the pulse in uS
+ */
+void knockPulseAt(uint32_t pulseTime)
+{
+  for(uint8_t x = 0; x < 2U; x++)
+  {
+    if(windows[x].channel == KNOCK_NO_CHANNEL) { continue; }
+    uint32_t sinceSpark = pulseTime - windows[x].sparkTime;
+    if( (sinceSpark >= windowOpenDelay) && (sinceSpark <= windowCloseDelay) && (windows[x].pulses < UINT8_MAX) ) { windows[x].pulses++; }
+  }
+}
+
+/** Number of knock events on a channel since it was last taken */
+uint8_t knockTakeEvents(uint8_t channel)
+{
+  uint8_t count = knockEventCount[channel];
+  uint8_t events = count - channelStates[channel].eventsSeen;
+  channelStates[channel].eventsSeen = count;
+  return events;
+}
+
+/**
+ * Run the retard and recovery of a channel. Called from the main loop for each ignition channel in use
+ * The first knock event applies the first step. While the channel keeps knocking, a further step is added every stepTime up to the max retard.
+ * Once the channel has not knocked for the duration, the retard is taken off one recovery step at a time
+ * @param channel Ignition channel, from 0
+ * @param nowMs Current time in ms
+ * @return The new retard for the channel in degrees
+ */
+uint8_t knockUpdateChannel(uint8_t channel, uint32_t nowMs, const knockRetardSettings_t &settings)
+{
+  knockChannelState_t &state = channelStates[channel];
+  uint16_t retard = knockChannelRetard[channel];
+
+  if(knockTakeEvents(channel) > 0U)
+  {
+    if(state.knocking == false)
+    {
+      if(retard < settings.firstStep) { retard = settings.firstStep; }
+      state.knocking = true;
+      state.lastStepTime = nowMs;
+    }
+    else if( (nowMs - state.lastStepTime) >= settings.stepTime )
+    {
+      retard += settings.stepSize;
+      state.lastStepTime = nowMs;
+    }
+    state.lastKnockTime = nowMs;
+    if(retard > settings.maxRetard) { retard = settings.maxRetard; }
+  }
+  else if(retard > 0U)
+  {
+    if(state.knocking == true)
+    {
+      //Wait for the duration after the last knock before starting the recovery
+      if( (nowMs - state.lastKnockTime) >= settings.duration )
+      {
+        state.knocking = false;
+        state.lastStepTime = nowMs - settings.recoveryStepTime; //First recovery step happens straight away
+      }
+    }
+    if( (state.knocking == false) && ((nowMs - state.lastStepTime) >= settings.recoveryStepTime) )
+    {
+      retard = (retard > settings.recoveryStep) ? (retard - settings.recoveryStep) : 0U;
+      state.lastStepTime = nowMs;
+    }
+  }
+  else { state.knocking = false; }
+
+  knockChannelRetard[channel] = (uint8_t)retard;
+  return knockChannelRetard[channel];
+}
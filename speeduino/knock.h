@@ -0,0 +1,45 @@
+/** \file knock.h
+ * @brief Crank angle windowed knock detection with per cylinder retard
+ *
+ * Each time a coil fires, the ignition scheduler arms the knock window of that ignition channel (knockWindowArm()). The window opens and closes
+ * a set number of uS after the spark, which correctionKnock() works out each loop from the knock window curves (Degrees ATDC) plus the current advance.
+ * Pulses from the knock conditioner (knockPulseAt()) only count if they fall inside an open window and they are counted against the channel that armed it.
+ * The 2 most recent windows are kept so that a window can still be open after the next coil has fired (Eg 8 cylinders with long windows).
+ * When a window is replaced, it is a knock event for its channel if it saw at least the required number of pulses.
+ *
+ * knockUpdateChannel() then runs the retard / recovery for each channel independently, so only the channels that knock are retarded.
+ * In wasted spark each ignition channel fires 2 cylinders, so the retard is per pair of cylinders.
+ *
+ * Nothing in here reads the config or the clock directly, so that it can be tested natively.
+ */
+#ifndef KNOCK_H
+#define KNOCK_H
+
+#include <stdint.h>
+
+#define KNOCK_MAX_CHANNELS  8U
+#define KNOCK_NO_CHANNEL    0xFFU
+
+/** The retard and recovery settings, in the units of the config page (Degrees) apart from the times, which are in ms */
+struct knockRetardSettings_t
+{
+  uint8_t firstStep; /**< Retard applied on the first knock event */
+  uint8_t stepSize; /**< Retard added for each stepTime that the channel keeps knocking */
+  uint8_t maxRetard;
+  uint8_t recoveryStep; /**< Retard taken off for each recoveryStepTime once recovery has started */
+  uint16_t stepTime;
+  uint16_t duration; /**< Time after the last knock event before recovery starts */
+  uint16_t recoveryStepTime;
+};
+
+extern volatile bool knockWindowsEnabled; /**< The scheduler only arms windows while this is set */
+extern uint8_t knockChannelRetard[KNOCK_MAX_CHANNELS]; /**< The current retard of each ignition channel in degrees */
+
+void knockReset(void);
+void knockSetWindow(uint16_t openDelay, uint16_t closeDelay, uint8_t pulsesRequired);
+void knockWindowArm(uint8_t channel, uint32_t sparkTime);
+void knockPulseAt(uint32_t pulseTime);
+uint8_t knockTakeEvents(uint8_t channel);
+uint8_t knockUpdateChannel(uint8_t channel, uint32_t nowMs, const knockRetardSettings_t &settings);
+
+#endif
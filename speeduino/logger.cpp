@@ -5,6 +5,7 @@
 #include "init.h"
 #include "maths.h"
 #include "utilities.h"
+#include "profiler.h"
 #include BOARD_H 
 
 /** 
@@ -174,6 +175,34 @@ byte getTSLogEntry(uint16_t byteNum)
     case 124: statusValue = currentStatus.airConStatus; break;
     case 125: statusValue = lowByte(currentStatus.actualDwell); break;
     case 126: statusValue = highByte(currentStatus.actualDwell); break;
+    case 127: statusValue = lowByte(profileAverage(PROFILE_COMMS)); break; //Loop profiler, uS
+    case 128: statusValue = highByte(profileAverage(PROFILE_COMMS)); break;
+    case 129: statusValue = lowByte(profileMaximum(PROFILE_COMMS)); break;
+    case 130: statusValue = highByte(profileMaximum(PROFILE_COMMS)); break;
+    case 131: statusValue = lowByte(profileAverage(PROFILE_SENSORS)); break;
+    case 132: statusValue = highByte(profileAverage(PROFILE_SENSORS)); break;
+    case 133: statusValue = lowByte(profileMaximum(PROFILE_SENSORS)); break;
+    case 134: statusValue = highByte(profileMaximum(PROFILE_SENSORS)); break;
+    case 135: statusValue = lowByte(profileAverage(PROFILE_CORRECTIONS)); break;
+    case 136: statusValue = highByte(profileAverage(PROFILE_CORRECTIONS)); break;
+    case 137: statusValue = lowByte(profileMaximum(PROFILE_CORRECTIONS)); break;
+    case 138: statusValue = highByte(profileMaximum(PROFILE_CORRECTIONS)); break;
+    case 139: statusValue = lowByte(profileAverage(PROFILE_PW)); break;
+    case 140: statusValue = highByte(profileAverage(PROFILE_PW)); break;
+    case 141: statusValue = lowByte(profileMaximum(PROFILE_PW)); break;
+    case 142: statusValue = highByte(profileMaximum(PROFILE_PW)); break;
+    case 143: statusValue = lowByte(profileAverage(PROFILE_SCHEDULE)); break;
+    case 144: statusValue = highByte(profileAverage(PROFILE_SCHEDULE)); break;
+    case 145: statusValue = lowByte(profileMaximum(PROFILE_SCHEDULE)); break;
+    case 146: statusValue = highByte(profileMaximum(PROFILE_SCHEDULE)); break;
+    case 147: statusValue = lowByte(profileAverage(PROFILE_AUX)); break;
+    case 148: statusValue = highByte(profileAverage(PROFILE_AUX)); break;
+    case 149: statusValue = lowByte(profileMaximum(PROFILE_AUX)); break;
+    case 150: statusValue = highByte(profileMaximum(PROFILE_AUX)); break;
+    case 151: statusValue = lowByte(profileAverage(PROFILE_SD)); break;
+    case 152: statusValue = highByte(profileAverage(PROFILE_SD)); break;
+    case 153: statusValue = lowByte(profileMaximum(PROFILE_SD)); break;
+    case 154: statusValue = highByte(profileMaximum(PROFILE_SD)); break;
     default: statusValue = 0; // MISRA check
   }
 
@@ -298,6 +327,20 @@ int16_t getReadableLogEntry(uint16_t logIndex)
     case 88: statusValue = currentStatus.fanDuty; break;
     case 89: statusValue = currentStatus.airConStatus; break;
     case 90: statusValue = currentStatus.actualDwell; break;
+    case 91: statusValue = profileAverage(PROFILE_COMMS); break; //Loop profiler, uS
+    case 92: statusValue = profileMaximum(PROFILE_COMMS); break;
+    case 93: statusValue = profileAverage(PROFILE_SENSORS); break;
+    case 94: statusValue = profileMaximum(PROFILE_SENSORS); break;
+    case 95: statusValue = profileAverage(PROFILE_CORRECTIONS); break;
+    case 96: statusValue = profileMaximum(PROFILE_CORRECTIONS); break;
+    case 97: statusValue = profileAverage(PROFILE_PW); break;
+    case 98: statusValue = profileMaximum(PROFILE_PW); break;
+    case 99: statusValue = profileAverage(PROFILE_SCHEDULE); break;
+    case 100: statusValue = profileMaximum(PROFILE_SCHEDULE); break;
+    case 101: statusValue = profileAverage(PROFILE_AUX); break;
+    case 102: statusValue = profileMaximum(PROFILE_AUX); break;
+    case 103: statusValue = profileAverage(PROFILE_SD); break;
+    case 104: statusValue = profileMaximum(PROFILE_SD); break;
     default: statusValue = 0; // MISRA check
   }
 
@@ -487,7 +530,7 @@ bool is2ByteEntry(uint8_t key)
   // This array indicates which index values from the log are 2 byte values
   // This array MUST remain in ascending order
   // !!!! WARNING: If any value above 255 is required in this array, changes MUST be made to is2ByteEntry() function !!!!
-  static constexpr byte PROGMEM fsIntIndex[] = {4, 14, 17, 22, 26, 28, 33, 42, 44, 46, 48, 50, 52, 54, 56, 58, 60, 62, 64, 66, 68, 70, 72, 76, 78, 80, 82, 86, 88, 90, 93, 95, 99, 104, 111, 121, 125 };
+  static constexpr byte PROGMEM fsIntIndex[] = {4, 14, 17, 22, 26, 28, 33, 42, 44, 46, 48, 50, 52, 54, 56, 58, 60, 62, 64, 66, 68, 70, 72, 76, 78, 80, 82, 86, 88, 90, 93, 95, 99, 104, 111, 121, 125, 127, 129, 131, 133, 135, 137, 139, 141, 143, 145, 147, 149, 151, 153 };
 
   unsigned int bot = 0U;
   unsigned int mid = _countof(fsIntIndex);
@@ -504,6 +547,76 @@ bool is2ByteEntry(uint8_t key)
   return key == pgm_read_byte(&fsIntIndex[bot]);
 }
 
+#ifdef SD_LOGGING
+volatile uint32_t toothRingTimes[TOOTH_RING_SIZE];
+volatile uint8_t toothRingFlags[TOOTH_RING_SIZE];
+volatile uint16_t toothRingHead = 0;
+volatile uint16_t toothRingTail = 0;
+volatile uint16_t toothRingOverflows = 0;
+volatile bool toothSDLogActive = false;
+
+/**
+ * Attaches the logger versions of the trigger interrupts required by the SD tooth logger
+ * Crank only mode needs the primary input only, crank and cams mode needs all of the inputs that are in use
+ */
+static void attachSDToothLoggerInterrupts(void)
+{
+  detachInterrupt( digitalPinToInterrupt(pinTrigger) );
+  attachInterrupt( digitalPinToInterrupt(pinTrigger), loggerPrimaryISR, CHANGE );
+
+  if(configPage13.onboard_log_tooth == LOGGER_TOOTH_ALL)
+  {
+    if( (VSS_USES_RPM2() != true) && (FLEX_USES_RPM2() != true) )
+    {
+      detachInterrupt( digitalPinToInterrupt(pinTrigger2) );
+      attachInterrupt( digitalPinToInterrupt(pinTrigger2), loggerSecondaryISR, CHANGE );
+    }
+    if(configPage10.vvt2Enabled > 0)
+    {
+      detachInterrupt( digitalPinToInterrupt(pinTrigger3) );
+      attachInterrupt( digitalPinToInterrupt(pinTrigger3), loggerTertiaryISR, CHANGE );
+    }
+  }
+}
+
+/**
+ * Starts recording trigger edges into the tooth ring. This runs alongside (Not instead of) the TunerStudio tooth and composite loggers
+ */
+void startSDToothLogger(void)
+{
+  toothRingHead = 0;
+  toothRingTail = 0;
+  toothRingOverflows = 0;
+  toothSDLogActive = true;
+  attachSDToothLoggerInterrupts();
+}
+
+void stopSDToothLogger(void)
+{
+  toothSDLogActive = false;
+
+  //If one of the TS loggers is running, it will restore the normal interrupts when it is stopped
+  if( (currentStatus.toothLogEnabled == true) || (currentStatus.compositeTriggerUsed > 0U) ) { return; }
+
+  detachInterrupt( digitalPinToInterrupt(pinTrigger) );
+  attachInterrupt( digitalPinToInterrupt(pinTrigger), triggerHandler, primaryTriggerEdge );
+
+  if(configPage13.onboard_log_tooth == LOGGER_TOOTH_ALL)
+  {
+    if( (VSS_USES_RPM2() != true) && (FLEX_USES_RPM2() != true) )
+    {
+      detachInterrupt( digitalPinToInterrupt(pinTrigger2) );
+      attachInterrupt( digitalPinToInterrupt(pinTrigger2), triggerSecondaryHandler, secondaryTriggerEdge );
+    }
+    if(configPage10.vvt2Enabled > 0)
+    {
+      detachInterrupt( digitalPinToInterrupt(pinTrigger3) );
+      attachInterrupt( digitalPinToInterrupt(pinTrigger3), triggerTertiaryHandler, tertiaryTriggerEdge );
+    }
+  }
+}
+#endif
+
 void startToothLogger(void)
 {
   currentStatus.toothLogEnabled = true;
@@ -536,6 +649,10 @@ void stopToothLogger(void)
     detachInterrupt( digitalPinToInterrupt(pinTrigger2) );
     attachInterrupt( digitalPinToInterrupt(pinTrigger2), triggerSecondaryHandler, secondaryTriggerEdge );  
   }
+
+  #ifdef SD_LOGGING
+    if(toothSDLogActive == true) { attachSDToothLoggerInterrupts(); } //The SD tooth logger still needs the logger interrupts
+  #endif
 }
 
 void startCompositeLogger(void)
@@ -569,6 +686,10 @@ void stopCompositeLogger(void)
     detachInterrupt( digitalPinToInterrupt(pinTrigger2) );
     attachInterrupt( digitalPinToInterrupt(pinTrigger2), triggerSecondaryHandler, secondaryTriggerEdge );
   }
+
+  #ifdef SD_LOGGING
+    if(toothSDLogActive == true) { attachSDToothLoggerInterrupts(); } //The SD tooth logger still needs the logger interrupts
+  #endif
 }
 
 void startCompositeLoggerTertiary(void)
@@ -596,6 +717,10 @@ void stopCompositeLoggerTertiary(void)
 
   detachInterrupt( digitalPinToInterrupt(pinTrigger3) );
   attachInterrupt( digitalPinToInterrupt(pinTrigger3), triggerTertiaryHandler, tertiaryTriggerEdge );
+
+  #ifdef SD_LOGGING
+    if(toothSDLogActive == true) { attachSDToothLoggerInterrupts(); } //The SD tooth logger still needs the logger interrupts
+  #endif
 }
 
 
@@ -630,4 +755,8 @@ void stopCompositeLoggerCams(void)
 
   detachInterrupt( digitalPinToInterrupt(pinTrigger3) );
   attachInterrupt( digitalPinToInterrupt(pinTrigger3), triggerTertiaryHandler, tertiaryTriggerEdge );
+
+  #ifdef SD_LOGGING
+    if(toothSDLogActive == true) { attachSDToothLoggerInterrupts(); } //The SD tooth logger still needs the logger interrupts
+  #endif
 }
@@ -12,7 +12,7 @@
 #include "globals.h" // Needed for FPU_MAX_SIZE
 
 #ifndef UNIT_TEST // Scope guard for unit testing
-  #define LOG_ENTRY_SIZE      127 /**< The size of the live data packet. This MUST match ochBlockSize setting in the ini file */
+  #define LOG_ENTRY_SIZE      155 /**< The size of the live data packet. This MUST match ochBlockSize setting in the ini file */
 #else
   #define LOG_ENTRY_SIZE      1 /**< The size of the live data packet. This MUST match ochBlockSize setting in the ini file */
 #endif
@@ -37,4 +37,25 @@ void stopCompositeLoggerTertiary(void);
 void startCompositeLoggerCams(void);
 void stopCompositeLoggerCams(void);
 
+#ifdef SD_LOGGING
+/*
+The SD tooth logger uses a single producer (Trigger ISRs), single consumer (SD logger in the main loop) ring buffer.
+The ISRs only ever write the head index and the main loop only ever writes the tail index, so no locking is required
+Entries are dropped (And counted in toothRingOverflows) if the ring is full
+*/
+#define TOOTH_RING_SIZE       2048U /**< Number of entries in the SD tooth log ring. Must be a power of 2 */
+#define TOOTH_RING_MASK       (TOOTH_RING_SIZE - 1U)
+#define TOOTH_RING_TOOTH_SHIFT 6 /**< The input (TOOTH_CRANK, TOOTH_CAM_SECONDARY etc) is stored in the top 2 bits of the flags */
+
+extern volatile uint32_t toothRingTimes[TOOTH_RING_SIZE];
+extern volatile uint8_t toothRingFlags[TOOTH_RING_SIZE];
+extern volatile uint16_t toothRingHead;
+extern volatile uint16_t toothRingTail;
+extern volatile uint16_t toothRingOverflows;
+extern volatile bool toothSDLogActive;
+
+void startSDToothLogger(void);
+void stopSDToothLogger(void);
+#endif
+
 #endif
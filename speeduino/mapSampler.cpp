@@ -0,0 +1,193 @@
+/*
+Speeduino - Simple engine management for the Arduino Mega 2560 platform
+Copyright (C) Josh Stewart
+A full copy of the license may be found in the projects root directory
+*/
+/** @file
+ * Crank angle synchronous MAP sampling, see mapSampler.h
+ */
+#include "mapSampler.h"
+
+static volatile uint8_t cycleRevolutions = 0; //0 when disabled
+static volatile uint8_t sampleInterval = 0; //Teeth between samples. Set by the main loop from the tooth count of the last cycle, 0 until it is known
+
+//Only used by the ISR
+static bool cycleStarted = false;
+static uint16_t cycleStartRevolution;
+static uint16_t toothInCycle;
+static uint16_t activeInterval; //sampleInterval is latched at the start of each cycle so it cannot change part way through
+static uint16_t untilSample;
+static uint8_t activeBuffer = 0;
+static uint8_t sampleCount;
+static uint8_t errorCount;
+
+//The ISR fills one buffer while the main loop processes the other one
+static uint16_t mapBuffers[2][MAP_SAMPLER_MAX_SAMPLES];
+static uint16_t emapBuffers[2][MAP_SAMPLER_MAX_SAMPLES];
+
+//The last completed cycle. completedSequence is incremented before and after these are written, so the main loop can tell that it read a consistent set
+static volatile uint8_t completedSequence = 0;
+static volatile uint8_t completedBuffer;
+static volatile uint8_t completedSamples;
+static volatile uint8_t completedErrors;
+static volatile uint16_t completedTeeth;
+static uint8_t takenSequence = 0;
+static uint16_t lastCycleTeeth = 0;
+
+static void startCycle(uint16_t revolution)
+{
+  cycleStartRevolution = revolution;
+  toothInCycle = 0;
+  activeInterval = sampleInterval;
+  untilSample = 0; //The first tooth of each cycle is always sampled
+  sampleCount = 0;
+  errorCount = 0;
+  cycleStarted = true;
+}
+
+static void publishCycle(void)
+{
+  completedSequence++;
+  completedBuffer = activeBuffer;
+  completedSamples = sampleCount;
+  completedErrors = errorCount;
+  completedTeeth = toothInCycle;
+  completedSequence++;
+  activeBuffer ^= 1U;
+}
+
+/** Number of teeth between samples that gives close to MAP_SAMPLER_TARGET_SAMPLES per cycle, without overflowing the buffer */
+static uint16_t intervalForTeeth(uint16_t teeth)
+{
+  uint16_t interval = (teeth + (MAP_SAMPLER_TARGET_SAMPLES / 2U)) / MAP_SAMPLER_TARGET_SAMPLES;
+  if(interval == 0U) { interval = 1; }
+  while( ((teeth + interval - 1U) / interval) > MAP_SAMPLER_MAX_SAMPLES ) { interval++; }
+  if(interval > UINT8_MAX) { interval = UINT8_MAX; }
+  return interval;
+}
+
+/**
+ * Enable or disable the sampling. Changing the cycle length resets the sampler
+ * @param revolutionsPerCycle 2 for 4 stroke, 1 for 2 stroke. 0 disables the sampling
+ */
+void mapSamplerConfigure(uint8_t revolutionsPerCycle)
+{
+  if(revolutionsPerCycle == cycleRevolutions) { return; }
+  cycleRevolutions = 0; //Stops the ISR while the state is reset
+  mapSamplerReset();
+  cycleRevolutions = revolutionsPerCycle;
+}
+
+/** Discards the current cycle and the tooth count. The first 2 cycles after this have no samples */
+void mapSamplerReset(void)
+{
+  sampleInterval = 0;
+  cycleStarted = false;
+  takenSequence = completedSequence;
+  lastCycleTeeth = 0;
+}
+
+/**
+ * Called from the primary trigger interrupt after the decoder, on every valid tooth
+ * @param revolution The revolution counter (currentStatus.startRevolutions). Cycles start on a revolution that is a multiple of the cycle length
+ * @return true if MAP should be sampled on this tooth, followed by a call to mapSamplerAdd() or mapSamplerReject()
+ */
+bool mapSamplerTooth(uint16_t revolution)
+{
+  uint8_t revolutions = cycleRevolutions;
+  if(revolutions == 0U) { return false; }
+
+  if(cycleStarted == true)
+  {
+    uint16_t cycleRevolution = revolution - cycleStartRevolution;
+    if(cycleRevolution == revolutions)
+    {
+      publishCycle();
+      startCycle(revolution);
+    }
+    else if(cycleRevolution > revolutions) { cycleStarted = false; } //Revolutions have been missed (Eg sync loss). Wait for the next cycle boundary
+  }
+  if(cycleStarted == false)
+  {
+    if((revolution % revolutions) != 0U) { return false; }
+    startCycle(revolution);
+  }
+
+  toothInCycle++;
+  if( (activeInterval == 0U) || (sampleCount >= MAP_SAMPLER_MAX_SAMPLES) ) { return false; }
+  if(untilSample > 0U)
+  {
+    untilSample--;
+    return false;
+  }
+  untilSample = activeInterval - 1U;
+  return true;
+}
+
+/** Store the readings of a sample tooth */
+void mapSamplerAdd(uint16_t mapADC, uint16_t emapADC)
+{
+  if(sampleCount >= MAP_SAMPLER_MAX_SAMPLES) { return; }
+  mapBuffers[activeBuffer][sampleCount] = mapADC;
+  emapBuffers[activeBuffer][sampleCount] = emapADC;
+  sampleCount++;
+}
+
+/** A sample tooth where the reading was out of range or could not be taken */
+void mapSamplerReject(void)
+{
+  if(errorCount < UINT8_MAX) { errorCount++; }
+}
+
+/**
+ * Process the last completed cycle, if there is a new one since the last call. Also sets the sample teeth for the following cycles
+ * @param cycle Filled with the averages and minimum of the cycle. The cycle has no samples (And the averages are 0) if its tooth count differs from the previous cycle
+ * @return true if there was a new cycle
+ */
+bool mapSamplerTakeCycle(mapCycle_t &cycle)
+{
+  uint8_t sequence;
+  uint32_t mapSum;
+  uint32_t emapSum;
+  uint16_t mapMinimum;
+  do
+  {
+    sequence = completedSequence;
+    if( (sequence == takenSequence) || ((sequence & 1U) != 0U) ) { return false; }
+    uint8_t buffer = completedBuffer;
+    cycle.samples = completedSamples;
+    cycle.errors = completedErrors;
+    cycle.teeth = completedTeeth;
+    mapSum = 0;
+    emapSum = 0;
+    mapMinimum = UINT16_MAX;
+    for(uint8_t x = 0; x < cycle.samples; x++)
+    {
+      uint16_t reading = mapBuffers[buffer][x];
+      mapSum += reading;
+      emapSum += emapBuffers[buffer][x];
+      if(reading < mapMinimum) { mapMinimum = reading; }
+    }
+  } while(sequence != completedSequence); //A new cycle was published while this one was being read
+  takenSequence = sequence;
+
+  //If the tooth count has changed (The first cycle, or a cycle cut short by a sync loss) the samples were not evenly spread over the cycle
+  if(cycle.teeth != lastCycleTeeth) { cycle.samples = 0; }
+  lastCycleTeeth = cycle.teeth;
+
+  if(cycle.samples > 0U)
+  {
+    cycle.mapAverage = (uint16_t)(mapSum / cycle.samples);
+    cycle.emapAverage = (uint16_t)(emapSum / cycle.samples);
+    cycle.mapMinimum = mapMinimum;
+  }
+  else
+  {
+    cycle.mapAverage = 0;
+    cycle.emapAverage = 0;
+    cycle.mapMinimum = 0;
+  }
+
+  sampleInterval = (uint8_t)intervalForTeeth(cycle.teeth);
+  return true;
+}
@@ -0,0 +1,40 @@
+/** \file mapSampler.h
+ * @brief Crank angle synchronous MAP sampling
+ *
+ * MAP (And EMAP) are sampled from the primary trigger interrupt on a fixed set of teeth in each engine cycle, rather than whenever the main loop gets to it.
+ * The samples for a cycle are stored in a per cycle buffer. When the cycle completes the buffer is handed to the main loop, which averages it (Or takes the minimum)
+ * with mapSamplerTakeCycle(). Sample density, and so the load measurement, is then independent of the loop speed.
+ *
+ * The sample teeth are set from the number of teeth seen in the previous cycle so that the samples are evenly spread over the cycle for any decoder, with
+ * around MAP_SAMPLER_TARGET_SAMPLES per cycle. The first cycle after a reset only counts the teeth, so the first 2 cycles have no samples. Neither does any cycle where the tooth count changes (Eg a sync loss).
+ *
+ * The ISR side (mapSamplerTooth(), mapSamplerAdd() and mapSamplerReject()) must only be called from the primary trigger interrupt. Everything else is for the main loop.
+ * The exception is the AVR, where the trigger interrupt only starts the conversion and mapSamplerAdd() or mapSamplerReject() is called from the ADC complete interrupt.
+ * Neither interrupt can preempt the other, but a sample that completes after the next cycle has started is stored in the new cycle.
+ */
+#ifndef MAPSAMPLER_H
+#define MAPSAMPLER_H
+
+#include <stdint.h>
+
+#define MAP_SAMPLER_MAX_SAMPLES     16U /**< Size of each of the cycle buffers */
+#define MAP_SAMPLER_TARGET_SAMPLES  12U /**< Number of samples per cycle the tooth interval is chosen for */
+
+struct mapCycle_t
+{
+  uint16_t mapAverage; /**< ADC */
+  uint16_t mapMinimum; /**< ADC */
+  uint16_t emapAverage; /**< ADC, only valid if EMAP was sampled */
+  uint16_t teeth; /**< Number of teeth in the cycle */
+  uint8_t samples; /**< Number of valid samples in the cycle */
+  uint8_t errors; /**< Number of samples rejected as out of range, or that could not be taken */
+};
+
+void mapSamplerConfigure(uint8_t revolutionsPerCycle);
+void mapSamplerReset(void);
+bool mapSamplerTooth(uint16_t revolution);
+void mapSamplerAdd(uint16_t mapADC, uint16_t emapADC);
+void mapSamplerReject(void);
+bool mapSamplerTakeCycle(mapCycle_t &cycle);
+
+#endif
@@ -1,6 +1,7 @@
 #include "pages.h"
 #include "globals.h"
 #include "utilities.h"
+#include "corrections.h"
 #include "table3d_axis_io.h"
 
 // Maps from virtual page "addresses" to addresses/bytes of real in memory entities
@@ -431,6 +432,8 @@ void setPageValue(byte pageNum, uint16_t offset, byte value)
   page_iterator_t entity = map_page_offset_to_entity(pageNum, offset);
 
   set_value(entity, value, offset);
+  if(pageNum == progOutsPage) { programmableIOChanged(); }
+  if(pageNum == warmupPage) { knockConfigChanged(); }
 }
 
 byte getPageValue(byte pageNum, uint16_t offset)
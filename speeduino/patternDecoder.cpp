@@ -0,0 +1,233 @@
+/*
+Speeduino - Simple engine management for the Arduino Mega 2560 platform
+Copyright (C) Josh Stewart
+A full copy of the license may be found in the projects root directory
+*/
+/** @file
+ * Table driven trigger wheel decoding, see patternDecoder.h
+ */
+#include "patternDecoder.h"
+
+#define PATTERN_RATIO_SHIFT 2U //Gap ratios are held with 2 fractional bits (Ie in quarters)
+#define PATTERN_RATIO_MARGIN 2U //The key ratio must be at least half a gap larger than any other ratio on the wheel
+
+//Built in wheels. Adding a wheel only needs a table here and an entry in patternTable()
+static const patternGap_t gaps36_2_1[] = { { 19U, 1U }, { 35U, 2U } }; //Mitsubishi 4B11. Tooth #1 is the first tooth after the double gap
+static const patternGap_t gapsGM7X[] = { { 2U, 5U }, { 9U, 4U }, { 14U, 5U }, { 20U, 5U }, { 26U, 5U }, { 32U, 5U } }; //6 teeth 60 degrees apart with the extra tooth 10 degrees after the 2nd
+
+static const triggerPattern_t pattern36_2_1 = { 36U, 360U, sizeof(gaps36_2_1) / sizeof(gaps36_2_1[0]), gaps36_2_1 };
+static const triggerPattern_t patternGM7X = { 36U, 360U, sizeof(gapsGM7X) / sizeof(gapsGM7X[0]), gapsGM7X };
+
+//The compiled wheel
+static uint8_t missingMap[(PATTERN_MAX_POSITIONS + 8U) / 8U]; //1 bit per position, set when there is no tooth
+static uint8_t positions = 0; //0 when no wheel has been compiled
+static uint16_t positionAngle = 0;
+static uint8_t keyPosition = 0;
+static uint16_t keyThreshold = 0; //Gap ratio of the key tooth, in quarters
+static uint8_t longestGap = 0; //Positions
+
+static volatile uint8_t currentPosition = 0; //0 until the key tooth has been found
+
+static inline bool isMissing(uint8_t position)
+{
+  return (missingMap[position >> 3] & (1U << (position & 7U))) != 0U;
+}
+
+/**
+ * Step from a tooth to the next one on the wheel
+ * @param position The current tooth
+ * @param gap Set to the number of positions moved
+ * @return The position of the next tooth
+ */
+static inline uint8_t nextTooth(uint8_t position, uint8_t &gap)
+{
+  gap = 0;
+  do
+  {
+    position = (position >= positions) ? 1U : (position + 1U);
+    gap++;
+  } while( (isMissing(position) == true) && (gap < positions) );
+  return position;
+}
+
+/**
+ * Get one of the built in wheels
+ * @param table One of the PATTERN_TABLE_* values
+ * @return The wheel, or nullptr for PATTERN_TABLE_MISSING_TOOTH and unknown values
+ */
+const triggerPattern_t* patternTable(uint8_t table)
+{
+  switch(table)
+  {
+    case PATTERN_TABLE_36_2_1:  return &pattern36_2_1;
+    case PATTERN_TABLE_GM7X:    return &patternGM7X;
+    default:                    return nullptr;
+  }
+}
+
+/**
+ * Build the bitmap and the sync rule for a wheel. This replaces any wheel that was compiled before and clears the position
+ * @return false if the description is invalid or the wheel has no unique key gap. patternTooth() then never finds the position
+ */
+bool patternCompile(const triggerPattern_t &pattern)
+{
+  currentPosition = 0;
+  positions = 0;
+  if( (pattern.positions < 2U) || (pattern.cycleAngle < pattern.positions) ) { return false; }
+
+  for(uint8_t x = 0; x < sizeof(missingMap); x++) { missingMap[x] = 0; }
+  for(uint8_t x = 0; x < pattern.gapCount; x++)
+  {
+    for(uint8_t y = 0; y < pattern.gaps[x].count; y++)
+    {
+      uint16_t position = (uint16_t)pattern.gaps[x].position + y;
+      if( (position == 0U) || (position > pattern.positions) ) { return false; }
+      missingMap[position >> 3] |= (1U << (position & 7U));
+    }
+  }
+  positions = pattern.positions;
+  positionAngle = pattern.cycleAngle / pattern.positions;
+
+  uint8_t firstTooth = 1;
+  while( (firstTooth <= positions) && (isMissing(firstTooth) == true) ) { firstTooth++; }
+  if(firstTooth > positions) { positions = 0; return false; }
+
+  //Go round once to find the gap before the first tooth and the number of teeth
+  uint8_t gap = 0;
+  uint8_t teeth = 0;
+  uint8_t position = firstTooth;
+  do
+  {
+    position = nextTooth(position, gap);
+    teeth++;
+  } while(position != firstTooth);
+  if(teeth < 2U) { positions = 0; return false; }
+
+  //Then again to find the tooth with the largest gap ratio, which is the key tooth
+  uint8_t previousGap = gap;
+  uint16_t largestRatio = 0;
+  uint16_t secondRatio = 0;
+  longestGap = 0;
+  do
+  {
+    position = nextTooth(position, gap);
+    uint16_t ratio = ((uint16_t)gap << PATTERN_RATIO_SHIFT) / previousGap;
+    if(ratio > largestRatio)
+    {
+      secondRatio = largestRatio;
+      largestRatio = ratio;
+      keyPosition = position;
+    }
+    else if(ratio > secondRatio) { secondRatio = ratio; }
+    if(gap > longestGap) { longestGap = gap; }
+    previousGap = gap;
+  } while(position != firstTooth);
+
+  if(largestRatio < (secondRatio + PATTERN_RATIO_MARGIN)) { positions = 0; return false; }
+  keyThreshold = (largestRatio + secondRatio) >> 1;
+  return true;
+}
+
+/**
+ * Compile a wheel with evenly spaced teeth and a single run of missing teeth before tooth #1
+ * @param teeth The number of teeth if none were missing
+ * @param missingTeeth The number of missing teeth
+ * @param cycleAngle 360 for a crank wheel, 720 for a cam wheel
+ */
+bool patternCompileMissingTooth(uint8_t teeth, uint8_t missingTeeth, uint16_t cycleAngle)
+{
+  patternGap_t gap = { (uint8_t)(teeth - missingTeeth + 1U), missingTeeth };
+  triggerPattern_t pattern = { teeth, cycleAngle, 1U, &gap };
+  if( (missingTeeth == 0U) || (missingTeeth >= teeth) ) { pattern.gapCount = 0; } //No key gap, fails to compile
+  return patternCompile(pattern);
+}
+
+/** Forget the position, Eg after a stall. The next key gap finds it again */
+void patternReset(void)
+{
+  currentPosition = 0;
+}
+
+/**
+ * Process a primary tooth. Called from the trigger interrupt
+ * @param gap uS since the previous tooth
+ * @param lastGap uS between the previous tooth and the one before it. 0 if it is not known yet
+ * @return PATTERN_EVENT_* bits
+ */
+uint8_t patternTooth(uint32_t gap, uint32_t lastGap)
+{
+  uint8_t events = 0;
+  if(positions == 0U) { return events; }
+
+  bool keyGap = (lastGap > 0U) && ((gap << PATTERN_RATIO_SHIFT) > (lastGap * keyThreshold));
+  if(currentPosition == 0U)
+  {
+    if(keyGap == true)
+    {
+      currentPosition = keyPosition;
+      events |= (1U << PATTERN_EVENT_KEY);
+    }
+  }
+  else
+  {
+    uint8_t toothGap;
+    uint8_t position = nextTooth(currentPosition, toothGap);
+    if( (keyGap == true) && (position != keyPosition) )
+    {
+      //A tooth has been missed or there was an extra one. Start again from the key tooth
+      position = keyPosition;
+      events |= (1U << PATTERN_EVENT_SYNC_LOST);
+    }
+    else
+    {
+      //The count is trusted at the key tooth even if the gap was not seen, as the missing tooth decoder does
+      if(position == keyPosition) { events |= (1U << PATTERN_EVENT_KEY); }
+      if(position < currentPosition) { events |= (1U << PATTERN_EVENT_CYCLE); }
+      if(toothGap == 1U) { events |= (1U << PATTERN_EVENT_NORMAL_GAP); }
+    }
+    currentPosition = position;
+  }
+  return events;
+}
+
+/** The position of the last tooth, 0 if it is not known */
+uint8_t patternPosition(void)
+{
+  return currentPosition;
+}
+
+/** The number of positions on the compiled wheel, 0 if there is none */
+uint8_t patternPositions(void)
+{
+  return positions;
+}
+
+/** Crank degrees between 2 positions */
+uint16_t patternPositionAngle(void)
+{
+  return positionAngle;
+}
+
+/** The longest gap between 2 teeth, in positions */
+uint8_t patternLongestGap(void)
+{
+  return longestGap;
+}
+
+/**
+ * Find the last tooth at or before a position. Used to pick the teeth that the per tooth timing is done on
+ * @param position 1 to range
+ * @param range The number of positions per cycle. This is a multiple of the wheel positions when the cycle is longer than 1 turn of the wheel (Eg sequential with a crank wheel)
+ * @return The position of the tooth, 1 to range
+ */
+uint16_t patternToothAtOrBefore(uint16_t position, uint16_t range)
+{
+  if(positions == 0U) { return position; }
+  for(uint8_t x = 0; x < positions; x++)
+  {
+    uint8_t wheelPosition = (uint8_t)(((position - 1U) % positions) + 1U);
+    if(isMissing(wheelPosition) == false) { break; }
+    position = (position > 1U) ? (position - 1U) : range;
+  }
+  return position;
+}
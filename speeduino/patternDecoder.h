@@ -0,0 +1,59 @@
+/** \file patternDecoder.h
+ * @brief Table driven trigger wheel decoding
+ *
+ * A wheel is described by a triggerPattern_t rather than by code: the number of evenly spaced tooth positions around the wheel and the runs of positions that have no tooth.
+ * patternCompile() turns the description into a bitmap of the missing positions and works out the sync rule, which is the tooth whose gap is the largest multiple of the gap
+ * before it (The key tooth, Eg the first tooth after the gap of a missing tooth wheel). The threshold for recognising the key gap is set halfway between that ratio and the
+ * next largest one on the wheel, so a wheel can be added as long as its key gap is unique.
+ *
+ * The primary trigger interrupt passes every tooth gap to patternTooth(), which does the same small amount of work for every wheel: one comparison for the key gap and a step
+ * along the bitmap to the next tooth position. The returned PATTERN_EVENT_* flags tell the decoder when the position was found, when the cycle starts again and when the key gap
+ * was seen somewhere it should not have been (Sync loss).
+ *
+ * Positions are numbered from 1, position 1 being the trigger angle. The angle of a position is (position - 1) * the angle of one position.
+ */
+#ifndef PATTERNDECODER_H
+#define PATTERNDECODER_H
+
+#include <stdint.h>
+
+#define PATTERN_MAX_POSITIONS     255U /**< The number of positions is stored as a byte, the same as the configured tooth count */
+
+#define PATTERN_EVENT_NORMAL_GAP  0U /**< The gap before this tooth was a single position */
+#define PATTERN_EVENT_KEY         1U /**< This is the key tooth, either when the position is first found or when it comes round again */
+#define PATTERN_EVENT_CYCLE       2U /**< The position has wrapped round to the start of the wheel */
+#define PATTERN_EVENT_SYNC_LOST   3U /**< The key gap was seen at the wrong position. The position is moved to the key tooth */
+
+/** A run of consecutive positions that have no tooth */
+struct patternGap_t
+{
+  uint8_t position; /**< The first missing position */
+  uint8_t count; /**< The number of missing positions */
+};
+
+/** Description of a trigger wheel */
+struct triggerPattern_t
+{
+  uint8_t positions; /**< The number of evenly spaced positions around the wheel, including the missing ones */
+  uint16_t cycleAngle; /**< Crank degrees for one turn of the wheel. 360 for a crank wheel, 720 for a cam wheel */
+  uint8_t gapCount; /**< The number of entries in gaps */
+  const patternGap_t *gaps; /**< The runs of missing positions */
+};
+
+//Built in wheels, see patternTable()
+#define PATTERN_TABLE_MISSING_TOOTH 0U /**< Not a table, the missing tooth wheel is built from the tooth count and missing teeth settings by patternCompileMissingTooth() */
+#define PATTERN_TABLE_36_2_1        1U
+#define PATTERN_TABLE_GM7X          2U
+
+const triggerPattern_t* patternTable(uint8_t table);
+bool patternCompile(const triggerPattern_t &pattern);
+bool patternCompileMissingTooth(uint8_t teeth, uint8_t missingTeeth, uint16_t cycleAngle);
+void patternReset(void);
+uint8_t patternTooth(uint32_t gap, uint32_t lastGap);
+uint8_t patternPosition(void);
+uint8_t patternPositions(void);
+uint16_t patternPositionAngle(void);
+uint8_t patternLongestGap(void);
+uint16_t patternToothAtOrBefore(uint16_t position, uint16_t range);
+
+#endif
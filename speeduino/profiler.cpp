@@ -0,0 +1,76 @@
+/*
+Speeduino - Simple engine management for the Arduino Mega 2560 platform
+Copyright (C) Josh Stewart
+A full copy of the license may be found in the projects root directory
+*/
+/** @file
+ * Per section timing of the main loop, see profiler.h
+ */
+#include "globals.h"
+#include "profiler.h"
+
+#define PROFILE_AVERAGE_SHIFT 4 /**< The rolling average covers roughly the last 16 passes of the loop */
+#define PROFILE_TIME_MAX      INT16_MAX /**< Times saturate at this (uS) so that they also fit the signed readable log entries */
+
+static uint16_t passTimes[PROFILE_SECTIONS]; //uS spent in each section in the current pass
+static uint16_t averages[PROFILE_SECTIONS]; //uS
+static uint16_t maximums[PROFILE_SECTIONS]; //uS, since the last publish
+static uint16_t publishedMaximums[PROFILE_SECTIONS]; //uS, the maximums of the last complete second
+
+/**
+ * Add the time since start to a section
+ * @param section One of profileSection_t
+ * @param start micros() at the start of the section
+ * @return micros() now, so that it can be used as the start of the next section
+ */
+uint32_t profileSection(uint8_t section, uint32_t start)
+{
+  uint32_t now = micros();
+  uint32_t elapsed = now - start;
+  profileAdd(section, (elapsed > PROFILE_TIME_MAX) ? PROFILE_TIME_MAX : (uint16_t)elapsed);
+  return now;
+}
+
+/** Add a time that has already been measured (Eg a task run time) to a section */
+void profileAdd(uint8_t section, uint16_t time)
+{
+  if(section >= PROFILE_SECTIONS) { return; }
+  uint32_t total = (uint32_t)passTimes[section] + time;
+  passTimes[section] = (total > PROFILE_TIME_MAX) ? PROFILE_TIME_MAX : (uint16_t)total;
+}
+
+/**
+ * Called at the end of every pass of the main loop
+ * @param publishMaximums true once per second. The maximums since the last publish are made available to profileMaximum() and then reset
+ */
+void profileLoopEnd(bool publishMaximums)
+{
+  for(uint8_t x = 0; x < PROFILE_SECTIONS; x++)
+  {
+    uint16_t passTime = passTimes[x];
+    passTimes[x] = 0;
+
+    averages[x] = (uint16_t)((((uint32_t)averages[x] << PROFILE_AVERAGE_SHIFT) - averages[x] + passTime) >> PROFILE_AVERAGE_SHIFT);
+    if(passTime > maximums[x]) { maximums[x] = passTime; }
+
+    if(publishMaximums == true)
+    {
+      publishedMaximums[x] = maximums[x];
+      maximums[x] = 0;
+    }
+  }
+}
+
+/** Rolling average time per pass of the loop of a section in uS */
+uint16_t profileAverage(uint8_t section)
+{
+  if(section >= PROFILE_SECTIONS) { return 0; }
+  return averages[section];
+}
+
+/** Longest time of a section in a single pass of the loop during the last second, in uS */
+uint16_t profileMaximum(uint8_t section)
+{
+  if(section >= PROFILE_SECTIONS) { return 0; }
+  return publishedMaximums[section];
+}
@@ -0,0 +1,33 @@
+/** \file profiler.h
+ * @brief Per section timing of the main loop
+ *
+ * The time spent in each major section of the main loop is added up over each pass of the loop with profileSection(). The tasks are added by the task scheduler
+ * to the section they are registered with. At the end of each pass profileLoopEnd() folds the pass times into a rolling average and a maximum per section.
+ * The averages and the maximums of the last second are sent as output channels and written to the SD log, so that the loop time under real load can be checked.
+ *
+ * A section that does not run on every pass (Eg the aux controls) has an average that is its cost spread over all of the passes, while the maximum shows the worst pass.
+ */
+#ifndef PROFILER_H
+#define PROFILER_H
+
+#include <stdint.h>
+
+enum profileSection_t
+{
+  PROFILE_COMMS, /**< Serial and CAN comms */
+  PROFILE_SENSORS, /**< Sensor reads */
+  PROFILE_CORRECTIONS, /**< Table lookups and the fuel corrections */
+  PROFILE_PW, /**< Pulse width, injection angle and ignition angle calculations */
+  PROFILE_SCHEDULE, /**< Setting the fuel and ignition schedules */
+  PROFILE_AUX, /**< Idle, boost, VVT, fan and the other aux controls */
+  PROFILE_SD, /**< SD card logging and storage */
+  PROFILE_SECTIONS /**< Number of sections. Must be last */
+};
+
+uint32_t profileSection(uint8_t section, uint32_t start);
+void profileAdd(uint8_t section, uint16_t time);
+void profileLoopEnd(bool publishMaximums);
+uint16_t profileAverage(uint8_t section);
+uint16_t profileMaximum(uint8_t section);
+
+#endif
@@ -0,0 +1,93 @@
+/*
+Speeduino - Simple engine management for the Arduino Mega 2560 platform
+Copyright (C) Josh Stewart
+A full copy of the license may be found in the projects root directory
+*/
+/** @file
+ * Consumer side of the frequency input capture, see pulseCapture.h
+ */
+#include "pulseCapture.h"
+
+#define CAPTURE_SNAPSHOT_ATTEMPTS 4U
+
+/**
+ * Clear a capture and set its glitch rejection. Must not be called while the interrupt for the input is attached
+ * @param capture
+ * @param minPeriod Edges less than this many uS after the last one are rejected
+ */
+void captureReset(pulseCapture_t &capture, uint32_t minPeriod)
+{
+  capture.samples = 0;
+  capture.head = 0;
+  capture.started = false;
+  capture.glitches = 0;
+  capture.widthStart = 0;
+  capture.minPeriod = minPeriod;
+}
+
+/**
+ * Change the glitch rejection of a running capture (Eg after the VSS calibration has changed).
+ * The interrupt only reads this value, so a torn write can at worst reject or accept a single edge wrongly
+ */
+void captureSetMinPeriod(pulseCapture_t &capture, uint32_t minPeriod)
+{
+  capture.minPeriod = minPeriod;
+}
+
+/**
+ * Copy the current periods of a capture.
+ * If the interrupt updates the capture during the copy, the copy is retried. In the very unlikely case that every attempt is interrupted
+ * (Which needs an edge rate close to the time of the copy) the last copy is used, which has at most 1 mixed up period that the median will ignore
+ */
+void captureSnapshot(const pulseCapture_t &capture, captureSnapshot_t &snapshot)
+{
+  uint8_t attempts = 0;
+  uint8_t sequence;
+  do
+  {
+    sequence = capture.sequence;
+    snapshot.samples = capture.samples;
+    snapshot.head = capture.head;
+    snapshot.lastEdge = capture.lastEdge;
+    for(uint8_t x = 0; x < CAPTURE_SAMPLES; x++)
+    {
+      snapshot.periods[x] = capture.periods[x];
+      snapshot.widths[x] = capture.widths[x];
+    }
+    attempts++;
+  } while( ( ((sequence & 1U) != 0U) || (capture.sequence != sequence) ) && (attempts < CAPTURE_SNAPSHOT_ATTEMPTS) );
+}
+
+//Insertion sort of the newest count values in the ring. count is at most CAPTURE_SAMPLES so this is quicker than anything more clever
+template <typename T>
+static T ringMedian(const T *ring, uint8_t head, uint8_t count)
+{
+  T sorted[CAPTURE_SAMPLES];
+  for(uint8_t x = 0; x < count; x++)
+  {
+    T value = ring[(head - x) & CAPTURE_SAMPLES_MASK];
+    uint8_t pos = x;
+    while( (pos > 0U) && (sorted[pos-1U] > value) )
+    {
+      sorted[pos] = sorted[pos-1U];
+      pos--;
+    }
+    sorted[pos] = value;
+  }
+  //Even counts use the mean of the 2 middle values
+  return (T)(sorted[(count - 1U) / 2U] + ((sorted[count / 2U] - sorted[(count - 1U) / 2U]) / 2U));
+}
+
+/** Median of the valid periods in a snapshot in uS, 0 if there are none */
+uint32_t captureMedianPeriod(const captureSnapshot_t &snapshot)
+{
+  if(snapshot.samples == 0U) { return 0; }
+  return ringMedian(snapshot.periods, snapshot.head, snapshot.samples);
+}
+
+/** Median of the pulse widths in a snapshot in uS, 0 if there are none */
+uint16_t captureMedianWidth(const captureSnapshot_t &snapshot)
+{
+  if(snapshot.samples == 0U) { return 0; }
+  return ringMedian(snapshot.widths, snapshot.head, snapshot.samples);
+}
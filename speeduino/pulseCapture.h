@@ -0,0 +1,94 @@
+/** \file pulseCapture.h
+ * @brief Timestamped capture of the frequency inputs (VSS and flex sensor)
+ *
+ * The interrupt for the input (Or the board's hardware input capture, see boardCaptureAttach()) passes the time of each edge to captureEdge().
+ * This works out the period since the previous edge, rejects glitches and adds the period to a small ring. Nothing else is done in the interrupt.
+ *
+ * The consumers (getSpeed() and the flex reading) take a copy of the ring with captureSnapshot() once each time they run. This does not disable interrupts:
+ * the interrupt increments a sequence number before and after each update and the copy is simply retried if it changed while copying.
+ * The median of the copied periods is then used, which ignores the odd bad period that gets past the glitch rejection.
+ */
+#ifndef PULSECAPTURE_H
+#define PULSECAPTURE_H
+
+#include <stdint.h>
+
+#define CAPTURE_SAMPLES       8U /**< Number of periods held for each input. Must be a power of 2 */
+#define CAPTURE_SAMPLES_MASK  (CAPTURE_SAMPLES - 1U)
+#define CAPTURE_TIMEOUT       1000000UL /**< A gap between edges longer than this (In uS) means the input had stopped. The ring is cleared and a new measurement is started */
+
+struct pulseCapture_t
+{
+  volatile uint32_t periods[CAPTURE_SAMPLES];
+  volatile uint16_t widths[CAPTURE_SAMPLES]; /**< Time from captureWidthStart() to the edge that ended each period. 0 if there was no width start in the period */
+  volatile uint32_t lastEdge; /**< Time of the last accepted edge */
+  volatile uint32_t widthStart;
+  volatile uint8_t head; /**< Index of the newest period */
+  volatile uint8_t samples; /**< Number of valid periods in the ring */
+  volatile uint8_t sequence; /**< Odd while the interrupt is updating the ring */
+  volatile uint8_t glitches; /**< Count of rejected edges. Rolls over */
+  volatile bool started; /**< Whether there has been an edge since the last reset */
+  uint32_t minPeriod; /**< Edges that come less than this (In uS) after the last accepted edge are rejected */
+};
+
+/** A copy of the capture ring that the consumer can use without worrying about the interrupt */
+struct captureSnapshot_t
+{
+  uint32_t periods[CAPTURE_SAMPLES];
+  uint16_t widths[CAPTURE_SAMPLES];
+  uint32_t lastEdge;
+  uint8_t head;
+  uint8_t samples;
+};
+
+/**
+ * Called from the interrupt for each edge that ends a period (Eg the rising edge).
+ * An edge is rejected as a glitch if it is less than the minimum period or less than 1/4 of the previous period after the last accepted edge.
+ * A rejected edge is ignored completely, so the next good edge still measures the full period
+ * @param capture
+ * @param edgeTime Time of the edge in uS
+ */
+static inline void captureEdge(pulseCapture_t &capture, uint32_t edgeTime)
+{
+  uint32_t period = edgeTime - capture.lastEdge;
+  if(capture.started == true)
+  {
+    if( (period < capture.minPeriod) || ( (capture.samples > 0U) && (period < (capture.periods[capture.head] >> 2)) ) )
+    {
+      capture.glitches++;
+      return;
+    }
+  }
+
+  capture.sequence++;
+  if( (capture.started == false) || (period > CAPTURE_TIMEOUT) ) { capture.samples = 0; } //1st edge after a stop only starts the measurement
+  else
+  {
+    uint8_t index = (capture.head + 1U) & CAPTURE_SAMPLES_MASK;
+    uint32_t width = edgeTime - capture.widthStart;
+    capture.periods[index] = period;
+    if(width >= period) { capture.widths[index] = 0; } //No width start in this period
+    else if(width > UINT16_MAX) { capture.widths[index] = UINT16_MAX; }
+    else { capture.widths[index] = (uint16_t)width; }
+    capture.head = index;
+    if(capture.samples < CAPTURE_SAMPLES) { capture.samples++; }
+  }
+  capture.lastEdge = edgeTime;
+  capture.started = true;
+  capture.sequence++;
+}
+
+/** Called from the interrupt for the edge that starts a pulse width measurement (Eg the falling edge). Optional */
+static inline void captureWidthStart(pulseCapture_t &capture, uint32_t edgeTime) { capture.widthStart = edgeTime; }
+
+void captureReset(pulseCapture_t &capture, uint32_t minPeriod);
+void captureSetMinPeriod(pulseCapture_t &capture, uint32_t minPeriod);
+void captureSnapshot(const pulseCapture_t &capture, captureSnapshot_t &snapshot);
+uint32_t captureMedianPeriod(const captureSnapshot_t &snapshot);
+uint16_t captureMedianWidth(const captureSnapshot_t &snapshot);
+/** Most recent period of a snapshot, 0 if there is none */
+static inline uint32_t captureLatestPeriod(const captureSnapshot_t &snapshot) { return (snapshot.samples > 0U) ? snapshot.periods[snapshot.head] : 0U; }
+/** Whether the input has stopped, ie there are no periods or the last edge was more than CAPTURE_TIMEOUT before now */
+static inline bool captureStopped(const captureSnapshot_t &snapshot, uint32_t now) { return (snapshot.samples == 0U) || ((now - snapshot.lastEdge) > CAPTURE_TIMEOUT); }
+
+#endif
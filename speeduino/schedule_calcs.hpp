@@ -5,6 +5,7 @@
 #include "crankMaths.h"
 #include "maths.h"
 #include "timers.h"
+#include "dwellLimit.h"
 
 static inline uint16_t calculateInjectorStartAngle(uint16_t pwDegrees, int16_t injChannelDegrees, uint16_t injAngle)
 {
@@ -104,11 +105,29 @@ static inline uint32_t calculateIgnitionTimeout(const IgnitionSchedule &schedule
   return _calculateIgnitionTimeout(schedule, _adjustToIgnChannel(startAngle, channelIgnDegrees), _adjustToIgnChannel(crankAngle, channelIgnDegrees));
 }
 
+/** The compare value that ends a RUNNING ignition schedule endTicks from now. Capped at the dwell limit set when the coil started charging, see dwellLimit.h */
+static inline COMPARE_TYPE ignitionRunningEndCompare(const IgnitionSchedule &schedule, COMPARE_TYPE endTicks)
+{
+  COMPARE_TYPE counter = schedule.counter;
+  return (COMPARE_TYPE)(counter + dwellRunningEndTicks(endTicks, (COMPARE_TYPE)(schedule.dwellLimitCompare - counter), (dwellLimitTicks != 0U)));
+}
+
+/** Sets the end of the charge when an ignition schedule goes from PENDING to RUNNING. The overdwell protection caps it at the dwell limit here rather than the coil being checked every ms */
+static inline void ignitionStartCharge(IgnitionSchedule &schedule)
+{
+  COMPARE_TYPE counter = schedule.counter;
+  COMPARE_TYPE dwellTicks;
+  if(schedule.endScheduleSetByDecoder == true) { dwellTicks = (COMPARE_TYPE)(schedule.endCompare - counter); }
+  else { dwellTicks = uS_TO_TIMER_COMPARE(schedule.duration); } //Doing this here prevents a potential overflow on restarts
+  schedule.endCompare = counter + dwellStartTicks(dwellTicks, dwellLimitTicks);
+  schedule.dwellLimitCompare = (dwellLimitTicks != 0U) ? (COMPARE_TYPE)(counter + dwellLimitTicks) : schedule.endCompare;
+}
+
 #define MIN_CYCLES_FOR_ENDCOMPARE 6
 
 inline void adjustCrankAngle(IgnitionSchedule &schedule, int endAngle, int crankAngle) {
   if( (schedule.Status == RUNNING) ) { 
-    SET_COMPARE(schedule.compare, schedule.counter + uS_TO_TIMER_COMPARE( angleToTimeMicroSecPerDegree( ignitionLimits( (endAngle - crankAngle) ) ) ) ); 
+    SET_COMPARE(schedule.compare, ignitionRunningEndCompare(schedule, uS_TO_TIMER_COMPARE( angleToTimeMicroSecPerDegree( ignitionLimits( (endAngle - crankAngle) ) ) ) ) ); 
   }
   else if(currentStatus.startRevolutions > MIN_CYCLES_FOR_ENDCOMPARE) { 
     schedule.endCompare = schedule.counter + uS_TO_TIMER_COMPARE( angleToTimeMicroSecPerDegree( ignitionLimits( (endAngle - crankAngle) ) ) ); 
@@ -29,6 +29,8 @@ A full copy of the license may be found in the projects root directory
 #include "scheduledIO.h"
 #include "timers.h"
 #include "schedule_calcs.h"
+#include "knock.h"
+#include <util/atomic.h>
 
 FuelSchedule fuelSchedule1(FUEL1_COUNTER, FUEL1_COMPARE, FUEL1_TIMER_DISABLE, FUEL1_TIMER_ENABLE);
 FuelSchedule fuelSchedule2(FUEL2_COUNTER, FUEL2_COMPARE, FUEL2_TIMER_DISABLE, FUEL2_TIMER_ENABLE);
@@ -48,6 +50,8 @@ FuelSchedule fuelSchedule7(FUEL7_COUNTER, FUEL7_COMPARE, FUEL7_TIMER_DISABLE, FU
 FuelSchedule fuelSchedule8(FUEL8_COUNTER, FUEL8_COMPARE, FUEL8_TIMER_DISABLE, FUEL8_TIMER_ENABLE);
 #endif
 
+volatile COMPARE_TYPE dwellLimitTicks = 0;
+
 IgnitionSchedule ignitionSchedule1(IGN1_COUNTER, IGN1_COMPARE, IGN1_TIMER_DISABLE, IGN1_TIMER_ENABLE);
 IgnitionSchedule ignitionSchedule2(IGN2_COUNTER, IGN2_COMPARE, IGN2_TIMER_DISABLE, IGN2_TIMER_ENABLE);
 IgnitionSchedule ignitionSchedule3(IGN3_COUNTER, IGN3_COMPARE, IGN3_TIMER_DISABLE, IGN3_TIMER_ENABLE);
@@ -273,12 +277,33 @@ void refreshIgnitionSchedule1(unsigned long timeToEnd)
   //if( (timeToEnd < ignitionSchedule1.duration) && (timeToEnd > IGNITION_REFRESH_THRESHOLD) )
   {
     noInterrupts();
-    ignitionSchedule1.endCompare = IGN1_COUNTER + uS_TO_TIMER_COMPARE(timeToEnd);
+    ignitionSchedule1.endCompare = ignitionRunningEndCompare(ignitionSchedule1, uS_TO_TIMER_COMPARE(timeToEnd));
     SET_COMPARE(IGN1_COMPARE, ignitionSchedule1.endCompare);
     interrupts();
   }
 }
 
+/** Update the longest time a coil is allowed to charge for.
+ * The limit is applied by the ignition schedule interrupt when each coil starts charging, so that the end compare of the schedule is never later than the dwell limit.
+ * The dwell limiter is disabled during cranking on setups using the locked cranking timing. This is called every time the dwell is calculated, so the RPM check is current
+ * rather than relying on the engine cranking bit, which can be too slow in updating.
+ */
+void updateDwellLimit(void)
+{
+  bool isCrankLocked = configPage4.ignCranklock && (currentStatus.RPM < currentStatus.crankRPM);
+  COMPARE_TYPE limitTicks = 0;
+  if ( (configPage4.useDwellLim == 1) && (isCrankLocked != true) )
+  {
+    //The limit cannot be longer than the timer is able to count
+    if (dwellLimit_uS >= MAX_TIMER_PERIOD) { limitTicks = uS_TO_TIMER_COMPARE( (MAX_TIMER_PERIOD - 1) ); }
+    else { limitTicks = uS_TO_TIMER_COMPARE(dwellLimit_uS); }
+  }
+
+  noInterrupts();
+  dwellLimitTicks = limitTicks;
+  interrupts();
+}
+
 /** Perform the injector priming pulses.
  * Set these to run at an arbitrary time in the future (100us).
  * The prime pulse value is in ms*10, so need to multiple by 100 to get to uS
@@ -444,15 +469,15 @@ void fuelSchedule8Interrupt() //Most ARM chips can simply call a function
 // Shared ISR function for all ignition timers.
 // This is completely inlined into the ISR - there is no function call
 // overhead.
-static inline __attribute__((always_inline)) void ignitionScheduleISR(IgnitionSchedule &schedule)
+static inline __attribute__((always_inline)) void ignitionScheduleISR(IgnitionSchedule &schedule, uint8_t channel)
 {
   if (schedule.Status == PENDING) //Check to see if this schedule is turn on
   {
     schedule.pStartCallback();
     schedule.Status = RUNNING; //Set the status to be in progress (ie The start callback has been called, but not the end callback)
     schedule.startTime = micros();
-    if(schedule.endScheduleSetByDecoder == true) { SET_COMPARE(schedule.compare, schedule.endCompare); }
-    else { SET_COMPARE(schedule.compare, schedule.counter + uS_TO_TIMER_COMPARE(schedule.duration) ); } //Doing this here prevents a potential overflow on restarts
+    ignitionStartCharge(schedule);
+    SET_COMPARE(schedule.compare, schedule.endCompare);
   }
   else if (schedule.Status == RUNNING)
   {
@@ -460,6 +485,7 @@ static inline __attribute__((always_inline)) void ignitionScheduleISR(IgnitionSc
     schedule.Status = OFF; //Turn off the schedule
     schedule.endScheduleSetByDecoder = false;
     ignitionCount = ignitionCount + 1; //Increment the ignition counter
+    if(knockWindowsEnabled == true) { knockWindowArm(channel, micros()); } //The spark opens this channel's knock window
     currentStatus.actualDwell = DWELL_AVERAGE( (micros() - schedule.startTime) );
 
     //If there is a next schedule queued up, activate it
@@ -487,7 +513,7 @@ ISR(TIMER5_COMPA_vect) //cppcheck-suppress misra-c2012-8.2
 void ignitionSchedule1Interrupt(void) //Most ARM chips can simply call a function
 #endif
   {
-    ignitionScheduleISR(ignitionSchedule1);
+    ignitionScheduleISR(ignitionSchedule1, 0);
   }
 
 #if IGN_CHANNELS >= 2
@@ -497,7 +523,7 @@ ISR(TIMER5_COMPB_vect) //cppcheck-suppress misra-c2012-8.2
 void ignitionSchedule2Interrupt(void) //Most ARM chips can simply call a function
 #endif
   {
-    ignitionScheduleISR(ignitionSchedule2);
+    ignitionScheduleISR(ignitionSchedule2, 1);
   }
 #endif
 
@@ -508,7 +534,7 @@ ISR(TIMER5_COMPC_vect) //cppcheck-suppress misra-c2012-8.2
 void ignitionSchedule3Interrupt(void) //Most ARM chips can simply call a function
 #endif
   {
-    ignitionScheduleISR(ignitionSchedule3);
+    ignitionScheduleISR(ignitionSchedule3, 2);
   }
 #endif
 
@@ -519,7 +545,7 @@ ISR(TIMER4_COMPA_vect) //cppcheck-suppress misra-c2012-8.2
 void ignitionSchedule4Interrupt(void) //Most ARM chips can simply call a function
 #endif
   {
-    ignitionScheduleISR(ignitionSchedule4);
+    ignitionScheduleISR(ignitionSchedule4, 3);
   }
 #endif
 
@@ -530,7 +556,7 @@ ISR(TIMER4_COMPC_vect) //cppcheck-suppress misra-c2012-8.2
 void ignitionSchedule5Interrupt(void) //Most ARM chips can simply call a function
 #endif
   {
-    ignitionScheduleISR(ignitionSchedule5);
+    ignitionScheduleISR(ignitionSchedule5, 4);
   }
 #endif
 
@@ -541,7 +567,7 @@ ISR(TIMER4_COMPB_vect) //cppcheck-suppress misra-c2012-8.2
 void ignitionSchedule6Interrupt(void) //Most ARM chips can simply call a function
 #endif
   {
-    ignitionScheduleISR(ignitionSchedule6);
+    ignitionScheduleISR(ignitionSchedule6, 5);
   }
 #endif
 
@@ -552,7 +578,7 @@ ISR(TIMER3_COMPC_vect) //cppcheck-suppress misra-c2012-8.2
 void ignitionSchedule7Interrupt(void) //Most ARM chips can simply call a function
 #endif
   {
-    ignitionScheduleISR(ignitionSchedule7);
+    ignitionScheduleISR(ignitionSchedule7, 6);
   }
 #endif
 
@@ -563,85 +589,87 @@ ISR(TIMER3_COMPB_vect) //cppcheck-suppress misra-c2012-8.2
 void ignitionSchedule8Interrupt(void) //Most ARM chips can simply call a function
 #endif
   {
-    ignitionScheduleISR(ignitionSchedule8);
+    ignitionScheduleISR(ignitionSchedule8, 7);
   }
 #endif
 
 void disablePendingFuelSchedule(byte channel)
 {
-  noInterrupts();
-  switch(channel)
+  ATOMIC_BLOCK(ATOMIC_RESTORESTATE) //Restores the interrupt state so that this can also be called from an interrupt (The tooth rev limiter)
   {
-    case 0:
-      if(fuelSchedule1.Status == PENDING) { fuelSchedule1.Status = OFF; }
-      break;
-    case 1:
-      if(fuelSchedule2.Status == PENDING) { fuelSchedule2.Status = OFF; }
-      break;
-    case 2: 
-      if(fuelSchedule3.Status == PENDING) { fuelSchedule3.Status = OFF; }
-      break;
-    case 3:
-      if(fuelSchedule4.Status == PENDING) { fuelSchedule4.Status = OFF; }
-      break;
-    case 4:
+    switch(channel)
+    {
+      case 0:
+        if(fuelSchedule1.Status == PENDING) { fuelSchedule1.Status = OFF; }
+        break;
+      case 1:
+        if(fuelSchedule2.Status == PENDING) { fuelSchedule2.Status = OFF; }
+        break;
+      case 2: 
+        if(fuelSchedule3.Status == PENDING) { fuelSchedule3.Status = OFF; }
+        break;
+      case 3:
+        if(fuelSchedule4.Status == PENDING) { fuelSchedule4.Status = OFF; }
+        break;
+      case 4:
 #if (INJ_CHANNELS >= 5)
-      if(fuelSchedule5.Status == PENDING) { fuelSchedule5.Status = OFF; }
+        if(fuelSchedule5.Status == PENDING) { fuelSchedule5.Status = OFF; }
 #endif
-      break;
-    case 5:
+        break;
+      case 5:
 #if (INJ_CHANNELS >= 6)
-      if(fuelSchedule6.Status == PENDING) { fuelSchedule6.Status = OFF; }
+        if(fuelSchedule6.Status == PENDING) { fuelSchedule6.Status = OFF; }
 #endif
-      break;
-    case 6:
+        break;
+      case 6:
 #if (INJ_CHANNELS >= 7)
-      if(fuelSchedule7.Status == PENDING) { fuelSchedule7.Status = OFF; }
+        if(fuelSchedule7.Status == PENDING) { fuelSchedule7.Status = OFF; }
 #endif
-      break;
-    case 7:
+        break;
+      case 7:
 #if (INJ_CHANNELS >= 8)
-      if(fuelSchedule8.Status == PENDING) { fuelSchedule8.Status = OFF; }
+        if(fuelSchedule8.Status == PENDING) { fuelSchedule8.Status = OFF; }
 #endif
-      break;
+        break;
+    }
   }
-  interrupts();
 }
 void disablePendingIgnSchedule(byte channel)
 {
-  noInterrupts();
-  switch(channel)
+  ATOMIC_BLOCK(ATOMIC_RESTORESTATE) //Restores the interrupt state so that this can also be called from an interrupt (The tooth rev limiter)
   {
-    case 0:
-      if(ignitionSchedule1.Status == PENDING) { ignitionSchedule1.Status = OFF; }
-      break;
-    case 1:
-      if(ignitionSchedule2.Status == PENDING) { ignitionSchedule2.Status = OFF; }
-      break;
-    case 2: 
-      if(ignitionSchedule3.Status == PENDING) { ignitionSchedule3.Status = OFF; }
-      break;
-    case 3:
-      if(ignitionSchedule4.Status == PENDING) { ignitionSchedule4.Status = OFF; }
-      break;
-    case 4:
-      if(ignitionSchedule5.Status == PENDING) { ignitionSchedule5.Status = OFF; }
-      break;
+    switch(channel)
+    {
+      case 0:
+        if(ignitionSchedule1.Status == PENDING) { ignitionSchedule1.Status = OFF; }
+        break;
+      case 1:
+        if(ignitionSchedule2.Status == PENDING) { ignitionSchedule2.Status = OFF; }
+        break;
+      case 2: 
+        if(ignitionSchedule3.Status == PENDING) { ignitionSchedule3.Status = OFF; }
+        break;
+      case 3:
+        if(ignitionSchedule4.Status == PENDING) { ignitionSchedule4.Status = OFF; }
+        break;
+      case 4:
+        if(ignitionSchedule5.Status == PENDING) { ignitionSchedule5.Status = OFF; }
+        break;
 #if IGN_CHANNELS >= 6      
-    case 6:
-      if(ignitionSchedule6.Status == PENDING) { ignitionSchedule6.Status = OFF; }
-      break;
+      case 5:
+        if(ignitionSchedule6.Status == PENDING) { ignitionSchedule6.Status = OFF; }
+        break;
 #endif
 #if IGN_CHANNELS >= 7      
-    case 7:
-      if(ignitionSchedule7.Status == PENDING) { ignitionSchedule7.Status = OFF; }
-      break;
+      case 6:
+        if(ignitionSchedule7.Status == PENDING) { ignitionSchedule7.Status = OFF; }
+        break;
 #endif
 #if IGN_CHANNELS >= 8      
-    case 8:
-      if(ignitionSchedule8.Status == PENDING) { ignitionSchedule8.Status = OFF; }
-      break;
+      case 7:
+        if(ignitionSchedule8.Status == PENDING) { ignitionSchedule8.Status = OFF; }
+        break;
 #endif
+    }
   }
-  interrupts();
 }
@@ -57,6 +57,7 @@ void disablePendingFuelSchedule(byte channel);
 void disablePendingIgnSchedule(byte channel);
 
 void refreshIgnitionSchedule1(unsigned long timeToEnd);
+void updateDwellLimit(void);
 
 //The ARM cores use separate functions for their ISRs
 #if defined(ARDUINO_ARCH_STM32) || defined(CORE_TEENSY)
@@ -132,9 +133,10 @@ struct IgnitionSchedule {
   volatile ScheduleStatus Status; ///< Schedule status: OFF, PENDING, STAGED, RUNNING
   void (*pStartCallback)(void);        ///< Start Callback function for schedule
   void (*pEndCallback)(void);          ///< End Callback function for schedule
-  volatile unsigned long startTime; /**< The system time (in uS) that the schedule started, used by the overdwell protection in timers.ino */
+  volatile unsigned long startTime; /**< The system time (in uS) that the schedule started, used for the actual dwell */
   volatile COMPARE_TYPE startCompare; ///< The counter value of the timer when this will start
   volatile COMPARE_TYPE endCompare;   ///< The counter value of the timer when this will end
+  volatile COMPARE_TYPE dwellLimitCompare; ///< The latest counter value the end can be moved to while RUNNING. Set by the dwell limiter when the coil starts charging
 
   COMPARE_TYPE nextStartCompare;      ///< Planned start of next schedule (when current schedule is RUNNING)
   COMPARE_TYPE nextEndCompare;        ///< Planned end of next schedule (when current schedule is RUNNING)
@@ -229,6 +231,7 @@ extern FuelSchedule fuelSchedule7;
 extern FuelSchedule fuelSchedule8;
 #endif
 
+extern volatile COMPARE_TYPE dwellLimitTicks; //The longest a coil may charge for, in ignition timer ticks. 0 when the dwell limiter is off
 extern IgnitionSchedule ignitionSchedule1;
 extern IgnitionSchedule ignitionSchedule2;
 extern IgnitionSchedule ignitionSchedule3;
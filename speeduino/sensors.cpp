@@ -18,7 +18,11 @@ A full copy of the license may be found in the projects root directory
 #include "pages.h"
 #include "decoders.h"
 #include "auxiliaries.h"
+#include "analogScan.h"
+#include "mapSampler.h"
 #include "utilities.h"
+#include "pulseCapture.h"
+#include "knock.h"
 #include BOARD_H
 
 uint32_t MAPcurRev; //Tracks which revolution we're sampling on
@@ -29,15 +33,10 @@ bool auxIsEnabled;
 uint16_t MAPlast; /**< The previous MAP reading */
 unsigned long MAP_time; //The time the MAP sample was taken
 unsigned long MAPlast_time; //The time the previous MAP sample was taken
-volatile unsigned long vssTimes[VSS_SAMPLES] = {0};
-volatile byte vssIndex;
-
-volatile byte flexCounter = 0;
-volatile unsigned long flexStartTime;
-volatile unsigned long flexPulseWidth;
-
-volatile byte knockCounter = 0;
-volatile uint16_t knockAngle;
+static pulseCapture_t vssCapture;
+static pulseCapture_t flexCapture;
+static uint16_t vssMinPeriodPulsesPerKm; //The vssPulsesPerKm that the VSS glitch rejection was last set for
+static uint16_t flexPulseWidth; //Filtered flex sensor pulse width in uS
 
 //These variables are used for tracking the number of running sensors values that appear to be errors. Once a threshold is reached, the sensor reading will go to default value and assume the sensor is faulty
 byte mapErrorCount = 0;
@@ -45,6 +44,7 @@ byte mapErrorCount = 0;
 //byte cltErrorCount = 0; Not used
 
 static inline void validateMAP(void);
+static uint32_t vssMinPeriod(void);
 
 #if defined(ANALOG_ISR)
 static volatile uint16_t AnChannel[16];
@@ -81,6 +81,71 @@ ISR(ADC_vect)
 }
 #endif
 
+#if defined(CORE_AVR) && !defined(ANALOG_ISR)
+/* The ADC is shared between the analogRead() calls in the main loop and the crank synchronous MAP samples.
+ * The main loop owns it: the trigger interrupt only starts a MAP conversion when the loop is not using the ADC and the result is
+ * taken by the ADC complete interrupt, so neither interrupt waits for a conversion. */
+#define ADC_SHARED_MAP_SAMPLE
+
+#define ADC_SAMPLE_IDLE 0
+#define ADC_SAMPLE_MAP  1
+#define ADC_SAMPLE_EMAP 2
+
+static volatile bool adcLoopActive = false; //Set while the main loop is using the ADC
+static volatile uint8_t adcSampleState = ADC_SAMPLE_IDLE; //Conversion started by the trigger interrupt
+static volatile uint16_t adcSampleMAP;
+
+static void mapSampleResult(uint16_t mapReading, uint16_t emapReading);
+
+/** Select the channel and start a conversion that completes in ISR(ADC_vect) */
+static inline void adcStartSample(uint8_t pin)
+{
+  uint8_t channel = pin - A0;
+  if(channel >= 8U) { BIT_SET(ADCSRB, MUX5); }
+  else { BIT_CLEAR(ADCSRB, MUX5); }
+  ADMUX = ADMUX_DEFAULT_CONFIG | (channel & 0x07U);
+  BIT_SET(ADCSRA, ADIF); //Clear any old completion flag (Written as 1 to clear)
+  BIT_SET(ADCSRA, ADIE);
+  BIT_SET(ADCSRA, ADSC);
+}
+
+ISR(ADC_vect)
+{
+  uint16_t reading = ADCL; //ADCL must be read first
+  reading |= (uint16_t)ADCH << 8;
+
+  if( (adcSampleState == ADC_SAMPLE_MAP) && (configPage6.useEMAP == true) )
+  {
+    adcSampleMAP = reading;
+    adcSampleState = ADC_SAMPLE_EMAP;
+    adcStartSample(pinEMAP);
+    return;
+  }
+
+  BIT_CLEAR(ADCSRA, ADIE); //analogRead() polls ADSC, the interrupt must be off when the loop uses the ADC
+  if(adcSampleState == ADC_SAMPLE_EMAP) { mapSampleResult(adcSampleMAP, reading); }
+  else { mapSampleResult(reading, 0); }
+  adcSampleState = ADC_SAMPLE_IDLE;
+}
+#endif
+
+/**
+ * analogRead() for the main loop.
+ * On the AVR this holds off the MAP samples from the trigger interrupt and waits for one that is already converting (At most 2 conversions, ~26uS)
+ */
+static inline uint16_t loopAnalogRead(uint8_t pin)
+{
+#if defined(ADC_SHARED_MAP_SAMPLE)
+  adcLoopActive = true;
+  while(adcSampleState != ADC_SAMPLE_IDLE) { }
+  uint16_t reading = analogRead(pin);
+  adcLoopActive = false;
+  return reading;
+#else
+  return analogRead(pin);
+#endif
+}
+
 /** Init all ADC conversions by setting resolutions, etc.
  */
 void initialiseADC(void)
@@ -122,6 +187,21 @@ void initialiseADC(void)
   #endif
 #elif defined(ARDUINO_ARCH_STM32) //STM32GENERIC core and ST STM32duino core, change analog read to 12 bit
   analogReadResolution(10); //use 10bits for analog reading on STM32 boards
+#endif
+#if defined(ANALOG_DMA)
+  //All of the analog inputs are scanned by DMA, so every one that is read must be in the scan. The aux inputs are added below
+  analogScanReset();
+  analogScanAttach(pinMAP, ANALOG_SCAN_FAST);
+  if(configPage6.useEMAP == true) { analogScanAttach(pinEMAP, ANALOG_SCAN_FAST); }
+  analogScanAttach(pinTPS, ANALOG_SCAN_MEDIUM);
+  analogScanAttach(pinCLT, ANALOG_SCAN_SLOW);
+  analogScanAttach(pinIAT, ANALOG_SCAN_SLOW);
+  analogScanAttach(pinO2, ANALOG_SCAN_SLOW);
+  analogScanAttach(pinO2_2, ANALOG_SCAN_SLOW);
+  analogScanAttach(pinBat, ANALOG_SCAN_SLOW);
+  if(configPage6.useExtBaro != 0) { analogScanAttach(pinBaro, ANALOG_SCAN_SLOW); }
+  if(configPage10.fuelPressureEnable > 0) { analogScanAttach(pinFuelPressure, ANALOG_SCAN_SLOW); }
+  if(configPage10.oilPressureEnable > 0) { analogScanAttach(pinOilPressure, ANALOG_SCAN_SLOW); }
 #endif
   MAPcurRev = 0;
   MAPcount = 0;
@@ -152,6 +232,9 @@ void initialiseADC(void)
       {
         //Channel is active and analog
         pinMode( pinNumber, INPUT);
+        #if defined(ANALOG_DMA)
+          analogScanAttach(pinNumber, ANALOG_SCAN_SLOW);
+        #endif
         //currentStatus.canin[14] = 33;  Dev test use only!
         auxIsEnabled = true;
       }  
@@ -176,6 +259,9 @@ void initialiseADC(void)
 
     }
   } //For loop iterating through aux in lines
+#if defined(ANALOG_DMA)
+  analogScanBegin();
+#endif
   
 
   //Sanity checks to ensure none of the filter values are set above 240 (Which would include the 255 value which is the default on a new arduino)
@@ -190,9 +276,9 @@ void initialiseADC(void)
   if(configPage4.ADCFILTER_BARO > 240) { configPage4.ADCFILTER_BARO  = ADCFILTER_BARO_DEFAULT;  writeConfig(ignSetPage); }
   if(configPage4.FILTER_FLEX    > 240) { configPage4.FILTER_FLEX     = FILTER_FLEX_DEFAULT;     writeConfig(ignSetPage); }
 
-  flexStartTime = micros();
-
-  vssIndex = 0;
+  captureReset(flexCapture, FLEX_MIN_PERIOD);
+  captureReset(vssCapture, vssMinPeriod());
+  vssMinPeriodPulsesPerKm = configPage2.vssPulsesPerKm;
 }
 
 static inline void validateMAP(void)
@@ -232,9 +318,11 @@ void instanteneousMAPReading(void)
   //Instantaneous MAP readings
   #if defined(ANALOG_ISR_MAP)
     tempReading = AnChannel[pinMAP-A0];
+  #elif defined(ANALOG_DMA)
+    tempReading = analogScanRead(pinMAP);
   #else
-    tempReading = analogRead(pinMAP);
-    tempReading = analogRead(pinMAP);
+    tempReading = loopAnalogRead(pinMAP);
+    tempReading = loopAnalogRead(pinMAP);
   #endif
   //Error checking
   if( (tempReading >= VALID_MAP_MAX) || (tempReading <= VALID_MAP_MIN) ) { mapErrorCount += 1; }
@@ -252,9 +340,11 @@ void instanteneousMAPReading(void)
   {
     #if defined(ANALOG_ISR_MAP)
       tempReading = AnChannel[pinEMAP-A0];
+    #elif defined(ANALOG_DMA)
+      tempReading = analogScanRead(pinEMAP);
     #else
-      tempReading = analogRead(pinEMAP);
-      tempReading = analogRead(pinEMAP);
+      tempReading = loopAnalogRead(pinEMAP);
+      tempReading = loopAnalogRead(pinEMAP);
     #endif
 
     //Error check
@@ -269,9 +359,91 @@ void instanteneousMAPReading(void)
 
 }
 
+#if defined(MAP_CRANK_SYNC)
+/** Store the readings of a sample tooth. Called from the trigger interrupt, or from the ADC complete interrupt on the AVR */
+static void mapSampleResult(uint16_t mapReading, uint16_t emapReading)
+{
+  if( (mapReading < VALID_MAP_MAX) && (mapReading > VALID_MAP_MIN) ) { mapSamplerAdd(mapReading, emapReading); }
+  else { mapSamplerReject(); }
+}
+
+/**
+ * Called from the primary trigger interrupt after the decoder on every valid tooth. Samples MAP (And EMAP) on the sample teeth of the cycle.
+ * On the AVR this only starts the conversion, the sample is stored by ISR(ADC_vect). The tooth is rejected if the main loop is using the ADC
+ */
+void mapSampleTooth(void)
+{
+  if( mapSamplerTooth((uint16_t)currentStatus.startRevolutions) == false ) { return; }
+
+  #if defined(ADC_SHARED_MAP_SAMPLE)
+    if( (adcLoopActive == true) || (adcSampleState != ADC_SAMPLE_IDLE) ) { mapSamplerReject(); return; }
+    adcSampleState = ADC_SAMPLE_MAP;
+    adcStartSample(pinMAP);
+  #elif defined(ANALOG_DMA)
+    mapSampleResult(analogScanRead(pinMAP), (configPage6.useEMAP == true) ? analogScanRead(pinEMAP) : 0U);
+  #else
+    //ANALOG_ISR, the free running ADC interrupt owns the ADC
+    mapSampleResult(AnChannel[pinMAP-A0], (configPage6.useEMAP == true) ? AnChannel[pinEMAP-A0] : 0U);
+  #endif
+}
+
+/**
+ * Cycle average or cycle minimum from the crank synchronous samples. MAP is updated once per cycle, when the cycle completes.
+ * The samples are not passed through the MAP filter as each cycle is averaged over the same crank positions
+ */
+static void cycleMAPReading(bool useMinimum)
+{
+  uint8_t revolutionsPerCycle = (configPage2.strokes == TWO_STROKE) ? 1U : 2U;
+
+  if ( (currentStatus.RPMdiv100 > configPage2.mapSwitchPoint) && ((currentStatus.hasSync == true) || BIT_CHECK(currentStatus.status3, BIT_STATUS3_HALFSYNC)) && (currentStatus.startRevolutions > 1) ) //If the engine isn't running and RPM below switch point, fall back to instantaneous reads
+  {
+    mapSamplerConfigure(revolutionsPerCycle);
+    mapCycle_t cycle;
+    if( mapSamplerTakeCycle(cycle) == true )
+    {
+      MAPcurRev = currentStatus.startRevolutions;
+      if(cycle.samples > 0U)
+      {
+        //Update the calculation times and last value. These are used by the MAP based Accel enrich
+        MAPlast = currentStatus.MAP;
+        MAPlast_time = MAP_time;
+        MAP_time = micros();
+
+        currentStatus.mapADC = (useMinimum == true) ? cycle.mapMinimum : cycle.mapAverage;
+        currentStatus.MAP = fastMap10Bit(currentStatus.mapADC, configPage2.mapMin, configPage2.mapMax); //Get the current MAP value
+        validateMAP();
+
+        if(configPage6.useEMAP == true)
+        {
+          currentStatus.EMAPADC = cycle.emapAverage;
+          currentStatus.EMAP = fastMap10Bit(currentStatus.EMAPADC, configPage2.EMAPMin, configPage2.EMAPMax);
+          if(currentStatus.EMAP < 0) { currentStatus.EMAP = 0; } //Sanity check
+        }
+      }
+      else
+      {
+        //The first cycles after the sampler is enabled only count the teeth
+        if(cycle.errors > 0U) { mapErrorCount += 1; }
+        instanteneousMAPReading();
+      }
+    }
+    else if( (currentStatus.startRevolutions - MAPcurRev) > (revolutionsPerCycle * 2U) ) { instanteneousMAPReading(); } //No cycles are completing, eg the decoder is not flagging valid teeth
+  }
+  else
+  {
+    mapSamplerConfigure(0);
+    MAPcurRev = currentStatus.startRevolutions;
+    instanteneousMAPReading();
+  }
+}
+#endif
+
 void readMAP(void)
 {
   unsigned int tempReading;
+  #if defined(MAP_CRANK_SYNC)
+    if( (configPage2.mapSample != 1U) && (configPage2.mapSample != 2U) ) { mapSamplerConfigure(0); }
+  #endif
   //MAP Sampling system
   switch(configPage2.mapSample)
   {
@@ -282,6 +454,10 @@ void readMAP(void)
 
     case 1:
       //Average of a cycle
+    #if defined(MAP_CRANK_SYNC)
+      cycleMAPReading(false);
+      break;
+    #else
 
       if ( (currentStatus.RPMdiv100 > configPage2.mapSwitchPoint) && ((currentStatus.hasSync == true) || BIT_CHECK(currentStatus.status3, BIT_STATUS3_HALFSYNC)) && (currentStatus.startRevolutions > 1) ) //If the engine isn't running and RPM below switch point, fall back to instantaneous reads
       {
@@ -289,9 +465,11 @@ void readMAP(void)
         {
           #if defined(ANALOG_ISR_MAP)
             tempReading = AnChannel[pinMAP-A0];
+          #elif defined(ANALOG_DMA)
+            tempReading = analogScanRead(pinMAP);
           #else
-            tempReading = analogRead(pinMAP);
-            tempReading = analogRead(pinMAP);
+            tempReading = loopAnalogRead(pinMAP);
+            tempReading = loopAnalogRead(pinMAP);
           #endif
 
           //Error check
@@ -308,9 +486,11 @@ void readMAP(void)
           {
             #if defined(ANALOG_ISR_MAP)
               tempReading = AnChannel[pinEMAP-A0];
+            #elif defined(ANALOG_DMA)
+              tempReading = analogScanRead(pinEMAP);
             #else
-              tempReading = analogRead(pinEMAP);
-              tempReading = analogRead(pinEMAP);
+              tempReading = loopAnalogRead(pinEMAP);
+              tempReading = loopAnalogRead(pinEMAP);
             #endif
 
             //Error check
@@ -364,18 +544,25 @@ void readMAP(void)
         MAPcount = 1;
       }
       break;
+    #endif
 
     case 2:
       //Minimum reading in a cycle
+    #if defined(MAP_CRANK_SYNC)
+      cycleMAPReading(true);
+      break;
+    #else
       if (currentStatus.RPMdiv100 > configPage2.mapSwitchPoint) //If the engine isn't running and RPM below switch point, fall back to instantaneous reads
       {
         if( (MAPcurRev == currentStatus.startRevolutions) || ((MAPcurRev+1) == currentStatus.startRevolutions) ) //2 revolutions are looked at for 4 stroke. 2 stroke not currently catered for.
         {
           #if defined(ANALOG_ISR_MAP)
             tempReading = AnChannel[pinMAP-A0];
+          #elif defined(ANALOG_DMA)
+            tempReading = analogScanRead(pinMAP);
           #else
-            tempReading = analogRead(pinMAP);
-            tempReading = analogRead(pinMAP);
+            tempReading = loopAnalogRead(pinMAP);
+            tempReading = loopAnalogRead(pinMAP);
           #endif
           //Error check
           if( (tempReading < VALID_MAP_MAX) && (tempReading > VALID_MAP_MIN) )
@@ -407,6 +594,7 @@ void readMAP(void)
         MAPrunningValue = currentStatus.mapADC;  //Keep updating the MAPrunningValue to give it head start when switching to cycle minimum.
       }
       break;
+    #endif
 
     case 3:
       //Average of an ignition event
@@ -416,9 +604,11 @@ void readMAP(void)
         {
           #if defined(ANALOG_ISR_MAP)
             tempReading = AnChannel[pinMAP-A0];
+          #elif defined(ANALOG_DMA)
+            tempReading = analogScanRead(pinMAP);
           #else
-            tempReading = analogRead(pinMAP);
-            tempReading = analogRead(pinMAP);
+            tempReading = loopAnalogRead(pinMAP);
+            tempReading = loopAnalogRead(pinMAP);
           #endif
 
           //Error check
@@ -472,9 +662,11 @@ void readTPS(bool useFilter)
   currentStatus.TPSlast = currentStatus.TPS;
   #if defined(ANALOG_ISR)
     byte tempTPS = fastMap1023toX(AnChannel[pinTPS-A0], 255); //Get the current raw TPS ADC value and map it into a byte
+  #elif defined(ANALOG_DMA)
+    byte tempTPS = fastMap1023toX(analogScanRead(pinTPS), 255); //Get the current raw TPS ADC value and map it into a byte
   #else
-    analogRead(pinTPS);
-    byte tempTPS = fastMap1023toX(analogRead(pinTPS), 255); //Get the current raw TPS ADC value and map it into a byte
+    loopAnalogRead(pinTPS);
+    byte tempTPS = fastMap1023toX(loopAnalogRead(pinTPS), 255); //Get the current raw TPS ADC value and map it into a byte
   #endif
   //The use of the filter can be overridden if required. This is used on startup to disable priming pulse if flood clear is wanted
   if(useFilter == true) { currentStatus.tpsADC = ADC_FILTER(tempTPS, configPage4.ADCFILTER_TPS, currentStatus.tpsADC); }
@@ -512,21 +704,60 @@ void readTPS(bool useFilter)
   else { currentStatus.CTPSActive = 0; }
 }
 
+#if defined(CALIBRATION_LUT)
+static inline uint16_t calibrationLUTIndex(int adc)
+{
+  if(adc < 0) { return 0; }
+  return ((uint16_t)adc < CALIBRATION_LUT_SIZE) ? (uint16_t)adc : (CALIBRATION_LUT_SIZE - 1U);
+}
+
+/**
+ * @brief Expand a calibration curve into its lookup table, so that converting a reading is a single array read instead of a search of the 32 bins.
+ * Must be called whenever the calibration curve changes (Startup and when a new calibration is received)
+ * 
+ * @param calibrationPage CLT_CALIBRATION_PAGE, IAT_CALIBRATION_PAGE or O2_CALIBRATION_PAGE
+ */
+void updateCalibrationLUT(uint8_t calibrationPage)
+{
+  struct table2D *curve;
+  if(calibrationPage == CLT_CALIBRATION_PAGE) { curve = &cltCalibrationTable; }
+  else if(calibrationPage == IAT_CALIBRATION_PAGE) { curve = &iatCalibrationTable; }
+  else if(calibrationPage == O2_CALIBRATION_PAGE) { curve = &o2CalibrationTable; }
+  else { return; }
+
+  curve->lastInput = -1; //The curve has changed, so the cached value from before must not be used for the first entry
+
+  for(uint16_t adc = 0; adc < CALIBRATION_LUT_SIZE; adc++)
+  {
+    int value = table2D_getValue(curve, adc);
+    if(calibrationPage == CLT_CALIBRATION_PAGE) { cltCalibrationLUT[adc] = (uint16_t)value; }
+    else if(calibrationPage == IAT_CALIBRATION_PAGE) { iatCalibrationLUT[adc] = (uint16_t)value; }
+    else { o2CalibrationLUT[adc] = (uint8_t)value; }
+  }
+}
+#endif
+
 void readCLT(bool useFilter)
 {
   unsigned int tempReading;
   #if defined(ANALOG_ISR)
     tempReading = AnChannel[pinCLT-A0]; //Get the current raw CLT value
+  #elif defined(ANALOG_DMA)
+    tempReading = analogScanRead(pinCLT); //Get the current raw CLT value
   #else
-    tempReading = analogRead(pinCLT);
-    tempReading = analogRead(pinCLT);
+    tempReading = loopAnalogRead(pinCLT);
+    tempReading = loopAnalogRead(pinCLT);
     //tempReading = fastMap1023toX(analogRead(pinCLT), 511); //Get the current raw CLT value
   #endif
   //The use of the filter can be overridden if required. This is used on startup so there can be an immediately accurate coolant value for priming
   if(useFilter == true) { currentStatus.cltADC = ADC_FILTER(tempReading, configPage4.ADCFILTER_CLT, currentStatus.cltADC); }
   else { currentStatus.cltADC = tempReading; }
   
-  currentStatus.coolant = table2D_getValue(&cltCalibrationTable, currentStatus.cltADC) - CALIBRATION_TEMPERATURE_OFFSET; //Temperature calibration values are stored as positive bytes. We subtract 40 from them to allow for negative temperatures
+  #if defined(CALIBRATION_LUT)
+    currentStatus.coolant = cltCalibrationLUT[calibrationLUTIndex(currentStatus.cltADC)] - CALIBRATION_TEMPERATURE_OFFSET;
+  #else
+    currentStatus.coolant = table2D_getValue(&cltCalibrationTable, currentStatus.cltADC) - CALIBRATION_TEMPERATURE_OFFSET; //Temperature calibration values are stored as positive bytes. We subtract 40 from them to allow for negative temperatures
+  #endif
 }
 
 void readIAT(void)
@@ -534,12 +765,18 @@ void readIAT(void)
   unsigned int tempReading;
   #if defined(ANALOG_ISR)
     tempReading = AnChannel[pinIAT-A0]; //Get the current raw IAT value
+  #elif defined(ANALOG_DMA)
+    tempReading = analogScanRead(pinIAT); //Get the current raw IAT value
   #else
-    tempReading = analogRead(pinIAT);
-    tempReading = analogRead(pinIAT);
+    tempReading = loopAnalogRead(pinIAT);
+    tempReading = loopAnalogRead(pinIAT);
   #endif
   currentStatus.iatADC = ADC_FILTER(tempReading, configPage4.ADCFILTER_IAT, currentStatus.iatADC);
-  currentStatus.IAT = table2D_getValue(&iatCalibrationTable, currentStatus.iatADC) - CALIBRATION_TEMPERATURE_OFFSET;
+  #if defined(CALIBRATION_LUT)
+    currentStatus.IAT = iatCalibrationLUT[calibrationLUTIndex(currentStatus.iatADC)] - CALIBRATION_TEMPERATURE_OFFSET;
+  #else
+    currentStatus.IAT = table2D_getValue(&iatCalibrationTable, currentStatus.iatADC) - CALIBRATION_TEMPERATURE_OFFSET;
+  #endif
 }
 
 void readBaro(void)
@@ -550,9 +787,11 @@ void readBaro(void)
     // readings
     #if defined(ANALOG_ISR_MAP)
       tempReading = AnChannel[pinBaro-A0];
+    #elif defined(ANALOG_DMA)
+      tempReading = analogScanRead(pinBaro);
     #else
-      tempReading = analogRead(pinBaro);
-      tempReading = analogRead(pinBaro);
+      tempReading = loopAnalogRead(pinBaro);
+      tempReading = loopAnalogRead(pinBaro);
     #endif
 
     if(currentStatus.initialisationComplete == true) { currentStatus.baroADC = ADC_FILTER(tempReading, configPage4.ADCFILTER_BARO, currentStatus.baroADC); }//Very weak filter
@@ -601,14 +840,19 @@ void readO2(void)
     unsigned int tempReading;
     #if defined(ANALOG_ISR)
       tempReading = AnChannel[pinO2-A0]; //Get the current O2 value.
+    #elif defined(ANALOG_DMA)
+      tempReading = analogScanRead(pinO2); //Get the current O2 value.
     #else
-      tempReading = analogRead(pinO2);
-      tempReading = analogRead(pinO2);
+      tempReading = loopAnalogRead(pinO2);
+      tempReading = loopAnalogRead(pinO2);
       //tempReading = fastMap1023toX(analogRead(pinO2), 511); //Get the current O2 value.
     #endif
     currentStatus.O2ADC = ADC_FILTER(tempReading, configPage4.ADCFILTER_O2, currentStatus.O2ADC);
-    //currentStatus.O2 = o2CalibrationTable[currentStatus.O2ADC];
-    currentStatus.O2 = table2D_getValue(&o2CalibrationTable, currentStatus.O2ADC);
+    #if defined(CALIBRATION_LUT)
+      currentStatus.O2 = o2CalibrationLUT[calibrationLUTIndex(currentStatus.O2ADC)];
+    #else
+      currentStatus.O2 = table2D_getValue(&o2CalibrationTable, currentStatus.O2ADC);
+    #endif
   }
   else
   {
@@ -625,13 +869,19 @@ void readO2_2(void)
   unsigned int tempReading;
   #if defined(ANALOG_ISR)
     tempReading = AnChannel[pinO2_2-A0]; //Get the current O2 value.
+  #elif defined(ANALOG_DMA)
+    tempReading = analogScanRead(pinO2_2); //Get the current O2 value.
   #else
-    tempReading = analogRead(pinO2_2);
-    tempReading = analogRead(pinO2_2);
+    tempReading = loopAnalogRead(pinO2_2);
+    tempReading = loopAnalogRead(pinO2_2);
     //tempReading = fastMap1023toX(analogRead(pinO2_2), 511); //Get the current O2 value.
   #endif
   currentStatus.O2_2ADC = ADC_FILTER(tempReading, configPage4.ADCFILTER_O2, currentStatus.O2_2ADC);
-  currentStatus.O2_2 = table2D_getValue(&o2CalibrationTable, currentStatus.O2_2ADC);
+  #if defined(CALIBRATION_LUT)
+    currentStatus.O2_2 = o2CalibrationLUT[calibrationLUTIndex(currentStatus.O2_2ADC)];
+  #else
+    currentStatus.O2_2 = table2D_getValue(&o2CalibrationTable, currentStatus.O2_2ADC);
+  #endif
 }
 
 void readBat(void)
@@ -639,9 +889,11 @@ void readBat(void)
   int tempReading;
   #if defined(ANALOG_ISR)
     tempReading = fastMap1023toX(AnChannel[pinBat-A0], 245); //Get the current raw Battery value. Permissible values are from 0v to 24.5v (245)
+  #elif defined(ANALOG_DMA)
+    tempReading = fastMap1023toX(analogScanRead(pinBat), 245); //Get the current raw Battery value. Permissible values are from 0v to 24.5v (245)
   #else
-    tempReading = analogRead(pinBat);
-    tempReading = fastMap1023toX(analogRead(pinBat), 245); //Get the current raw Battery value. Permissible values are from 0v to 24.5v (245)
+    tempReading = loopAnalogRead(pinBat);
+    tempReading = fastMap1023toX(loopAnalogRead(pinBat), 245); //Get the current raw Battery value. Permissible values are from 0v to 24.5v (245)
   #endif
 
   //Apply the offset calibration value to the reading
@@ -672,25 +924,23 @@ void readBat(void)
 }
 
 /**
- * @brief Returns the VSS pulse gap for a given history point
- * 
- * @param historyIndex The gap number that is wanted. EG:
- * historyIndex = 0 = Latest entry
- * historyIndex = 1 = 2nd entry entry
+ * @brief The shortest VSS period that is accepted, from VSS_MAX_SPEED and the current calibration. Anything shorter is treated as a glitch
  */
-uint32_t vssGetPulseGap(byte historyIndex)
+static uint32_t vssMinPeriod(void)
 {
-  uint32_t tempGap = 0;
-  
-  noInterrupts();
-  int8_t tempIndex = vssIndex - historyIndex;
-  if(tempIndex < 0) { tempIndex += VSS_SAMPLES; }
-
-  if(tempIndex > 0) { tempGap = vssTimes[tempIndex] - vssTimes[tempIndex - 1]; }
-  else { tempGap = vssTimes[0] - vssTimes[(VSS_SAMPLES-1)]; }
-  interrupts();
+  if(configPage2.vssPulsesPerKm == 0U) { return 0; }
+  return (uint32_t)MICROS_PER_HOUR / ((uint32_t)VSS_MAX_SPEED * configPage2.vssPulsesPerKm);
+}
 
-  return tempGap;
+/**
+ * @brief Returns the median VSS pulse gap in uS, or 0 if the vehicle is stopped
+ */
+uint32_t vssGetPulseGap(void)
+{
+  captureSnapshot_t snapshot;
+  captureSnapshot(vssCapture, snapshot);
+  if(captureStopped(snapshot, micros()) == true) { return 0; }
+  return captureMedianPeriod(snapshot);
 }
 
 uint16_t getSpeed(void)
@@ -714,17 +964,15 @@ uint16_t getSpeed(void)
   // Interrupt driven mode
   else if(configPage2.vssMode > 1)
   {
-    uint32_t pulseTime = 0;
-    uint32_t vssTotalTime = 0;
-
-    //Add up the time between the teeth. Note that the total number of gaps is equal to the number of samples minus 1
-    for(byte x = 0; x<(VSS_SAMPLES-1); x++)
+    //The glitch rejection depends on the calibration, which can be changed while running
+    if(configPage2.vssPulsesPerKm != vssMinPeriodPulsesPerKm)
     {
-      vssTotalTime += vssGetPulseGap(x);
+      captureSetMinPeriod(vssCapture, vssMinPeriod());
+      vssMinPeriodPulsesPerKm = configPage2.vssPulsesPerKm;
     }
 
-    pulseTime = vssTotalTime / (VSS_SAMPLES - 1);
-    if ( (micros() - vssTimes[vssIndex]) > MICROS_PER_SEC ) { tempSpeed = 0; } // Check that the car hasn't come to a stop. Is true if last pulse was more than 1 second ago
+    uint32_t pulseTime = vssGetPulseGap(); //Median of the periods held by the pulse capture (Up to CAPTURE_SAMPLES), so the odd bad gap that gets past the glitch rejection has no effect. 0 once the input has stopped
+    if ( (pulseTime == 0U) || (configPage2.vssPulsesPerKm == 0U) ) { tempSpeed = 0; } // Check that the car hasn't come to a stop. Is true if last pulse was more than 1 second ago
     else 
     {
       tempSpeed = MICROS_PER_HOUR / (pulseTime * configPage2.vssPulsesPerKm); //Convert the pulse gap into km/h
@@ -767,9 +1015,11 @@ byte getFuelPressure(void)
     //Perform ADC read
     #if defined(ANALOG_ISR)
       tempReading = AnChannel[pinFuelPressure-A0];
+    #elif defined(ANALOG_DMA)
+      tempReading = analogScanRead(pinFuelPressure);
     #else
-      tempReading = analogRead(pinFuelPressure);
-      tempReading = analogRead(pinFuelPressure);
+      tempReading = loopAnalogRead(pinFuelPressure);
+      tempReading = loopAnalogRead(pinFuelPressure);
     #endif
 
     tempFuelPressure = fastMap10Bit(tempReading, configPage10.fuelPressureMin, configPage10.fuelPressureMax);
@@ -792,9 +1042,11 @@ byte getOilPressure(void)
     //Perform ADC read
     #if defined(ANALOG_ISR)
       tempReading = AnChannel[pinOilPressure-A0];
+    #elif defined(ANALOG_DMA)
+      tempReading = analogScanRead(pinOilPressure);
     #else
-      tempReading = analogRead(pinOilPressure);
-      tempReading = analogRead(pinOilPressure);
+      tempReading = loopAnalogRead(pinOilPressure);
+      tempReading = loopAnalogRead(pinOilPressure);
     #endif
 
 
@@ -810,38 +1062,69 @@ byte getOilPressure(void)
 }
 
 /*
- * The interrupt function for reading the flex sensor frequency and pulse width
- * flexCounter value is incremented with every pulse and reset back to 0 once per second
+ * The edge handler for the flex sensor. The period is measured between the rising edges and the pulse width from the falling to the rising edge
+ * @param edgeTime Time of the edge in uS
+ */
+void flexEdge(uint32_t edgeTime)
+{
+  if(READ_FLEX() == true) { captureEdge(flexCapture, edgeTime); }
+  else { captureWidthStart(flexCapture, edgeTime); }
+}
+
+/*
+ * The interrupt function for the flex sensor when it is not using a hardware input capture
  */
 void flexPulse(void)
 {
-  if(READ_FLEX() == true)
+  flexEdge(micros());
+}
+
+/**
+ * @brief Reads the ethanol percentage and fuel temperature from the flex sensor. Called once per second
+ */
+void readFlex(void)
+{
+  captureSnapshot_t snapshot;
+  captureSnapshot(flexCapture, snapshot);
+
+  byte tempEthPct = 0;
+  uint32_t flexFrequency = 0;
+  if(captureStopped(snapshot, micros()) == false)
   {
-    unsigned long tempPW = (micros() - flexStartTime); //Calculate the pulse width
-    flexPulseWidth = ADC_FILTER(tempPW, configPage4.FILTER_FLEX, flexPulseWidth);
-    ++flexCounter;
+    uint32_t period = captureMedianPeriod(snapshot);
+    flexFrequency = (MICROS_PER_SEC + (period / 2U)) / period; //Rounded to the nearest Hz
   }
-  else
+
+  //Standard GM Continental sensor reads from 50Hz (0 ethanol) to 150Hz (Pure ethanol). Subtracting 50 from the frequency therefore gives the ethanol percentage.
+  if(flexFrequency < 50U) { tempEthPct = 0; }
+  else if(flexFrequency > 151U) //1Hz buffer
   {
-    flexStartTime = micros(); //Start pulse width measurement.
+    //Spec of the sensor is that errors are above 170Hz
+    if(flexFrequency < 169U) { tempEthPct = 100; }
+    else { tempEthPct = 0; }
   }
+  else { tempEthPct = flexFrequency - 50U; }
+
+  //Off by 1 error check
+  if (tempEthPct == 1) { tempEthPct = 0; }
+
+  currentStatus.ethanolPct = ADC_FILTER(tempEthPct, configPage4.FILTER_FLEX, currentStatus.ethanolPct);
+
+  //Continental flex sensor fuel temperature can be read with following formula: (Temperature = (41.25 * pulse width(ms)) - 81.25). 1000μs = -40C and 5000μs = 125C
+  uint16_t tempPW = captureMedianWidth(snapshot);
+  if(tempPW > 5000U) { tempPW = 5000; }
+  else if(tempPW < 1000U) { tempPW = 1000; }
+  flexPulseWidth = ADC_FILTER(tempPW, configPage4.FILTER_FLEX, flexPulseWidth);
+  currentStatus.fuelTemp = div100( (int16_t)(((4224 * (long)flexPulseWidth) >> 10) - 8125) );
 }
 
 /*
- * The interrupt function for pulses from a knock conditioner / controller
+ * The interrupt function for pulses from a knock conditioner / controller. The pulse is only counted if it is inside a knock window, see knock.h
  * 
  */
 void knockPulse(void)
 {
-  //Check if this the start of a knock. 
-  if(knockCounter == 0)
-  {
-    //knockAngle = crankAngle + timeToAngleDegPerMicroSec( (micros() - lastCrankAngleCalc) ); 
-    knockStartTime = micros();
-    knockCounter = 1;
-  }
-  else { ++knockCounter; } //Knock has already started, so just increment the counter for this
-
+  knockPulseAt(micros());
 }
 
 /**
@@ -850,11 +1133,15 @@ void knockPulse(void)
  */
 void vssPulse(void)
 {
-  //TODO: Add basic filtering here
-  vssIndex++;
-  if(vssIndex == VSS_SAMPLES) { vssIndex = 0; }
+  captureEdge(vssCapture, micros());
+}
 
-  vssTimes[vssIndex] = micros();
+/**
+ * @brief The edge handler for VSS pulses when the board's hardware input capture is used
+ */
+void vssEdge(uint32_t edgeTime)
+{
+  captureEdge(vssCapture, edgeTime);
 }
 
 uint16_t readAuxanalog(uint8_t analogPin)
@@ -863,9 +1150,11 @@ uint16_t readAuxanalog(uint8_t analogPin)
   unsigned int tempReading;
   #if defined(ANALOG_ISR)
     tempReading = AnChannel[analogPin-A0]; //Get the current raw Auxanalog value
+  #elif defined(ANALOG_DMA)
+    tempReading = analogScanRead(analogPin); //Get the current raw Auxanalog value
   #else
-    tempReading = analogRead(analogPin);
-    tempReading = analogRead(analogPin);
+    tempReading = loopAnalogRead(analogPin);
+    tempReading = loopAnalogRead(analogPin);
   #endif
   return tempReading;
 } 
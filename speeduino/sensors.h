@@ -24,14 +24,11 @@
 #define KNOCK_MODE_ANALOG   2
 
 #define VSS_GEAR_HYSTERESIS 10
-#define VSS_SAMPLES         4 //Must be a power of 2 and smaller than 255
+#define VSS_MAX_SPEED       500 //km/h. VSS pulses closer together than this speed would give are rejected as glitches
+#define FLEX_MIN_PERIOD     2000UL //uS. Flex sensor pulses above 500Hz are rejected as glitches. The sensor reports its own errors above 170Hz
 
 #define TPS_READ_FREQUENCY  30 //ONLY VALID VALUES ARE 15 or 30!!!
 
-extern volatile byte flexCounter;
-extern volatile unsigned long flexStartTime;
-extern volatile unsigned long flexPulseWidth;
-
 #if defined(CORE_AVR)
   #define READ_FLEX() ((*flex_pin_port & flex_pin_mask) ? true : false)
 #else
@@ -40,7 +37,9 @@ extern volatile unsigned long flexPulseWidth;
 
 #define ADMUX_DEFAULT_CONFIG  0x40 //AVCC reference, ADC0 input, right adjusted, ADC enabled
 
-extern volatile byte knockCounter;
+#if defined(ANALOG_ISR_MAP) || defined(ANALOG_DMA) || defined(CORE_AVR)
+  #define MAP_CRANK_SYNC //MAP can be read from the trigger interrupt, so the cycle average and cycle minimum modes sample at fixed teeth. See mapSampler.h
+#endif
 
 extern unsigned int MAPcount; //Number of samples taken in the current MAP cycle
 extern uint32_t MAPcurRev; //Tracks which revolution we're sampling on
@@ -60,8 +59,12 @@ void initialiseADC(void);
 void readTPS(bool useFilter=true); //Allows the option to override the use of the filter
 void readO2_2(void);
 void flexPulse(void);
-uint32_t vssGetPulseGap(byte toothHistoryIndex);
+void knockPulse(void);
+void flexEdge(uint32_t edgeTime);
+void readFlex(void);
+uint32_t vssGetPulseGap(void);
 void vssPulse(void);
+void vssEdge(uint32_t edgeTime);
 uint16_t getSpeed(void);
 byte getGear(void);
 byte getFuelPressure(void);
@@ -69,11 +72,15 @@ byte getOilPressure(void);
 uint16_t readAuxanalog(uint8_t analogPin);
 uint16_t readAuxdigital(uint8_t digitalPin);
 void readCLT(bool useFilter=true); //Allows the option to override the use of the filter
+#if defined(CALIBRATION_LUT)
+void updateCalibrationLUT(uint8_t calibrationPage);
+#endif
 void readIAT(void);
 void readO2(void);
 void readBat(void);
 void readBaro(void);
 void readMAP(void);
 void instanteneousMAPReading(void);
+void mapSampleTooth(void);
 
 #endif // SENSORS_H
@@ -0,0 +1,152 @@
+/*
+Speeduino - Simple engine management for the Arduino Mega 2560 platform
+Copyright (C) Josh Stewart
+A full copy of the license may be found in the projects root directory
+*/
+/** @file
+ * Software PWM engine. All auxiliary PWM outputs are serviced from a single timer compare, see softPWM.h
+ */
+#include "globals.h"
+#include "softPWM.h"
+#include "softPWMEdges.h"
+#include "timers.h"
+#include <util/atomic.h>
+
+#if defined(USE_SOFT_PWM)
+
+static_assert(AUX_PWM_CHANNELS <= SOFT_PWM_MAX_CHANNELS, "The soft PWM edge list has fewer channels than the auxiliary outputs");
+
+struct softPWMOutput
+{
+  volatile PORT_TYPE *port;
+  PINMASK_TYPE mask;
+  volatile PORT_TYPE *complementPort; //Optional second output that is always the opposite of the main one
+  PINMASK_TYPE complementMask;
+  bool inverted;
+};
+
+static softPWMOutput outputs[AUX_PWM_CHANNELS];
+
+//The hardware side of the edge list (softPWMEdges.h)
+uint16_t softPWMHwCounter(void) { return SOFT_PWM_COUNTER; }
+void softPWMHwSetCompare(uint16_t compare) { SET_COMPARE(SOFT_PWM_COMPARE, compare); }
+void softPWMHwTimerEnable(void) { ENABLE_SOFT_PWM_TIMER(); }
+void softPWMHwTimerDisable(void) { DISABLE_SOFT_PWM_TIMER(); }
+
+void softPWMHwOutput(uint8_t channel, bool on)
+{
+  const softPWMOutput &output = outputs[channel];
+  if(on != output.inverted) { *output.port |= output.mask; }
+  else { *output.port &= ~(output.mask); }
+
+  if(output.complementPort != nullptr)
+  {
+    if(on != output.inverted) { *output.complementPort &= ~(output.complementMask); }
+    else { *output.complementPort |= output.complementMask; }
+  }
+}
+
+/**
+ * Set the output pin of a channel. This stops the channel if it is running
+ * @param channel One of the AUX_PWM_ channels
+ * @param pin
+ * @param inverted If true the pin is low during the on part of the period
+ */
+void softPWMAttach(uint8_t channel, uint8_t pin, bool inverted)
+{
+  softPWMStop(channel);
+  outputs[channel].port = portOutputRegister(digitalPinToPort(pin));
+  outputs[channel].mask = digitalPinToBitMask(pin);
+  outputs[channel].complementPort = nullptr;
+  outputs[channel].inverted = inverted;
+}
+
+/**
+ * Add a second pin to a channel that is driven as the opposite of the main pin (Eg 2 wire idle valves)
+ */
+void softPWMAttachComplement(uint8_t channel, uint8_t pin)
+{
+  noInterrupts();
+  outputs[channel].complementPort = portOutputRegister(digitalPinToPort(pin));
+  outputs[channel].complementMask = digitalPinToBitMask(pin);
+  interrupts();
+}
+
+/**
+ * Remove the pin from a channel (Eg when the output has been moved to a hardware PWM). The channel will not start again until it is re-attached
+ */
+void softPWMDetach(uint8_t channel)
+{
+  softPWMStop(channel);
+  outputs[channel].port = nullptr;
+  outputs[channel].complementPort = nullptr;
+}
+
+/**
+ * Set the duty and frequency of a channel. This is cheap when nothing has changed, so the control functions can call it on every run
+ * @param channel One of the AUX_PWM_ channels
+ * @param onTicks On time in timer ticks. Values greater than periodTicks are treated as 100%
+ * @param periodTicks Period in timer ticks. Must be less than 32768. 0 leaves the current period unchanged
+ */
+void softPWMSetDuty(uint8_t channel, uint16_t onTicks, uint16_t periodTicks)
+{
+  noInterrupts();
+  if(periodTicks == 0U) { periodTicks = softPWMEdgePendingPeriod(channel); }
+  if(onTicks > periodTicks) { onTicks = periodTicks; }
+  softPWMEdgeSetDuty(channel, onTicks, periodTicks);
+  interrupts();
+}
+
+/**
+ * Start a channel. The first period begins straight away. Does nothing if the channel is already running, has no pin or no period set
+ */
+void softPWMStart(uint8_t channel)
+{
+  if(outputs[channel].port == nullptr) { return; }
+
+  noInterrupts();
+  if(softPWMEdgePendingPeriod(channel) != 0U) { softPWMEdgeStart(channel); }
+  interrupts();
+}
+
+/**
+ * Stop a channel. The output is left in its current state, the caller is responsible for setting it
+ */
+void softPWMStop(uint8_t channel)
+{
+  noInterrupts();
+  softPWMEdgeStop(channel);
+  interrupts();
+}
+
+/**
+ * Output one or more pulses on a channel. The first pulse starts straight away if the channel is idle, otherwise the pulses are added to the ones
+ * still to be output. This can be called from an interrupt (The ignition schedules)
+ * @param channel One of the AUX_PWM_ channels. This must not also be run with softPWMStart()
+ * @param onTicks Length of each pulse in timer ticks. Limited to be shorter than periodTicks
+ * @param periodTicks Time between the starts of consecutive pulses in timer ticks. Must be at least 2 and less than 32768
+ * @param pulses The number of pulses to add
+ */
+void softPWMPulse(uint8_t channel, uint16_t onTicks, uint16_t periodTicks, uint8_t pulses)
+{
+  if( (outputs[channel].port == nullptr) || (periodTicks < 2U) ) { return; }
+  if(onTicks >= periodTicks) { onTicks = periodTicks - 1U; }
+  if(onTicks == 0U) { onTicks = 1U; }
+
+  ATOMIC_BLOCK(ATOMIC_RESTORESTATE)
+  {
+    softPWMEdgePulse(channel, onTicks, periodTicks, pulses);
+  }
+}
+
+//The interrupt for all the auxiliary PWM outputs
+#if defined(CORE_AVR)
+  ISR(TIMER1_COMPA_vect) //cppcheck-suppress misra-c2012-8.2
+#else
+  void softPWMInterrupt(void) //Most ARM chips can simply call a function
+#endif
+{
+  softPWMEdgeService();
+}
+
+#endif
@@ -0,0 +1,39 @@
+/** \file softPWM.h
+ * @brief Software PWM engine for the auxiliary outputs
+ *
+ * Boost, VVT1/2 (Also used by WMI), PWM idle and the PWM fan are all run from a single timer compare instead of one compare and ISR per output.
+ * The engine keeps a list of the active channels sorted by the time of their next edge (softPWMEdges.h). The compare is always set to the first edge in the list
+ * and each interrupt toggles every output that is due, moves those channels to their new place in the list and sets the compare to the next edge.
+ * Duty and frequency changes from the control functions are only latched at the start of a channel's next period, so the edge list only
+ * changes when an output actually toggles.
+ *
+ * A channel can also be run as single pulses (The scheduled tacho output) with softPWMPulse(). Each pulse is added to a count on the channel and the
+ * channel removes itself from the list once the count reaches zero and the period of the last pulse has passed, so pulses that are requested close
+ * together are spaced out rather than being merged or dropped.
+ *
+ * This frees the other compare channels of the auxiliary timer. It is enabled with the USE_SOFT_PWM build flag and requires all of the
+ * auxiliary outputs to run from the same free running counter (Currently AVR Timer1 and STM32 TIM1).
+ */
+#ifndef SOFTPWM_H
+#define SOFTPWM_H
+
+#include "globals.h"
+#include "auxiliaries.h" //For the AUX_PWM_ channel numbers
+
+#if defined(USE_SOFT_PWM)
+  #if !defined(SOFT_PWM_COMPARE)
+    #error "USE_SOFT_PWM is not supported on this board"
+  #endif
+
+void softPWMAttach(uint8_t channel, uint8_t pin, bool inverted);
+void softPWMAttachComplement(uint8_t channel, uint8_t pin);
+void softPWMDetach(uint8_t channel);
+void softPWMSetDuty(uint8_t channel, uint16_t onTicks, uint16_t periodTicks);
+void softPWMStart(uint8_t channel);
+void softPWMStop(uint8_t channel);
+void softPWMPulse(uint8_t channel, uint16_t onTicks, uint16_t periodTicks, uint8_t pulses);
+void softPWMInterrupt(void);
+
+#endif
+
+#endif
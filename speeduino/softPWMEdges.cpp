@@ -0,0 +1,187 @@
+/*
+Speeduino - Simple engine management for the Arduino Mega 2560 platform
+Copyright (C) Josh Stewart
+A full copy of the license may be found in the projects root directory
+*/
+/** @file
+ * Edge list of the software PWM engine, see softPWMEdges.h
+ */
+#include "softPWMEdges.h"
+
+#if defined(USE_SOFT_PWM)
+
+struct softPWMEdgeChannel
+{
+  bool active;
+  bool outputOn; //True while in the on part of the period
+  bool singlePulse; //Set by softPWMEdgePulse(). The channel stops once pulsesLeft reaches zero
+  uint8_t pulsesLeft;
+  volatile uint16_t pendingOnTicks; //Set by the control functions, latched at the start of the next period
+  volatile uint16_t pendingPeriodTicks;
+  uint16_t onTicks;
+  uint16_t periodTicks;
+  uint16_t nextEdge; //Counter value of the next edge
+};
+
+static softPWMEdgeChannel channels[SOFT_PWM_MAX_CHANNELS];
+static uint8_t edgeOrder[SOFT_PWM_MAX_CHANNELS]; //The active channels, sorted by their next edge
+static uint8_t activeChannels = 0;
+
+static inline bool edgeBefore(uint16_t edge, uint16_t reference) { return (int16_t)(edge - reference) < 0; }
+
+//The channel is placed after any other channels with the same edge time
+static void insertEdge(uint8_t channelNum)
+{
+  uint8_t pos = activeChannels;
+  while( (pos > 0U) && edgeBefore(channels[channelNum].nextEdge, channels[edgeOrder[pos-1U]].nextEdge) )
+  {
+    edgeOrder[pos] = edgeOrder[pos-1U];
+    pos--;
+  }
+  edgeOrder[pos] = channelNum;
+  activeChannels++;
+}
+
+static void removeEdge(uint8_t channelNum)
+{
+  uint8_t pos = 0;
+  while( (pos < activeChannels) && (edgeOrder[pos] != channelNum) ) { pos++; }
+  if(pos == activeChannels) { return; }
+
+  activeChannels--;
+  for(; pos < activeChannels; pos++) { edgeOrder[pos] = edgeOrder[pos+1U]; }
+}
+
+/**
+ * Toggle the output of a channel that is due and work out the time of its next edge.
+ * 0% and 100% duty are handled by not toggling the output, but the channel keeps running so that a new duty takes effect at the next period
+ * Single pulse channels are marked as inactive at the start of a period when there are no pulses left, the caller must then remove them from the list
+ */
+static inline void processEdge(uint8_t channelNum)
+{
+  softPWMEdgeChannel &channel = channels[channelNum];
+  if(channel.outputOn == false)
+  {
+    if(channel.singlePulse == true)
+    {
+      if(channel.pulsesLeft == 0U) { channel.active = false; return; }
+      channel.pulsesLeft--;
+    }
+
+    //Start of a new period. Any new duty or frequency takes effect here so that there is never a partial pulse
+    channel.onTicks = channel.pendingOnTicks;
+    channel.periodTicks = channel.pendingPeriodTicks;
+
+    if(channel.onTicks == 0U) { softPWMHwOutput(channelNum, false); channel.nextEdge += channel.periodTicks; } //0%
+    else if(channel.onTicks >= channel.periodTicks) { softPWMHwOutput(channelNum, true); channel.nextEdge += channel.periodTicks; } //100%
+    else
+    {
+      softPWMHwOutput(channelNum, true);
+      channel.outputOn = true;
+      channel.nextEdge += channel.onTicks;
+    }
+  }
+  else
+  {
+    softPWMHwOutput(channelNum, false);
+    channel.outputOn = false;
+    channel.nextEdge += (channel.periodTicks - channel.onTicks);
+  }
+}
+
+static void startChannel(uint8_t channel, bool singlePulse)
+{
+  channels[channel].active = true;
+  channels[channel].outputOn = false;
+  channels[channel].singlePulse = singlePulse;
+  channels[channel].nextEdge = softPWMHwCounter() + (SOFT_PWM_MIN_TICKS * 2U);
+  insertEdge(channel);
+  if(edgeOrder[0] == channel) { softPWMHwSetCompare(channels[channel].nextEdge); }
+  if(activeChannels == 1U) { softPWMHwTimerEnable(); }
+}
+
+/** Set the duty and period that the channel latches at the start of its next period. onTicks must not be more than periodTicks */
+void softPWMEdgeSetDuty(uint8_t channel, uint16_t onTicks, uint16_t periodTicks)
+{
+  channels[channel].pendingOnTicks = onTicks;
+  channels[channel].pendingPeriodTicks = periodTicks;
+}
+
+uint16_t softPWMEdgePendingPeriod(uint8_t channel) { return channels[channel].pendingPeriodTicks; }
+
+bool softPWMEdgeActive(uint8_t channel) { return channels[channel].active; }
+
+/** Start a continuous PWM channel. The first period begins SOFT_PWM_MIN_TICKS * 2 ticks from now */
+void softPWMEdgeStart(uint8_t channel)
+{
+  if(channels[channel].active == true) { return; }
+  startChannel(channel, false);
+}
+
+/** Stop a channel. The output is left in its current state */
+void softPWMEdgeStop(uint8_t channel)
+{
+  if(channels[channel].active == false) { return; }
+
+  removeEdge(channel);
+  channels[channel].active = false;
+  channels[channel].outputOn = false;
+  channels[channel].pulsesLeft = 0;
+  if(activeChannels == 0U) { softPWMHwTimerDisable(); }
+}
+
+/**
+ * Add pulses to a single pulse channel, starting it if it is idle. The pulse count saturates at 255
+ * @param onTicks Must be at least 1 and less than periodTicks
+ */
+void softPWMEdgePulse(uint8_t channel, uint16_t onTicks, uint16_t periodTicks, uint8_t pulses)
+{
+  channels[channel].pendingOnTicks = onTicks;
+  channels[channel].pendingPeriodTicks = periodTicks;
+  if( (UINT8_MAX - channels[channel].pulsesLeft) < pulses ) { channels[channel].pulsesLeft = UINT8_MAX; }
+  else { channels[channel].pulsesLeft += pulses; }
+
+  if(channels[channel].active == false) { startChannel(channel, true); }
+}
+
+/** The body of the compare interrupt. Processes every edge that is due and sets the compare to the next one */
+void softPWMEdgeService(void)
+{
+  uint16_t now = softPWMHwCounter();
+  while(activeChannels > 0U)
+  {
+    uint8_t channelNum = edgeOrder[0];
+    softPWMEdgeChannel &channel = channels[channelNum];
+
+    if( edgeBefore(now + SOFT_PWM_MIN_TICKS, channel.nextEdge) )
+    {
+      //Next edge is not due yet
+      softPWMHwSetCompare(channel.nextEdge);
+      //If the counter has reached the edge while the compare was being set, it would not fire until the counter wraps around
+      now = softPWMHwCounter();
+      if(edgeBefore(now, channel.nextEdge)) { break; }
+      continue;
+    }
+
+    processEdge(channelNum);
+
+    if(channel.active == false)
+    {
+      //A single pulse channel that has finished
+      removeEdge(channelNum);
+      if(activeChannels == 0U) { softPWMHwTimerDisable(); }
+      continue;
+    }
+
+    //Move the channel back to its new place in the list. The channel's edge has only moved later, so it only needs to go towards the end
+    uint8_t pos = 0;
+    while( ((pos + 1U) < activeChannels) && (edgeBefore(channels[edgeOrder[pos+1U]].nextEdge, channel.nextEdge) || (channels[edgeOrder[pos+1U]].nextEdge == channel.nextEdge)) )
+    {
+      edgeOrder[pos] = edgeOrder[pos+1U];
+      pos++;
+    }
+    edgeOrder[pos] = channelNum;
+  }
+}
+
+#endif
@@ -0,0 +1,35 @@
+/** \file softPWMEdges.h
+ * @brief Edge list of the software PWM engine (softPWM.h)
+ *
+ * The active channels are kept in a list sorted by the time of their next edge. The compare is always set to the first edge in the list and
+ * softPWMEdgeService() toggles every output that is due, moves those channels to their new place in the list and sets the compare to the next edge.
+ * Edge times are 16 bit timer counts that are compared relative to each other, so the counter wrapping is handled. All periods must be less than 32768 ticks.
+ *
+ * Nothing in here touches the hardware. The timer and the pins are reached through the softPWMHw* functions, which are provided by softPWM.cpp
+ * (And by the native tests), so that the edge list can be tested natively.
+ * All of the functions must be called with interrupts disabled, or from the compare interrupt.
+ */
+#ifndef SOFTPWMEDGES_H
+#define SOFTPWMEDGES_H
+
+#include <stdint.h>
+
+#define SOFT_PWM_MAX_CHANNELS 6U /**< Must be at least AUX_PWM_CHANNELS */
+#define SOFT_PWM_MIN_TICKS    2U /**< Edges that are due within this many timer ticks are processed in the same interrupt rather than risking the compare being set after the counter has passed it */
+
+//Provided by the user of the edge list
+uint16_t softPWMHwCounter(void);
+void softPWMHwSetCompare(uint16_t compare);
+void softPWMHwTimerEnable(void);
+void softPWMHwTimerDisable(void);
+void softPWMHwOutput(uint8_t channel, bool on);
+
+void softPWMEdgeSetDuty(uint8_t channel, uint16_t onTicks, uint16_t periodTicks);
+uint16_t softPWMEdgePendingPeriod(uint8_t channel);
+bool softPWMEdgeActive(uint8_t channel);
+void softPWMEdgeStart(uint8_t channel);
+void softPWMEdgeStop(uint8_t channel);
+void softPWMEdgePulse(uint8_t channel, uint16_t onTicks, uint16_t periodTicks, uint8_t pulses);
+void softPWMEdgeService(void);
+
+#endif
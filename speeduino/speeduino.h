@@ -27,6 +27,8 @@ void checkLaunchAndFlatShift();
 
 extern uint16_t req_fuel_uS; /**< The required fuel variable (As calculated by TunerStudio) in uS */
 extern uint16_t inj_opentime_uS; /**< The injector opening time. This is set within Tuner Studio, but stored here in uS rather than mS */
+extern uint8_t ignitionChannelsOn; /**< The current state of the ignition system (on or off) */
+extern uint8_t fuelChannelsOn; /**< The current state of the fuel system (on or off) */
 
 /** @name Staging
  * These values are a percentage of the total (Combined) req_fuel value that would be required for each injector channel to deliver that much fuel.   
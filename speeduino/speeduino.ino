@@ -43,8 +43,15 @@ Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
 #include "secondaryTables.h"
 #include "comms_CAN.h"
 #include "SD_logger.h"
+#include "burst_logger.h"
 #include "schedule_calcs.h"
+#include "softPWM.h"
+#include "knock.h"
 #include "auxiliaries.h"
+#include "taskScheduler.h"
+#include "profiler.h"
+#include "cutPattern.h"
+#include "toothLimiter.h"
 #include RTC_LIB_H //Defined in each boards .h file
 #include BOARD_H //Note that this is not a real file, it is defined in globals.h. 
 
@@ -56,14 +63,19 @@ uint8_t ignitionChannelsOn; /**< The current state of the ignition system (on or
 uint8_t ignitionChannelsPending = 0; /**< Any ignition channels that are pending injections before they are resumed */
 uint8_t fuelChannelsOn; /**< The current state of the fuel system (on or off) */
 uint32_t rollingCutLastRev = 0; /**< Tracks whether we're on the same or a different rev for the rolling cut */
+static uint16_t toothLimitRPM = 0; /**< The limit the per tooth rev limiter periods were calculated for. 0 when it is off */
+static uint16_t toothLimitAngle = 0; /**< The tooth angle the per tooth rev limiter periods were calculated for */
 
 uint16_t staged_req_fuel_mult_pri = 0;
 uint16_t staged_req_fuel_mult_sec = 0;   
 #ifndef UNIT_TEST // Scope guard for unit testing
+static void initialiseTasks(void);
+
 void setup(void)
 {
   currentStatus.initialisationComplete = false; //Tracks whether the initialiseAll() function has run completely
   initialiseAll();
+  initialiseTasks();
 }
 
 inline uint16_t applyFuelTrimToPW(trimTable3d *pTrimTable, int16_t fuelLoad, int16_t RPM, uint16_t currentPW)
@@ -72,65 +84,372 @@ inline uint16_t applyFuelTrimToPW(trimTable3d *pTrimTable, int16_t fuelLoad, int
     return percentage(pw1percent, currentPW);
 }
 
+/** @name Tasks
+ * The periodic work of the main loop, which is registered with the task scheduler by initialiseTasks(). See taskScheduler.h
+ */
+///@{
+/** Serial comms. Checks whether the last send values request is still outstanding, then for any new or in-progress requests */
+static void commsTask(void)
+{
+  if (serialTransmitInProgress())
+  {
+    serialTransmit();
+  }
+
+  if (Serial.available()>0 || serialRecieveInProgress())
+  {
+    serialReceive();
+  }
+
+  //And check whether the tooth log buffer is ready
+  if(toothHistoryIndex > TOOTH_LOG_SIZE) { BIT_SET(currentStatus.status1, BIT_STATUS1_TOOTHLOG1READY); }
+}
+
+#if defined(secondarySerial_AVAILABLE) || defined(NATIVE_CAN_AVAILABLE)
+/** Check for any secondary serial or CAN comms requiring action */
+static void canTask(void)
+{
+  #if defined(secondarySerial_AVAILABLE)
+    //if can or secondary serial interface is enabled then check for requests.
+    if (configPage9.enable_secondarySerial == 1)  //secondary serial interface enabled
+    {
+      if ( ((mainLoopCount & 31) == 1) || (secondarySerial.available() > SERIAL_BUFFER_THRESHOLD) )
+      {
+        if (secondarySerial.available() > 0)  { secondserial_Command(); }
+      } 
+    }
+  #endif
+  #if defined (NATIVE_CAN_AVAILABLE)
+    if (configPage9.enable_intcan == 1) // use internal can module
+    {            
+      //check local can module
+      while (CAN_read()) 
+      {
+        can_Command();
+        readAuxCanBus();
+        if (configPage2.canWBO > 0) { receiveCANwbo(); }
+      }
+    }   
+  #endif
+}
+#endif
+
+#if defined(NATIVE_CAN_AVAILABLE)
+/** Dash cluster broadcasts. 30Hz */
+static void canClusterTask(void)
+{
+  if (configPage2.canBMWCluster == true) { sendBMWCluster(); }
+  if (configPage2.canVAGCluster == true) { sendVAGCluster(); }
+}
+#endif
+
+/** NOTE: The timer releases this every 1ms, but it is NOT guaranteed to run at 1kHz on AVR systems. It will run at 1kHz if possible or as fast as loops/s allows if not. The overruns in the task stats show which */
+static void mapTask(void)
+{
+  readMAP();
+}
+
+#if defined(ANALOG_ISR)
+/** ADC in free running mode does 1 complete conversion of all 16 channels and then the interrupt is disabled. Every 200Hz we re-enable the interrupt to get another conversion cycle */
+static void adcTask(void)
+{
+  BIT_SET(ADCSRA,ADIE); //Enable ADC interrupt
+}
+#endif
+
+/** TPS reading is performed at TPS_READ_FREQUENCY (any faster and it can upset the TPSdot sampling time) */
+static void tpsTask(void)
+{
+  readTPS();
+}
+
+static void o2Task(void)
+{
+  if (configPage2.canWBO == 0)
+  {
+    readO2();
+    readO2_2();
+  }      
+}
+
+/** Check for launch control and flat shift being active. 15Hz */
+static void launchTask(void)
+{
+  checkLaunchAndFlatShift();
+}
+
+static void programmableIOTask(void)
+{
+  checkProgrammableIO();
+}
+
+/** Perform any idle related actions. This needs to be run at 10Hz to align with the idle taper resolution of 0.1s */
+static void idleTask(void)
+{
+  idleControl();
+}
+
+/** Air conditioning control. 10Hz */
+static void airConTask(void)
+{
+  airConControl();
+}
+
+static void speedTask(void)
+{
+  currentStatus.vss = getSpeed();
+  currentStatus.gear = getGear();
+}
+
+/** Most boost tends to run at about 30Hz, so running it at 30Hz ensures a new target time is fetched frequently enough */
+static void boostTask(void)
+{
+  boostControl();
+}
+
+/** The VVT targets and limits are updated at 30Hz. When enabled the closed loop PIDs are run on every cam edge by vvtEdgeTask() */
+static void vvtTask(void)
+{
+  vvtControl();
+}
+
+static void vvtEdgeTask(void)
+{
+  vvtEdgeControl();
+}
+
+/** Water methanol injection. 30Hz */
+static void wmiTask(void)
+{
+  wmiControl();
+}
+
+/** Flashes the WMI indicator at 1 sec intervals while the water tank is empty. 1Hz */
+static void wmiIndicatorTask(void)
+{
+  if ( (configPage10.wmiEnabled > 0) && (configPage10.wmiIndicatorEnabled > 0) )
+  {
+    // water tank empty
+    if (BIT_CHECK(currentStatus.status4, BIT_STATUS4_WMI_EMPTY) > 0)
+    {
+      // flash with 1sec interval
+      digitalWrite(pinWMIIndicator, !digitalRead(pinWMIIndicator));
+    }
+    else
+    {
+      digitalWrite(pinWMIIndicator, configPage10.wmiIndicatorPolarity ? HIGH : LOW);
+    } 
+  }
+}
+
+static void nitrousTask(void)
+{
+  nitrousControl();
+}
+
+/** The IAT and CLT readings can be done less frequently (4 times per second) */
+static void slowSensorsTask(void)
+{
+  readCLT();
+  readIAT();
+  readBat();
+
+  //Lookup the current target idle RPM. This is aligned with coolant and so needs to be calculated at the same rate CLT is read
+  if( (configPage2.idleAdvEnabled >= 1) || (configPage6.iacAlgorithm != IAC_ALGORITHM_NONE) )
+  {
+    currentStatus.CLIdleTarget = (byte)table2D_getValue(&idleTargetTable, currentStatus.coolant + CALIBRATION_TEMPERATURE_OFFSET); //All temps are offset by 40 degrees
+    if(BIT_CHECK(currentStatus.airConStatus, BIT_AIRCON_TURNING_ON)) { currentStatus.CLIdleTarget += configPage15.airConIdleUpRPMAdder;  } //Adds Idle Up RPM amount if active
+  }
+
+  currentStatus.fuelPressure = getFuelPressure();
+  currentStatus.oilPressure = getOilPressure();
+}
+
+/** Infrequent baro readings are not an issue. 1Hz */
+static void baroTask(void)
+{
+  readBaro();
+}
+
+/** Check the fan output status. 1Hz */
+static void fanTask(void)
+{
+  if (configPage2.fanEnable >= 1)
+  {
+    fanControl();
+  }
+}
+
+#if defined(USE_SOFT_PWM)
+/** Update the length of the scheduled tacho pulses for the current RPM. 30Hz */
+static void tachoTask(void)
+{
+  updateTachoPulse();
+}
+#endif
+
+/** Check through the Aux input channels if enabled for Can or local use. 4Hz */
+static void auxInputsTask(void)
+{
+  if(auxIsEnabled == false) { return; }
+
+  //TODO dazq to clean this right up :)
+  //check through the Aux input channels if enabled for Can or local use
+  for (byte AuxinChan = 0; AuxinChan <16 ; AuxinChan++)
+  {
+    currentStatus.current_caninchannel = AuxinChan;          
+          
+    if (((configPage9.caninput_sel[currentStatus.current_caninchannel]&12) == 4) 
+        && (((configPage9.enable_secondarySerial == 1) && ((configPage9.enable_intcan == 0)&&(configPage9.intcan_available == 1)))
+        || ((configPage9.enable_secondarySerial == 1) && ((configPage9.enable_intcan == 1)&&(configPage9.intcan_available == 1))&& 
+        ((configPage9.caninput_sel[currentStatus.current_caninchannel]&64) == 0))
+        || ((configPage9.enable_secondarySerial == 1) && ((configPage9.enable_intcan == 1)&&(configPage9.intcan_available == 0)))))              
+    { //if current input channel is enabled as external & secondary serial enabled & internal can disabled(but internal can is available)
+      // or current input channel is enabled as external & secondary serial enabled & internal can enabled(and internal can is available)
+      //currentStatus.canin[13] = 11;  Dev test use only!
+      if (configPage9.enable_secondarySerial == 1)  // megas only support can via secondary serial
+      {
+        sendCancommand(2,0,currentStatus.current_caninchannel,0,((configPage9.caninput_source_can_address[currentStatus.current_caninchannel]&2047)+0x100));
+        //send an R command for data from caninput_source_address[currentStatus.current_caninchannel] from secondarySerial
+      }
+    }  
+    else if (((configPage9.caninput_sel[currentStatus.current_caninchannel]&12) == 4) 
+        && (((configPage9.enable_secondarySerial == 1) && ((configPage9.enable_intcan == 1)&&(configPage9.intcan_available == 1))&& 
+        ((configPage9.caninput_sel[currentStatus.current_caninchannel]&64) == 64))
+        || ((configPage9.enable_secondarySerial == 0) && ((configPage9.enable_intcan == 1)&&(configPage9.intcan_available == 1))&& 
+        ((configPage9.caninput_sel[currentStatus.current_caninchannel]&128) == 128))))                             
+    { //if current input channel is enabled as external for canbus & secondary serial enabled & internal can enabled(and internal can is available)
+      // or current input channel is enabled as external for canbus & secondary serial disabled & internal can enabled(and internal can is available)
+      //currentStatus.canin[13] = 12;  Dev test use only!  
+    #if defined(CORE_STM32) || defined(CORE_TEENSY)
+     if (configPage9.enable_intcan == 1) //  if internal can is enabled 
+     {
+        sendCancommand(3,configPage9.speeduino_tsCanId,currentStatus.current_caninchannel,0,((configPage9.caninput_source_can_address[currentStatus.current_caninchannel]&2047)+0x100));  
+        //send an R command for data from caninput_source_address[currentStatus.current_caninchannel] from internal canbus
+     }
+    #endif
+    }   
+    else if ((((configPage9.enable_secondarySerial == 1) || ((configPage9.enable_intcan == 1) && (configPage9.intcan_available == 1))) && (configPage9.caninput_sel[currentStatus.current_caninchannel]&12) == 8)
+            || (((configPage9.enable_secondarySerial == 0) && ( (configPage9.enable_intcan == 1) && (configPage9.intcan_available == 0) )) && (configPage9.caninput_sel[currentStatus.current_caninchannel]&3) == 2)  
+            || (((configPage9.enable_secondarySerial == 0) && (configPage9.enable_intcan == 0)) && ((configPage9.caninput_sel[currentStatus.current_caninchannel]&3) == 2)))  
+    { //if current input channel is enabled as analog local pin
+      //read analog channel specified
+      //currentStatus.canin[13] = (configPage9.Auxinpina[currentStatus.current_caninchannel]&63);  Dev test use only!127
+      currentStatus.canin[currentStatus.current_caninchannel] = readAuxanalog(pinTranslateAnalog(configPage9.Auxinpina[currentStatus.current_caninchannel]&63));
+    }
+    else if ((((configPage9.enable_secondarySerial == 1) || ((configPage9.enable_intcan == 1) && (configPage9.intcan_available == 1))) && (configPage9.caninput_sel[currentStatus.current_caninchannel]&12) == 12)
+            || (((configPage9.enable_secondarySerial == 0) && ( (configPage9.enable_intcan == 1) && (configPage9.intcan_available == 0) )) && (configPage9.caninput_sel[currentStatus.current_caninchannel]&3) == 3)
+            || (((configPage9.enable_secondarySerial == 0) && (configPage9.enable_intcan == 0)) && ((configPage9.caninput_sel[currentStatus.current_caninchannel]&3) == 3)))
+    { //if current input channel is enabled as digital local pin
+      //read digital channel specified
+      //currentStatus.canin[14] = ((configPage9.Auxinpinb[currentStatus.current_caninchannel]&63)+1);  Dev test use only!127+1
+      currentStatus.canin[currentStatus.current_caninchannel] = readAuxdigital((configPage9.Auxinpinb[currentStatus.current_caninchannel]&63)+1);
+    } //Channel type
+  } //For loop going through each channel
+}
+
+#ifdef SD_LOGGING
+/** Only writes the fast log and burst entries, or the tooth log, when they are enabled. Otherwise writes a log entry when the timer flag of the log rate is set */
+static void sdLogTask(void)
+{
+  writeSDLogEntryFast(); //Only writes an entry if one of the fast log rates is enabled
+  burstLoggerFlush(); //Only does anything when a burst capture is waiting to be written
+  writeSDToothLog(); //Only does anything when the SD tooth log is running
+
+  uint8_t logRateFlag;
+  switch(configPage13.onboard_log_file_rate)
+  {
+    case LOGGER_RATE_1HZ:  logRateFlag = BIT_TIMER_1HZ; break;
+    case LOGGER_RATE_4HZ:  logRateFlag = BIT_TIMER_4HZ; break;
+    case LOGGER_RATE_10HZ: logRateFlag = BIT_TIMER_10HZ; break;
+    case LOGGER_RATE_30HZ: logRateFlag = BIT_TIMER_30HZ; break;
+    default:               logRateFlag = TASK_EVERY_LOOP; break;
+  }
+  if( (logRateFlag != TASK_EVERY_LOOP) && BIT_CHECK(LOOP_TIMER, logRateFlag) && (isSDLogFastRateActive() == false) ) { writeSDLogEntry(); }
+  if( BIT_CHECK(LOOP_TIMER, BIT_TIMER_4HZ) ) { syncSDLog(); } //Sync the SD log file to the card 4 times per second. 
+}
+#endif
+
+/** Check for any outstanding EEPROM writes. 30Hz */
+static void eepromTask(void)
+{
+  if( (isEepromWritePending() == true) && (serialStatusFlag == SERIAL_INACTIVE) && (micros() > deferEEPROMWritesUntil)) { writeAllConfig(); } 
+  serviceEEPROM();
+}
+///@}
+
+/** Register all of the periodic work of the main loop with the task scheduler.
+ * 
+ * Tasks that are due in the same pass of the loop run in priority order: comms first, then the fast sensors that the fuel and ignition calculations
+ * depend on, the controls, the slow sensors and lastly the logging and storage
+ */
+static void initialiseTasks(void)
+{
+  clearTasks();
+  registerTask(F("comms"), commsTask, TASK_EVERY_LOOP, 0, PROFILE_COMMS);
+#if defined(secondarySerial_AVAILABLE) || defined(NATIVE_CAN_AVAILABLE)
+  registerTask(F("can"), canTask, TASK_EVERY_LOOP, 0, PROFILE_COMMS);
+#endif
+  registerTask(F("map"), mapTask, BIT_TIMER_1KHZ, 1, PROFILE_SENSORS);
+#if defined(ANALOG_ISR)
+  registerTask(F("adc"), adcTask, BIT_TIMER_200HZ, 1, PROFILE_SENSORS);
+#endif
+#if TPS_READ_FREQUENCY == 15
+  registerTask(F("tps"), tpsTask, BIT_TIMER_15HZ, 2, PROFILE_SENSORS);
+#else
+  registerTask(F("tps"), tpsTask, BIT_TIMER_30HZ, 2, PROFILE_SENSORS);
+#endif
+  registerTask(F("o2"), o2Task, BIT_TIMER_30HZ, 2, PROFILE_SENSORS);
+  registerTask(F("launch"), launchTask, BIT_TIMER_15HZ, 2, PROFILE_AUX);
+  registerTask(F("progIO"), programmableIOTask, BIT_TIMER_10HZ, 3, PROFILE_AUX);
+  registerTask(F("idle"), idleTask, BIT_TIMER_10HZ, 3, PROFILE_AUX);
+  registerTask(F("airCon"), airConTask, BIT_TIMER_10HZ, 3, PROFILE_AUX);
+  registerTask(F("speed"), speedTask, BIT_TIMER_10HZ, 3, PROFILE_SENSORS);
+  registerTask(F("boost"), boostTask, BIT_TIMER_30HZ, 3, PROFILE_AUX);
+  registerTask(F("vvt"), vvtTask, BIT_TIMER_30HZ, 3, PROFILE_AUX);
+  registerTask(F("vvtEdge"), vvtEdgeTask, TASK_EVERY_LOOP, 3, PROFILE_AUX);
+  registerTask(F("wmi"), wmiTask, BIT_TIMER_30HZ, 3, PROFILE_AUX);
+#if defined(USE_SOFT_PWM)
+  registerTask(F("tacho"), tachoTask, BIT_TIMER_30HZ, 3, PROFILE_AUX);
+#endif
+  registerTask(F("nitrous"), nitrousTask, BIT_TIMER_4HZ, 3, PROFILE_AUX);
+  registerTask(F("sensors"), slowSensorsTask, BIT_TIMER_4HZ, 4, PROFILE_SENSORS);
+  registerTask(F("auxIn"), auxInputsTask, BIT_TIMER_4HZ, 4, PROFILE_SENSORS);
+  registerTask(F("baro"), baroTask, BIT_TIMER_1HZ, 4, PROFILE_SENSORS);
+  registerTask(F("fan"), fanTask, BIT_TIMER_1HZ, 4, PROFILE_AUX);
+  registerTask(F("wmiInd"), wmiIndicatorTask, BIT_TIMER_1HZ, 4, PROFILE_AUX);
+#if defined(NATIVE_CAN_AVAILABLE)
+  registerTask(F("canTx"), canClusterTask, BIT_TIMER_30HZ, 5, PROFILE_COMMS);
+#endif
+#ifdef SD_LOGGING
+  registerTask(F("sdLog"), sdLogTask, BIT_TIMER_1KHZ, 5, PROFILE_SD);
+#endif
+  registerTask(F("eeprom"), eepromTask, BIT_TIMER_30HZ, 5, PROFILE_SD);
+}
 /** Speeduino main loop.
  * 
  * Main loop chores (roughly in the order that they are performed):
- * - Check if serial comms or tooth logging are in progress (send or receive, prioritise communication)
  * - Record loop timing vars
  * - Check tooth time, update @ref statuses (currentStatus) variables
- * - Read sensors
+ * - Run the tasks that are due (comms, sensor reads, aux controls, logging etc), see initialiseTasks()
  * - get VE for fuel calcs and spark advance for ignition
  * - Check crank/cam/tooth/timing sync (skip remaining ops if out-of-sync)
  * - execute doCrankSpeedCalcs()
  * 
  * single byte variable @ref LOOP_TIMER plays a big part here as:
- * - it contains expire-bits for interval based frequency driven events (e.g. 15Hz, 4Hz, 1Hz)
+ * - it contains expire-bits for interval based frequency driven events (e.g. 15Hz, 4Hz, 1Hz), which release the tasks
  * - Can be tested for certain frequency interval being expired by (eg) BIT_CHECK(LOOP_TIMER, BIT_TIMER_15HZ)
  * 
  */
 void loop(void)
 {
-      mainLoopCount++;
-      LOOP_TIMER = TIMER_mask;
-
-      //SERIAL Comms
-      //Initially check that the last serial send values request is not still outstanding
-      if (serialTransmitInProgress())
-      {
-        serialTransmit();
-      }
+    mainLoopCount++;
+    //Take the timer flags that have been set since the last loop. Any of these are then available to the rest of the loop in LOOP_TIMER
+    noInterrupts();
+    LOOP_TIMER = TIMER_mask;
+    TIMER_mask = 0;
+    interrupts();
 
-      //Check for any new or in-progress requests from serial.
-      if (Serial.available()>0 || serialRecieveInProgress())
-      {
-        serialReceive();
-      }
-      
-      //Check for any CAN comms requiring action 
-      #if defined(secondarySerial_AVAILABLE)
-        //if can or secondary serial interface is enabled then check for requests.
-        if (configPage9.enable_secondarySerial == 1)  //secondary serial interface enabled
-        {
-          if ( ((mainLoopCount & 31) == 1) || (secondarySerial.available() > SERIAL_BUFFER_THRESHOLD) )
-          {
-            if (secondarySerial.available() > 0)  { secondserial_Command(); }
-          } 
-        }
-      #endif
-      #if defined (NATIVE_CAN_AVAILABLE)
-        if (configPage9.enable_intcan == 1) // use internal can module
-        {            
-          //check local can module
-          // if ( BIT_CHECK(LOOP_TIMER, BIT_TIMER_15HZ) or (CANbus0.available())
-          while (CAN_read()) 
-          {
-            can_Command();
-            readAuxCanBus();
-            if (configPage2.canWBO > 0) { receiveCANwbo(); }
-          }
-        }   
-      #endif
-          
     if(currentLoopTime > micros_safe())
     {
       //Occurs when micros() has overflowed
@@ -187,206 +506,17 @@ void loop(void)
       VVT1_PIN_LOW();
       VVT2_PIN_LOW();
       DISABLE_VVT_TIMER();
+      auxPWMSetDuty(AUX_PWM_VVT1, 0, vvt_pwm_max_count);
+      auxPWMSetDuty(AUX_PWM_VVT2, 0, vvt_pwm_max_count);
+      vvtEdgeReset();
       boostDisable();
       if(configPage4.ignBypassEnabled > 0) { digitalWrite(pinIgnBypass, LOW); } //Reset the ignition bypass ready for next crank attempt
     }
-    //***Perform sensor reads***
+    //***Perform sensor reads, comms and the aux controls***
     //-----------------------------------------------------------------------------------------------------
-    if (BIT_CHECK(LOOP_TIMER, BIT_TIMER_1KHZ)) //Every 1ms. NOTE: This is NOT guaranteed to run at 1kHz on AVR systems. It will run at 1kHz if possible or as fast as loops/s allows if not. 
-    {
-      BIT_CLEAR(TIMER_mask, BIT_TIMER_1KHZ);
-      readMAP();
-    }
-    if(BIT_CHECK(LOOP_TIMER, BIT_TIMER_200HZ))
-    {
-      BIT_CLEAR(TIMER_mask, BIT_TIMER_200HZ);
-      #if defined(ANALOG_ISR)
-        //ADC in free running mode does 1 complete conversion of all 16 channels and then the interrupt is disabled. Every 200Hz we re-enable the interrupt to get another conversion cycle
-        BIT_SET(ADCSRA,ADIE); //Enable ADC interrupt
-      #endif
-    }
-    
-    if (BIT_CHECK(LOOP_TIMER, BIT_TIMER_15HZ)) //Every 32 loops
-    {
-      BIT_CLEAR(TIMER_mask, BIT_TIMER_15HZ);
-      #if TPS_READ_FREQUENCY == 15
-        readTPS(); //TPS reading to be performed every 32 loops (any faster and it can upset the TPSdot sampling time)
-      #endif
-      #if  defined(CORE_TEENSY35)       
-          if (configPage9.enable_intcan == 1) // use internal can module
-          {
-           // this is just to test the interface is sending
-           //sendCancommand(3,((configPage9.realtime_base_address & 0x3FF)+ 0x100),currentStatus.TPS,0,0x200);
-          }
-      #endif     
-
-      checkLaunchAndFlatShift(); //Check for launch control and flat shift being active
-
-      //And check whether the tooth log buffer is ready
-      if(toothHistoryIndex > TOOTH_LOG_SIZE) { BIT_SET(currentStatus.status1, BIT_STATUS1_TOOTHLOG1READY); }
-
-      
-
-    }
-    if(BIT_CHECK(LOOP_TIMER, BIT_TIMER_10HZ)) //10 hertz
-    {
-      BIT_CLEAR(TIMER_mask, BIT_TIMER_10HZ);
-      //updateFullStatus();
-      checkProgrammableIO();
-      idleControl(); //Perform any idle related actions. This needs to be run at 10Hz to align with the idle taper resolution of 0.1s
-      
-      // Air conditioning control
-      airConControl();
-
-      currentStatus.vss = getSpeed();
-      currentStatus.gear = getGear();
-
-      #ifdef SD_LOGGING
-        if(configPage13.onboard_log_file_rate == LOGGER_RATE_10HZ) { writeSDLogEntry(); }
-      #endif
-    }
-    if(BIT_CHECK(LOOP_TIMER, BIT_TIMER_30HZ)) //30 hertz
-    {
-      BIT_CLEAR(TIMER_mask, BIT_TIMER_30HZ);
-      //Most boost tends to run at about 30Hz, so placing it here ensures a new target time is fetched frequently enough
-      boostControl();
-      //VVT may eventually need to be synced with the cam readings (ie run once per cam rev) but for now run at 30Hz
-      vvtControl();
-      //Water methanol injection
-      wmiControl();
-      #if defined(NATIVE_CAN_AVAILABLE)
-      if (configPage2.canBMWCluster == true) { sendBMWCluster(); }
-      if (configPage2.canVAGCluster == true) { sendVAGCluster(); }
-      #endif
-      #if TPS_READ_FREQUENCY == 30
-        readTPS();
-      #endif
-      if (configPage2.canWBO == 0)
-      {
-        readO2();
-        readO2_2();
-      }      
-      #ifdef SD_LOGGING
-        if(configPage13.onboard_log_file_rate == LOGGER_RATE_30HZ) { writeSDLogEntry(); }
-      #endif
-
-      //Check for any outstanding EEPROM writes.
-      if( (isEepromWritePending() == true) && (serialStatusFlag == SERIAL_INACTIVE) && (micros() > deferEEPROMWritesUntil)) { writeAllConfig(); } 
-    }
-    if (BIT_CHECK(LOOP_TIMER, BIT_TIMER_4HZ))
-    {
-      BIT_CLEAR(TIMER_mask, BIT_TIMER_4HZ);
-      //The IAT and CLT readings can be done less frequently (4 times per second)
-      readCLT();
-      readIAT();
-      readBat();
-      nitrousControl();
-
-      //Lookup the current target idle RPM. This is aligned with coolant and so needs to be calculated at the same rate CLT is read
-      if( (configPage2.idleAdvEnabled >= 1) || (configPage6.iacAlgorithm != IAC_ALGORITHM_NONE) )
-      {
-        currentStatus.CLIdleTarget = (byte)table2D_getValue(&idleTargetTable, currentStatus.coolant + CALIBRATION_TEMPERATURE_OFFSET); //All temps are offset by 40 degrees
-        if(BIT_CHECK(currentStatus.airConStatus, BIT_AIRCON_TURNING_ON)) { currentStatus.CLIdleTarget += configPage15.airConIdleUpRPMAdder;  } //Adds Idle Up RPM amount if active
-      }
-
-      #ifdef SD_LOGGING
-        if(configPage13.onboard_log_file_rate == LOGGER_RATE_4HZ) { writeSDLogEntry(); }
-        syncSDLog(); //Sync the SD log file to the card 4 times per second. 
-      #endif  
-      
-      currentStatus.fuelPressure = getFuelPressure();
-      currentStatus.oilPressure = getOilPressure();
-      
-      if(auxIsEnabled == true)
-      {
-        //TODO dazq to clean this right up :)
-        //check through the Aux input channels if enabled for Can or local use
-        for (byte AuxinChan = 0; AuxinChan <16 ; AuxinChan++)
-        {
-          currentStatus.current_caninchannel = AuxinChan;          
-          
-          if (((configPage9.caninput_sel[currentStatus.current_caninchannel]&12) == 4) 
-              && (((configPage9.enable_secondarySerial == 1) && ((configPage9.enable_intcan == 0)&&(configPage9.intcan_available == 1)))
-              || ((configPage9.enable_secondarySerial == 1) && ((configPage9.enable_intcan == 1)&&(configPage9.intcan_available == 1))&& 
-              ((configPage9.caninput_sel[currentStatus.current_caninchannel]&64) == 0))
-              || ((configPage9.enable_secondarySerial == 1) && ((configPage9.enable_intcan == 1)&&(configPage9.intcan_available == 0)))))              
-          { //if current input channel is enabled as external & secondary serial enabled & internal can disabled(but internal can is available)
-            // or current input channel is enabled as external & secondary serial enabled & internal can enabled(and internal can is available)
-            //currentStatus.canin[13] = 11;  Dev test use only!
-            if (configPage9.enable_secondarySerial == 1)  // megas only support can via secondary serial
-            {
-              sendCancommand(2,0,currentStatus.current_caninchannel,0,((configPage9.caninput_source_can_address[currentStatus.current_caninchannel]&2047)+0x100));
-              //send an R command for data from caninput_source_address[currentStatus.current_caninchannel] from secondarySerial
-            }
-          }  
-          else if (((configPage9.caninput_sel[currentStatus.current_caninchannel]&12) == 4) 
-              && (((configPage9.enable_secondarySerial == 1) && ((configPage9.enable_intcan == 1)&&(configPage9.intcan_available == 1))&& 
-              ((configPage9.caninput_sel[currentStatus.current_caninchannel]&64) == 64))
-              || ((configPage9.enable_secondarySerial == 0) && ((configPage9.enable_intcan == 1)&&(configPage9.intcan_available == 1))&& 
-              ((configPage9.caninput_sel[currentStatus.current_caninchannel]&128) == 128))))                             
-          { //if current input channel is enabled as external for canbus & secondary serial enabled & internal can enabled(and internal can is available)
-            // or current input channel is enabled as external for canbus & secondary serial disabled & internal can enabled(and internal can is available)
-            //currentStatus.canin[13] = 12;  Dev test use only!  
-          #if defined(CORE_STM32) || defined(CORE_TEENSY)
-           if (configPage9.enable_intcan == 1) //  if internal can is enabled 
-           {
-              sendCancommand(3,configPage9.speeduino_tsCanId,currentStatus.current_caninchannel,0,((configPage9.caninput_source_can_address[currentStatus.current_caninchannel]&2047)+0x100));  
-              //send an R command for data from caninput_source_address[currentStatus.current_caninchannel] from internal canbus
-           }
-          #endif
-          }   
-          else if ((((configPage9.enable_secondarySerial == 1) || ((configPage9.enable_intcan == 1) && (configPage9.intcan_available == 1))) && (configPage9.caninput_sel[currentStatus.current_caninchannel]&12) == 8)
-                  || (((configPage9.enable_secondarySerial == 0) && ( (configPage9.enable_intcan == 1) && (configPage9.intcan_available == 0) )) && (configPage9.caninput_sel[currentStatus.current_caninchannel]&3) == 2)  
-                  || (((configPage9.enable_secondarySerial == 0) && (configPage9.enable_intcan == 0)) && ((configPage9.caninput_sel[currentStatus.current_caninchannel]&3) == 2)))  
-          { //if current input channel is enabled as analog local pin
-            //read analog channel specified
-            //currentStatus.canin[13] = (configPage9.Auxinpina[currentStatus.current_caninchannel]&63);  Dev test use only!127
-            currentStatus.canin[currentStatus.current_caninchannel] = readAuxanalog(pinTranslateAnalog(configPage9.Auxinpina[currentStatus.current_caninchannel]&63));
-          }
-          else if ((((configPage9.enable_secondarySerial == 1) || ((configPage9.enable_intcan == 1) && (configPage9.intcan_available == 1))) && (configPage9.caninput_sel[currentStatus.current_caninchannel]&12) == 12)
-                  || (((configPage9.enable_secondarySerial == 0) && ( (configPage9.enable_intcan == 1) && (configPage9.intcan_available == 0) )) && (configPage9.caninput_sel[currentStatus.current_caninchannel]&3) == 3)
-                  || (((configPage9.enable_secondarySerial == 0) && (configPage9.enable_intcan == 0)) && ((configPage9.caninput_sel[currentStatus.current_caninchannel]&3) == 3)))
-          { //if current input channel is enabled as digital local pin
-            //read digital channel specified
-            //currentStatus.canin[14] = ((configPage9.Auxinpinb[currentStatus.current_caninchannel]&63)+1);  Dev test use only!127+1
-            currentStatus.canin[currentStatus.current_caninchannel] = readAuxdigital((configPage9.Auxinpinb[currentStatus.current_caninchannel]&63)+1);
-          } //Channel type
-        } //For loop going through each channel
-      } //aux channels are enabled
-    } //4Hz timer
-    if (BIT_CHECK(LOOP_TIMER, BIT_TIMER_1HZ)) //Once per second)
-    {
-      BIT_CLEAR(TIMER_mask, BIT_TIMER_1HZ);
-      readBaro(); //Infrequent baro readings are not an issue.
-
-      if ( (configPage10.wmiEnabled > 0) && (configPage10.wmiIndicatorEnabled > 0) )
-      {
-        // water tank empty
-        if (BIT_CHECK(currentStatus.status4, BIT_STATUS4_WMI_EMPTY) > 0)
-        {
-          // flash with 1sec interval
-          digitalWrite(pinWMIIndicator, !digitalRead(pinWMIIndicator));
-        }
-        else
-        {
-          digitalWrite(pinWMIIndicator, configPage10.wmiIndicatorPolarity ? HIGH : LOW);
-        } 
-      }
-
-      #ifdef SD_LOGGING
-        if(configPage13.onboard_log_file_rate == LOGGER_RATE_1HZ) { writeSDLogEntry(); }
-      #endif
-
-    } //1Hz timer
+    runTasks(LOOP_TIMER);
 
-    if( (configPage6.iacAlgorithm == IAC_ALGORITHM_STEP_OL)
-    || (configPage6.iacAlgorithm == IAC_ALGORITHM_STEP_CL)
-    || (configPage6.iacAlgorithm == IAC_ALGORITHM_STEP_OLCL) )
-    {
-      idleControl(); //Run idlecontrol every loop for stepper idle.
-    }
-
-    
+    uint32_t sectionStart = micros(); //For the loop profiler
     //VE and advance calculation were moved outside the sync/RPM check so that the fuel and ignition load value will be accurately shown when RPM=0
     currentStatus.VE1 = getVE1();
     currentStatus.VE = currentStatus.VE1; //Set the final VE value to be VE 1 as a default. This may be changed in the section below
@@ -396,6 +526,7 @@ void loop(void)
 
     calculateSecondaryFuel();
     calculateSecondarySpark();
+    profileSection(PROFILE_CORRECTIONS, sectionStart);
 
     //Always check for sync
     //Main loop runs within this clause
@@ -431,7 +562,9 @@ void loop(void)
 
       //Begin the fuel calculation
       //Calculate an injector pulsewidth from the VE
+      sectionStart = micros();
       currentStatus.corrections = correctionsFuel();
+      sectionStart = profileSection(PROFILE_CORRECTIONS, sectionStart);
 
       currentStatus.PW1 = PW(req_fuel_uS, currentStatus.VE, currentStatus.MAP, currentStatus.corrections, inj_opentime_uS);
 
@@ -730,6 +863,7 @@ void loop(void)
         }
       }
       currentStatus.dwell = correctionsDwell(currentStatus.dwell);
+      updateDwellLimit(); //Overdwell protection is applied by the ignition schedules as each coil starts charging
 
       // Convert the dwell time to dwell angle based on the current engine speed
       calculateIgnitionAngles(timeToAngleDegPerMicroSec(currentStatus.dwell));
@@ -739,6 +873,8 @@ void loop(void)
       //if( (configPage2.perToothIgn == true) && (lastToothCalcAdvance != currentStatus.advance) ) { triggerSetEndTeeth(); }
       if( (configPage2.perToothIgn == true) ) { triggerSetEndTeeth(); }
 
+      sectionStart = profileSection(PROFILE_PW, sectionStart);
+
       //***********************************************************************************************
       //| BEGIN FUEL SCHEDULES
       //Finally calculate the time (uS) until we reach the firing angles and set the schedules
@@ -773,7 +909,22 @@ void loop(void)
       maxAllowedRPM = maxAllowedRPM * 100; //All of the above limits are divided by 100, convert back to RPM
       if ( (currentStatus.flatShiftingHard == true) && (currentStatus.clutchEngagedRPM < maxAllowedRPM) ) { maxAllowedRPM = currentStatus.clutchEngagedRPM; } //Flat shifting is a special case as the RPM limit is based on when the clutch was engaged. It is not divided by 100 as it is set with the actual RPM
     
-      if( (configPage2.hardCutType == HARD_CUT_FULL) && (currentStatus.RPM > maxAllowedRPM) )
+      //The per tooth limiter uses the same limit. Its periods only need to be recalculated when the limit or the tooth angle changes
+      uint16_t toothLimit = 0;
+      if( (configPage15.toothRevLimit == true) && (configPage2.hardCutType == HARD_CUT_FULL) && (configPage6.engineProtectType != PROTECT_CUT_OFF) && (maxAllowedRPM > TOOTH_LIMITER_HYSTERESIS) ) { toothLimit = maxAllowedRPM; }
+      uint16_t toothAngle = triggerToothAngle;
+      if( (toothLimit != toothLimitRPM) || (toothAngle != toothLimitAngle) )
+      {
+        uint32_t cutPeriod = toothLimiterPeriod(toothLimit, toothAngle);
+        uint32_t resumePeriod = toothLimiterPeriod(toothLimit - TOOTH_LIMITER_HYSTERESIS, toothAngle);
+        noInterrupts();
+        toothLimiterSet(cutPeriod, resumePeriod, toothAngle);
+        interrupts();
+        toothLimitRPM = toothLimit;
+        toothLimitAngle = toothAngle;
+      }
+
+      if( (configPage2.hardCutType == HARD_CUT_FULL) && ( (currentStatus.RPM > maxAllowedRPM) || (toothLimiterActive() == true) ) )
       {
         //Full hard cut turns outputs off completely. 
         switch(configPage6.engineProtectType)
@@ -817,7 +968,7 @@ void loop(void)
 
           for(uint8_t x=0; x<max(maxIgnOutputs, maxInjOutputs); x++)
           {  
-            if( (cutPercent == 100) || (random1to100() < cutPercent) )
+            if( cutPatternNext(cutPercent) == true ) //Channels are checked in firing order, so the pattern spreads the cuts across the cylinders
             {
               switch(configPage6.engineProtectType)
               {
@@ -876,6 +1027,7 @@ void loop(void)
       else
       {
         currentStatus.engineProtectStatus = 0;
+        cutPatternReset(); //Each rolling cut starts from the same point in the pattern
         //No engine protection active, so turn all the channels on
         if(currentStatus.startRevolutions >= configPage4.StgCycles)
         { 
@@ -1165,6 +1317,7 @@ void loop(void)
 #endif
 
       } //Ignition schedules on
+      profileSection(PROFILE_SCHEDULE, sectionStart);
 
       if ( (!BIT_CHECK(currentStatus.status3, BIT_STATUS3_RESET_PREVENT)) && (resetControl == RESET_CONTROL_PREVENT_WHEN_RUNNING) ) 
       {
@@ -1178,6 +1331,14 @@ void loop(void)
       digitalWrite(pinResetControl, LOW);
       BIT_CLEAR(currentStatus.status3, BIT_STATUS3_RESET_PREVENT);
     }
+
+    #ifdef SD_LOGGING
+      sectionStart = micros();
+      burstLoggerSample(); //Records every loop so that burst captures are at full loop resolution
+      profileSection(PROFILE_SD, sectionStart);
+    #endif
+
+    profileLoopEnd(BIT_CHECK(LOOP_TIMER, BIT_TIMER_1HZ));
 } //loop()
 #endif //Unit test guard
 
@@ -1318,6 +1479,12 @@ byte getAdvance1(void)
   return tempAdvance;
 }
 
+//The advance for an ignition channel, less any knock retard of that channel
+static inline int8_t channelAdvance(uint8_t channel)
+{
+  return (int8_t)(currentStatus.advance - knockChannelRetard[channel]);
+}
+
 /** Calculate the Ignition angles for all cylinders (based on @ref config2.nCylinders).
  * both start and end angles are calculated for each channel.
  * Also the mode of ignition firing - wasted spark vs. dedicated spark per cyl. - is considered here.
@@ -1329,31 +1496,31 @@ void calculateIgnitionAngles(uint16_t dwellAngle)
   {
     //1 cylinder
     case 1:
-      calculateIgnitionAngle(dwellAngle, channel1IgnDegrees, currentStatus.advance, &ignition1EndAngle, &ignition1StartAngle);
+      calculateIgnitionAngle(dwellAngle, channel1IgnDegrees, channelAdvance(0), &ignition1EndAngle, &ignition1StartAngle);
       break;
     //2 cylinders
     case 2:
-      calculateIgnitionAngle(dwellAngle, channel1IgnDegrees, currentStatus.advance, &ignition1EndAngle, &ignition1StartAngle);
-      calculateIgnitionAngle(dwellAngle, channel2IgnDegrees, currentStatus.advance, &ignition2EndAngle, &ignition2StartAngle);
+      calculateIgnitionAngle(dwellAngle, channel1IgnDegrees, channelAdvance(0), &ignition1EndAngle, &ignition1StartAngle);
+      calculateIgnitionAngle(dwellAngle, channel2IgnDegrees, channelAdvance(1), &ignition2EndAngle, &ignition2StartAngle);
       break;
     //3 cylinders
     case 3:
-      calculateIgnitionAngle(dwellAngle, channel1IgnDegrees, currentStatus.advance, &ignition1EndAngle, &ignition1StartAngle);
-      calculateIgnitionAngle(dwellAngle, channel2IgnDegrees, currentStatus.advance, &ignition2EndAngle, &ignition2StartAngle);
-      calculateIgnitionAngle(dwellAngle, channel3IgnDegrees, currentStatus.advance, &ignition3EndAngle, &ignition3StartAngle);
+      calculateIgnitionAngle(dwellAngle, channel1IgnDegrees, channelAdvance(0), &ignition1EndAngle, &ignition1StartAngle);
+      calculateIgnitionAngle(dwellAngle, channel2IgnDegrees, channelAdvance(1), &ignition2EndAngle, &ignition2StartAngle);
+      calculateIgnitionAngle(dwellAngle, channel3IgnDegrees, channelAdvance(2), &ignition3EndAngle, &ignition3StartAngle);
       break;
     //4 cylinders
     case 4:
-      calculateIgnitionAngle(dwellAngle, channel1IgnDegrees, currentStatus.advance, &ignition1EndAngle, &ignition1StartAngle);
-      calculateIgnitionAngle(dwellAngle, channel2IgnDegrees, currentStatus.advance, &ignition2EndAngle, &ignition2StartAngle);
+      calculateIgnitionAngle(dwellAngle, channel1IgnDegrees, channelAdvance(0), &ignition1EndAngle, &ignition1StartAngle);
+      calculateIgnitionAngle(dwellAngle, channel2IgnDegrees, channelAdvance(1), &ignition2EndAngle, &ignition2StartAngle);
 
       #if IGN_CHANNELS >= 4
       if((configPage4.sparkMode == IGN_MODE_SEQUENTIAL) && currentStatus.hasSync)
       {
         if( CRANK_ANGLE_MAX_IGN != 720 ) { changeHalfToFullSync(); }
 
-        calculateIgnitionAngle(dwellAngle, channel3IgnDegrees, currentStatus.advance, &ignition3EndAngle, &ignition3StartAngle);
-        calculateIgnitionAngle(dwellAngle, channel4IgnDegrees, currentStatus.advance, &ignition4EndAngle, &ignition4StartAngle);
+        calculateIgnitionAngle(dwellAngle, channel3IgnDegrees, channelAdvance(2), &ignition3EndAngle, &ignition3StartAngle);
+        calculateIgnitionAngle(dwellAngle, channel4IgnDegrees, channelAdvance(3), &ignition4EndAngle, &ignition4StartAngle);
       }
       else if(configPage4.sparkMode == IGN_MODE_ROTARY)
       {
@@ -1372,28 +1539,28 @@ void calculateIgnitionAngles(uint16_t dwellAngle)
       break;
     //5 cylinders
     case 5:
-      calculateIgnitionAngle(dwellAngle, channel1IgnDegrees, currentStatus.advance, &ignition1EndAngle, &ignition1StartAngle);
-      calculateIgnitionAngle(dwellAngle, channel2IgnDegrees, currentStatus.advance, &ignition2EndAngle, &ignition2StartAngle);
-      calculateIgnitionAngle(dwellAngle, channel3IgnDegrees, currentStatus.advance, &ignition3EndAngle, &ignition3StartAngle);
-      calculateIgnitionAngle(dwellAngle, channel4IgnDegrees, currentStatus.advance, &ignition4EndAngle, &ignition4StartAngle);
+      calculateIgnitionAngle(dwellAngle, channel1IgnDegrees, channelAdvance(0), &ignition1EndAngle, &ignition1StartAngle);
+      calculateIgnitionAngle(dwellAngle, channel2IgnDegrees, channelAdvance(1), &ignition2EndAngle, &ignition2StartAngle);
+      calculateIgnitionAngle(dwellAngle, channel3IgnDegrees, channelAdvance(2), &ignition3EndAngle, &ignition3StartAngle);
+      calculateIgnitionAngle(dwellAngle, channel4IgnDegrees, channelAdvance(3), &ignition4EndAngle, &ignition4StartAngle);
       #if (IGN_CHANNELS >= 5)
-      calculateIgnitionAngle(dwellAngle, channel5IgnDegrees, currentStatus.advance, &ignition5EndAngle, &ignition5StartAngle);
+      calculateIgnitionAngle(dwellAngle, channel5IgnDegrees, channelAdvance(4), &ignition5EndAngle, &ignition5StartAngle);
       #endif
       break;
     //6 cylinders
     case 6:
-      calculateIgnitionAngle(dwellAngle, channel1IgnDegrees, currentStatus.advance, &ignition1EndAngle, &ignition1StartAngle);
-      calculateIgnitionAngle(dwellAngle, channel2IgnDegrees, currentStatus.advance, &ignition2EndAngle, &ignition2StartAngle);
-      calculateIgnitionAngle(dwellAngle, channel3IgnDegrees, currentStatus.advance, &ignition3EndAngle, &ignition3StartAngle);
+      calculateIgnitionAngle(dwellAngle, channel1IgnDegrees, channelAdvance(0), &ignition1EndAngle, &ignition1StartAngle);
+      calculateIgnitionAngle(dwellAngle, channel2IgnDegrees, channelAdvance(1), &ignition2EndAngle, &ignition2StartAngle);
+      calculateIgnitionAngle(dwellAngle, channel3IgnDegrees, channelAdvance(2), &ignition3EndAngle, &ignition3StartAngle);
 
       #if IGN_CHANNELS >= 6
       if((configPage4.sparkMode == IGN_MODE_SEQUENTIAL) && currentStatus.hasSync)
       {
         if( CRANK_ANGLE_MAX_IGN != 720 ) { changeHalfToFullSync(); }
 
-        calculateIgnitionAngle(dwellAngle, channel4IgnDegrees, currentStatus.advance, &ignition4EndAngle, &ignition4StartAngle);
-        calculateIgnitionAngle(dwellAngle, channel5IgnDegrees, currentStatus.advance, &ignition5EndAngle, &ignition5StartAngle);
-        calculateIgnitionAngle(dwellAngle, channel6IgnDegrees, currentStatus.advance, &ignition6EndAngle, &ignition6StartAngle);
+        calculateIgnitionAngle(dwellAngle, channel4IgnDegrees, channelAdvance(3), &ignition4EndAngle, &ignition4StartAngle);
+        calculateIgnitionAngle(dwellAngle, channel5IgnDegrees, channelAdvance(4), &ignition5EndAngle, &ignition5StartAngle);
+        calculateIgnitionAngle(dwellAngle, channel6IgnDegrees, channelAdvance(5), &ignition6EndAngle, &ignition6StartAngle);
       }
       else
       {
@@ -1403,20 +1570,20 @@ void calculateIgnitionAngles(uint16_t dwellAngle)
       break;
     //8 cylinders
     case 8:
-      calculateIgnitionAngle(dwellAngle, channel1IgnDegrees, currentStatus.advance, &ignition1EndAngle, &ignition1StartAngle);
-      calculateIgnitionAngle(dwellAngle, channel2IgnDegrees, currentStatus.advance, &ignition2EndAngle, &ignition2StartAngle);
-      calculateIgnitionAngle(dwellAngle, channel3IgnDegrees, currentStatus.advance, &ignition3EndAngle, &ignition3StartAngle);
-      calculateIgnitionAngle(dwellAngle, channel4IgnDegrees, currentStatus.advance, &ignition4EndAngle, &ignition4StartAngle);
+      calculateIgnitionAngle(dwellAngle, channel1IgnDegrees, channelAdvance(0), &ignition1EndAngle, &ignition1StartAngle);
+      calculateIgnitionAngle(dwellAngle, channel2IgnDegrees, channelAdvance(1), &ignition2EndAngle, &ignition2StartAngle);
+      calculateIgnitionAngle(dwellAngle, channel3IgnDegrees, channelAdvance(2), &ignition3EndAngle, &ignition3StartAngle);
+      calculateIgnitionAngle(dwellAngle, channel4IgnDegrees, channelAdvance(3), &ignition4EndAngle, &ignition4StartAngle);
 
       #if IGN_CHANNELS >= 8
       if((configPage4.sparkMode == IGN_MODE_SEQUENTIAL) && currentStatus.hasSync)
       {
         if( CRANK_ANGLE_MAX_IGN != 720 ) { changeHalfToFullSync(); }
 
-        calculateIgnitionAngle(dwellAngle, channel5IgnDegrees, currentStatus.advance, &ignition5EndAngle, &ignition5StartAngle);
-        calculateIgnitionAngle(dwellAngle, channel6IgnDegrees, currentStatus.advance, &ignition6EndAngle, &ignition6StartAngle);
-        calculateIgnitionAngle(dwellAngle, channel7IgnDegrees, currentStatus.advance, &ignition7EndAngle, &ignition7StartAngle);
-        calculateIgnitionAngle(dwellAngle, channel8IgnDegrees, currentStatus.advance, &ignition8EndAngle, &ignition8StartAngle);
+        calculateIgnitionAngle(dwellAngle, channel5IgnDegrees, channelAdvance(4), &ignition5EndAngle, &ignition5StartAngle);
+        calculateIgnitionAngle(dwellAngle, channel6IgnDegrees, channelAdvance(5), &ignition6EndAngle, &ignition6StartAngle);
+        calculateIgnitionAngle(dwellAngle, channel7IgnDegrees, channelAdvance(6), &ignition7EndAngle, &ignition7StartAngle);
+        calculateIgnitionAngle(dwellAngle, channel8IgnDegrees, channelAdvance(7), &ignition8EndAngle, &ignition8StartAngle);
       }
       else
       {
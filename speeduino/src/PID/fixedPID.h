@@ -0,0 +1,289 @@
+/** \file fixedPID.h
+ * @brief Fixed point PID controller used by the idle, boost, VVT and closed loop O2 controls
+ *
+ * All of the maths is done in 32 bit integers with FRAC_BITS fractional bits (Q format) for the gains and the internal sums,
+ * so there is no floating point. Compute() has no division, ComputeDt() divides to scale the integral and derivative by the sample length.
+ *
+ * - Proportional and integral act on the error, the derivative acts on the measurement only so that a change in the setpoint
+ *   does not cause a derivative kick. The derivative can optionally be filtered with a 1st order low pass (SetDerivativeFilter())
+ * - The integral is always clamped so that integral + feed forward stays within the output limits. Optionally (SetBackCalculation())
+ *   the amount by which the output exceeds the limits is also taken back off the integral (Back calculation), which stops the integral
+ *   winding up while the proportional term alone is saturating the output
+ * - A feed forward term (Eg an open loop value looked up from a 2D/3D table) can be passed to Compute(). It is added to the output
+ *   outside of the loop, so the PID only has to correct the error of the feed forward value
+ * - ComputeDt() runs a step for an input that is sampled at an irregular rate (Eg on each cam edge) rather than on the sample time, scaling the
+ *   integral and derivative by the actual time between the samples
+ *
+ * The gains are per sample. SetTunings(Kp, Ki, Kd) uses the same scaling that the idle and VVT tunings have always used
+ * (Kp and Ki in 1/32 steps, Ki and Kd scaled by the sample time), SetTunings() with a multiplier and divisor can be used for other scalings.
+ *
+ * The input, setpoint and output are linked by pointer when the controller is created, the same as the Arduino PID library this replaces.
+ * The range of (gain * error) must fit in 32 bits, so higher FRAC_BITS give more resolution to small gains at the cost of range.
+ */
+#ifndef FIXEDPID_H
+#define FIXEDPID_H
+
+#include <stdint.h>
+#if defined(ARDUINO)
+  #include <Arduino.h>
+#else
+  unsigned long millis(void); //Native unit tests provide this
+#endif
+
+#define AUTOMATIC 1
+#define MANUAL    0
+#define DIRECT    0
+#define REVERSE   1
+
+#define PID_SHIFTS          10 /**< Default number of fractional bits */
+#define PID_DEFAULT_SAMPLE  250 /**< Default sample time in ms. This is the 4Hz control time for idle */
+#define PID_FILTER_OFF      0 /**< SetDerivativeFilter() value to disable the derivative filter */
+#define PID_BACKCALC_OFF    0xFFU /**< SetBackCalculation() value to use clamping only */
+#define PID_DT_ONE_SAMPLE   256L /**< ComputeDt() works in sample times with 8 fractional bits */
+
+template <uint8_t FRAC_BITS>
+class fixedPID
+{
+  static_assert( (FRAC_BITS >= 5U) && (FRAC_BITS <= 20U), "fixedPID needs between 5 and 20 fractional bits");
+
+  public:
+    fixedPID(long *Input, long *Output, long *Setpoint, uint8_t ControllerDirection)
+    : myInput(Input), myOutput(Output), mySetpoint(Setpoint)
+    {
+      controllerDirection = ControllerDirection;
+      SetOutputLimits(0, 255);
+    }
+
+    /** Turns the controller on (AUTOMATIC) or off (MANUAL). Turning it on initialises it from the current output so the change is bumpless */
+    void SetMode(uint8_t Mode)
+    {
+      bool newAuto = (Mode == AUTOMATIC);
+      if( (newAuto == true) && (inAuto == false) ) { Initialize(); }
+      inAuto = newAuto;
+    }
+
+    /** Clamps the output (And the integral) to a range. The current output is clamped straight away if the controller is running */
+    void SetOutputLimits(long Min, long Max)
+    {
+      if(Min >= Max) { return; }
+      outMin = Min * (1L << FRAC_BITS);
+      outMax = Max * (1L << FRAC_BITS);
+
+      if(inAuto == true)
+      {
+        if(*myOutput > Max) { *myOutput = Max; }
+        else if(*myOutput < Min) { *myOutput = Min; }
+        integral = clamp(integral, outMin, outMax);
+      }
+    }
+
+    /** Sets the time in ms between computations. 0 computes on every call. The standard tunings are rescaled to the new sample time */
+    void SetSampleTime(uint16_t NewSampleTime)
+    {
+      if(NewSampleTime == sampleTime) { return; }
+      sampleTime = NewSampleTime;
+      if(standardTunings == true) { applyStandardTunings(); }
+    }
+
+    /**
+     * Sets the gains using the standard Speeduino scaling that the idle and VVT tunings use.
+     * Kp is in 1/32 steps, Ki in 1/32 steps per second and Kd in 1/128 steps per second.
+     * Does nothing if the values have not changed, so it can be called often
+     */
+    void SetTunings(int16_t Kp, int16_t Ki, int16_t Kd)
+    {
+      if( (standardTunings == true) && (dispKp == Kp) && (dispKi == Ki) && (dispKd == Kd) ) { return; }
+      dispKp = Kp; dispKi = Ki; dispKd = Kd;
+      standardTunings = true;
+      applyStandardTunings();
+    }
+
+    /**
+     * Sets the gains for another scaling. Each gain is (K * multiplier / divisor) output units per input unit, per sample
+     * Does nothing if the values have not changed, so it can be called often
+     */
+    void SetTunings(int16_t Kp, int16_t Ki, int16_t Kd, int32_t multiplier, int32_t divisor)
+    {
+      if( (divisor <= 0) || ( (standardTunings == false) && (dispKp == Kp) && (dispKi == Ki) && (dispKd == Kd) && (dispMultiplier == multiplier) && (dispDivisor == divisor) ) ) { return; }
+      dispKp = Kp; dispKi = Ki; dispKd = Kd;
+      dispMultiplier = multiplier; dispDivisor = divisor;
+      standardTunings = false;
+
+      kp = ((int32_t)Kp << FRAC_BITS) * multiplier / divisor;
+      ki = ((int32_t)Ki << FRAC_BITS) * multiplier / divisor;
+      kd = ((int32_t)Kd << FRAC_BITS) * multiplier / divisor;
+    }
+
+    /** DIRECT means the output increases when the input is below the setpoint, REVERSE is the opposite */
+    void SetControllerDirection(uint8_t Direction) { controllerDirection = Direction; }
+
+    /** Low pass filter on the derivative term. Each sample the filtered value moves 1/(2^shift) of the way to the new value. PID_FILTER_OFF disables it */
+    void SetDerivativeFilter(uint8_t shift) { filterShift = shift; }
+
+    /** Each sample the output is saturated, 1/(2^shift) of the excess is taken off the integral. PID_BACKCALC_OFF to only clamp the integral */
+    void SetBackCalculation(uint8_t shift) { backCalcShift = shift; }
+
+    /** Sets the integral from the current output, so that the next computation continues from the current output */
+    void Initialize(void)
+    {
+      integral = clamp(*myOutput * (1L << FRAC_BITS), outMin, outMax);
+      lastInput = *myInput;
+      filteredDTerm = 0;
+    }
+
+    /** Clears the integral. The derivative history is restarted from the current input, so the next computation does not see the change in input since the controller was last run */
+    void ResetIntegral(void)
+    {
+      integral = 0;
+      lastInput = *myInput;
+      filteredDTerm = 0;
+    }
+
+    uint8_t GetMode(void) { return (inAuto == true) ? AUTOMATIC : MANUAL; }
+    uint8_t GetDirection(void) { return controllerDirection; }
+
+    /**
+     * Computes a new output if the sample time has passed since the last one
+     * @param FeedForward Added to the output, in output units
+     * @return true if a new output was computed
+     */
+    bool Compute(long FeedForward = 0) { return ComputeAt(millis(), FeedForward); }
+
+    /** Compute() with the current time passed in (In ms) */
+    bool ComputeAt(uint32_t now, long FeedForward)
+    {
+      if( (inAuto == false) || ((uint32_t)(now - lastTime) < sampleTime) ) { return false; }
+      if(computeScaled(PID_DT_ONE_SAMPLE, FeedForward) == false) { return false; }
+      lastTime = now;
+      return true;
+    }
+
+    /**
+     * Computes a new output for an input that is sampled at an irregular rate (Eg once per cam edge), without waiting for the sample time.
+     * The gains are still for the sample time set with SetSampleTime(), the integral and derivative terms are scaled by how long the sample
+     * actually took, so the response is the same whatever the sample rate.
+     * The scaled integral step (Ki * error * dt) and derivative are limited to the output span, a short sample with a large Kd saturates the output.
+     * @param dt The time since the previous sample in uS. Limited to between 1/16 and 16 sample times
+     * @param FeedForward Added to the output, in output units
+     * @return true if a new output was computed
+     */
+    bool ComputeDt(uint32_t dt, long FeedForward = 0)
+    {
+      if(inAuto == false) { return false; }
+
+      uint32_t samplePeriod = (sampleTime > 0U) ? (sampleTime * 1000UL) : 1000UL;
+      if(dt > (samplePeriod * 16UL)) { dt = samplePeriod * 16UL; }
+      long samples = (long)((dt * PID_DT_ONE_SAMPLE) / samplePeriod);
+      if(samples < (PID_DT_ONE_SAMPLE / 16)) { samples = PID_DT_ONE_SAMPLE / 16; }
+
+      return computeScaled(samples, FeedForward);
+    }
+
+  private:
+    static inline long clamp(long value, long min, long max)
+    {
+      if(value > max) { return max; }
+      if(value < min) { return min; }
+      return value;
+    }
+
+    /** value * multiplier / divisor for the dt scaling. Up to 16x the 32 bit term, so this uses a 64 bit intermediate and limits the result to the output span */
+    long scaleTerm(long value, long multiplier, long divisor) const
+    {
+      int64_t scaled = ((int64_t)value * multiplier) / divisor;
+      int64_t span = (int64_t)outMax - outMin;
+      if(scaled > span) { return (long)span; }
+      if(scaled < -span) { return (long)-span; }
+      return (long)scaled;
+    }
+
+    /** The computation for one sample. samples is the length of the sample as a multiple of the sample time, PID_DT_ONE_SAMPLE being exactly 1 sample time */
+    bool computeScaled(long samples, long FeedForward)
+    {
+      long input = *myInput;
+      if(input <= 0) { return false; } //Fail safe, should never be 0
+
+      long error = *mySetpoint - input;
+      long dInput = input - lastInput;
+      if(controllerDirection == REVERSE)
+      {
+        error = -error;
+        dInput = -dInput;
+      }
+      long feedForward = FeedForward * (1L << FRAC_BITS);
+
+      long integralStep = ki * error;
+      long dTerm = kd * dInput;
+      if(samples != PID_DT_ONE_SAMPLE)
+      {
+        integralStep = scaleTerm(integralStep, samples, PID_DT_ONE_SAMPLE);
+        dTerm = scaleTerm(dTerm, PID_DT_ONE_SAMPLE, samples);
+      }
+
+      if(ki != 0) { integral = clamp(integral + integralStep, outMin - feedForward, outMax - feedForward); }
+
+      if(filterShift != PID_FILTER_OFF)
+      {
+        filteredDTerm += (dTerm - filteredDTerm) >> filterShift;
+        dTerm = filteredDTerm;
+      }
+
+      long output = (kp * error) - dTerm + feedForward;
+      if(ki != 0) { output += integral; }
+
+      if(output > outMax)
+      {
+        if( (backCalcShift != PID_BACKCALC_OFF) && (ki != 0) ) { integral -= (output - outMax) >> backCalcShift; }
+        output = outMax;
+      }
+      else if(output < outMin)
+      {
+        if( (backCalcShift != PID_BACKCALC_OFF) && (ki != 0) ) { integral += (outMin - output) >> backCalcShift; }
+        output = outMin;
+      }
+
+      *myOutput = output >> FRAC_BITS;
+
+      lastInput = input;
+      return true;
+    }
+
+    void applyStandardTunings(void)
+    {
+      //The sample time is applied as a whole number of samples per second, the same as the integer PID always has
+      int32_t samplesPerSecond = (sampleTime > 0U) ? (1000 / sampleTime) : 1000;
+      if(samplesPerSecond == 0) { samplesPerSecond = 1; }
+      kp = (int32_t)dispKp << FRAC_BITS >> 5;
+      ki = ((int32_t)dispKi << FRAC_BITS >> 5) / samplesPerSecond;
+      kd = ((int32_t)dispKd << FRAC_BITS >> 7) * samplesPerSecond;
+    }
+
+    long *myInput;
+    long *myOutput;
+    long *mySetpoint;
+
+    int32_t kp = 0; //Gains with FRAC_BITS fractional bits
+    int32_t ki = 0;
+    int32_t kd = 0;
+    int16_t dispKp = 0; //Tunings as they were set, for detecting changes and rescaling
+    int16_t dispKi = 0;
+    int16_t dispKd = 0;
+    int32_t dispMultiplier = 0;
+    int32_t dispDivisor = 0;
+    bool standardTunings = false;
+
+    long integral = 0;
+    long lastInput = 0;
+    long filteredDTerm = 0;
+    long outMin;
+    long outMax;
+
+    uint32_t lastTime = 0;
+    uint16_t sampleTime = PID_DEFAULT_SAMPLE;
+    uint8_t filterShift = PID_FILTER_OFF;
+    uint8_t backCalcShift = PID_BACKCALC_OFF;
+    uint8_t controllerDirection;
+    bool inAuto = false;
+};
+
+#endif
@@ -0,0 +1,389 @@
+/* Speeduino journaled flash storage
+ * See FlashJournal.h for a description of the flash layout
+ */
+#include "FlashJournal.h"
+
+#define BLOCK_BIT(block)    (1ULL << (block))
+#define PADDED_LENGTH(len)  (((len) + 3U) & ~3U)
+
+static uint16_t readU16(const uint8_t *buffer) { return (uint16_t)buffer[0] | ((uint16_t)buffer[1] << 8); }
+static uint32_t readU32(const uint8_t *buffer) { return (uint32_t)readU16(buffer) | ((uint32_t)readU16(&buffer[2]) << 16); }
+static void writeU16(uint8_t *buffer, uint16_t value) { buffer[0] = (uint8_t)value; buffer[1] = (uint8_t)(value >> 8); }
+static void writeU32(uint8_t *buffer, uint32_t value) { writeU16(buffer, (uint16_t)value); writeU16(&buffer[2], (uint16_t)(value >> 16)); }
+
+FlashJournal_BaseClass::FlashJournal_BaseClass(FlashJournal_Config config)
+{
+  _config = config;
+  _bankSize = _config.Flash_Sectors_Per_Bank * _config.Flash_Sector_Size;
+  memset(_image, 0xFF, sizeof(_image));
+}
+
+bool FlashJournal_BaseClass::initFlash() { return true; }
+
+//CRC16 CCITT (0x1021) using a 4 bit table. This is only used when records are written or loaded, so a full table is not worth the space
+uint16_t FlashJournal_BaseClass::crc16(uint16_t crc, const uint8_t *data, uint32_t length)
+{
+  static const uint16_t crcTable[16] = { 0x0000, 0x1021, 0x2042, 0x3063, 0x4084, 0x50A5, 0x60C6, 0x70E7, 0x8108, 0x9129, 0xA14A, 0xB16B, 0xC18C, 0xD1AD, 0xE1CE, 0xF1EF };
+  for(uint32_t i = 0; i < length; i++)
+  {
+    crc = (uint16_t)((crc << 4) ^ crcTable[(crc >> 12) ^ (data[i] >> 4)]);
+    crc = (uint16_t)((crc << 4) ^ crcTable[(crc >> 12) ^ (data[i] & 0x0F)]);
+  }
+  return crc;
+}
+
+uint32_t FlashJournal_BaseClass::bankAddress(uint8_t bank) { return bank * _bankSize; }
+
+bool FlashJournal_BaseClass::readBankHeader(uint8_t bank, uint32_t &sequence)
+{
+  uint8_t header[FLASH_JOURNAL_HEADER_SIZE];
+  readFlashBytes(bankAddress(bank), header, FLASH_JOURNAL_HEADER_SIZE);
+
+  if(readU32(header) != FLASH_JOURNAL_MAGIC) { return false; }
+  if(readU16(&header[8]) != FLASH_JOURNAL_EEPROM_SIZE) { return false; }
+  if(readU16(&header[10]) != FLASH_JOURNAL_VERSION) { return false; }
+  if(readU16(&header[12]) != crc16(0xFFFF, header, 12)) { return false; }
+
+  sequence = readU32(&header[4]);
+  return true;
+}
+
+/*
+Walks through the records of a bank, stopping at the first erased or invalid record.
+Data records that start before applyLimit are copied into the RAM image
+boundary is set to the end of the last commit or snapshot marker. Records after this belong to a commit that did not complete
+Returns the offset within the bank of the first free location
+*/
+uint32_t FlashJournal_BaseClass::scanBank(uint8_t bank, uint32_t applyLimit, bool &complete, bool &corrupt, uint32_t &boundary)
+{
+  uint32_t position = FLASH_JOURNAL_HEADER_SIZE;
+  complete = false;
+  corrupt = false;
+  boundary = position;
+
+  while( (position + FLASH_JOURNAL_RECORD_HEADER) <= _bankSize )
+  {
+    uint8_t *header = _recordBuffer;
+    readFlashBytes(bankAddress(bank) + position, header, FLASH_JOURNAL_RECORD_HEADER);
+
+    bool erased = true;
+    for(uint8_t i = 0; i < FLASH_JOURNAL_RECORD_HEADER; i++) { if(header[i] != 0xFF) { erased = false; } }
+    if(erased == true) { break; }
+
+    uint16_t address = readU16(header);
+    uint16_t length = readU16(&header[2]);
+    uint8_t type = header[6];
+    if( ((uint8_t)(type ^ header[7]) != 0xFF)
+      || ((type != FLASH_JOURNAL_RECORD_DATA) && (type != FLASH_JOURNAL_RECORD_COMMIT) && (type != FLASH_JOURNAL_RECORD_SNAPSHOT))
+      || (length > FLASH_JOURNAL_MAX_RECORD)
+      || (((uint32_t)address + length) > FLASH_JOURNAL_EEPROM_SIZE)
+      || ((position + FLASH_JOURNAL_RECORD_HEADER + PADDED_LENGTH(length)) > _bankSize) )
+    {
+      corrupt = true;
+      break;
+    }
+
+    uint8_t *data = &_recordBuffer[FLASH_JOURNAL_RECORD_HEADER];
+    if(length > 0U) { readFlashBytes(bankAddress(bank) + position + FLASH_JOURNAL_RECORD_HEADER, data, length); }
+    uint16_t crc = crc16(0xFFFF, header, 4);
+    crc = crc16(crc, &header[6], 1);
+    crc = crc16(crc, data, length);
+    if(crc != readU16(&header[4]))
+    {
+      corrupt = true; //Torn write. Nothing after this can be trusted
+      break;
+    }
+
+    if(position < applyLimit) { memcpy(&_image[address], data, length); }
+    position += FLASH_JOURNAL_RECORD_HEADER + PADDED_LENGTH(length);
+    if(type == FLASH_JOURNAL_RECORD_SNAPSHOT) { complete = true; }
+    if( (type != FLASH_JOURNAL_RECORD_DATA) && (complete == true) ) { boundary = position; }
+  }
+
+  return position;
+}
+
+bool FlashJournal_BaseClass::initialize()
+{
+  if(initFlash() == false) { return false; }
+
+  bool valid[2];
+  uint32_t sequence[2] = { 0, 0 };
+  uint32_t boundary[2] = { 0, 0 };
+  uint32_t end[2] = { 0, 0 };
+  bool corrupt[2] = { false, false };
+  for(uint8_t bank = 0; bank < 2U; bank++)
+  {
+    bool complete;
+    valid[bank] = readBankHeader(bank, sequence[bank]);
+    if(valid[bank] == true)
+    {
+      end[bank] = scanBank(bank, 0, complete, corrupt[bank], boundary[bank]);
+      valid[bank] = complete; //A bank is only usable once its snapshot has been completely written
+    }
+  }
+
+  if( (valid[0] == false) && (valid[1] == false) )
+  {
+    //No usable data. Format the flash
+    clear();
+    return true;
+  }
+
+  if(valid[0] && valid[1]) { _activeBank = ((int32_t)(sequence[1] - sequence[0]) > 0) ? 1U : 0U; }
+  else { _activeBank = valid[1] ? 1U : 0U; }
+  _sequence = sequence[_activeBank];
+
+  //Only the records up to the end of the last complete commit are loaded
+  bool complete;
+  bool applyCorrupt;
+  uint32_t applyBoundary;
+  memset(_image, 0xFF, sizeof(_image));
+  _appendPosition = scanBank(_activeBank, boundary[_activeBank], complete, applyCorrupt, applyBoundary);
+  _dirtyBlocks = 0;
+  _compactState = FLASH_JOURNAL_COMPACT_IDLE;
+  _mounted = true;
+
+  if( (corrupt[_activeBank] == true) || (end[_activeBank] != boundary[_activeBank]) )
+  {
+    //Power was lost during a commit. The space after a torn record may be partially programmed and the records of the
+    //incomplete commit must not be loaded after any later commit, so nothing more can be appended to this bank
+    _appendPosition = _bankSize;
+    startCompaction();
+  }
+
+  return true;
+}
+
+uint8_t FlashJournal_BaseClass::read(uint16_t addressEEPROM)
+{
+  if(_mounted == false) { initialize(); }
+  if(addressEEPROM >= FLASH_JOURNAL_EEPROM_SIZE) { return 0; }
+  return _image[addressEEPROM];
+}
+
+int8_t FlashJournal_BaseClass::write(uint16_t addressEEPROM, uint8_t val)
+{
+  if(_mounted == false) { initialize(); }
+  if(addressEEPROM >= FLASH_JOURNAL_EEPROM_SIZE) { return -1; }
+  if(_image[addressEEPROM] == val) { return 0; }
+
+  _image[addressEEPROM] = val;
+  _dirtyBlocks |= BLOCK_BIT(addressEEPROM / FLASH_JOURNAL_BLOCK_SIZE);
+  return 1;
+}
+
+int8_t FlashJournal_BaseClass::update(uint16_t addressEEPROM, uint8_t val) { return write(addressEEPROM, val); }
+
+uint16_t FlashJournal_BaseClass::length() { return FLASH_JOURNAL_EEPROM_SIZE; }
+
+bool FlashJournal_BaseClass::isCommitPending() { return (_dirtyBlocks != 0U); }
+
+bool FlashJournal_BaseClass::isCompacting() { return (_compactState != FLASH_JOURNAL_COMPACT_IDLE); }
+
+int8_t FlashJournal_BaseClass::appendRecord(uint8_t bank, uint32_t &position, uint16_t address, uint16_t length, uint8_t type)
+{
+  uint8_t *data = &_recordBuffer[FLASH_JOURNAL_RECORD_HEADER];
+  uint16_t paddedLength = PADDED_LENGTH(length);
+
+  writeU16(_recordBuffer, address);
+  writeU16(&_recordBuffer[2], length);
+  _recordBuffer[6] = type;
+  _recordBuffer[7] = (uint8_t)~type;
+  memcpy(data, &_image[address], length);
+  memset(&data[length], 0xFF, paddedLength - length);
+
+  uint16_t crc = crc16(0xFFFF, _recordBuffer, 4);
+  crc = crc16(crc, &_recordBuffer[6], 1);
+  crc = crc16(crc, data, length);
+  writeU16(&_recordBuffer[4], crc);
+
+  int8_t result = writeFlashBytes(bankAddress(bank) + position, _recordBuffer, FLASH_JOURNAL_RECORD_HEADER + paddedLength);
+  position += FLASH_JOURNAL_RECORD_HEADER + paddedLength;
+  _recordsWritten++;
+  return result;
+}
+
+int16_t FlashJournal_BaseClass::commit()
+{
+  if(_mounted == false) { initialize(); }
+
+  int16_t records = 0;
+  uint8_t block = 0;
+  while( (block < FLASH_JOURNAL_BLOCKS) && (_dirtyBlocks != 0U) )
+  {
+    if( (_dirtyBlocks & BLOCK_BIT(block)) == 0U ) { block++; continue; }
+
+    //Combine consecutive dirty blocks into a single record
+    uint8_t firstBlock = block;
+    while( (block < FLASH_JOURNAL_BLOCKS) && ((_dirtyBlocks & BLOCK_BIT(block)) != 0U) && ((uint8_t)(block - firstBlock) < (FLASH_JOURNAL_MAX_RECORD / FLASH_JOURNAL_BLOCK_SIZE)) ) { block++; }
+    uint16_t address = firstBlock * FLASH_JOURNAL_BLOCK_SIZE;
+    uint16_t length = (block - firstBlock) * FLASH_JOURNAL_BLOCK_SIZE;
+
+    //The last record of the commit is marked so that a commit that was cut short by a power loss is not loaded
+    uint64_t remainingBlocks = _dirtyBlocks;
+    for(uint8_t i = firstBlock; i < block; i++) { remainingBlocks &= ~BLOCK_BIT(i); }
+    uint8_t type = (remainingBlocks == 0U) ? FLASH_JOURNAL_RECORD_COMMIT : FLASH_JOURNAL_RECORD_DATA;
+
+    if( (_appendPosition + FLASH_JOURNAL_RECORD_HEADER + length) > _bankSize )
+    {
+      //Active bank is full. The compaction has to be completed now and the rest of this commit goes into the snapshot.
+      //The dirty blocks may have been copied before they were changed, so they are all copied again
+      startCompaction();
+      _compactForced = true;
+      _recopyBlocks |= _dirtyBlocks;
+      while(_compactState != FLASH_JOURNAL_COMPACT_IDLE) { compactionStep(); }
+      if(_compactForced == true) { return -1; } //Bank is too small for the image
+
+      //Everything in RAM is now in the new bank. The snapshot marker completes the commit
+      _dirtyBlocks = 0;
+      records++;
+      break;
+    }
+
+    if(appendRecord(_activeBank, _appendPosition, address, length, type) < 0) { return -1; }
+    records++;
+
+    for(uint8_t i = firstBlock; i < block; i++)
+    {
+      _dirtyBlocks &= ~BLOCK_BIT(i);
+      //If the compaction has already copied this block, it needs to be copied again before the new bank is used
+      if( ((_compactState == FLASH_JOURNAL_COMPACT_COPY) && (i < _compactPosition)) || (_compactState == FLASH_JOURNAL_COMPACT_RECOPY) ) { _recopyBlocks |= BLOCK_BIT(i); }
+    }
+  }
+
+  if(_appendPosition > (_bankSize / 2U)) { startCompaction(); }
+
+  return records;
+}
+
+void FlashJournal_BaseClass::startCompaction()
+{
+  if(_compactState != FLASH_JOURNAL_COMPACT_IDLE) { return; }
+  _compactState = FLASH_JOURNAL_COMPACT_ERASE;
+  _compactPosition = 0;
+  _recopyBlocks = 0;
+  _compactForced = false;
+}
+
+void FlashJournal_BaseClass::finishCompaction()
+{
+  uint8_t newBank = 1U - _activeBank;
+  appendRecord(newBank, _compactWritePosition, 0, 0, FLASH_JOURNAL_RECORD_SNAPSHOT);
+
+  _activeBank = newBank;
+  _appendPosition = _compactWritePosition;
+  _sequence++;
+  _compactState = FLASH_JOURNAL_COMPACT_IDLE;
+  _compactForced = false;
+}
+
+void FlashJournal_BaseClass::compactionStep()
+{
+  uint8_t newBank = 1U - _activeBank;
+
+  switch(_compactState)
+  {
+    case FLASH_JOURNAL_COMPACT_ERASE:
+      //1 sector is erased per step
+      eraseFlashSector(bankAddress(newBank) + (_compactPosition * _config.Flash_Sector_Size), _config.Flash_Sector_Size);
+      _eraseCount++;
+      _compactPosition++;
+      if(_compactPosition >= _config.Flash_Sectors_Per_Bank)
+      {
+        uint8_t header[FLASH_JOURNAL_HEADER_SIZE];
+        writeU32(header, FLASH_JOURNAL_MAGIC);
+        writeU32(&header[4], _sequence + 1U);
+        writeU16(&header[8], FLASH_JOURNAL_EEPROM_SIZE);
+        writeU16(&header[10], FLASH_JOURNAL_VERSION);
+        writeU16(&header[12], crc16(0xFFFF, header, 12));
+        writeU16(&header[14], 0xFFFF);
+        writeFlashBytes(bankAddress(newBank), header, FLASH_JOURNAL_HEADER_SIZE);
+
+        _compactWritePosition = FLASH_JOURNAL_HEADER_SIZE;
+        _compactPosition = 0;
+        _compactState = FLASH_JOURNAL_COMPACT_COPY;
+      }
+      break;
+
+    case FLASH_JOURNAL_COMPACT_COPY:
+    {
+      //Blocks that are still erased do not need to be copied. Skip over them to find the next 1 to copy
+      while(_compactPosition < FLASH_JOURNAL_BLOCKS)
+      {
+        bool erased = true;
+        const uint8_t *blockData = &_image[_compactPosition * FLASH_JOURNAL_BLOCK_SIZE];
+        for(uint16_t i = 0; i < FLASH_JOURNAL_BLOCK_SIZE; i++) { if(blockData[i] != 0xFF) { erased = false; break; } }
+        if(erased == false) { break; }
+        _compactPosition++;
+      }
+      if(_compactPosition >= FLASH_JOURNAL_BLOCKS)
+      {
+        _compactState = FLASH_JOURNAL_COMPACT_RECOPY;
+        break;
+      }
+
+      uint32_t firstBlock = _compactPosition;
+      uint32_t lastBlock = firstBlock + (FLASH_JOURNAL_MAX_RECORD / FLASH_JOURNAL_BLOCK_SIZE);
+      if(lastBlock > FLASH_JOURNAL_BLOCKS) { lastBlock = FLASH_JOURNAL_BLOCKS; }
+      uint16_t length = (lastBlock - firstBlock) * FLASH_JOURNAL_BLOCK_SIZE;
+      if( (_compactWritePosition + FLASH_JOURNAL_RECORD_HEADER + length) > _bankSize ) { _compactState = FLASH_JOURNAL_COMPACT_IDLE; break; } //Bank is too small for the image
+
+      appendRecord(newBank, _compactWritePosition, firstBlock * FLASH_JOURNAL_BLOCK_SIZE, length, FLASH_JOURNAL_RECORD_DATA);
+      _compactPosition = lastBlock;
+      break;
+    }
+
+    case FLASH_JOURNAL_COMPACT_RECOPY:
+      if(_recopyBlocks == 0U)
+      {
+        //Blocks with uncommitted changes may have been copied. Wait for them to be committed (And recopied) so that the new bank only holds committed values
+        if( (_dirtyBlocks == 0U) || (_compactForced == true) ) { finishCompaction(); }
+      }
+      else
+      {
+        uint8_t block = 0;
+        while( (_recopyBlocks & BLOCK_BIT(block)) == 0U ) { block++; }
+        if( (_compactWritePosition + FLASH_JOURNAL_RECORD_HEADER + FLASH_JOURNAL_BLOCK_SIZE) > _bankSize ) { _compactState = FLASH_JOURNAL_COMPACT_IDLE; break; }
+        appendRecord(newBank, _compactWritePosition, block * FLASH_JOURNAL_BLOCK_SIZE, FLASH_JOURNAL_BLOCK_SIZE, FLASH_JOURNAL_RECORD_DATA);
+        _recopyBlocks &= ~BLOCK_BIT(block);
+      }
+      break;
+
+    default:
+      break;
+  }
+}
+
+void FlashJournal_BaseClass::service(bool allowErase)
+{
+  if(_mounted == false) { return; }
+  if( (_compactState == FLASH_JOURNAL_COMPACT_ERASE) && (allowErase == false) ) { return; }
+  compactionStep();
+}
+
+int16_t FlashJournal_BaseClass::clear()
+{
+  if(_mounted == false) { initFlash(); }
+
+  memset(_image, 0xFF, sizeof(_image));
+  _dirtyBlocks = 0;
+  _compactState = FLASH_JOURNAL_COMPACT_IDLE;
+  _activeBank = 1;
+  _appendPosition = _bankSize;
+  _mounted = true;
+
+  //A compaction of the empty image erases bank 0 and writes its header and snapshot marker
+  startCompaction();
+  _compactForced = true;
+  while(_compactState != FLASH_JOURNAL_COMPACT_IDLE) { compactionStep(); }
+
+  //The old bank is erased as well so there is no old data left on the flash
+  for(uint32_t sector = 0; sector < _config.Flash_Sectors_Per_Bank; sector++)
+  {
+    eraseFlashSector(bankAddress(1) + (sector * _config.Flash_Sector_Size), _config.Flash_Sector_Size);
+    _eraseCount++;
+  }
+
+  return (int16_t)(_config.Flash_Sectors_Per_Bank * 2U);
+}
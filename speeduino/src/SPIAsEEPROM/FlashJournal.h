@@ -0,0 +1,242 @@
+/* Speeduino journaled flash storage
+ *
+ * This file is part of the Speeduino project. It provides an EEPROM style interface
+ * (read/write/update/get/put) on top of SPI or internal flash in the same way as the
+ * FLASH_EEPROM_BaseClass in SPIAsEEPROM.h, but with a log structured layout instead of
+ * the per byte emulation.
+ *
+ * ----------------- Explanation of the journal -------------------
+ * The whole EEPROM image is held in RAM. Reads are served directly from RAM and writes only
+ * change the RAM copy and mark the 64 byte block they are in as dirty. Calling commit() appends
+ * every dirty block range to the flash as a journal record with a CRC. The last record of each
+ * commit has a different type to mark the end of the commit.
+ * Unlike the byte emulation, changing a byte does not rewrite a whole flash section and the
+ * flash is only erased when a bank fills up, so both the burn time and the flash wear are much lower.
+ *
+ * The flash is split into 2 banks of Flash_Sectors_Per_Bank sectors. Only 1 bank is active at a time.
+ * When the active bank is more than half full, a compaction is started: the other bank is erased and a
+ * snapshot of the RAM image is copied into it. This is done in small steps from service() so it never
+ * holds up the main loop for long. Once the snapshot is complete a marker record is written and the new
+ * bank (With a higher sequence number) becomes the active one. Changes that are committed while the
+ * snapshot is being written go to the old bank and are copied again before the marker is written.
+ * The marker is not written while there are uncommitted changes, so the new bank never holds values that were not committed.
+ * If the active bank fills up during a commit, the compaction is completed immediately with the rest of the commit
+ * included in the snapshot, so the marker is then also the end of that commit.
+ *
+ * table 1: Each bank
+ * +-------------------+----------------------------------------------------------------------------------+
+ * | Bank header       | FLASH_JOURNAL_MAGIC, sequence number, EEPROM size, version and CRC (16 bytes)    |
+ * | Snapshot records  | Copy of the EEPROM image at the time of the compaction. Blocks that are all 0xFF |
+ * |                   | are not written                                                                  |
+ * | Snapshot marker   | FLASH_JOURNAL_RECORD_SNAPSHOT. The bank is only used if this is present          |
+ * | Journal records   | Changes committed after the compaction                                           |
+ * | Erased (0xFF)     | Free space                                                                       |
+ * +-------------------+----------------------------------------------------------------------------------+
+ *
+ * table 2: Each record (Padded to 4 bytes)
+ * +---------+-------------------------------------------------------------------------+
+ * | 2 bytes | EEPROM address                                                          |
+ * | 2 bytes | Data length                                                             |
+ * | 2 bytes | CRC16 (CCITT) of the address, length, type and data                     |
+ * | 1 byte  | Record type                                                             |
+ * | 1 byte  | Inverse of the record type                                              |
+ * | N bytes | Data                                                                    |
+ * +---------+-------------------------------------------------------------------------+
+ *
+ * Power loss safety:
+ * - A record that was only partly written fails its CRC. It and everything after it in the bank is ignored.
+ * - Records after the last commit end (Or snapshot marker) are ignored, so a commit is either fully applied or not applied at all.
+ * - In both cases the bank is compacted after the next start as the rest of it cannot be appended to safely.
+ * - A compaction that did not complete has no snapshot marker, so the previous bank is still used.
+ *
+ * This file has no Arduino dependencies so that it can be tested natively with a simulated flash.
+ */
+#ifndef FLASH_JOURNAL_H
+#define FLASH_JOURNAL_H
+
+#include <stdint.h>
+#include <string.h>
+
+#define FLASH_JOURNAL_EEPROM_SIZE     4096U //Size of the emulated EEPROM. Must be a multiple of FLASH_JOURNAL_BLOCK_SIZE
+#define FLASH_JOURNAL_BLOCK_SIZE      64U //Granularity of the dirty tracking
+#define FLASH_JOURNAL_BLOCKS          (FLASH_JOURNAL_EEPROM_SIZE / FLASH_JOURNAL_BLOCK_SIZE)
+#define FLASH_JOURNAL_MAX_RECORD      256U //Maximum data length of a single record. Must be a multiple of FLASH_JOURNAL_BLOCK_SIZE
+#define FLASH_JOURNAL_HEADER_SIZE     16U
+#define FLASH_JOURNAL_RECORD_HEADER   8U
+#define FLASH_JOURNAL_MAGIC           0x4C4E524AUL //"JRNL"
+#define FLASH_JOURNAL_VERSION         1U
+
+#define FLASH_JOURNAL_RECORD_DATA     0x5AU
+#define FLASH_JOURNAL_RECORD_COMMIT   0x3CU //Data record that is the last of a commit
+#define FLASH_JOURNAL_RECORD_SNAPSHOT 0xC3U
+
+#define FLASH_JOURNAL_COMPACT_IDLE    0
+#define FLASH_JOURNAL_COMPACT_ERASE   1
+#define FLASH_JOURNAL_COMPACT_COPY    2
+#define FLASH_JOURNAL_COMPACT_RECOPY  3
+
+typedef struct {
+  uint32_t Flash_Sectors_Per_Bank;  //Number of flash sectors in each of the 2 banks. A bank must be able to hold at least 2 snapshots of the EEPROM image
+  uint32_t Flash_Sector_Size;       //Flash sector size: This is determined by the physical device. This is the smallest block that can be erased at one time
+  uint32_t Flash_BaseAddress;       //Flash address of the first bank. The second bank follows directly after it
+} FlashJournal_Config;
+
+class FlashJournal_BaseClass
+{
+  public:
+    FlashJournal_BaseClass(FlashJournal_Config);
+
+    /**
+     * Find the newest complete bank and load it into RAM. If there is no valid bank the flash is formatted
+     * @return success
+     */
+    bool initialize();
+
+    /**
+     * Read an eeprom cell
+     * @param address
+     * @return value
+     */
+    uint8_t read(uint16_t);
+
+    /**
+     * Write value to an eeprom cell. The value is only stored to flash once commit() is called
+     * @param address
+     * @param value
+     * @return 1 if the value changed, 0 if it did not, -1 if the address is invalid
+     */
+    int8_t write(uint16_t, uint8_t);
+
+    /**
+     * Update a eeprom cell. Same as write() as unchanged values are never written anyway
+     * @param address
+     * @param value
+     * @return 1 if the value changed, 0 if it did not, -1 if the address is invalid
+     */
+    int8_t update(uint16_t, uint8_t);
+
+    /**
+     * Read AnyTypeOfData from eeprom
+     * @param address
+     * @return AnyTypeOfData
+     */
+    template< typename T > T &get( int idx, T &t ){
+        uint16_t e = idx;
+        uint8_t *ptr = (uint8_t*) &t;
+        for( int count = sizeof(T) ; count ; --count, ++e )  *ptr++ = read(e);
+        return t;
+    }
+
+    /**
+     * Write AnyTypeOfData to eeprom
+     * @param address
+     * @param AnyTypeOfData
+     */
+    template< typename T > const T &put( int idx, const T &t ){
+        const uint8_t *ptr = (const uint8_t*) &t;
+        uint16_t e = idx;
+        for( int count = sizeof(T) ; count ; --count, ++e )  write(e, *ptr++);
+        return t;
+    }
+
+    /**
+     * Append all changed blocks to the flash
+     * @return Number of records written, -1 on a flash error
+     */
+    int16_t commit();
+
+    /**
+     * Performs 1 step of any compaction that is in progress
+     * @param allowErase Sector erases can block for a long time on internal flash. They are only done when this is true, or when the active bank is full
+     */
+    void service(bool allowErase);
+
+    /**
+     * Erase both banks and set every cell to 0xFF
+     * @return Number of sectors erased
+     */
+    int16_t clear();
+
+    /**
+     * @return emulated eeprom length in bytes
+     */
+    uint16_t length();
+
+    /**
+     * @return True if there are changed values that have not been committed
+     */
+    bool isCommitPending();
+
+    /**
+     * @return True while a compaction is in progress
+     */
+    bool isCompacting();
+
+    //Statistics, mostly useful for testing
+    uint32_t _sequence = 0;         //Sequence number of the active bank
+    uint32_t _eraseCount = 0;       //Number of sector erases since startup
+    uint32_t _recordsWritten = 0;   //Number of records written since startup
+
+  protected:
+    /**
+     * Make the flash ready for use. Called once before the first flash access
+     * @return success
+     */
+    virtual bool initFlash();
+
+    //************************************************* START Implement for actual flash used ****************************************
+    /**
+     * Read bytes from the flash storage
+     * @param address Relative to Flash_BaseAddress
+     * @param buffer
+     * @param length
+     * @return success
+     */
+    virtual int8_t readFlashBytes(uint32_t, uint8_t*, uint32_t) = 0;
+
+    /**
+     * Write bytes to the flash storage. Address and length are always a multiple of 4
+     * @param address Relative to Flash_BaseAddress
+     * @param buffer
+     * @param length
+     * @return success
+     */
+    virtual int8_t writeFlashBytes(uint32_t, uint8_t*, uint32_t) = 0;
+
+    /**
+     * Erase a flash sector.
+     * @param address Relative to Flash_BaseAddress
+     * @param length
+     * @return success
+     */
+    virtual int8_t eraseFlashSector(uint32_t, uint32_t) = 0;
+    //************************************************* END Implement for actual flash used ****************************************
+
+    FlashJournal_Config _config;
+
+  private:
+    uint32_t bankAddress(uint8_t bank);
+    bool readBankHeader(uint8_t bank, uint32_t &sequence);
+    uint32_t scanBank(uint8_t bank, uint32_t applyLimit, bool &complete, bool &corrupt, uint32_t &boundary);
+    int8_t appendRecord(uint8_t bank, uint32_t &position, uint16_t address, uint16_t length, uint8_t type);
+    void startCompaction();
+    void finishCompaction();
+    void compactionStep();
+    static uint16_t crc16(uint16_t crc, const uint8_t *data, uint32_t length);
+
+    uint8_t _image[FLASH_JOURNAL_EEPROM_SIZE];
+    uint8_t _recordBuffer[FLASH_JOURNAL_RECORD_HEADER + FLASH_JOURNAL_MAX_RECORD];
+    uint64_t _dirtyBlocks = 0;        //Blocks changed since the last commit
+    uint64_t _recopyBlocks = 0;       //Blocks committed during a compaction after they had already been copied
+    uint32_t _bankSize;
+    uint32_t _appendPosition = 0;     //Offset within the active bank of the next record
+    bool _mounted = false;
+    uint8_t _activeBank = 0;
+
+    uint8_t _compactState = FLASH_JOURNAL_COMPACT_IDLE;
+    bool _compactForced = false;      //Compaction is being completed immediately as the active bank is full
+    uint32_t _compactPosition = 0;    //Next sector to erase or next block to copy, depending on the compaction state
+    uint32_t _compactWritePosition = 0; //Offset within the new bank of the next record
+};
+
+#endif
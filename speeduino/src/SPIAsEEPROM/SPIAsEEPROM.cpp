@@ -291,6 +291,48 @@ int8_t SPI_EEPROM_Class::eraseFlashSector(uint32_t address, uint32_t length){
   return 0;
 }
 
+#define SPI_FLASH_PAGE_SIZE 256UL //Page programming wraps around within a page, so writes must not cross a page boundary
+
+SPI_Journal_EEPROM_Class::SPI_Journal_EEPROM_Class(FlashJournal_Config JournalConfig, Flash_SPI_Config SPIConfig):FlashJournal_BaseClass(JournalConfig)
+{
+  _configSPI = SPIConfig;
+}
+
+bool SPI_Journal_EEPROM_Class::initFlash(){
+  SPISettings settings(22500000, MSBFIRST, SPI_MODE0);
+  _configSPI.SPIport.beginTransaction(settings);
+  pinMode(_configSPI.pinChipSelect, OUTPUT);
+  return winbondSPIFlash.begin(winbondFlashClass::partNumber::autoDetect, _configSPI.SPIport, _configSPI.pinChipSelect);
+}
+
+int8_t SPI_Journal_EEPROM_Class::readFlashBytes(uint32_t address, byte *buf, uint32_t length){
+  while(winbondSPIFlash.busy());
+  return winbondSPIFlash.read(address+_config.Flash_BaseAddress, buf, length);
+}
+
+int8_t SPI_Journal_EEPROM_Class::writeFlashBytes(uint32_t address, byte *buf, uint32_t length){
+  uint32_t flashAddress = address+_config.Flash_BaseAddress;
+  while(length > 0)
+  {
+    uint32_t chunk = SPI_FLASH_PAGE_SIZE - (flashAddress % SPI_FLASH_PAGE_SIZE);
+    if(chunk > length) { chunk = length; }
+    winbondSPIFlash.setWriteEnable(true);
+    winbondSPIFlash.writePage(flashAddress, buf, chunk);
+    while(winbondSPIFlash.busy());
+    flashAddress += chunk;
+    buf += chunk;
+    length -= chunk;
+  }
+  return 0;
+}
+
+int8_t SPI_Journal_EEPROM_Class::eraseFlashSector(uint32_t address, uint32_t length){
+  winbondSPIFlash.setWriteEnable(true);
+  winbondSPIFlash.eraseSector(address+_config.Flash_BaseAddress);
+  while(winbondSPIFlash.busy());
+  return 0;
+}
+
 #endif
 
 //THIS IS NOT WORKING! FOR STM32F103 YOU CAN ONLY WRITE IN JUST ERASED HALFWORDS(UINT16_T). THE PHILOSOPHY IS FLAWWED THERE.
@@ -388,9 +430,9 @@ int8_t InternalSTM32F4_EEPROM_Class::readFlashBytes(uint32_t address, byte *buf,
   return 0;
 }
 
-int8_t InternalSTM32F4_EEPROM_Class::writeFlashBytes(uint32_t flashAddress, byte *buf, uint32_t length){
+//Shared by the emulated EEPROM and the journal
+static int8_t writeSTM32F4Flash(uint32_t translatedAddress, byte *buf, uint32_t length){
  {
-  uint32_t translatedAddress = flashAddress+_config.EEPROM_Flash_BaseAddress;
   uint16_t data = 0;
   uint32_t offset = 0;
   uint32_t countaddress = translatedAddress; 
@@ -417,11 +459,8 @@ int8_t InternalSTM32F4_EEPROM_Class::writeFlashBytes(uint32_t flashAddress, byte
   return 0;
 }
 
-int8_t InternalSTM32F4_EEPROM_Class::eraseFlashSector(uint32_t address, uint32_t length){
+static int8_t eraseSTM32F4Sector(uint32_t realAddress){
   FLASH_EraseInitTypeDef EraseInitStruct;
-  // uint32_t offset = 0;
-  uint32_t realAddress = _config.EEPROM_Flash_BaseAddress+address;
-  // uint32_t address_end = FLASH_BASE_ADDRESS + E2END;
   bool EraseSucceed=false;
   uint32_t SectorError = 0;
   uint32_t _Sector = 11;
@@ -452,6 +491,32 @@ int8_t InternalSTM32F4_EEPROM_Class::eraseFlashSector(uint32_t address, uint32_t
   HAL_FLASH_Lock();
   return EraseSucceed;
 }
+
+int8_t InternalSTM32F4_EEPROM_Class::writeFlashBytes(uint32_t flashAddress, byte *buf, uint32_t length){
+  return writeSTM32F4Flash(flashAddress+_config.EEPROM_Flash_BaseAddress, buf, length);
+}
+
+int8_t InternalSTM32F4_EEPROM_Class::eraseFlashSector(uint32_t address, uint32_t length){
+  return eraseSTM32F4Sector(_config.EEPROM_Flash_BaseAddress+address);
+}
+
+InternalSTM32F4_Journal_EEPROM_Class::InternalSTM32F4_Journal_EEPROM_Class(FlashJournal_Config config) : FlashJournal_BaseClass(config)
+{
+
+}
+
+int8_t InternalSTM32F4_Journal_EEPROM_Class::readFlashBytes(uint32_t address, byte *buf, uint32_t length){
+  memcpy(buf, (uint8_t *)(_config.Flash_BaseAddress + address), length);
+  return 0;
+}
+
+int8_t InternalSTM32F4_Journal_EEPROM_Class::writeFlashBytes(uint32_t flashAddress, byte *buf, uint32_t length){
+  return writeSTM32F4Flash(flashAddress+_config.Flash_BaseAddress, buf, length);
+}
+
+int8_t InternalSTM32F4_Journal_EEPROM_Class::eraseFlashSector(uint32_t address, uint32_t length){
+  return eraseSTM32F4Sector(_config.Flash_BaseAddress+address);
+}
 #endif
 
 
@@ -109,6 +109,7 @@
 
 #include <Arduino.h>
 #include "winbondflash.h"
+#include "FlashJournal.h"
 #include <SPI.h>
 
 // #elif defined(STM32F103xB) 
@@ -396,6 +397,52 @@ class InternalSTM32F4_EEPROM_Class : public FLASH_EEPROM_BaseClass
 };
 
 
+//Journaled storage on SPI flash. See FlashJournal.h
+class SPI_Journal_EEPROM_Class : public FlashJournal_BaseClass
+{
+  public:
+    SPI_Journal_EEPROM_Class(FlashJournal_Config, Flash_SPI_Config);
+
+  protected:
+    /**
+     * Start the SPI flash chip
+     * @return success
+     */
+    bool initFlash();
+
+    int8_t readFlashBytes(uint32_t , byte*, uint32_t);
+
+    /**
+     * Write bytes to the flash storage. Writes are split at the flash page boundaries
+     * @param address
+     * @param buffer
+     * @param length
+     * @return success
+     */
+    int8_t writeFlashBytes(uint32_t, byte*, uint32_t);
+
+    int8_t eraseFlashSector(uint32_t, uint32_t);
+
+    //winbond flash class instance for interacting with the spi flash chip
+    winbondFlashSPI winbondSPIFlash;
+
+    //SPI configuration struct
+    Flash_SPI_Config _configSPI;
+};
+
+//Journaled storage on the internal flash of the STM32F4. See FlashJournal.h
+//Each bank must be at least 1 whole flash sector. Erasing a 128kb sector stalls the CPU for 1-2 seconds, so compaction erases are only done when the engine is stopped
+class InternalSTM32F4_Journal_EEPROM_Class : public FlashJournal_BaseClass
+{
+  public:
+    InternalSTM32F4_Journal_EEPROM_Class(FlashJournal_Config);
+
+  protected:
+    int8_t readFlashBytes(uint32_t , byte*, uint32_t);
+    int8_t writeFlashBytes(uint32_t, byte*, uint32_t);
+    int8_t eraseFlashSector(uint32_t, uint32_t);
+};
+
 // class InternalSTM32F1_EEPROM_Class : public FLASH_EEPROM_BaseClass
 // {
 
@@ -0,0 +1,206 @@
+/*
+Speeduino - Simple engine management for the Arduino Mega 2560 platform
+Copyright (C) Josh Stewart
+A full copy of the license may be found in the projects root directory
+*/
+/** @file
+ * Step generator for the stepper idle motor, see stepGenerator.h
+ */
+#include "stepGenerator.h"
+
+#define STEP_BIT(bit) ((uint8_t)(1U << (bit)))
+
+enum stepPhase_t {STEP_IDLE, STEP_HIGH, STEP_COOL};
+
+//Set by the main loop with interrupts disabled
+static volatile uint8_t stepTime = 1; //mS
+static volatile uint8_t coolTime = 0; //mS
+static volatile uint8_t rampSteps = 0;
+static volatile uint8_t hysteresis = 0;
+static volatile bool disableWhenStopped = true;
+static volatile int16_t stepTarget = 0;
+
+//Only changed by stepperTick(), except by stepperHome()
+static volatile stepPhase_t phase = STEP_IDLE;
+static volatile uint16_t phaseTicks = 0; //mS left in the current phase. Cool time and ramp time together can be more than 255
+static volatile int16_t stepPosition = 0;
+static volatile uint16_t homeStepsLeft = 0;
+static volatile bool homed = false;
+static volatile bool moving = false;
+static volatile bool driverOn = false; //Whether STEPPER_PIN_ENABLE has been returned since the last STEPPER_PIN_DISABLE
+static volatile int8_t dirPin = 0; //Direction the direction pin was last set to. 1 more air, -1 less air, 0 not set
+static volatile uint16_t moveSteps = 0; //Steps taken so far in the current move
+
+/**
+ * Sets the step timing
+ * @param newStepTime Time the step pin is held on for, in mS. At least 1
+ * @param newCoolTime Time the step pin is held off for after each step, in mS. With 0 the next step is made in the same tick the step pin is turned off
+ * @param newRampSteps Number of steps at each end of a move that are slowed down, 0 for no ramp
+ * @param newHysteresis A move is only started when the target is more than this many steps from the position
+ * @param powerWhenActive Whether the driver is turned off at the end of each move
+ */
+void stepperConfigure(uint8_t newStepTime, uint8_t newCoolTime, uint8_t newRampSteps, uint8_t newHysteresis, bool powerWhenActive)
+{
+  stepTime = (newStepTime == 0U) ? 1U : newStepTime;
+  coolTime = newCoolTime;
+  rampSteps = newRampSteps;
+  hysteresis = newHysteresis;
+  disableWhenStopped = powerWhenActive;
+}
+
+/**
+ * Starts homing the motor. It is stepped towards the home position homeSteps times (Whatever the target is), after which the position is 0.
+ * Any move or homing that is in progress is abandoned, the step that is being made is finished first. The driver and direction pins are set again before the first step
+ */
+void stepperHome(uint16_t homeSteps)
+{
+  homeStepsLeft = homeSteps;
+  stepPosition = 0;
+  homed = (homeSteps == 0U);
+  moving = false;
+  driverOn = false;
+  dirPin = 0;
+  moveSteps = 0;
+}
+
+/** Sets the position to move to. Ignored until homing is complete */
+void stepperSetTarget(int16_t target)
+{
+  stepTarget = target;
+}
+
+/** The extra cool time for the step that has just been made, remainingSteps being the number of steps left in the move after it */
+static uint16_t rampTime(uint16_t remainingSteps)
+{
+  uint16_t fromEnd = (moveSteps < remainingSteps) ? moveSteps : remainingSteps;
+  if(fromEnd >= rampSteps) { return 0; }
+  return (uint16_t)(rampSteps - fromEnd);
+}
+
+static void checkHomingDone(void)
+{
+  if( (homed == false) && (homeStepsLeft == 0U) )
+  {
+    homed = true;
+    stepPosition = 0;
+  }
+}
+
+/** The direction of the next step, 1 more air, -1 less air or 0 for no step */
+static int8_t stepDirection(void)
+{
+  if(homed == false) { return (homeStepsLeft > 0U) ? -1 : 0; }
+
+  int16_t error = stepTarget - stepPosition;
+  if( (moving == false) && (error <= (int16_t)hysteresis) && (error >= -(int16_t)hysteresis) ) { return 0; }
+  if(error > 0) { return 1; }
+  if(error < 0) { return -1; }
+  return 0;
+}
+
+/** Sets the direction pin, and turns the driver on if it is off. Must be at least 1 tick before the step so the driver sees the direction before the step edge */
+static uint8_t setDirection(int8_t direction)
+{
+  uint8_t pins = (direction > 0) ? STEP_BIT(STEPPER_PIN_MORE_AIR) : STEP_BIT(STEPPER_PIN_LESS_AIR);
+  if(driverOn == false)
+  {
+    pins |= STEP_BIT(STEPPER_PIN_ENABLE);
+    driverOn = true;
+  }
+  dirPin = direction;
+  //Start of a move or a change of direction, which starts the ramp again
+  moving = true;
+  moveSteps = 0;
+  return pins;
+}
+
+static uint8_t startStep(int8_t direction)
+{
+  if(moving == false)
+  {
+    moving = true;
+    moveSteps = 0;
+  }
+  if(homed == false) { homeStepsLeft--; }
+  else { stepPosition += direction; }
+
+  moveSteps++;
+  phase = STEP_HIGH;
+  phaseTicks = stepTime;
+  return STEP_BIT(STEPPER_PIN_STEP_ON);
+}
+
+/**
+ * Runs the generator for 1mS. Must be called every 1mS
+ * @return STEPPER_PIN_* bits for the pin changes to make
+ */
+uint8_t stepperTick(void)
+{
+  if(phaseTicks > 0U)
+  {
+    phaseTicks--;
+    if(phaseTicks > 0U) { return 0; }
+  }
+
+  uint8_t pins = 0;
+  if(phase == STEP_HIGH)
+  {
+    //End of the step
+    pins = STEP_BIT(STEPPER_PIN_STEP_OFF);
+    uint16_t remainingSteps = homeStepsLeft;
+    if(homed == true)
+    {
+      int16_t error = stepTarget - stepPosition;
+      remainingSteps = (error < 0) ? (uint16_t)(-error) : (uint16_t)error;
+    }
+    checkHomingDone();
+
+    uint16_t cool = (uint16_t)coolTime + rampTime(remainingSteps);
+    int8_t direction = stepDirection();
+    if( (direction != 0) && (direction != dirPin) )
+    {
+      //Reversing. The direction is set now, at least 1 tick before the next step
+      pins |= setDirection(direction);
+      if(cool == 0U) { cool = 1; }
+    }
+    if(cool > 0U)
+    {
+      phase = STEP_COOL;
+      phaseTicks = cool;
+      return pins;
+    }
+    //No cool time, the next step is made in this tick
+  }
+  phase = STEP_IDLE;
+  checkHomingDone();
+
+  int8_t direction = stepDirection();
+  if(direction == 0)
+  {
+    moving = false;
+    if( (disableWhenStopped == true) && (driverOn == true) )
+    {
+      driverOn = false;
+      pins |= STEP_BIT(STEPPER_PIN_DISABLE);
+    }
+    return pins;
+  }
+
+  if( (driverOn == false) || (direction != dirPin) )
+  {
+    //The driver and direction are set 1 tick before the step
+    pins |= setDirection(direction);
+    phase = STEP_COOL;
+    phaseTicks = 1;
+    return pins;
+  }
+  return pins | startStep(direction);
+}
+
+int16_t stepperPosition(void) { return stepPosition; }
+
+/** Whether homing has finished */
+bool stepperHomed(void) { return homed; }
+
+/** Whether the motor is moving towards the target or homing */
+bool stepperMoving(void) { return (moving == true) || (homed == false); }
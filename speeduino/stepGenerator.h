@@ -0,0 +1,41 @@
+/** \file stepGenerator.h
+ * @brief Step generator for the stepper idle motor
+ *
+ * The steps are timed by the 1ms timer interrupt, which calls stepperTick() once per ms. The main loop only sets the target position with stepperSetTarget(),
+ * the generator then steps towards it on its own, so the step timing does not depend on the loop time and the main loop does not need to poll the motor.
+ *
+ * Each step holds the step pin on for the step time, then off for the cool time. With no cool time the step pin is turned off and the next step is made in the
+ * same tick, so the step period is the step time. A move is started when the target is more than the hysteresis away from
+ * the position and then runs all the way to the target. The target can change at any time during a move, the move continues to the newest target.
+ * To let the motor get up to speed without missing steps, the cool time of the first and last rampSteps steps of each move (And of homing) is lengthened by
+ * 1ms for each step closer to the start or end of the move that the step is.
+ *
+ * The driver needs the direction (And enable) pin set before the step edge, so these are never returned in the same tick as STEPPER_PIN_STEP_ON. They are set
+ * when the previous step ends, or 1 tick before the first step of a move, which delays that step by 1mS.
+ *
+ * stepperTick() does not drive the pins, it returns STEPPER_PIN_* flags for the pin changes the caller must make. STEPPER_PIN_STEP_OFF and STEPPER_PIN_STEP_ON
+ * can be returned together, in which case the step pin must be held off for the minimum low time of the driver before it is turned on again.
+ * The configuration and target must only be changed with interrupts disabled.
+ */
+#ifndef STEPGENERATOR_H
+#define STEPGENERATOR_H
+
+#include <stdint.h>
+
+//Bits returned by stepperTick()
+#define STEPPER_PIN_STEP_ON   0U /**< Set the step pin high */
+#define STEPPER_PIN_STEP_OFF  1U /**< Set the step pin low */
+#define STEPPER_PIN_MORE_AIR  2U /**< Set the direction pin to move away from the home position. Never returned along with STEPPER_PIN_STEP_ON */
+#define STEPPER_PIN_LESS_AIR  3U /**< Set the direction pin to move towards the home position. Never returned along with STEPPER_PIN_STEP_ON */
+#define STEPPER_PIN_ENABLE    4U /**< Turn the driver on. Never returned along with STEPPER_PIN_STEP_ON */
+#define STEPPER_PIN_DISABLE   5U /**< Turn the driver off at the end of a move */
+
+void stepperConfigure(uint8_t stepTime, uint8_t coolTime, uint8_t rampSteps, uint8_t hysteresis, bool powerWhenActive);
+void stepperHome(uint16_t homeSteps);
+void stepperSetTarget(int16_t target);
+uint8_t stepperTick(void);
+int16_t stepperPosition(void);
+bool stepperHomed(void);
+bool stepperMoving(void);
+
+#endif
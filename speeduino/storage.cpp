@@ -55,7 +55,7 @@ void writeAllConfig(void)
 struct write_location {
   eeprom_address_t address; // EEPROM address to write next
   uint16_t counter; // Number of bytes written
-  uint8_t write_block_size; // Maximum number of bytes to write
+  uint16_t write_block_size; // Maximum number of bytes to write
 
   /** Update byte to EEPROM by first comparing content and the need to write it.
   We only ever write to the EEPROM where the new value is different from the currently stored byte
@@ -154,7 +154,10 @@ void writeConfig(uint8_t pageNum)
 //The maximum number of write operations that will be performed in one go.
 //If we try to write to the EEPROM too fast (Eg Each write takes ~3ms on the AVR) then 
 //the rest of the system can hang)
-#if defined(USE_SPI_EEPROM)
+#if defined(EEPROM_IS_JOURNAL)
+  //Writes only go to RAM and are committed to the flash in one go at the end of this function, so there is no limit on the number of bytes written per call
+  uint16_t EEPROM_MAX_WRITE_BLOCK = UINT16_MAX;
+#elif defined(USE_SPI_EEPROM)
   //For use with common Winbond SPI EEPROMs Eg W25Q16JV
   uint8_t EEPROM_MAX_WRITE_BLOCK = 20; //This needs tuning
 #elif defined(CORE_STM32) || defined(CORE_TEENSY)
@@ -324,6 +327,22 @@ void writeConfig(uint8_t pageNum)
   }
 
   BIT_WRITE(currentStatus.status4, BIT_STATUS4_BURNPENDING, !result.can_write());
+
+#if defined(EEPROM_IS_JOURNAL)
+  EEPROM.commit(); //Append the changed parts of the page to the flash journal
+#endif
+}
+
+/** Background EEPROM tasks. Called at 10Hz from the main loop.
+ * For journaled flash storage this commits any values written outside of writeConfig() (Calibration, baro etc) and performs 1 step of any compaction.
+ * Sector erases can stall the CPU, so the compaction only erases when the engine is stopped (Unless the journal is full)
+ */
+void serviceEEPROM(void)
+{
+#if defined(EEPROM_IS_JOURNAL)
+  if(EEPROM.isCommitPending() && !isEepromWritePending()) { EEPROM.commit(); }
+  EEPROM.service(currentStatus.RPM == 0U);
+#endif
 }
 
 /** Reset all configPage* structs (2,4,6,9,10,13) and write them full of null-bytes.
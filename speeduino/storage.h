@@ -141,6 +141,7 @@ void storeCalibrationCRC32(uint8_t calibrationPageNum, uint32_t calibrationCRC);
 uint32_t readCalibrationCRC32(uint8_t calibrationPageNum);
 uint16_t getEEPROMSize(void);
 bool isEepromWritePending(void);
+void serviceEEPROM(void);
 
 extern uint32_t deferEEPROMWritesUntil;
 
@@ -0,0 +1,131 @@
+/*
+Speeduino - Simple engine management for the Arduino Mega 2560 platform
+Copyright (C) Josh Stewart
+A full copy of the license may be found in the projects root directory
+*/
+/** @file
+ * Cooperative scheduler for the periodic work of the main loop, see taskScheduler.h
+ */
+#include "globals.h"
+#include "taskScheduler.h"
+#include "profiler.h"
+
+static task_t tasks[TASK_MAX]; //Sorted by priority
+static uint8_t taskCount = 0;
+
+/** Remove all of the registered tasks */
+void clearTasks(void)
+{
+  taskCount = 0;
+}
+
+/**
+ * Add a task to the scheduler
+ * @param name Name of the task in the stats. Must be a flash string, ie F("name")
+ * @param callback The function that performs the work of the task
+ * @param rate The BIT_TIMER_* flag the task runs on, or TASK_EVERY_LOOP
+ * @param priority Tasks that are due in the same pass of the main loop run in order of priority, lowest value first
+ * @param section The profileSection_t that the run time of the task counts towards
+ * @return false if the scheduler is full
+ */
+bool registerTask(const __FlashStringHelper *name, void (*callback)(void), uint8_t rate, uint8_t priority, uint8_t section)
+{
+  if(taskCount >= TASK_MAX) { return false; }
+
+  //Insert after all of the tasks with the same or higher priority so that tasks with equal priority keep their registration order
+  uint8_t position = taskCount;
+  while( (position > 0U) && (tasks[position - 1U].priority > priority) )
+  {
+    tasks[position] = tasks[position - 1U];
+    position--;
+  }
+
+  task_t &task = tasks[position];
+  task.callback = callback;
+  task.name = name;
+  task.rate = rate;
+  task.priority = priority;
+  task.section = section;
+  task.lastStart = 0;
+  task.runtimeAverage = 0;
+  task.runtimeMax = 0;
+  task.jitterMax = 0;
+  task.overruns = 0;
+  taskCount++;
+  return true;
+}
+
+/** The period of a task rate in uS. 0 for TASK_EVERY_LOOP */
+uint32_t taskPeriod(uint8_t rate)
+{
+  switch(rate)
+  {
+    case BIT_TIMER_1KHZ:  return 1000UL;
+    case BIT_TIMER_200HZ: return 5000UL;
+    case BIT_TIMER_30HZ:  return 33000UL;
+    case BIT_TIMER_15HZ:  return 66000UL;
+    case BIT_TIMER_10HZ:  return 100000UL;
+    case BIT_TIMER_4HZ:   return 250000UL;
+    case BIT_TIMER_1HZ:   return 1000000UL;
+    default:              return 0;
+  }
+}
+
+static inline uint16_t saturate16(uint32_t value)
+{
+  return (value > UINT16_MAX) ? UINT16_MAX : (uint16_t)value;
+}
+
+/**
+ * Run all of the tasks that are due
+ * @param timerFlags The BIT_TIMER_* flags that have been set by the timer since the last call (LOOP_TIMER)
+ */
+void runTasks(uint8_t timerFlags)
+{
+  for(uint8_t x = 0; x < taskCount; x++)
+  {
+    task_t &task = tasks[x];
+    if( (task.rate != TASK_EVERY_LOOP) && (BIT_CHECK(timerFlags, task.rate) == false) ) { continue; }
+
+    uint32_t startTime = micros();
+    uint32_t period = taskPeriod(task.rate);
+    if( (period > 0U) && (task.lastStart != 0U) )
+    {
+      uint32_t interval = startTime - task.lastStart;
+      uint32_t jitter = (interval > period) ? (interval - period) : (period - interval);
+      if(jitter > task.jitterMax) { task.jitterMax = saturate16(jitter); }
+      if(interval > (period + (period >> 1))) { task.overruns++; }
+    }
+    task.lastStart = startTime;
+
+    task.callback();
+
+    uint16_t runtime = saturate16(micros() - startTime);
+    if(runtime > task.runtimeMax) { task.runtimeMax = runtime; }
+    task.runtimeAverage = (uint16_t)((((uint32_t)task.runtimeAverage * 7U) + runtime) >> 3);
+    profileAdd(task.section, runtime);
+  }
+}
+
+uint8_t getTaskCount(void)
+{
+  return taskCount;
+}
+
+const task_t* getTask(uint8_t index)
+{
+  if(index >= taskCount) { return nullptr; }
+  return &tasks[index];
+}
+
+/** Clear the maximums and overrun counts of all tasks. The averages are kept */
+void resetTaskStats(void)
+{
+  for(uint8_t x = 0; x < taskCount; x++)
+  {
+    tasks[x].lastStart = 0;
+    tasks[x].runtimeMax = 0;
+    tasks[x].jitterMax = 0;
+    tasks[x].overruns = 0;
+  }
+}
@@ -0,0 +1,43 @@
+/** \file taskScheduler.h
+ * @brief Cooperative scheduler for the periodic work of the main loop
+ *
+ * Each subsystem registers its periodic work as a task with registerTask(), giving the rate it runs at and a priority. The rates are the BIT_TIMER_* flags
+ * that the 1ms timer interrupt sets, so the release times of the tasks are as deterministic as the timer itself. TASK_EVERY_LOOP tasks run on every pass of the main loop.
+ *
+ * runTasks() is called once per pass of the main loop with the timer flags that have been set since the last pass. It runs every task that is due, highest priority
+ * (Lowest value) first. Tasks with the same priority run in the order they were registered. Tasks are never pre-empted, so a slow task delays every task after it.
+ *
+ * The run time of every task is measured, along with the jitter of its start time and the number of releases it missed (overruns), so that the task that is
+ * taking the loop time can be found. The stats are sent by the 'y' serial command. The run time is also added to the loop profiler section of the task.
+ */
+#ifndef TASKSCHEDULER_H
+#define TASKSCHEDULER_H
+
+#include <Arduino.h>
+
+#define TASK_MAX          28U /**< Maximum number of tasks that can be registered */
+#define TASK_EVERY_LOOP   0xFFU /**< Rate for a task that runs on every pass of the main loop */
+
+struct task_t
+{
+  void (*callback)(void);
+  const __FlashStringHelper *name;
+  uint8_t rate; /**< The BIT_TIMER_* flag that releases the task, or TASK_EVERY_LOOP */
+  uint8_t priority; /**< Lower values run first */
+  uint8_t section; /**< The profileSection_t the run time of the task is added to */
+  uint32_t lastStart; /**< micros() at the last start of the task, 0 if it has not run since the stats were reset */
+  uint16_t runtimeAverage; /**< uS, exponential average */
+  uint16_t runtimeMax; /**< uS */
+  uint16_t jitterMax; /**< uS. Largest difference between the time from one start to the next and the period of the task */
+  uint16_t overruns; /**< Number of times the task started more than half a period late, ie a release was missed */
+};
+
+void clearTasks(void);
+bool registerTask(const __FlashStringHelper *name, void (*callback)(void), uint8_t rate, uint8_t priority, uint8_t section);
+void runTasks(uint8_t timerFlags);
+uint32_t taskPeriod(uint8_t rate);
+uint8_t getTaskCount(void);
+const task_t* getTask(uint8_t index);
+void resetTaskStats(void);
+
+#endif
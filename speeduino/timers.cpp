@@ -18,8 +18,10 @@ Timers are typically low resolution (Compared to Schedulers), with maximum frequ
 #include "speeduino.h"
 #include "scheduler.h"
 #include "auxiliaries.h"
+#include "idle.h"
 #include "comms.h"
 #include "maths.h"
+#include "softPWM.h"
 
 #if defined(CORE_AVR)
   #include <avr/wdt.h>
@@ -39,6 +41,10 @@ volatile uint8_t tachoEndTime; //The time (in ms) that the tacho pulse needs to
 volatile TachoOutputStatus tachoOutputFlag;
 volatile uint16_t tachoSweepIncr;
 volatile uint16_t tachoSweepAccum;
+#if defined(USE_SOFT_PWM)
+  static volatile uint16_t tachoPulseTicks; //The length of each tacho pulse in soft PWM timer ticks
+  static volatile uint16_t tachoPeriodTicks; //The shortest time between the starts of 2 tacho pulses in soft PWM timer ticks
+#endif
 volatile uint8_t testInjectorPulseCount = 0;
 volatile uint8_t testIgnitionPulseCount = 0;
 
@@ -56,13 +62,60 @@ void initialiseTimers(void)
   loop250ms = 0;
   loopSec = 0;
   tachoOutputFlag = TACHO_INACTIVE;
+#if defined(USE_SOFT_PWM)
+  tachoPulseTicks = 0;
+  tachoPeriodTicks = 0;
+#endif
 }
 
-static inline void applyOverDwellCheck(IgnitionSchedule &schedule, uint32_t targetOverdwellTime) {
-  //Check first whether each spark output is currently on. Only check it's dwell time if it is
-  if ((schedule.Status == RUNNING) && (schedule.startTime < targetOverdwellTime)) { 
-    schedule.pEndCallback(); schedule.Status = OFF; 
+/** Start a tacho pulse. Called by the ignition outputs when the tacho is in fixed duration mode and by the power on sweep.
+ * With the soft PWM engine the pulse is timed by the soft PWM timer (See updateTachoPulse()), otherwise it is flagged to be started and ended by the 1ms interval.
+ */
+void tachoPulse(void)
+{
+#if defined(USE_SOFT_PWM)
+  //Check for half speed tacho
+  if( (configPage2.tachoDiv != TACHO_DIV_HALF) || (currentStatus.tachoAlt == true) )
+  {
+    softPWMPulse(AUX_PWM_TACHO, tachoPulseTicks, tachoPeriodTicks, ((configPage2.tachoDiv == TACHO_DIV_DOUBLE) ? 2U : 1U) );
   }
+  currentStatus.tachoAlt = !currentStatus.tachoAlt; //Flip the alternating value in case half speed tacho is in use.
+#else
+  tachoOutputFlag = READY;
+#endif
+}
+
+/** Work out the length of the tacho pulses and the time between them from the current RPM.
+ * The pulse is the configured duration, but is limited to half of the time between pulses so that pulses never merge together at high RPM.
+ * Does nothing without the soft PWM engine, as the pulses are then timed by the 1ms interval.
+ */
+void updateTachoPulse(void)
+{
+#if defined(USE_SOFT_PWM)
+  uint32_t pulseTime = (uint32_t)configPage2.tachoDuration * 1000UL;
+  uint32_t periodTime = pulseTime * 2UL; //Engine not running, pulses can run at up to 50% duty
+  if( (currentStatus.RPM > 0U) && (configPage2.nCylinders > 0U) )
+  {
+    //Time between ignition events. 2 stroke engines fire every cylinder on each revolution
+    if(configPage2.strokes == TWO_STROKE) { periodTime = revolutionTime / configPage2.nCylinders; }
+    else { periodTime = (revolutionTime * 2UL) / configPage2.nCylinders; }
+    if(configPage2.tachoDiv == TACHO_DIV_HALF) { periodTime = periodTime * 2UL; }
+    else if(configPage2.tachoDiv == TACHO_DIV_DOUBLE) { periodTime = periodTime / 2UL; }
+  }
+  else if( (currentStatus.tachoSweepEnabled == true) && (tachoSweepIncr > 0U) ) { periodTime = MICROS_PER_SEC / tachoSweepIncr; } //Time between pulses at the top of the power on sweep
+  if(pulseTime > (periodTime / 2UL)) { pulseTime = periodTime / 2UL; }
+
+  //Periods must be less than 32768 ticks. The period only matters when a pulse is requested before the previous one has finished
+  uint32_t periodTicks = uS_TO_SOFT_PWM_TICKS(periodTime);
+  if(periodTicks > INT16_MAX) { periodTicks = INT16_MAX; }
+  uint32_t pulseTicks = uS_TO_SOFT_PWM_TICKS(pulseTime);
+  if(pulseTicks > INT16_MAX) { pulseTicks = INT16_MAX; }
+
+  noInterrupts();
+  tachoPulseTicks = (uint16_t)pulseTicks;
+  tachoPeriodTicks = (uint16_t)periodTicks;
+  interrupts();
+#endif
 }
 
 //Timer2 Overflow Interrupt Vector, called when the timer overflows.
@@ -85,34 +138,7 @@ void oneMSInterval(void) //Most ARM chips can simply call a function
   loop250ms++;
   loopSec++;
 
-  //Overdwell check
-  uint32_t targetOverdwellTime = micros() - dwellLimit_uS; //Set a target time in the past that all coil charging must have begun after. If the coil charge began before this time, it's been running too long
-  bool isCrankLocked = configPage4.ignCranklock && (currentStatus.RPM < currentStatus.crankRPM); //Dwell limiter is disabled during cranking on setups using the locked cranking timing. WE HAVE to do the RPM check here as relying on the engine cranking bit can be potentially too slow in updating
-  if ((configPage4.useDwellLim == 1) && (isCrankLocked != true)) 
-  {
-    applyOverDwellCheck(ignitionSchedule1, targetOverdwellTime);
-#if IGN_CHANNELS >= 2
-    applyOverDwellCheck(ignitionSchedule2, targetOverdwellTime);
-#endif
-#if IGN_CHANNELS >= 3
-    applyOverDwellCheck(ignitionSchedule3, targetOverdwellTime);
-#endif
-#if IGN_CHANNELS >= 4
-    applyOverDwellCheck(ignitionSchedule4, targetOverdwellTime);
-#endif
-#if IGN_CHANNELS >= 5
-    applyOverDwellCheck(ignitionSchedule5, targetOverdwellTime);
-#endif
-#if IGN_CHANNELS >= 6
-    applyOverDwellCheck(ignitionSchedule6, targetOverdwellTime);
-#endif
-#if IGN_CHANNELS >= 7
-    applyOverDwellCheck(ignitionSchedule7, targetOverdwellTime);
-#endif
-#if IGN_CHANNELS >= 8
-    applyOverDwellCheck(ignitionSchedule8, targetOverdwellTime);
-#endif
-  }
+  idleStepperInterrupt(); //Stepper idle steps are timed to the ms
 
   //Tacho is flagged as being ready for a pulse by the ignition outputs, or the sweep interval upon startup
 
@@ -129,17 +155,18 @@ void oneMSInterval(void) //Most ARM chips can simply call a function
       // Each time it rolls over, it's time to pulse the Tach
       if( tachoSweepAccum >= MS_PER_SEC ) 
       {  
-        tachoOutputFlag = READY;
+        tachoPulse();
         tachoSweepAccum -= MS_PER_SEC;
       }
     }
   }
 
+#if !defined(USE_SOFT_PWM) //The soft PWM engine times the tacho pulses
   //Tacho output check. This code will not do anything if tacho pulse duration is fixed to coil dwell.
   if(tachoOutputFlag == READY)
   {
     //Check for half speed tacho
-    if( (configPage2.tachoDiv == 0) || (currentStatus.tachoAlt == true) ) 
+    if( (configPage2.tachoDiv != TACHO_DIV_HALF) || (currentStatus.tachoAlt == true) ) 
     { 
       TACHO_PULSE_LOW();
       //ms_counter is cast down to a byte as the tacho duration can only be in the range of 1-6, so no extra resolution above that is required
@@ -162,6 +189,7 @@ void oneMSInterval(void) //Most ARM chips can simply call a function
       tachoOutputFlag = TACHO_INACTIVE;
     }
   }
+#endif
 
   //200Hz loop
   if (loop5ms == 5)
@@ -262,12 +290,6 @@ void oneMSInterval(void) //Most ARM chips can simply call a function
     //increment secl (secl is simply a counter that increments every second and is used to track whether the system has unexpectedly reset
     currentStatus.secl++;
     //**************************************************************************************************************************************************
-    //Check the fan output status
-    if (configPage2.fanEnable >= 1)
-    {
-       fanControl();            // Function to turn the cooling fan on/off
-    }
-
     //Check whether fuel pump priming is complete
     if(currentStatus.fpPrimed == false)
     {
@@ -284,46 +306,8 @@ void oneMSInterval(void) //Most ARM chips can simply call a function
       }
     }
     //**************************************************************************************************************************************************
-    //Set the flex reading (if enabled). The flexCounter is updated with every pulse from the sensor. If cleared once per second, we get a frequency reading
-    if(configPage2.flexEnabled == true)
-    {
-      byte tempEthPct = 0; 
-      if(flexCounter < 50)
-      {
-        tempEthPct = 0; //Standard GM Continental sensor reads from 50Hz (0 ethanol) to 150Hz (Pure ethanol). Subtracting 50 from the frequency therefore gives the ethanol percentage.
-        flexCounter = 0;
-      }
-      else if (flexCounter > 151) //1 pulse buffer
-      {
-
-        if(flexCounter < 169)
-        {
-          tempEthPct = 100;
-          flexCounter = 0;
-        }
-        else
-        {
-          //This indicates an error condition. Spec of the sensor is that errors are above 170Hz)
-          tempEthPct = 0;
-          flexCounter = 0;
-        }
-      }
-      else
-      {
-        tempEthPct = flexCounter - 50; //Standard GM Continental sensor reads from 50Hz (0 ethanol) to 150Hz (Pure ethanol). Subtracting 50 from the frequency therefore gives the ethanol percentage.
-        flexCounter = 0;
-      }
-
-      //Off by 1 error check
-      if (tempEthPct == 1) { tempEthPct = 0; }
-
-      currentStatus.ethanolPct = ADC_FILTER(tempEthPct, configPage4.FILTER_FLEX, currentStatus.ethanolPct);
-
-      //Continental flex sensor fuel temperature can be read with following formula: (Temperature = (41.25 * pulse width(ms)) - 81.25). 1000μs = -40C and 5000μs = 125C
-      if(flexPulseWidth > 5000) { flexPulseWidth = 5000; }
-      else if(flexPulseWidth < 1000) { flexPulseWidth = 1000; }
-      currentStatus.fuelTemp = div100( (int16_t)(((4224 * (long)flexPulseWidth) >> 10) - 8125) );
-    }
+    //Set the flex reading (if enabled). The period and pulse width of the sensor are captured on every pulse and filtered here
+    if(configPage2.flexEnabled == true) { readFlex(); }
 
   }
 
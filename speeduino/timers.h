@@ -27,6 +27,11 @@ Hence we will preload the timer with 131 cycles to leave 125 until overflow (1ms
 #define TACHO_PULSE_LOW() *tach_pin_port &= ~(tach_pin_mask)
 enum TachoOutputStatus {TACHO_INACTIVE, READY, ACTIVE}; //The 3 statuses that the tacho output pulse can have. NOTE: Cannot just use 'INACTIVE' as this is already defined within the Teensy Libs
 
+//Values of configPage2.tachoDiv
+#define TACHO_DIV_NORMAL  0
+#define TACHO_DIV_HALF    1
+#define TACHO_DIV_DOUBLE  2 //Only available with the scheduled tacho (USE_SOFT_PWM), otherwise this is the same as normal speed
+
 extern volatile TachoOutputStatus tachoOutputFlag;
 extern volatile bool tachoSweepEnabled;
 extern volatile uint16_t tachoSweepIncr;
@@ -44,5 +49,7 @@ extern volatile unsigned int dwellLimit_uS;
   void oneMSInterval(void);
 #endif
 void initialiseTimers(void);
+void tachoPulse(void);
+void updateTachoPulse(void);
 
 #endif // TIMERS_H
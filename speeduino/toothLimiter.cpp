@@ -0,0 +1,72 @@
+/*
+Speeduino - Simple engine management for the Arduino Mega 2560 platform
+Copyright (C) Josh Stewart
+A full copy of the license may be found in the projects root directory
+*/
+/** @file
+ * Per tooth hard rev limiter, see toothLimiter.h
+ */
+#include "toothLimiter.h"
+
+#define TOOTH_LIMITER_US_PER_DEG_1_RPM 166667UL //uS per degree at 1 RPM, the same as MICROS_PER_DEG_1_RPM. Repeated here so that this file can be tested natively
+
+//These are only changed with interrupts disabled
+static volatile uint32_t limitCutPeriod = 0; //uS. 0 when the limiter is off
+static volatile uint32_t limitResumePeriod = 0; //uS
+static volatile uint16_t limitToothAngle = 0; //The tooth angle the periods were calculated for
+static volatile bool limiterActive = false;
+
+/**
+ * The period of a tooth at an RPM
+ * @param limitRPM The RPM. 0 gives 0, which turns the limiter off
+ * @param toothAngle Degrees per tooth
+ * @return The period in uS
+ */
+uint32_t toothLimiterPeriod(uint16_t limitRPM, uint16_t toothAngle)
+{
+  if(limitRPM == 0U) { return 0; }
+  return (TOOTH_LIMITER_US_PER_DEG_1_RPM * toothAngle) / limitRPM;
+}
+
+/**
+ * Set the periods that the teeth are compared against. Must be called with interrupts disabled
+ * @param cutPeriod Teeth shorter than this start the cut. 0 turns the limiter off and ends any cut
+ * @param resumePeriod Teeth longer than this end the cut
+ * @param toothAngle The tooth angle the periods were calculated for
+ */
+void toothLimiterSet(uint32_t cutPeriod, uint32_t resumePeriod, uint16_t toothAngle)
+{
+  limitCutPeriod = cutPeriod;
+  limitResumePeriod = resumePeriod;
+  limitToothAngle = toothAngle;
+  if(cutPeriod == 0U) { limiterActive = false; }
+}
+
+/**
+ * Check a primary tooth. Must only be called from the primary trigger interrupt
+ * @param toothGap uS since the previous tooth
+ * @param toothAngle Degrees since the previous tooth
+ * @return true on the tooth that starts a cut. The caller must then cut the pending events
+ */
+bool toothLimiterTooth(uint32_t toothGap, uint16_t toothAngle)
+{
+  if( (limitCutPeriod == 0U) || (toothAngle != limitToothAngle) ) { return false; }
+
+  if(limiterActive == true)
+  {
+    if(toothGap > limitResumePeriod) { limiterActive = false; }
+    return false;
+  }
+  if(toothGap < limitCutPeriod)
+  {
+    limiterActive = true;
+    return true;
+  }
+  return false;
+}
+
+/** Whether a cut started by toothLimiterTooth() is being held */
+bool toothLimiterActive(void)
+{
+  return limiterActive;
+}
@@ -0,0 +1,26 @@
+/** \file toothLimiter.h
+ * @brief Per tooth hard rev limiter
+ *
+ * The main loop limiter only sees the RPM of the last revolution and only acts on the next pass of the loop, so a fast revving engine can overshoot it by a long way when the loop is slow.
+ * This limiter instead compares the period of every primary tooth against the period a tooth takes at the limit. The periods are calculated by the main loop whenever
+ * the limit changes (toothLimiterPeriod() and toothLimiterSet()), so the primary trigger interrupt only does one comparison per tooth. As soon as a tooth is shorter than the
+ * cut period, toothLimiterTooth() returns true once and the caller cuts the pending events. The overshoot is then at most one tooth.
+ *
+ * The cut is held until a tooth is longer than the resume period, which is TOOTH_LIMITER_HYSTERESIS below the limit. While the cut is held the main loop treats it the same as its own full cut.
+ *
+ * Only teeth whose angle is known to be correct and matches the angle the periods were calculated for may be checked. The missing tooth gaps and the irregular teeth of some
+ * patterns would otherwise look slower than the real RPM.
+ */
+#ifndef TOOTHLIMITER_H
+#define TOOTHLIMITER_H
+
+#include <stdint.h>
+
+#define TOOTH_LIMITER_HYSTERESIS 100U /**< RPM below the limit that the RPM must drop to before the cut ends */
+
+uint32_t toothLimiterPeriod(uint16_t limitRPM, uint16_t toothAngle);
+void toothLimiterSet(uint32_t cutPeriod, uint32_t resumePeriod, uint16_t toothAngle);
+bool toothLimiterTooth(uint32_t toothGap, uint16_t toothAngle);
+bool toothLimiterActive(void);
+
+#endif
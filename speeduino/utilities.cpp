@@ -20,7 +20,7 @@
 uint8_t ioDelay[sizeof(configPage13.outputPin)];
 uint8_t ioOutDelay[sizeof(configPage13.outputPin)];
 uint8_t pinIsValid = 0;
-uint8_t currentRuleStatus = 0;
+uint16_t currentRuleStatus = 0;
 
 
 /** Translate between the pin list that appears in TS and the actual pin numbers.
@@ -121,6 +121,210 @@ void setResetControlPinState(void)
 }
 
 //*********************************************************************************************************************************************************************************
+/*
+The rules on page 13 are compiled into ioProgram when the page changes, rather than being interpreted on every call of checkProgrammableIO().
+Only the active rules are in the program, the data inputs are resolved to direct reads of currentStatus where possible and a rule that uses the
+result of another rule (Cascaded rules) is placed after it so that it sees the result from the same pass.
+*/
+#define IO_OPERAND_NONE         0 //Always 0. Used for an invalid rule reference
+#define IO_OPERAND_LOG          1 //Any entry of the log block that is not a plain copy of a currentStatus field, read with ProgrammableIOGetData()
+#define IO_OPERAND_RULE         2 //Result of another rule
+#define IO_OPERAND_BYTE         3
+#define IO_OPERAND_WORD         4 //uint16_t or int16_t
+#define IO_OPERAND_INT          5
+#define IO_OPERAND_LONG         6
+#define IO_OPERAND_TEMPERATURE  7 //int, with the same offset and truncation to a byte as the log entry
+
+struct ioOperand
+{
+  const volatile void *source; ///< Field in currentStatus for the direct operand types
+  int16_t target; ///< Value the data is compared to
+  uint8_t type; ///< IO_OPERAND_*
+  uint8_t comparator; ///< COMPARATOR_*
+  uint8_t index; ///< Log entry for IO_OPERAND_LOG, rule number for IO_OPERAND_RULE
+};
+
+struct ioRule
+{
+  ioOperand first;
+  ioOperand second;
+  uint8_t bitwise; ///< BITWISE_*. BITWISE_DISABLED if there is no valid second check
+  uint8_t output; ///< Rule number, used for the output and timer state
+};
+
+static_assert(sizeof(configPage13.outputPin) <= PROGRAMMABLE_IO_MAX_RULES, "Page 13 has more rules than the compiled program can hold");
+
+static ioRule ioProgram[PROGRAMMABLE_IO_MAX_RULES];
+static uint8_t ioProgramLength = 0;
+static bool ioProgramValid = false;
+
+/** The rule number of a data input that references another rule (REUSE_RULES + rule), or PROGRAMMABLE_IO_MAX_RULES if it is not a rule reference */
+static inline uint8_t ioReferencedRule(uint8_t dataIn)
+{
+  if( (dataIn >= REUSE_RULES) && ((uint8_t)(dataIn - REUSE_RULES) < sizeof(configPage13.outputPin)) ) { return dataIn - REUSE_RULES; }
+  return PROGRAMMABLE_IO_MAX_RULES;
+}
+
+/** Resolve a data input to the currentStatus field that its log entry is a plain copy of. Entries that are calculated are left as IO_OPERAND_LOG */
+static void ioResolveData(ioOperand &operand, uint8_t dataIn)
+{
+  operand.type = IO_OPERAND_BYTE;
+  operand.index = dataIn;
+  switch(dataIn)
+  {
+    case 0: operand.source = &currentStatus.secl; break;
+    case 4: operand.source = &currentStatus.MAP; operand.type = IO_OPERAND_LONG; break;
+    case 6: operand.source = &currentStatus.IAT; operand.type = IO_OPERAND_TEMPERATURE; break;
+    case 7: operand.source = &currentStatus.coolant; operand.type = IO_OPERAND_TEMPERATURE; break;
+    case 9: operand.source = &currentStatus.battery10; break;
+    case 10: operand.source = &currentStatus.O2; break;
+    case 14: operand.source = &currentStatus.RPM; operand.type = IO_OPERAND_WORD; break;
+    case 21: operand.source = &currentStatus.afrTarget; break;
+    case 22: operand.source = &currentStatus.tpsDOT; operand.type = IO_OPERAND_WORD; break;
+    case 24: operand.source = &currentStatus.advance; break; //Read as a byte, the same as the log entry
+    case 25: operand.source = &currentStatus.TPS; break;
+    case 33: operand.source = &currentStatus.rpmDOT; operand.type = IO_OPERAND_INT; break;
+    case 35: operand.source = &currentStatus.ethanolPct; break;
+    case 38: operand.source = &currentStatus.idleLoad; break;
+    case 40: operand.source = &currentStatus.O2_2; break;
+    case 41: operand.source = &currentStatus.baro; break;
+    case 86: operand.source = &currentStatus.fuelLoad; operand.type = IO_OPERAND_WORD; break;
+    case 88: operand.source = &currentStatus.ignLoad; operand.type = IO_OPERAND_WORD; break;
+    case 90: operand.source = &currentStatus.dwell; operand.type = IO_OPERAND_WORD; break;
+    case 95: operand.source = &currentStatus.vvt1Angle; operand.type = IO_OPERAND_WORD; break;
+    case 102: operand.source = &currentStatus.VE; break;
+    case 104: operand.source = &currentStatus.vss; operand.type = IO_OPERAND_WORD; break;
+    case 106: operand.source = &currentStatus.gear; break;
+    case 107: operand.source = &currentStatus.fuelPressure; break;
+    case 108: operand.source = &currentStatus.oilPressure; break;
+    default:
+      if( (dataIn >= 42U) && (dataIn <= 72U) && ((dataIn & 1U) == 0U) ) //CAN inputs
+      {
+        operand.source = &currentStatus.canin[(dataIn - 42U) >> 1];
+        operand.type = IO_OPERAND_WORD;
+      }
+      else
+      {
+        operand.source = nullptr;
+        operand.type = IO_OPERAND_LOG;
+      }
+      break;
+  }
+}
+
+static void ioCompileOperand(ioOperand &operand, uint8_t dataIn, int16_t target, uint8_t comparator)
+{
+  operand.target = target;
+  operand.comparator = comparator;
+  uint8_t rule = ioReferencedRule(dataIn);
+  if(rule < PROGRAMMABLE_IO_MAX_RULES)
+  {
+    operand.type = IO_OPERAND_RULE;
+    operand.index = rule;
+    operand.source = nullptr;
+  }
+  else if(dataIn >= REUSE_RULES)
+  {
+    operand.type = IO_OPERAND_NONE;
+    operand.source = nullptr;
+  }
+  else { ioResolveData(operand, dataIn); }
+}
+
+/** Compile the rules on page 13 into ioProgram. Called from checkProgrammableIO() after the page has changed */
+static void compileProgrammableIO(void)
+{
+  uint16_t compiled = 0; //Bit for each rule that is in the program, or is not active
+  uint8_t rules = sizeof(configPage13.outputPin);
+
+  for(uint8_t y = 0; y < rules; y++)
+  {
+    if( (configPage13.outputPin[y] == 0U) || !BIT_CHECK(pinIsValid, y) ) { BIT_SET(compiled, y); }
+  }
+
+  ioProgramLength = 0;
+  while(ioProgramLength < rules)
+  {
+    //Add the first rule that does not reference a rule that is still to be added. If there is a loop of references, the first remaining rule is added and sees the other results from the previous pass
+    uint8_t next = rules;
+    uint8_t fallback = rules;
+    for(uint8_t y = 0; y < rules; y++)
+    {
+      if(BIT_CHECK(compiled, y)) { continue; }
+      if(fallback == rules) { fallback = y; }
+      uint8_t firstRule = ioReferencedRule(configPage13.firstDataIn[y]);
+      uint8_t secondRule = (configPage13.operation[y].bitwise != BITWISE_DISABLED) ? ioReferencedRule(configPage13.secondDataIn[y]) : PROGRAMMABLE_IO_MAX_RULES;
+      bool firstReady = (firstRule >= rules) || (firstRule == y) || BIT_CHECK(compiled, firstRule);
+      bool secondReady = (secondRule >= rules) || (secondRule == y) || BIT_CHECK(compiled, secondRule);
+      if(firstReady && secondReady)
+      {
+        next = y;
+        break;
+      }
+    }
+    if(next == rules) { next = fallback; }
+    if(next == rules) { break; } //All done
+
+    ioRule &rule = ioProgram[ioProgramLength];
+    rule.output = next;
+    ioCompileOperand(rule.first, configPage13.firstDataIn[next], configPage13.firstTarget[next], configPage13.operation[next].firstCompType);
+    rule.bitwise = configPage13.operation[next].bitwise;
+    //A second data input that is past the rule references disables the second check
+    if( (rule.bitwise != BITWISE_DISABLED) && (configPage13.secondDataIn[next] <= (REUSE_RULES + sizeof(configPage13.outputPin))) )
+    {
+      ioCompileOperand(rule.second, configPage13.secondDataIn[next], configPage13.secondTarget[next], configPage13.operation[next].secondCompType);
+    }
+    else { rule.bitwise = BITWISE_DISABLED; }
+
+    BIT_SET(compiled, next);
+    ioProgramLength++;
+  }
+  ioProgramValid = true;
+}
+
+/** Called when page 13 is changed so that the rules are compiled again before they are next checked */
+void programmableIOChanged(void)
+{
+  ioProgramValid = false;
+}
+
+static int16_t ioOperandData(const ioOperand &operand)
+{
+  int16_t data;
+  switch(operand.type)
+  {
+    case IO_OPERAND_BYTE: data = *(const volatile uint8_t *)operand.source; break;
+    case IO_OPERAND_WORD: data = (int16_t)*(const volatile uint16_t *)operand.source; break;
+    case IO_OPERAND_INT: data = (int16_t)*(const volatile int *)operand.source; break;
+    case IO_OPERAND_LONG: data = (int16_t)*(const volatile long *)operand.source; break;
+    case IO_OPERAND_TEMPERATURE: data = (int16_t)lowByte(*(const volatile int *)operand.source + CALIBRATION_TEMPERATURE_OFFSET) - CALIBRATION_TEMPERATURE_OFFSET; break;
+    case IO_OPERAND_RULE: data = BIT_CHECK(currentRuleStatus, operand.index); break;
+    case IO_OPERAND_LOG: data = ProgrammableIOGetData(operand.index); break;
+    default: data = 0; break;
+  }
+  return data;
+}
+
+static bool ioOperandCheck(const ioOperand &operand)
+{
+  int16_t data = ioOperandData(operand);
+  int16_t target = operand.target;
+  bool check;
+  switch(operand.comparator)
+  {
+    case COMPARATOR_EQUAL: check = (data == target); break;
+    case COMPARATOR_NOT_EQUAL: check = (data != target); break;
+    case COMPARATOR_GREATER: check = (data > target); break;
+    case COMPARATOR_GREATER_EQUAL: check = (data >= target); break;
+    case COMPARATOR_LESS: check = (data < target); break;
+    case COMPARATOR_LESS_EQUAL: check = (data <= target); break;
+    case COMPARATOR_AND: check = ((data & target) != 0); break;
+    case COMPARATOR_XOR: check = ((data ^ target) != 0); break;
+    default: check = false; break;
+  }
+  return check;
+}
+
 void initialiseProgrammableIO(void)
 {
   uint8_t outputPin;
@@ -146,112 +350,69 @@ void initialiseProgrammableIO(void)
       else { BIT_CLEAR(pinIsValid, y); }
     }
   }
+  compileProgrammableIO();
 }
-/** Check all (8) programmable I/O:s and carry out action on output pin as needed.
- * Compare 2 (16 bit) vars in a way configured by @ref cmpOperation (see also @ref config13.operation).
- * Use ProgrammableIOGetData() to get 2 vars to compare.
- * Skip all programmable I/O:s where output pin is set 0 (meaning: not programmed).
+/** Check all of the active programmable I/O rules and carry out the action on the output pin as needed.
+ * Each rule compares 1 or 2 (16 bit) vars in a way configured by @ref cmpOperation (see also @ref config13.operation).
+ * The rules are compiled (See compileProgrammableIO()) when page 13 changes, so only the active rules are run here.
  */
 void checkProgrammableIO(void)
 {
-  int16_t data, data2;
-  uint8_t dataRequested;
-  bool firstCheck, secondCheck;
+  if(ioProgramValid == false) { compileProgrammableIO(); }
 
-  for (uint8_t y = 0; y < sizeof(configPage13.outputPin); y++)
+  for (uint8_t x = 0; x < ioProgramLength; x++)
   {
-    firstCheck = false;
-    secondCheck = false;
-    if ( BIT_CHECK(pinIsValid, y) ) //if outputPin == 0 it is disabled
+    const ioRule &rule = ioProgram[x];
+    uint8_t y = rule.output;
+    bool firstCheck = ioOperandCheck(rule.first);
+    switch(rule.bitwise)
     {
-      dataRequested = configPage13.firstDataIn[y];
-      if ( dataRequested > 239U ) //Somehow using 239 uses 9 bytes of RAM, why??
-      {
-        dataRequested -= REUSE_RULES;
-        if ( dataRequested <= sizeof(configPage13.outputPin) ) { data = BIT_CHECK(currentRuleStatus, dataRequested); }
-        else { data = 0; }
-      }
-      else { data = ProgrammableIOGetData(dataRequested); }
-      data2 = configPage13.firstTarget[y];
-
-      if ( (configPage13.operation[y].firstCompType == COMPARATOR_EQUAL) && (data == data2) ) { firstCheck = true; }
-      else if ( (configPage13.operation[y].firstCompType == COMPARATOR_NOT_EQUAL) && (data != data2) ) { firstCheck = true; }
-      else if ( (configPage13.operation[y].firstCompType == COMPARATOR_GREATER) && (data > data2) ) { firstCheck = true; }
-      else if ( (configPage13.operation[y].firstCompType == COMPARATOR_GREATER_EQUAL) && (data >= data2) ) { firstCheck = true; }
-      else if ( (configPage13.operation[y].firstCompType == COMPARATOR_LESS) && (data < data2) ) { firstCheck = true; }
-      else if ( (configPage13.operation[y].firstCompType == COMPARATOR_LESS_EQUAL) && (data <= data2) ) { firstCheck = true; }
-      else if ( (configPage13.operation[y].firstCompType == COMPARATOR_AND) && ((data & data2) != 0) ) { firstCheck = true; }
-      else if ( (configPage13.operation[y].firstCompType == COMPARATOR_XOR) && ((data ^ data2) != 0) ) { firstCheck = true; }
+      case BITWISE_AND: firstCheck &= ioOperandCheck(rule.second); break;
+      case BITWISE_OR: firstCheck |= ioOperandCheck(rule.second); break;
+      case BITWISE_XOR: firstCheck ^= ioOperandCheck(rule.second); break;
+      default: break;
+    }
 
-      if (configPage13.operation[y].bitwise != BITWISE_DISABLED)
+    //If the limiting time is active(>0) and using maximum time
+    if (BIT_CHECK(configPage13.kindOfLimiting, y))
+    {
+      if(firstCheck)
       {
-        dataRequested = configPage13.secondDataIn[y];
-        if ( dataRequested <= (REUSE_RULES + sizeof(configPage13.outputPin)) ) //Failsafe check
-        {
-          if ( dataRequested > 239U ) //Somehow using 239 uses 9 bytes of RAM, why??
-          {
-            dataRequested -= REUSE_RULES;
-            data = BIT_CHECK(currentRuleStatus, dataRequested);
-          }
-          else { data = ProgrammableIOGetData(dataRequested); }
-          data2 = configPage13.secondTarget[y];
-          
-          if ( (configPage13.operation[y].secondCompType == COMPARATOR_EQUAL) && (data == data2) ) { secondCheck = true; }
-          else if ( (configPage13.operation[y].secondCompType == COMPARATOR_NOT_EQUAL) && (data != data2) ) { secondCheck = true; }
-          else if ( (configPage13.operation[y].secondCompType == COMPARATOR_GREATER) && (data > data2) ) { secondCheck = true; }
-          else if ( (configPage13.operation[y].secondCompType == COMPARATOR_GREATER_EQUAL) && (data >= data2) ) { secondCheck = true; }
-          else if ( (configPage13.operation[y].secondCompType == COMPARATOR_LESS) && (data < data2) ) { secondCheck = true; }
-          else if ( (configPage13.operation[y].secondCompType == COMPARATOR_LESS_EQUAL) && (data <= data2) ) { secondCheck = true; }
-          else if ( (configPage13.operation[y].secondCompType == COMPARATOR_AND) && ((data & data2) != 0) ) { secondCheck = true; }
-          else if ( (configPage13.operation[y].secondCompType == COMPARATOR_XOR) && ((data ^ data2) != 0) ) { secondCheck = true; }
-
-          if (configPage13.operation[y].bitwise == BITWISE_AND) { firstCheck &= secondCheck; }
-          if (configPage13.operation[y].bitwise == BITWISE_OR) { firstCheck |= secondCheck; }
-          if (configPage13.operation[y].bitwise == BITWISE_XOR) { firstCheck ^= secondCheck; }
-        }
+        if ((configPage13.outputTimeLimit[y] != 0) && (ioOutDelay[y] >= configPage13.outputTimeLimit[y])) { firstCheck = false; } //Time has counted, disable the output
       }
-
-      //If the limiting time is active(>0) and using maximum time
-      if (BIT_CHECK(configPage13.kindOfLimiting, y))
+      else
       {
-        if(firstCheck)
-        {
-          if ((configPage13.outputTimeLimit[y] != 0) && (ioOutDelay[y] >= configPage13.outputTimeLimit[y])) { firstCheck = false; } //Time has counted, disable the output
-        }
-        else
-        {
-          //Released before Maximum time, set delay to maximum to flip the output next
-          if(BIT_CHECK(currentStatus.outputsStatus, y)) { ioOutDelay[y] = configPage13.outputTimeLimit[y]; }
-          else { ioOutDelay[y] = 0; } //Reset the counter for next time
-        }
+        //Released before Maximum time, set delay to maximum to flip the output next
+        if(BIT_CHECK(currentStatus.outputsStatus, y)) { ioOutDelay[y] = configPage13.outputTimeLimit[y]; }
+        else { ioOutDelay[y] = 0; } //Reset the counter for next time
       }
+    }
 
-      if ( (firstCheck == true) && (configPage13.outputDelay[y] < 255) )
+    if ( (firstCheck == true) && (configPage13.outputDelay[y] < 255) )
+    {
+      if (ioDelay[y] >= configPage13.outputDelay[y])
       {
-        if (ioDelay[y] >= configPage13.outputDelay[y])
-        {
-          bool bitStatus = BIT_CHECK(configPage13.outputInverted, y) ^ firstCheck;
-          if (BIT_CHECK(currentStatus.outputsStatus, y) && (ioOutDelay[y] < configPage13.outputTimeLimit[y])) { ioOutDelay[y]++; }
-          if (configPage13.outputPin[y] < 128) { digitalWrite(configPage13.outputPin[y], bitStatus); }
-          else { BIT_WRITE(currentRuleStatus, y, bitStatus); }
-          BIT_WRITE(currentStatus.outputsStatus, y, bitStatus);
-        }
-        else { ioDelay[y]++; }
+        bool bitStatus = BIT_CHECK(configPage13.outputInverted, y) ^ firstCheck;
+        if (BIT_CHECK(currentStatus.outputsStatus, y) && (ioOutDelay[y] < configPage13.outputTimeLimit[y])) { ioOutDelay[y]++; }
+        if (configPage13.outputPin[y] < 128) { digitalWrite(configPage13.outputPin[y], bitStatus); }
+        else { BIT_WRITE(currentRuleStatus, y, bitStatus); }
+        BIT_WRITE(currentStatus.outputsStatus, y, bitStatus);
       }
-      else
+      else { ioDelay[y]++; }
+    }
+    else
+    {
+      if (ioOutDelay[y] >= configPage13.outputTimeLimit[y])
       {
-        if (ioOutDelay[y] >= configPage13.outputTimeLimit[y])
-        {
-          bool bitStatus = BIT_CHECK(configPage13.outputInverted, y) ^ firstCheck;
-          if (configPage13.outputPin[y] < 128) { digitalWrite(configPage13.outputPin[y], bitStatus); }
-          else { BIT_WRITE(currentRuleStatus, y, bitStatus); }
-          BIT_WRITE(currentStatus.outputsStatus, y, bitStatus);
-          if(!BIT_CHECK(configPage13.kindOfLimiting, y)) { ioOutDelay[y] = 0; }
-        }
-        else { ioOutDelay[y]++; }
-
-        ioDelay[y] = 0;
+        bool bitStatus = BIT_CHECK(configPage13.outputInverted, y) ^ firstCheck;
+        if (configPage13.outputPin[y] < 128) { digitalWrite(configPage13.outputPin[y], bitStatus); }
+        else { BIT_WRITE(currentRuleStatus, y, bitStatus); }
+        BIT_WRITE(currentStatus.outputsStatus, y, bitStatus);
+        if(!BIT_CHECK(configPage13.kindOfLimiting, y)) { ioOutDelay[y] = 0; }
       }
+      else { ioOutDelay[y]++; }
+
+      ioDelay[y] = 0;
     }
   }
 }
@@ -23,11 +23,12 @@ These are some utility functions and variables used through the main code
 #define BITWISE_XOR 3
 
 #define REUSE_RULES 240
+#define PROGRAMMABLE_IO_MAX_RULES 16U //Size of the compiled rule program. Page 13 currently holds 8 rules
 
 extern uint8_t ioOutDelay[sizeof(configPage13.outputPin)];
 extern uint8_t ioDelay[sizeof(configPage13.outputPin)];
 extern uint8_t pinIsValid;
-extern uint8_t currentRuleStatus;
+extern uint16_t currentRuleStatus;
 //uint8_t outputPin[sizeof(configPage13.outputPin)];
 
 void setResetControlPinState(void);
@@ -35,6 +36,7 @@ byte pinTranslate(byte rawPin);
 byte pinTranslateAnalog(byte rawPin);
 void initialiseProgrammableIO(void);
 void checkProgrammableIO(void);
+void programmableIOChanged(void);
 int16_t ProgrammableIOGetData(uint16_t index);
 
 #if !defined(UNUSED)
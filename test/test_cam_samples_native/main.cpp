@@ -0,0 +1,80 @@
+#include <unity.h>
+#include "../../speeduino/camSamples.cpp"
+
+static void drain(void)
+{
+  camSampleReset(CAM_SAMPLE_VVT1);
+  camSampleReset(CAM_SAMPLE_VVT2);
+}
+
+static void test_cam_samples_in_order(void)
+{
+  drain();
+  camSample_t sample;
+  TEST_ASSERT_FALSE(camSamplePop(CAM_SAMPLE_VVT1, sample));
+
+  //Several times round the queue, so the indexes wrap
+  uint32_t time = 1000;
+  for(int16_t angle = 0; angle < 40; angle += 2)
+  {
+    camSamplePush(CAM_SAMPLE_VVT1, angle, time);
+    camSamplePush(CAM_SAMPLE_VVT1, angle + 1, time + 10U);
+
+    TEST_ASSERT_TRUE(camSamplePop(CAM_SAMPLE_VVT1, sample));
+    TEST_ASSERT_EQUAL_INT16(angle, sample.angle);
+    TEST_ASSERT_EQUAL_UINT32(time, sample.time);
+    TEST_ASSERT_TRUE(camSamplePop(CAM_SAMPLE_VVT1, sample));
+    TEST_ASSERT_EQUAL_INT16(angle + 1, sample.angle);
+    TEST_ASSERT_EQUAL_UINT32(time + 10U, sample.time);
+    TEST_ASSERT_FALSE(camSamplePop(CAM_SAMPLE_VVT1, sample));
+    time += 20U;
+  }
+}
+
+static void test_cam_samples_full(void)
+{
+  drain();
+  camSample_t sample;
+
+  //One slot is always left empty, further samples are dropped until the reader catches up
+  for(int16_t angle = 1; angle <= (int16_t)CAM_SAMPLE_QUEUE_SIZE + 2; angle++) { camSamplePush(CAM_SAMPLE_VVT1, angle, (uint32_t)angle); }
+  for(int16_t angle = 1; angle < (int16_t)CAM_SAMPLE_QUEUE_SIZE; angle++)
+  {
+    TEST_ASSERT_TRUE(camSamplePop(CAM_SAMPLE_VVT1, sample));
+    TEST_ASSERT_EQUAL_INT16(angle, sample.angle);
+  }
+  TEST_ASSERT_FALSE(camSamplePop(CAM_SAMPLE_VVT1, sample));
+
+  camSamplePush(CAM_SAMPLE_VVT1, -5, 100);
+  TEST_ASSERT_TRUE(camSamplePop(CAM_SAMPLE_VVT1, sample));
+  TEST_ASSERT_EQUAL_INT16(-5, sample.angle);
+}
+
+static void test_cam_samples_reset_and_cams(void)
+{
+  drain();
+  camSample_t sample;
+
+  camSamplePush(CAM_SAMPLE_VVT1, 10, 1);
+  camSamplePush(CAM_SAMPLE_VVT2, 20, 2);
+  camSamplePush(CAM_SAMPLE_VVT2, 21, 3);
+
+  camSampleReset(CAM_SAMPLE_VVT1);
+  TEST_ASSERT_FALSE(camSamplePop(CAM_SAMPLE_VVT1, sample));
+
+  TEST_ASSERT_TRUE(camSamplePop(CAM_SAMPLE_VVT2, sample));
+  TEST_ASSERT_EQUAL_INT16(20, sample.angle);
+  TEST_ASSERT_TRUE(camSamplePop(CAM_SAMPLE_VVT2, sample));
+  TEST_ASSERT_EQUAL_INT16(21, sample.angle);
+  TEST_ASSERT_EQUAL_UINT32(3, sample.time);
+  TEST_ASSERT_FALSE(camSamplePop(CAM_SAMPLE_VVT2, sample));
+}
+
+int main(int argc, char **argv) {
+  UNITY_BEGIN();
+
+  RUN_TEST(test_cam_samples_in_order);
+  RUN_TEST(test_cam_samples_full);
+  RUN_TEST(test_cam_samples_reset_and_cams);
+  return UNITY_END();
+}
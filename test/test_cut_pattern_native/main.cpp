@@ -0,0 +1,108 @@
+#include <unity.h>
+#include "../../speeduino/cutPattern.cpp"
+
+/*
+The rolling cut calls cutPatternNext() once per channel per cut window, with the channels in firing order.
+These tests run the pattern in the same way for a number of cycles and check how many events were cut overall, per cylinder and per cycle.
+*/
+
+#define TEST_CYCLES 1010U //10 full passes of the pattern
+
+struct test_cut_counts_t
+{
+  uint16_t total;
+  uint16_t perCylinder[8];
+  uint8_t minPerCycle;
+  uint8_t maxPerCycle;
+};
+
+static test_cut_counts_t runCycles(uint8_t cutPercent, uint8_t cylinders, uint16_t cycles)
+{
+  test_cut_counts_t counts = { 0, { 0 }, 0xFF, 0 };
+  cutPatternReset();
+  for(uint16_t cycle = 0; cycle < cycles; cycle++)
+  {
+    uint8_t cycleCuts = 0;
+    for(uint8_t cylinder = 0; cylinder < cylinders; cylinder++)
+    {
+      if(cutPatternNext(cutPercent) == true)
+      {
+        counts.total++;
+        counts.perCylinder[cylinder]++;
+        cycleCuts++;
+      }
+    }
+    if(cycleCuts < counts.minPerCycle) { counts.minPerCycle = cycleCuts; }
+    if(cycleCuts > counts.maxPerCycle) { counts.maxPerCycle = cycleCuts; }
+  }
+  return counts;
+}
+
+static void test_cut_pattern_extremes(void)
+{
+  test_cut_counts_t counts = runCycles(0, 4, 100);
+  TEST_ASSERT_EQUAL_UINT16(0, counts.total);
+
+  counts = runCycles(100, 4, 100);
+  TEST_ASSERT_EQUAL_UINT16(400, counts.total);
+}
+
+//Over whole passes of the pattern the fraction cut matches the percentage to within the resolution of the pattern
+static void test_cut_pattern_percentage(void)
+{
+  for(uint8_t percent = 1; percent < 100U; percent++)
+  {
+    test_cut_counts_t counts = runCycles(percent, 1, TEST_CYCLES);
+    uint32_t expected = ((uint32_t)percent * TEST_CYCLES) / 100U;
+    TEST_ASSERT_UINT32_WITHIN(10, expected, counts.total);
+  }
+}
+
+//The cuts are spread evenly over the cycles, so no cycle has more than 1 cut more than any other
+static void test_cut_pattern_per_cycle(void)
+{
+  const uint8_t percents[] = { 10, 25, 33, 50, 75, 90 };
+  for(uint8_t x = 0; x < sizeof(percents); x++)
+  {
+    test_cut_counts_t counts = runCycles(percents[x], 4, TEST_CYCLES);
+    TEST_ASSERT_LESS_OR_EQUAL_UINT8(counts.minPerCycle + 1U, counts.maxPerCycle);
+  }
+}
+
+//As the pattern length is prime, every cylinder is cut the same number of times over a whole number of passes. A 50% cut on 4 cylinders must not always cut the same 2
+static void test_cut_pattern_per_cylinder(void)
+{
+  const uint8_t cylinderCounts[] = { 2, 3, 4, 6, 8 };
+  for(uint8_t x = 0; x < sizeof(cylinderCounts); x++)
+  {
+    uint8_t cylinders = cylinderCounts[x];
+    test_cut_counts_t counts = runCycles(50, cylinders, CUT_PATTERN_LENGTH * 2U);
+    for(uint8_t cylinder = 1; cylinder < cylinders; cylinder++)
+    {
+      TEST_ASSERT_EQUAL_UINT16(counts.perCylinder[0], counts.perCylinder[cylinder]);
+    }
+  }
+}
+
+//The same cut percentage always gives the same sequence
+static void test_cut_pattern_repeatable(void)
+{
+  bool first[50];
+  cutPatternReset();
+  for(uint8_t x = 0; x < 50U; x++) { first[x] = cutPatternNext(37); }
+
+  (void)cutPatternNext(80); //Rebuild for a different percentage
+  cutPatternReset();
+  for(uint8_t x = 0; x < 50U; x++) { TEST_ASSERT_EQUAL(first[x], cutPatternNext(37)); }
+}
+
+int main(int argc, char **argv)
+{
+  UNITY_BEGIN();
+  RUN_TEST(test_cut_pattern_extremes);
+  RUN_TEST(test_cut_pattern_percentage);
+  RUN_TEST(test_cut_pattern_per_cycle);
+  RUN_TEST(test_cut_pattern_per_cylinder);
+  RUN_TEST(test_cut_pattern_repeatable);
+  return UNITY_END();
+}
@@ -0,0 +1,104 @@
+#include <decoders.h>
+#include <globals.h>
+#include <unity.h>
+#include "pattern.h"
+#include "patternDecoder.h"
+#include "schedule_calcs.h"
+
+static void test_setup_pattern_missing_tooth(uint8_t teeth, uint8_t missingTeeth)
+{
+    configPage4.TrigPattern = DECODER_PATTERN;
+    configPage15.triggerTable = PATTERN_TABLE_MISSING_TOOTH;
+    configPage4.triggerTeeth = teeth;
+    configPage4.triggerMissingTeeth = missingTeeth;
+    configPage4.TrigSpeed = CRANK_SPEED;
+    configPage4.trigPatternSec = SEC_TRIGGER_SINGLE;
+    configPage4.sparkMode = IGN_MODE_WASTED;
+
+    triggerSetup_Pattern();
+}
+
+//The same cases as the missing tooth decoder tests. The pattern table decoder must give the same end teeth
+static void test_pattern_newIgn_36_1_1(void)
+{
+    const int16_t triggerAngles[] = { 0, 90, 180, 270, 360, -90, -180, -270, -360 };
+    const uint16_t endTeeth[] = { 34, 25, 16, 7, 34, 7, 16, 25, 34 };
+    test_setup_pattern_missing_tooth(36, 1);
+    ignition1EndAngle = 360 - 10; //Set 10 degrees advance
+
+    for(uint8_t x = 0; x < (sizeof(triggerAngles) / sizeof(triggerAngles[0])); x++)
+    {
+        configPage4.triggerAngle = triggerAngles[x];
+        triggerSetEndTeeth_Pattern();
+        TEST_ASSERT_EQUAL(endTeeth[x], ignition1EndTooth);
+    }
+}
+
+static void test_pattern_newIgn_36_1_2(void)
+{
+    const int16_t triggerAngles[] = { 0, 90, 180, 270, 360, -90, -180, -270, -360 };
+    const uint16_t endTeeth[] = { 16, 7, 34, 25, 16, 25, 34, 7, 16 };
+    test_setup_pattern_missing_tooth(36, 1);
+    ignition2EndAngle = 180 - 10; //Set 10 degrees advance
+
+    for(uint8_t x = 0; x < (sizeof(triggerAngles) / sizeof(triggerAngles[0])); x++)
+    {
+        configPage4.triggerAngle = triggerAngles[x];
+        triggerSetEndTeeth_Pattern();
+        TEST_ASSERT_EQUAL(endTeeth[x], ignition2EndTooth);
+    }
+}
+
+//Sweep the end angle round a whole cycle and compare with the missing tooth decoder, including sequential where the 2nd revolution uses the higher tooth numbers
+static void test_pattern_newIgn_60_2_matches_missing_tooth(void)
+{
+    const uint8_t sparkModes[] = { IGN_MODE_WASTED, IGN_MODE_SEQUENTIAL };
+    configPage2.strokes = FOUR_STROKE;
+    configPage4.triggerAngle = 60;
+
+    for(uint8_t mode = 0; mode < 2U; mode++)
+    {
+        uint16_t maxAngle = (sparkModes[mode] == IGN_MODE_SEQUENTIAL) ? 720U : 360U;
+        for(uint16_t angle = 0; angle < maxAngle; angle += 7U)
+        {
+            test_setup_pattern_missing_tooth(60, 2);
+            configPage4.sparkMode = sparkModes[mode];
+            ignition1EndAngle = angle;
+            triggerSetEndTeeth_Pattern();
+            uint16_t patternEndTooth = ignition1EndTooth;
+
+            triggerSetup_missingTooth();
+            triggerSetEndTeeth_missingTooth();
+            TEST_ASSERT_EQUAL(ignition1EndTooth, patternEndTooth);
+        }
+    }
+}
+
+//An end angle in one of the gaps must use the last tooth before the gap
+static void test_pattern_newIgn_36_2_1(void)
+{
+    configPage15.triggerTable = PATTERN_TABLE_36_2_1;
+    configPage4.sparkMode = IGN_MODE_WASTED;
+    configPage4.triggerAngle = 0;
+    triggerSetup_Pattern();
+
+    ignition1EndAngle = 200; //Position 20 with the 1 tooth margin is position 19, which is in the single gap
+    triggerSetEndTeeth_Pattern();
+    TEST_ASSERT_EQUAL(18, ignition1EndTooth);
+
+    ignition1EndAngle = 365; //Position 36 with the margin is position 35, which is in the double gap
+    triggerSetEndTeeth_Pattern();
+    TEST_ASSERT_EQUAL(34, ignition1EndTooth);
+
+    ignition1EndAngle = 100;
+    triggerSetEndTeeth_Pattern();
+    TEST_ASSERT_EQUAL(9, ignition1EndTooth);
+}
+
+void testPattern()
+{
+  RUN_TEST(test_pattern_newIgn_36_1_1);
+  RUN_TEST(test_pattern_newIgn_36_1_2);
+  RUN_TEST(test_pattern_newIgn_60_2_matches_missing_tooth);
+  RUN_TEST(test_pattern_newIgn_36_2_1);
+}
@@ -0,0 +1,115 @@
+#include <unity.h>
+#include "../../speeduino/dwellLimit.h"
+
+/*
+The schedule wrappers in schedule_calcs.hpp work out the end compare as counter + the ticks returned here, so the same is done with a 16 bit counter below.
+The ticks are 4uS, as on the Mega
+*/
+#define TICKS(uS) ((uint16_t)((uS) / 4U))
+
+struct coil_t
+{
+  uint16_t endCompare;
+  uint16_t limitCompare;
+};
+
+//The same as ignitionStartCharge() for a schedule with a fixed duration
+static coil_t startCharge(uint16_t counter, uint16_t dwellTicks, uint16_t limitTicks)
+{
+  coil_t coil;
+  coil.endCompare = (uint16_t)(counter + dwellStartTicks(dwellTicks, limitTicks));
+  coil.limitCompare = (limitTicks != 0U) ? (uint16_t)(counter + limitTicks) : coil.endCompare;
+  return coil;
+}
+
+//The same as ignitionRunningEndCompare()
+static uint16_t runningEnd(const coil_t &coil, uint16_t counter, uint16_t endTicks, uint16_t limitTicks)
+{
+  return (uint16_t)(counter + dwellRunningEndTicks(endTicks, (uint16_t)(coil.limitCompare - counter), (limitTicks != 0U)));
+}
+
+static void test_dwell_limit_start(void)
+{
+  //Under the limit is unchanged
+  TEST_ASSERT_EQUAL_UINT16(TICKS(3000), dwellStartTicks(TICKS(3000), TICKS(5000)));
+  TEST_ASSERT_EQUAL_UINT16(TICKS(5000), dwellStartTicks(TICKS(5000), TICKS(5000)));
+  //Over the limit is capped
+  TEST_ASSERT_EQUAL_UINT16(TICKS(5000), dwellStartTicks(TICKS(8000), TICKS(5000)));
+  //An end set by the decoder that has already passed looks like a very long dwell and is capped as well
+  TEST_ASSERT_EQUAL_UINT16(TICKS(5000), dwellStartTicks((uint16_t)(100U - 200U), TICKS(5000)));
+  //Limiter off
+  TEST_ASSERT_EQUAL_UINT16(TICKS(8000), dwellStartTicks(TICKS(8000), 0));
+}
+
+static void test_dwell_limit_running(void)
+{
+  const uint16_t limit = TICKS(5000);
+  coil_t coil = startCharge(1000, TICKS(3000), limit);
+  TEST_ASSERT_EQUAL_UINT16(1000U + TICKS(3000), coil.endCompare);
+  TEST_ASSERT_EQUAL_UINT16(1000U + limit, coil.limitCompare);
+
+  //1ms into the charge the end is moved. Before the limit it is used as is, after the limit it stops at the limit
+  uint16_t counter = 1000U + TICKS(1000);
+  TEST_ASSERT_EQUAL_UINT16(counter + TICKS(2500), runningEnd(coil, counter, TICKS(2500), limit));
+  TEST_ASSERT_EQUAL_UINT16(coil.limitCompare, runningEnd(coil, counter, TICKS(4000), limit));
+  TEST_ASSERT_EQUAL_UINT16(coil.limitCompare, runningEnd(coil, counter, UINT16_MAX, limit));
+
+  //Limiter off
+  coil = startCharge(1000, TICKS(3000), 0);
+  TEST_ASSERT_EQUAL_UINT16(counter + TICKS(8000), runningEnd(coil, counter, TICKS(8000), 0));
+}
+
+static void test_dwell_limit_counter_wrap(void)
+{
+  //The charge starts just before the counter wraps and the limit is after it
+  const uint16_t limit = TICKS(5000);
+  coil_t coil = startCharge(UINT16_MAX - 100U, TICKS(8000), limit);
+  TEST_ASSERT_EQUAL_UINT16((uint16_t)(UINT16_MAX - 100U + limit), coil.endCompare);
+  TEST_ASSERT_EQUAL_UINT16(coil.endCompare, coil.limitCompare);
+
+  //Before and after the counter wraps
+  TEST_ASSERT_EQUAL_UINT16(coil.limitCompare, runningEnd(coil, UINT16_MAX - 50U, TICKS(8000), limit));
+  TEST_ASSERT_EQUAL_UINT16(coil.limitCompare, runningEnd(coil, 200U, TICKS(8000), limit));
+  TEST_ASSERT_EQUAL_UINT16(300U, runningEnd(coil, 200U, 100U, limit));
+}
+
+static void test_dwell_limit_min_ticks(void)
+{
+  //An end that is due now is set a couple of ticks ahead so that the compare cannot be missed
+  const uint16_t limit = TICKS(5000);
+  coil_t coil = startCharge(1000, TICKS(3000), limit);
+  uint16_t counter = 1500;
+  TEST_ASSERT_EQUAL_UINT16(counter + DWELL_END_MIN_TICKS, runningEnd(coil, counter, 0, limit));
+  TEST_ASSERT_EQUAL_UINT16(counter + DWELL_END_MIN_TICKS, runningEnd(coil, counter, 1, 0));
+  TEST_ASSERT_EQUAL_UINT16(counter + DWELL_END_MIN_TICKS + 1U, runningEnd(coil, counter, DWELL_END_MIN_TICKS + 1U, limit));
+
+  //Reaching the limit in the same tick
+  counter = coil.limitCompare;
+  TEST_ASSERT_EQUAL_UINT16(counter + DWELL_END_MIN_TICKS, runningEnd(coil, counter, TICKS(1000), limit));
+}
+
+static void test_dwell_limit_per_tooth(void)
+{
+  //The per tooth timing of a slowing engine pushes the end later on every tooth. Until the coil is turned off at the limit, the end is never past it
+  const uint16_t limit = TICKS(4000);
+  const uint16_t start = 60000;
+  coil_t coil = startCharge(start, TICKS(3000), limit);
+  uint16_t endTicks = TICKS(3000);
+  for(uint16_t elapsed = TICKS(200); elapsed < limit; elapsed += TICKS(200))
+  {
+    endTicks = (uint16_t)(endTicks + 10U); //The end is further away on each tooth
+    uint16_t end = runningEnd(coil, (uint16_t)(start + elapsed), endTicks, limit);
+    TEST_ASSERT_TRUE((uint16_t)(end - start) <= limit);
+  }
+}
+
+int main(int argc, char **argv) {
+  UNITY_BEGIN();
+
+  RUN_TEST(test_dwell_limit_start);
+  RUN_TEST(test_dwell_limit_running);
+  RUN_TEST(test_dwell_limit_counter_wrap);
+  RUN_TEST(test_dwell_limit_min_ticks);
+  RUN_TEST(test_dwell_limit_per_tooth);
+  return UNITY_END();
+}
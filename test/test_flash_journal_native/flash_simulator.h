@@ -0,0 +1,82 @@
+#pragma once
+#include <stdint.h>
+#include <stdlib.h>
+#include <vector>
+#include "../../speeduino/src/SPIAsEEPROM/FlashJournal.h"
+
+/*
+Simulated NOR flash for testing the journal natively.
+Programming can only clear bits and erasing sets a whole sector to 0xFF, the same as the real flash.
+A power loss can be injected after a given number of flash operations. The operation that is interrupted is
+only partly completed (Some bytes programmed/erased, the last one possibly with only some of its bits cleared)
+and a simulated_power_loss exception is thrown. The flash contents survive, so a new journal can be started
+on the same flash to check what was recovered.
+*/
+struct simulated_power_loss {};
+
+struct simulated_flash_t
+{
+  std::vector<uint8_t> data;
+  uint32_t sectorSize;
+  int32_t operationsUntilPowerLoss = -1; //-1 = Never
+  uint32_t programErrors = 0; //Number of attempts to set a bit from 0 to 1
+  uint32_t alignmentErrors = 0;
+
+  simulated_flash_t(uint32_t sectors, uint32_t size) : data(sectors * size, 0xFF), sectorSize(size) {}
+
+  //Returns true if the power should fail during this operation
+  bool powerFails(void)
+  {
+    if(operationsUntilPowerLoss < 0) { return false; }
+    if(operationsUntilPowerLoss == 0) { return true; }
+    operationsUntilPowerLoss--;
+    return false;
+  }
+};
+
+class SimulatedFlashJournal : public FlashJournal_BaseClass
+{
+  public:
+    SimulatedFlashJournal(simulated_flash_t &flash, uint32_t sectorsPerBank) : FlashJournal_BaseClass({sectorsPerBank, flash.sectorSize, 0}), _flash(flash) {}
+
+  protected:
+    int8_t readFlashBytes(uint32_t address, uint8_t *buf, uint32_t length)
+    {
+      memcpy(buf, &_flash.data[address], length);
+      return 0;
+    }
+
+    int8_t writeFlashBytes(uint32_t address, uint8_t *buf, uint32_t length)
+    {
+      if( ((address % 4U) != 0U) || ((length % 4U) != 0U) ) { _flash.alignmentErrors++; }
+
+      //Each 4 bytes counts as 1 operation so that a power loss can happen part way through a record
+      for(uint32_t i = 0; i < length; i++)
+      {
+        if( ((i % 4U) == 0U) && _flash.powerFails() )
+        {
+          _flash.data[address + i] &= (buf[i] | (uint8_t)rand()); //Partly programmed byte
+          throw simulated_power_loss();
+        }
+        if( (_flash.data[address + i] & buf[i]) != buf[i] ) { _flash.programErrors++; }
+        _flash.data[address + i] &= buf[i];
+      }
+      return 0;
+    }
+
+    int8_t eraseFlashSector(uint32_t address, uint32_t length)
+    {
+      if(_flash.powerFails())
+      {
+        //Interrupted erase leaves the sector in an unknown state
+        for(uint32_t i = 0; i < (length / 2U); i++) { _flash.data[address + i] = 0xFF; }
+        for(uint32_t i = length / 2U; i < length; i++) { _flash.data[address + i] |= (uint8_t)rand(); }
+        throw simulated_power_loss();
+      }
+      memset(&_flash.data[address], 0xFF, length);
+      return 0;
+    }
+
+  private:
+    simulated_flash_t &_flash;
+};
@@ -0,0 +1,247 @@
+#include <unity.h>
+#include <stdlib.h>
+#include <vector>
+#include "flash_simulator.h"
+#include "../../speeduino/src/SPIAsEEPROM/FlashJournal.cpp"
+
+#define TEST_SECTOR_SIZE      1024U
+#define TEST_SECTORS_PER_BANK 12U
+
+typedef std::vector<uint8_t> image_t;
+
+static image_t readImage(FlashJournal_BaseClass &journal)
+{
+  image_t image(journal.length());
+  for(uint16_t i = 0; i < image.size(); i++) { image[i] = journal.read(i); }
+  return image;
+}
+
+//Changes 1 to 3 random ranges of the image, in the same way that a burn of a page or calibration would
+static void randomChanges(FlashJournal_BaseClass &journal, image_t &model)
+{
+  uint8_t ranges = 1 + (rand() % 3);
+  for(uint8_t range = 0; range < ranges; range++)
+  {
+    uint16_t start = rand() % FLASH_JOURNAL_EEPROM_SIZE;
+    uint16_t length = 1 + (rand() % 300);
+    for(uint16_t i = start; (i < (start + length)) && (i < FLASH_JOURNAL_EEPROM_SIZE); i++)
+    {
+      model[i] = (uint8_t)rand();
+      journal.write(i, model[i]);
+    }
+  }
+}
+
+static void test_journal_blank_flash(void)
+{
+  simulated_flash_t flash(TEST_SECTORS_PER_BANK * 2U, TEST_SECTOR_SIZE);
+  SimulatedFlashJournal journal(flash, TEST_SECTORS_PER_BANK);
+
+  TEST_ASSERT_TRUE(journal.initialize());
+  TEST_ASSERT_EQUAL_UINT16(FLASH_JOURNAL_EEPROM_SIZE, journal.length());
+  TEST_ASSERT_EQUAL_UINT8(0xFF, journal.read(0));
+  TEST_ASSERT_EQUAL_UINT8(0xFF, journal.read(FLASH_JOURNAL_EEPROM_SIZE - 1U));
+  TEST_ASSERT_EQUAL_UINT8(0, journal.read(FLASH_JOURNAL_EEPROM_SIZE)); //Out of range
+  TEST_ASSERT_EQUAL_INT8(-1, journal.write(FLASH_JOURNAL_EEPROM_SIZE, 1));
+}
+
+static void test_journal_commit_persists(void)
+{
+  simulated_flash_t flash(TEST_SECTORS_PER_BANK * 2U, TEST_SECTOR_SIZE);
+  {
+    SimulatedFlashJournal journal(flash, TEST_SECTORS_PER_BANK);
+    uint32_t value = 0x12345678UL;
+    journal.put(100, value);
+    journal.update(4000, 55);
+    TEST_ASSERT_TRUE(journal.isCommitPending());
+    TEST_ASSERT_EQUAL_INT16(2, journal.commit()); //2 separate blocks
+    TEST_ASSERT_FALSE(journal.isCommitPending());
+    TEST_ASSERT_EQUAL_INT16(0, journal.commit()); //Nothing left to write
+
+    journal.write(200, 1); //Never committed
+  }
+
+  SimulatedFlashJournal journal(flash, TEST_SECTORS_PER_BANK);
+  uint32_t value = 0;
+  TEST_ASSERT_EQUAL_UINT32(0x12345678UL, journal.get(100, value));
+  TEST_ASSERT_EQUAL_UINT8(55, journal.read(4000));
+  TEST_ASSERT_EQUAL_UINT8(0xFF, journal.read(200));
+  TEST_ASSERT_EQUAL_UINT32(0, flash.programErrors);
+  TEST_ASSERT_EQUAL_UINT32(0, flash.alignmentErrors);
+}
+
+static void test_journal_unchanged_write(void)
+{
+  simulated_flash_t flash(TEST_SECTORS_PER_BANK * 2U, TEST_SECTOR_SIZE);
+  SimulatedFlashJournal journal(flash, TEST_SECTORS_PER_BANK);
+  journal.write(10, 3);
+  journal.commit();
+
+  uint32_t recordsBefore = journal._recordsWritten;
+  TEST_ASSERT_EQUAL_INT8(0, journal.update(10, 3));
+  TEST_ASSERT_FALSE(journal.isCommitPending());
+  journal.commit();
+  TEST_ASSERT_EQUAL_UINT32(recordsBefore, journal._recordsWritten);
+}
+
+static void test_journal_background_compaction(void)
+{
+  simulated_flash_t flash(TEST_SECTORS_PER_BANK * 2U, TEST_SECTOR_SIZE);
+  image_t model(FLASH_JOURNAL_EEPROM_SIZE, 0xFF);
+  srand(1);
+  {
+    SimulatedFlashJournal journal(flash, TEST_SECTORS_PER_BANK);
+    for(uint16_t burn = 0; burn < 200U; burn++)
+    {
+      randomChanges(journal, model);
+      TEST_ASSERT_TRUE(journal.commit() > 0);
+      journal.service(true);
+      journal.service(true);
+    }
+    TEST_ASSERT_TRUE(journal._sequence > 3U);
+    TEST_ASSERT_TRUE(readImage(journal) == model);
+  }
+
+  SimulatedFlashJournal journal(flash, TEST_SECTORS_PER_BANK);
+  TEST_ASSERT_TRUE(readImage(journal) == model);
+  TEST_ASSERT_EQUAL_UINT32(0, flash.programErrors);
+  TEST_ASSERT_EQUAL_UINT32(0, flash.alignmentErrors);
+}
+
+static void test_journal_forced_compaction(void)
+{
+  //Without any calls to service() the compaction has to be completed by commit() when the bank is full
+  simulated_flash_t flash(TEST_SECTORS_PER_BANK * 2U, TEST_SECTOR_SIZE);
+  image_t model(FLASH_JOURNAL_EEPROM_SIZE, 0xFF);
+  srand(2);
+  {
+    SimulatedFlashJournal journal(flash, TEST_SECTORS_PER_BANK);
+    for(uint16_t burn = 0; burn < 200U; burn++)
+    {
+      randomChanges(journal, model);
+      TEST_ASSERT_TRUE(journal.commit() > 0);
+    }
+    TEST_ASSERT_TRUE(journal._sequence > 3U);
+  }
+
+  SimulatedFlashJournal journal(flash, TEST_SECTORS_PER_BANK);
+  TEST_ASSERT_TRUE(readImage(journal) == model);
+  TEST_ASSERT_EQUAL_UINT32(0, flash.programErrors);
+}
+
+static void test_journal_flash_wear(void)
+{
+  //A burn of a single table cell must not erase anything until the bank is half full
+  simulated_flash_t flash(TEST_SECTORS_PER_BANK * 2U, TEST_SECTOR_SIZE);
+  SimulatedFlashJournal journal(flash, TEST_SECTORS_PER_BANK);
+  journal.initialize();
+  uint32_t erasesAfterFormat = journal._eraseCount;
+
+  uint16_t burns = ((TEST_SECTORS_PER_BANK * TEST_SECTOR_SIZE) / 2U) / (FLASH_JOURNAL_RECORD_HEADER + FLASH_JOURNAL_BLOCK_SIZE);
+  for(uint16_t burn = 0; burn < burns; burn++)
+  {
+    journal.write(500, (uint8_t)burn);
+    journal.commit();
+    journal.service(true);
+  }
+  TEST_ASSERT_EQUAL_UINT32(erasesAfterFormat, journal._eraseCount);
+}
+
+static void test_journal_clear(void)
+{
+  simulated_flash_t flash(TEST_SECTORS_PER_BANK * 2U, TEST_SECTOR_SIZE);
+  {
+    SimulatedFlashJournal journal(flash, TEST_SECTORS_PER_BANK);
+    journal.write(1, 1);
+    journal.commit();
+    TEST_ASSERT_EQUAL_INT16(TEST_SECTORS_PER_BANK * 2U, journal.clear());
+    TEST_ASSERT_EQUAL_UINT8(0xFF, journal.read(1));
+  }
+  SimulatedFlashJournal journal(flash, TEST_SECTORS_PER_BANK);
+  TEST_ASSERT_EQUAL_UINT8(0xFF, journal.read(1));
+}
+
+/*
+Runs a series of burns with a power loss injected after powerLossAfter flash operations.
+After the power loss, the recovered image must be either the last committed image or (If the power was lost during
+a commit) the image that was being committed. Nothing in between is allowed.
+Returns false once powerLossAfter is beyond the end of the test
+*/
+static bool runPowerLossScenario(int32_t powerLossAfter)
+{
+  simulated_flash_t flash(TEST_SECTORS_PER_BANK * 2U, TEST_SECTOR_SIZE);
+  image_t committed(FLASH_JOURNAL_EEPROM_SIZE, 0xFF);
+  image_t pending(FLASH_JOURNAL_EEPROM_SIZE, 0xFF);
+  bool inCommit = false;
+  bool powerLost = false;
+  srand(powerLossAfter);
+
+  {
+    SimulatedFlashJournal journal(flash, TEST_SECTORS_PER_BANK);
+    journal.initialize();
+    flash.operationsUntilPowerLoss = powerLossAfter;
+    try
+    {
+      for(uint8_t burn = 0; burn < 40U; burn++)
+      {
+        randomChanges(journal, pending);
+        inCommit = true;
+        journal.commit();
+        inCommit = false;
+        committed = pending;
+        journal.service(true);
+        journal.service(true);
+        journal.service(true);
+      }
+    }
+    catch(simulated_power_loss &)
+    {
+      powerLost = true;
+    }
+  }
+  flash.operationsUntilPowerLoss = -1;
+
+  SimulatedFlashJournal recovered(flash, TEST_SECTORS_PER_BANK);
+  image_t image = readImage(recovered);
+  if(inCommit == true) { TEST_ASSERT_TRUE((image == committed) || (image == pending)); }
+  else { TEST_ASSERT_TRUE(image == committed); }
+
+  //The journal must still be usable after the recovery, including the compaction that follows a torn write
+  image = readImage(recovered);
+  for(uint8_t burn = 0; burn < 10U; burn++)
+  {
+    randomChanges(recovered, image);
+    TEST_ASSERT_TRUE(recovered.commit() > 0);
+    recovered.service(true);
+  }
+  SimulatedFlashJournal remounted(flash, TEST_SECTORS_PER_BANK);
+  TEST_ASSERT_TRUE(readImage(remounted) == image);
+  TEST_ASSERT_EQUAL_UINT32(0, flash.programErrors);
+  TEST_ASSERT_EQUAL_UINT32(0, flash.alignmentErrors);
+
+  return powerLost;
+}
+
+static void test_journal_power_loss(void)
+{
+  int32_t powerLossAfter = 0;
+  while(runPowerLossScenario(powerLossAfter) == true) { powerLossAfter++; }
+  TEST_ASSERT_TRUE(powerLossAfter > 1000); //Make sure the scenario covered at least 1 compaction
+}
+
+int main(int argc, char **argv) {
+  UNITY_BEGIN();
+
+  RUN_TEST(test_journal_blank_flash);
+  RUN_TEST(test_journal_commit_persists);
+  RUN_TEST(test_journal_unchanged_write);
+  RUN_TEST(test_journal_background_compaction);
+  RUN_TEST(test_journal_forced_compaction);
+  RUN_TEST(test_journal_flash_wear);
+  RUN_TEST(test_journal_clear);
+  RUN_TEST(test_journal_power_loss);
+
+  UNITY_END();
+
+  return 0;
+}
@@ -0,0 +1,205 @@
+#include <unity.h>
+#include <math.h>
+#include <vector>
+#include <algorithm>
+#include "../../speeduino/knock.cpp"
+
+/*
+Knock pulses are injected at known crank angles against a synthetic 36 tooth crank wheel. The tooth times include a per tooth speed variation
+(As from the firing pulses) so the angle to time conversion in the windows is not exact, the same as on a real engine.
+The sparks are generated in the same way as the ignition schedules would fire them and are passed to knockWindowArm() in time order with the knock pulses.
+*/
+
+#define TEST_TOOTH_ANGLE  10U
+
+struct test_engine_t
+{
+  uint16_t rpm;
+  uint8_t cylinders;
+  int8_t advance;
+  int16_t windowStart; //Degrees ATDC
+  int16_t windowEnd;
+};
+
+struct test_event_t
+{
+  uint32_t time;
+  bool isSpark;
+  uint8_t channel;
+};
+
+//Time of a crank angle (Degrees since the start) from the synthetic tooth waveform
+static uint32_t angleToTime(const test_engine_t &engine, uint32_t angle)
+{
+  double usPerDeg = 60000000.0 / (engine.rpm * 360.0);
+  uint32_t toothCount = angle / TEST_TOOTH_ANGLE; //Teeth since the start, including the missing ones
+  double time = 100000.0;
+  for(uint32_t tooth = 0; tooth < toothCount; tooth++)
+  {
+    //Speed varies by +-3% over each firing interval
+    double phase = (double)((tooth * TEST_TOOTH_ANGLE) % (720U / engine.cylinders)) / (720.0 / engine.cylinders);
+    time += TEST_TOOTH_ANGLE * usPerDeg * (1.0 + (0.03 * sin(phase * 2.0 * M_PI)));
+  }
+  time += (angle % TEST_TOOTH_ANGLE) * usPerDeg; //Interpolate within the tooth, as a decoder would
+  return (uint32_t)time;
+}
+
+static void setWindow(const test_engine_t &engine, uint8_t pulsesRequired)
+{
+  double usPerDeg = 60000000.0 / (engine.rpm * 360.0);
+  knockSetWindow((uint16_t)((engine.windowStart + engine.advance) * usPerDeg), (uint16_t)((engine.windowEnd + engine.advance) * usPerDeg), pulsesRequired);
+}
+
+//Runs a number of cycles. knockAngles holds the angles ATDC of the knock pulses for each cylinder (Empty for none)
+static void runCycles(const test_engine_t &engine, uint16_t cycles, const std::vector<int16_t> knockAngles[KNOCK_MAX_CHANNELS])
+{
+  std::vector<test_event_t> events;
+  uint16_t spacing = 720U / engine.cylinders;
+  for(uint16_t cycle = 1; cycle <= cycles; cycle++)
+  {
+    for(uint8_t cyl = 0; cyl < engine.cylinders; cyl++)
+    {
+      uint32_t tdc = (cycle * 720U) + (cyl * spacing);
+      events.push_back({ angleToTime(engine, tdc - engine.advance), true, cyl });
+      for(int16_t angle : knockAngles[cyl]) { events.push_back({ angleToTime(engine, tdc + angle), false, cyl }); }
+    }
+  }
+  std::stable_sort(events.begin(), events.end(), [](const test_event_t &a, const test_event_t &b) { return a.time < b.time; });
+
+  knockWindowsEnabled = true;
+  for(const test_event_t &event : events)
+  {
+    if(event.isSpark == true) { knockWindowArm(event.channel, event.time); }
+    else { knockPulseAt(event.time); }
+  }
+}
+
+static void test_knock_window_attribution(void)
+{
+  test_engine_t engine = { 3000, 4, 20, 10, 50 };
+  knockReset();
+  setWindow(engine, 1);
+  std::vector<int16_t> knock[KNOCK_MAX_CHANNELS];
+  knock[2].push_back(30); //Cylinder 3 only
+
+  runCycles(engine, 20, knock);
+  TEST_ASSERT_EQUAL_UINT8(0, knockTakeEvents(0));
+  TEST_ASSERT_EQUAL_UINT8(0, knockTakeEvents(1));
+  uint8_t events = knockTakeEvents(2); //The newest windows are not finished until 2 more coils have fired
+  TEST_ASSERT_INT32_WITHIN(1, 20, events);
+  TEST_ASSERT_EQUAL_UINT8(0, knockTakeEvents(3));
+  TEST_ASSERT_EQUAL_UINT8(0, knockTakeEvents(2)); //Taken
+}
+
+static void test_knock_outside_window(void)
+{
+  test_engine_t engine = { 6000, 4, 30, 10, 50 };
+  knockReset();
+  setWindow(engine, 1);
+  std::vector<int16_t> knock[KNOCK_MAX_CHANNELS];
+  knock[1].push_back(5); //Before the window
+  knock[1].push_back(80); //After the window
+  knock[3].push_back(-10); //BTDC, before the spark of this cylinder has even been seen as knock
+
+  runCycles(engine, 20, knock);
+  for(uint8_t channel = 0; channel < 4U; channel++) { TEST_ASSERT_EQUAL_UINT8(0, knockTakeEvents(channel)); }
+}
+
+static void test_knock_pulses_required(void)
+{
+  test_engine_t engine = { 2500, 6, 15, 5, 60 };
+  std::vector<int16_t> knock[KNOCK_MAX_CHANNELS];
+  knock[0].push_back(20);
+  knock[4].push_back(20);
+  knock[4].push_back(40);
+
+  knockReset();
+  setWindow(engine, 2);
+  runCycles(engine, 10, knock);
+  TEST_ASSERT_EQUAL_UINT8(0, knockTakeEvents(0)); //Only 1 pulse per window
+  uint8_t events = knockTakeEvents(4);
+  TEST_ASSERT_INT32_WITHIN(1, 10, events);
+}
+
+static void test_knock_overlapping_windows(void)
+{
+  //8 cylinders with the window still open when the next coil fires
+  test_engine_t engine = { 4000, 8, 20, 10, 80 };
+  knockReset();
+  setWindow(engine, 1);
+  std::vector<int16_t> knock[KNOCK_MAX_CHANNELS];
+  knock[5].push_back(75); //After the spark of the next cylinder (70 ATDC of this one), but before that cylinder's window opens
+
+  runCycles(engine, 10, knock);
+  uint8_t events = knockTakeEvents(5);
+  TEST_ASSERT_INT32_WITHIN(1, 10, events);
+  TEST_ASSERT_EQUAL_UINT8(0, knockTakeEvents(6));
+  TEST_ASSERT_EQUAL_UINT8(0, knockTakeEvents(4));
+}
+
+static const knockRetardSettings_t testSettings = { 4, 2, 10, 1, 200, 1000, 500 };
+
+static void test_knock_retard_and_recovery(void)
+{
+  test_engine_t engine = { 3000, 4, 20, 10, 50 };
+  std::vector<int16_t> knock[KNOCK_MAX_CHANNELS];
+  knock[1].push_back(25);
+  std::vector<int16_t> none[KNOCK_MAX_CHANNELS];
+  knockReset();
+  setWindow(engine, 1);
+
+  //First knock gives the first step, on the knocking channel only
+  runCycles(engine, 2, knock);
+  TEST_ASSERT_EQUAL_UINT8(4, knockUpdateChannel(1, 0, testSettings));
+  TEST_ASSERT_EQUAL_UINT8(0, knockUpdateChannel(0, 0, testSettings));
+
+  //Continued knock adds a step each step time, up to the max
+  runCycles(engine, 2, knock);
+  TEST_ASSERT_EQUAL_UINT8(4, knockUpdateChannel(1, 100, testSettings)); //Not a full step time yet
+  runCycles(engine, 2, knock);
+  TEST_ASSERT_EQUAL_UINT8(6, knockUpdateChannel(1, 200, testSettings));
+  for(uint32_t now = 400; now <= 2000U; now += 200U)
+  {
+    runCycles(engine, 2, knock);
+    knockUpdateChannel(1, now, testSettings);
+  }
+  TEST_ASSERT_EQUAL_UINT8(10, knockChannelRetard[1]);
+  TEST_ASSERT_EQUAL_UINT8(0, knockChannelRetard[0]);
+
+  //Knock stops. The retard is held for the duration, then recovers a step at a time
+  runCycles(engine, 2, none);
+  TEST_ASSERT_EQUAL_UINT8(10, knockUpdateChannel(1, 2500, testSettings));
+  TEST_ASSERT_EQUAL_UINT8(9, knockUpdateChannel(1, 3000, testSettings));
+  TEST_ASSERT_EQUAL_UINT8(9, knockUpdateChannel(1, 3200, testSettings));
+  TEST_ASSERT_EQUAL_UINT8(8, knockUpdateChannel(1, 3500, testSettings));
+  for(uint32_t now = 4000; now <= 10000U; now += 500U) { knockUpdateChannel(1, now, testSettings); }
+  TEST_ASSERT_EQUAL_UINT8(0, knockChannelRetard[1]);
+
+  //Knocking again after recovery starts from the first step
+  runCycles(engine, 2, knock);
+  TEST_ASSERT_EQUAL_UINT8(4, knockUpdateChannel(1, 11000, testSettings));
+}
+
+static void test_knock_windows_disabled(void)
+{
+  knockReset();
+  knockWindowsEnabled = false;
+  //The scheduler does not arm windows while disabled, so pulses on their own never count
+  for(uint32_t time = 0; time < 100000U; time += 1000U) { knockPulseAt(time); }
+  for(uint8_t channel = 0; channel < KNOCK_MAX_CHANNELS; channel++) { TEST_ASSERT_EQUAL_UINT8(0, knockTakeEvents(channel)); }
+}
+
+int main(int argc, char **argv) {
+  UNITY_BEGIN();
+
+  RUN_TEST(test_knock_window_attribution);
+  RUN_TEST(test_knock_outside_window);
+  RUN_TEST(test_knock_pulses_required);
+  RUN_TEST(test_knock_overlapping_windows);
+  RUN_TEST(test_knock_retard_and_recovery);
+  RUN_TEST(test_knock_windows_disabled);
+
+  UNITY_END();
+
+  return 0;
+}
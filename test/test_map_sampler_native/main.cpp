@@ -0,0 +1,201 @@
+#include <unity.h>
+#include <math.h>
+#include <vector>
+#include "../../speeduino/mapSampler.cpp"
+
+/*
+The sampler is driven by a synthetic 36-1 crank wheel, calling mapSamplerTooth() on each of the 35 teeth per revolution in the same way as the primary
+trigger interrupt. The revolution counter is incremented on the first tooth after the gap, as the decoder does.
+MAP on the sample teeth comes from a synthetic waveform with an intake pulse for each cylinder, so the true average and minimum of each cycle are known.
+*/
+
+#define TEST_TEETH_PER_REV  35U
+#define TEST_TOOTH_ANGLE    10U
+
+struct test_waveform_t
+{
+  double base; //ADC
+  double amplitude; //ADC
+  uint8_t cylinders;
+};
+
+static uint16_t testRevolution;
+
+static uint16_t waveformAt(const test_waveform_t &waveform, uint16_t cycleAngle)
+{
+  double pulseAngle = 720.0 / waveform.cylinders;
+  return (uint16_t)lround(waveform.base - (waveform.amplitude * cos((cycleAngle / pulseAngle) * 2.0 * M_PI)));
+}
+
+//Runs a number of cycles of the wheel with the main loop taking the completed cycles after each revolution
+static void runCycles(const test_waveform_t &waveform, uint8_t cycles, uint8_t revolutionsPerCycle, std::vector<mapCycle_t> &results)
+{
+  for(uint16_t revolution = 0; revolution < (cycles * revolutionsPerCycle); revolution++)
+  {
+    testRevolution++;
+    for(uint16_t tooth = 0; tooth < TEST_TEETH_PER_REV; tooth++)
+    {
+      if(mapSamplerTooth(testRevolution) == true)
+      {
+        uint16_t cycleAngle = ((testRevolution % revolutionsPerCycle) * 360U) + (tooth * TEST_TOOTH_ANGLE);
+        uint16_t reading = waveformAt(waveform, cycleAngle);
+        if(reading >= 1023U) { mapSamplerReject(); }
+        else { mapSamplerAdd(reading, reading / 2U); }
+      }
+    }
+    mapCycle_t cycle;
+    if(mapSamplerTakeCycle(cycle) == true) { results.push_back(cycle); }
+  }
+}
+
+static void resetSampler(uint8_t revolutionsPerCycle)
+{
+  mapSamplerConfigure(0);
+  mapSamplerConfigure(revolutionsPerCycle);
+  testRevolution = 1; //Part way through a cycle, so the sampler has to align to the next cycle boundary
+}
+
+static void test_map_sampler_first_cycle(void)
+{
+  test_waveform_t waveform = { 500, 100, 4 };
+  std::vector<mapCycle_t> results;
+  resetSampler(2);
+  runCycles(waveform, 4, 2, results);
+
+  TEST_ASSERT_EQUAL_UINT32(3, results.size()); //The last cycle is still running
+  TEST_ASSERT_EQUAL_UINT16(70, results[0].teeth);
+  TEST_ASSERT_EQUAL_UINT8(0, results[0].samples); //Only counts the teeth
+  TEST_ASSERT_EQUAL_UINT8(0, results[1].samples); //Started before the sample teeth were set from the first cycle
+  for(uint8_t x = 2; x < results.size(); x++)
+  {
+    TEST_ASSERT_EQUAL_UINT16(70, results[x].teeth);
+    TEST_ASSERT_EQUAL_UINT8(12, results[x].samples); //Every 6th tooth
+    TEST_ASSERT_EQUAL_UINT8(0, results[x].errors);
+  }
+}
+
+static void test_map_sampler_average(void)
+{
+  //4 and 6 cylinders, with large pulsations
+  const test_waveform_t waveforms[] = { { 500, 200, 4 }, { 300, 150, 6 }, { 800, 50, 4 } };
+  for(const test_waveform_t &waveform : waveforms)
+  {
+    std::vector<mapCycle_t> results;
+    resetSampler(2);
+    runCycles(waveform, 6, 2, results);
+    for(uint8_t x = 2; x < results.size(); x++)
+    {
+      TEST_ASSERT_UINT16_WITHIN(2, (uint16_t)waveform.base, results[x].mapAverage);
+      TEST_ASSERT_UINT16_WITHIN(2, (uint16_t)(waveform.base / 2), results[x].emapAverage);
+    }
+  }
+}
+
+static void test_map_sampler_minimum(void)
+{
+  test_waveform_t waveform = { 500, 200, 4 };
+  std::vector<mapCycle_t> results;
+  resetSampler(2);
+  runCycles(waveform, 4, 2, results);
+  //The first tooth of the cycle is at the bottom of an intake pulse
+  for(uint8_t x = 2; x < results.size(); x++) { TEST_ASSERT_UINT16_WITHIN(1, 300, results[x].mapMinimum); }
+}
+
+static void test_map_sampler_step_change(void)
+{
+  //Each cycle is averaged on its own, so a load change shows in full in the first cycle after it with no lag
+  test_waveform_t before = { 600, 100, 4 };
+  test_waveform_t after = { 300, 100, 4 };
+  std::vector<mapCycle_t> results;
+  resetSampler(2);
+  runCycles(before, 3, 2, results);
+  results.clear();
+  runCycles(after, 2, 2, results);
+
+  TEST_ASSERT_EQUAL_UINT32(2, results.size());
+  TEST_ASSERT_UINT16_WITHIN(2, 600, results[0].mapAverage); //The last cycle before the change
+  TEST_ASSERT_UINT16_WITHIN(2, 300, results[1].mapAverage);
+}
+
+static void test_map_sampler_sync_loss(void)
+{
+  test_waveform_t waveform = { 500, 100, 4 };
+  std::vector<mapCycle_t> results;
+  resetSampler(2);
+  runCycles(waveform, 4, 2, results);
+  size_t before = results.size();
+  testRevolution += 3; //Revolutions missed
+  runCycles(waveform, 4, 2, results);
+  TEST_ASSERT_EQUAL_UINT32(before + 3, results.size()); //The cycle with the missed revolutions is dropped, then the sampler waits for the next cycle boundary
+
+  //Every cycle that has samples must have been a full cycle
+  uint8_t sampled = 0;
+  for(const mapCycle_t &cycle : results)
+  {
+    if(cycle.samples == 0U) { continue; }
+    sampled++;
+    TEST_ASSERT_EQUAL_UINT16(70, cycle.teeth);
+    TEST_ASSERT_EQUAL_UINT8(12, cycle.samples);
+    TEST_ASSERT_UINT16_WITHIN(2, 500, cycle.mapAverage);
+  }
+  TEST_ASSERT_EQUAL_UINT8(results.size() - 2U, sampled); //Only the first 2 cycles after the reset have no samples
+}
+
+static void test_map_sampler_two_stroke(void)
+{
+  test_waveform_t waveform = { 400, 100, 2 }; //A pulse every 360 degrees over the 720 degree waveform, ie 1 per revolution
+  std::vector<mapCycle_t> results;
+  resetSampler(1);
+  runCycles(waveform, 5, 1, results);
+  TEST_ASSERT_EQUAL_UINT32(4, results.size());
+  for(uint8_t x = 2; x < results.size(); x++)
+  {
+    TEST_ASSERT_EQUAL_UINT16(35, results[x].teeth);
+    TEST_ASSERT_EQUAL_UINT8(12, results[x].samples); //Every 3rd tooth
+    TEST_ASSERT_UINT16_WITHIN(2, 400, results[x].mapAverage);
+  }
+}
+
+static void test_map_sampler_rejected(void)
+{
+  test_waveform_t waveform = { 900, 200, 4 }; //Peaks are above the ADC range
+  std::vector<mapCycle_t> results;
+  resetSampler(2);
+  runCycles(waveform, 3, 2, results);
+  for(uint8_t x = 2; x < results.size(); x++)
+  {
+    TEST_ASSERT_EQUAL_UINT8(12, results[x].samples + results[x].errors);
+    TEST_ASSERT_GREATER_THAN(0, results[x].errors);
+    TEST_ASSERT_LESS_THAN(1023, results[x].mapAverage);
+  }
+}
+
+static void test_map_sampler_disabled(void)
+{
+  mapSamplerConfigure(0);
+  for(uint16_t tooth = 0; tooth < 1000U; tooth++)
+  {
+    bool sample = mapSamplerTooth(tooth / TEST_TEETH_PER_REV);
+    TEST_ASSERT_FALSE(sample);
+  }
+  mapCycle_t cycle;
+  bool taken = mapSamplerTakeCycle(cycle);
+  TEST_ASSERT_FALSE(taken);
+}
+
+int main(int argc, char **argv) {
+  UNITY_BEGIN();
+
+  RUN_TEST(test_map_sampler_first_cycle);
+  RUN_TEST(test_map_sampler_average);
+  RUN_TEST(test_map_sampler_minimum);
+  RUN_TEST(test_map_sampler_step_change);
+  RUN_TEST(test_map_sampler_sync_loss);
+  RUN_TEST(test_map_sampler_two_stroke);
+  RUN_TEST(test_map_sampler_rejected);
+  RUN_TEST(test_map_sampler_disabled);
+
+  UNITY_END();
+
+  return 0;
+}
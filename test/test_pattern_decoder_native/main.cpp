@@ -0,0 +1,190 @@
+#include <unity.h>
+#include "../../speeduino/patternDecoder.cpp"
+
+/*
+The wheels are run past the decoder with the engine accelerating, so that the tooth gaps change from tooth to tooth as they would when cranking.
+The true position of every tooth is known, so the decoder must find it on the first key gap and then follow it without ever reporting a sync loss.
+*/
+
+struct wheel_run_t
+{
+  uint16_t keyTeeth; //Teeth seen before the position was found
+  uint16_t wrongPositions; //Teeth after that where the decoder disagreed with the wheel
+  uint16_t cycles;
+  uint16_t syncLosses;
+  uint16_t normalGaps;
+};
+
+static bool wheelHasTooth(const triggerPattern_t &pattern, uint8_t position)
+{
+  for(uint8_t x = 0; x < pattern.gapCount; x++)
+  {
+    if( (position >= pattern.gaps[x].position) && (position < (pattern.gaps[x].position + pattern.gaps[x].count)) ) { return false; }
+  }
+  return true;
+}
+
+//Turns the wheel for a number of turns starting at startPosition, with the speed rising from startRPM by rpmPerTurn every turn
+static wheel_run_t runWheel(const triggerPattern_t &pattern, uint8_t startPosition, uint8_t turns, float startRPM, float rpmPerTurn)
+{
+  wheel_run_t run = { 0, 0, 0, 0, 0 };
+  float rpm = startRPM;
+  float positionTime = 0;
+  uint32_t gap = 0;
+  uint32_t lastGap = 0;
+  uint32_t time = 0;
+  uint32_t lastToothTime = 0;
+  bool found = false;
+  uint8_t position = startPosition;
+
+  for(uint16_t step = 0; step < ((uint16_t)turns * pattern.positions); step++)
+  {
+    positionTime = (166667.0f * (pattern.cycleAngle / pattern.positions)) / rpm;
+    rpm += rpmPerTurn / pattern.positions;
+    time += (uint32_t)positionTime;
+    position = (position >= pattern.positions) ? 1U : (position + 1U);
+    if(wheelHasTooth(pattern, position) == false) { continue; }
+
+    lastGap = gap;
+    gap = (lastToothTime == 0U) ? 0U : (time - lastToothTime);
+    lastToothTime = time;
+
+    uint8_t events = patternTooth(gap, lastGap);
+    if(found == false)
+    {
+      run.keyTeeth++;
+      if(patternPosition() != 0U) { found = true; }
+    }
+    if(found == true)
+    {
+      if(patternPosition() != position) { run.wrongPositions++; }
+      if(events & (1U << PATTERN_EVENT_CYCLE)) { run.cycles++; }
+      if(events & (1U << PATTERN_EVENT_SYNC_LOST)) { run.syncLosses++; }
+      if(events & (1U << PATTERN_EVENT_NORMAL_GAP)) { run.normalGaps++; }
+    }
+  }
+  return run;
+}
+
+static void test_pattern_compile(void)
+{
+  TEST_ASSERT_TRUE(patternCompileMissingTooth(36, 1, 360));
+  TEST_ASSERT_EQUAL_UINT8(36, patternPositions());
+  TEST_ASSERT_EQUAL_UINT16(10, patternPositionAngle());
+  TEST_ASSERT_EQUAL_UINT8(2, patternLongestGap());
+
+  TEST_ASSERT_TRUE(patternCompileMissingTooth(24, 1, 720));
+  TEST_ASSERT_EQUAL_UINT16(30, patternPositionAngle());
+
+  TEST_ASSERT_TRUE(patternCompile(*patternTable(PATTERN_TABLE_36_2_1)));
+  TEST_ASSERT_EQUAL_UINT8(3, patternLongestGap());
+  TEST_ASSERT_TRUE(patternCompile(*patternTable(PATTERN_TABLE_GM7X)));
+  TEST_ASSERT_EQUAL_UINT8(6, patternLongestGap());
+  TEST_ASSERT_TRUE(patternTable(PATTERN_TABLE_MISSING_TOOTH) == nullptr);
+}
+
+//Wheels without a unique key gap cannot be synced from the crank alone
+static void test_pattern_compile_invalid(void)
+{
+  TEST_ASSERT_FALSE(patternCompileMissingTooth(36, 0, 360));
+  TEST_ASSERT_EQUAL_UINT8(0, patternPositions());
+  TEST_ASSERT_FALSE(patternCompileMissingTooth(4, 4, 360));
+
+  static const patternGap_t twoGaps[] = { { 9U, 1U }, { 18U, 1U } }; //2 identical gaps
+  triggerPattern_t pattern = { 18U, 360U, 2U, twoGaps };
+  TEST_ASSERT_FALSE(patternCompile(pattern));
+
+  static const patternGap_t outside[] = { { 36U, 2U } };
+  pattern = { 36U, 360U, 1U, outside };
+  TEST_ASSERT_FALSE(patternCompile(pattern));
+  TEST_ASSERT_EQUAL_UINT8(0, patternTooth(1000, 1000));
+}
+
+static void checkWheel(const triggerPattern_t &pattern, uint8_t physicalTeeth)
+{
+  for(uint8_t start = 1; start <= pattern.positions; start += 5)
+  {
+    patternCompile(pattern);
+    wheel_run_t run = runWheel(pattern, start, 6, 150.0f, 100.0f);
+    TEST_ASSERT_TRUE(run.keyTeeth <= (physicalTeeth + 1U)); //Found within 1 turn of the wheel
+    TEST_ASSERT_EQUAL_UINT16(0, run.wrongPositions);
+    TEST_ASSERT_EQUAL_UINT16(0, run.syncLosses);
+    TEST_ASSERT_TRUE(run.cycles >= 4U);
+  }
+}
+
+static void test_pattern_missing_tooth(void)
+{
+  triggerPattern_t pattern;
+  patternGap_t gap36_1 = { 36U, 1U };
+  pattern = { 36U, 360U, 1U, &gap36_1 };
+  checkWheel(pattern, 35);
+
+  patternGap_t gap60_2 = { 59U, 2U };
+  pattern = { 60U, 360U, 1U, &gap60_2 };
+  checkWheel(pattern, 58);
+
+  patternGap_t gap4_1 = { 4U, 1U };
+  pattern = { 4U, 720U, 1U, &gap4_1 };
+  checkWheel(pattern, 3);
+}
+
+static void test_pattern_tables(void)
+{
+  checkWheel(*patternTable(PATTERN_TABLE_36_2_1), 33);
+  checkWheel(*patternTable(PATTERN_TABLE_GM7X), 7);
+}
+
+//Only the teeth after a single position gap can be used for tooth based RPM
+static void test_pattern_normal_gaps(void)
+{
+  patternCompileMissingTooth(36, 1, 360);
+  patternTooth(1000, 1000);
+  TEST_ASSERT_EQUAL_UINT8((1U << PATTERN_EVENT_KEY), patternTooth(2000, 1000));
+  for(uint8_t x = 2; x <= 35U; x++)
+  {
+    TEST_ASSERT_EQUAL_UINT8((1U << PATTERN_EVENT_NORMAL_GAP), patternTooth(1000, (x == 2U) ? 2000U : 1000U));
+  }
+  TEST_ASSERT_EQUAL_UINT8((1U << PATTERN_EVENT_KEY) | (1U << PATTERN_EVENT_CYCLE), patternTooth(2000, 1000));
+}
+
+//A missed tooth puts the key gap in the wrong place, which must be reported and the position recovered
+static void test_pattern_sync_loss(void)
+{
+  patternCompileMissingTooth(36, 1, 360);
+  patternTooth(1000, 1000);
+  patternTooth(2000, 1000); //Key gap, position is tooth #1
+  TEST_ASSERT_EQUAL_UINT8(1, patternPosition());
+  for(uint8_t x = 0; x < 10U; x++) { patternTooth(1000, 1000); }
+  TEST_ASSERT_EQUAL_UINT8(11, patternPosition());
+
+  uint8_t events = patternTooth(2000, 1000); //A missed tooth looks like the gap
+  TEST_ASSERT_TRUE(events & (1U << PATTERN_EVENT_SYNC_LOST));
+  TEST_ASSERT_EQUAL_UINT8(1, patternPosition());
+
+  patternReset();
+  TEST_ASSERT_EQUAL_UINT8(0, patternPosition());
+}
+
+static void test_pattern_tooth_at_or_before(void)
+{
+  patternCompile(*patternTable(PATTERN_TABLE_36_2_1));
+  TEST_ASSERT_EQUAL_UINT16(18, patternToothAtOrBefore(19, 36));
+  TEST_ASSERT_EQUAL_UINT16(34, patternToothAtOrBefore(36, 36));
+  TEST_ASSERT_EQUAL_UINT16(20, patternToothAtOrBefore(20, 36));
+  TEST_ASSERT_EQUAL_UINT16(54, patternToothAtOrBefore(55, 72)); //2nd turn of a 720 degree cycle
+  TEST_ASSERT_EQUAL_UINT16(70, patternToothAtOrBefore(72, 72));
+}
+
+int main(int argc, char **argv)
+{
+  UNITY_BEGIN();
+  RUN_TEST(test_pattern_compile);
+  RUN_TEST(test_pattern_compile_invalid);
+  RUN_TEST(test_pattern_missing_tooth);
+  RUN_TEST(test_pattern_tables);
+  RUN_TEST(test_pattern_normal_gaps);
+  RUN_TEST(test_pattern_sync_loss);
+  RUN_TEST(test_pattern_tooth_at_or_before);
+  return UNITY_END();
+}
@@ -0,0 +1,477 @@
+#include <unity.h>
+#include <stdio.h>
+#include <chrono>
+
+unsigned long millis(void) { return 0; } //Only ComputeAt() is used by the tests
+#include "../../speeduino/src/PID/fixedPID.h"
+
+//The PIDs are set up in the same way as in idle.cpp, auxiliaries.cpp and corrections.cpp
+
+static void test_pid_proportional_scaling(void)
+{
+  long input = 900, output = 0, setpoint = 1000;
+  fixedPID<PID_SHIFTS> pid(&input, &output, &setpoint, DIRECT);
+  pid.SetOutputLimits(0, 1000);
+  pid.SetTunings(32, 0, 0); //Kp of 32 is a gain of 1
+  pid.SetMode(AUTOMATIC);
+
+  TEST_ASSERT_TRUE(pid.ComputeAt(1000, 0));
+  TEST_ASSERT_EQUAL_INT32(100, output);
+
+  TEST_ASSERT_TRUE(pid.ComputeAt(2000, 50)); //Feed forward is added outside the loop
+  TEST_ASSERT_EQUAL_INT32(150, output);
+
+  pid.SetControllerDirection(REVERSE);
+  input = 1100;
+  TEST_ASSERT_TRUE(pid.ComputeAt(3000, 500));
+  TEST_ASSERT_EQUAL_INT32(600, output);
+}
+
+static void test_pid_sample_time(void)
+{
+  long input = 900, output = 0, setpoint = 1000;
+  fixedPID<PID_SHIFTS> pid(&input, &output, &setpoint, DIRECT);
+  pid.SetTunings(32, 32, 0);
+  pid.SetSampleTime(100);
+
+  TEST_ASSERT_FALSE(pid.ComputeAt(1000, 0)); //Not running yet
+  pid.SetMode(AUTOMATIC);
+  TEST_ASSERT_TRUE(pid.ComputeAt(1000, 0));
+  TEST_ASSERT_FALSE(pid.ComputeAt(1099, 0));
+  TEST_ASSERT_TRUE(pid.ComputeAt(1100, 0));
+
+  input = 0; //Fail safe
+  TEST_ASSERT_FALSE(pid.ComputeAt(1200, 0));
+}
+
+static void test_pid_output_and_integral_limits(void)
+{
+  long input = 500, output = 0, setpoint = 1000;
+  fixedPID<PID_SHIFTS> pid(&input, &output, &setpoint, DIRECT);
+  pid.SetOutputLimits(10, 200);
+  pid.SetSampleTime(0);
+  pid.SetTunings(0, 320, 0);
+  pid.SetMode(AUTOMATIC);
+
+  for(uint32_t now = 1; now < 100U; now++) { pid.ComputeAt(now, 50); }
+  TEST_ASSERT_EQUAL_INT32(200, output);
+
+  //The integral must have been held at (max - feed forward) rather than winding up, so the output comes off the limit straight away
+  input = 1001;
+  pid.ComputeAt(100, 50);
+  TEST_ASSERT_TRUE(output < 200);
+
+  input = 2000;
+  for(uint32_t now = 101; now < 200U; now++) { pid.ComputeAt(now, 50); }
+  TEST_ASSERT_EQUAL_INT32(10, output);
+}
+
+static void test_pid_no_derivative_kick(void)
+{
+  long input = 500, output = 0, setpoint = 500;
+  fixedPID<PID_SHIFTS> pid(&input, &output, &setpoint, DIRECT);
+  pid.SetOutputLimits(-1000, 1000);
+  pid.SetSampleTime(1000);
+  pid.SetTunings(0, 0, 128); //Kd of 128 is a gain of 1 at 1 sample per second
+  pid.SetMode(AUTOMATIC);
+
+  setpoint = 800; //A setpoint change alone does nothing to the derivative
+  pid.ComputeAt(1000, 0);
+  TEST_ASSERT_EQUAL_INT32(0, output);
+
+  input = 510;
+  pid.ComputeAt(2000, 0);
+  TEST_ASSERT_EQUAL_INT32(-10, output);
+}
+
+static void test_pid_derivative_filter(void)
+{
+  long input = 500, output = 0, setpoint = 500;
+  fixedPID<PID_SHIFTS> pid(&input, &output, &setpoint, DIRECT);
+  pid.SetOutputLimits(-1000, 1000);
+  pid.SetSampleTime(1000);
+  pid.SetTunings(0, 0, 128);
+  pid.SetDerivativeFilter(2);
+  pid.SetMode(AUTOMATIC);
+
+  input = 540;
+  pid.ComputeAt(1000, 0);
+  TEST_ASSERT_EQUAL_INT32(-10, output); //1/4 of the unfiltered value
+  pid.ComputeAt(2000, 0);
+  TEST_ASSERT_TRUE( (output > -10) && (output <= 0) ); //Decays away once the input stops changing
+}
+
+//Holds the output against the limit with the proportional term for a while, then returns the output (Which is then only the integral) once the input reaches the setpoint
+static long integralAfterSaturation(uint8_t backCalcShift)
+{
+  long input = 100, output = 0, setpoint = 1000;
+  fixedPID<PID_SHIFTS> pid(&input, &output, &setpoint, DIRECT);
+  pid.SetOutputLimits(0, 100);
+  pid.SetSampleTime(1000);
+  pid.SetTunings(64, 1, 0);
+  pid.SetBackCalculation(backCalcShift);
+  pid.SetMode(AUTOMATIC);
+
+  uint32_t now = 1000;
+  for(; now < 50000U; now += 1000U) { pid.ComputeAt(now, 0); }
+  TEST_ASSERT_EQUAL_INT32(100, output);
+
+  input = 1000;
+  pid.ComputeAt(now, 0);
+  return output;
+}
+
+static void test_pid_back_calculation(void)
+{
+  TEST_ASSERT_EQUAL_INT32(100, integralAfterSaturation(PID_BACKCALC_OFF)); //Clamping alone lets the integral reach the limit
+  TEST_ASSERT_TRUE(integralAfterSaturation(2) < 50);
+}
+
+static void test_pid_initialize_is_bumpless(void)
+{
+  long input = 900, output = 300, setpoint = 900;
+  fixedPID<PID_SHIFTS> pid(&input, &output, &setpoint, DIRECT);
+  pid.SetOutputLimits(0, 1000);
+  pid.SetTunings(32, 32, 32);
+  pid.SetMode(AUTOMATIC);
+  TEST_ASSERT_TRUE(pid.ComputeAt(1000, 0));
+  TEST_ASSERT_EQUAL_INT32(300, output);
+
+  pid.ResetIntegral();
+  TEST_ASSERT_TRUE(pid.ComputeAt(2000, 0));
+  TEST_ASSERT_EQUAL_INT32(0, output);
+}
+
+static void test_pid_reset_integral_no_derivative_kick(void)
+{
+  //The input moves while the controller is not being run (Eg boost below the control threshold). The first computation after the reset must not see that as a derivative
+  long input = 100, output = 0, setpoint = 100;
+  fixedPID<PID_SHIFTS> pid(&input, &output, &setpoint, DIRECT);
+  pid.SetOutputLimits(-1000, 1000);
+  pid.SetTunings(0, 0, 128);
+  pid.SetSampleTime(1000);
+  pid.SetMode(AUTOMATIC);
+  TEST_ASSERT_TRUE(pid.ComputeAt(1000, 0));
+
+  input = 200;
+  setpoint = 200;
+  pid.ResetIntegral();
+  TEST_ASSERT_TRUE(pid.ComputeAt(2000, 0));
+  TEST_ASSERT_EQUAL_INT32(0, output);
+}
+
+static void test_pid_dt_one_sample(void)
+{
+  //A step of exactly one sample time is the same as ComputeAt()
+  long inputAt = 10, outputAt = 100, inputDt = 10, outputDt = 100, setpoint = 30;
+  fixedPID<PID_SHIFTS> pidAt(&inputAt, &outputAt, &setpoint, DIRECT);
+  fixedPID<PID_SHIFTS> pidDt(&inputDt, &outputDt, &setpoint, DIRECT);
+  pidAt.SetOutputLimits(40, 160);
+  pidDt.SetOutputLimits(40, 160);
+  pidAt.SetSampleTime(33);
+  pidDt.SetSampleTime(33);
+  pidAt.SetTunings(100, 20, 10);
+  pidDt.SetTunings(100, 20, 10);
+  pidAt.SetMode(AUTOMATIC);
+  pidDt.SetMode(AUTOMATIC);
+
+  for(uint8_t sample = 1; sample < 50U; sample++)
+  {
+    inputAt = 10 + (sample / 2U);
+    inputDt = inputAt;
+    TEST_ASSERT_TRUE(pidAt.ComputeAt(sample * 33U, 0));
+    TEST_ASSERT_TRUE(pidDt.ComputeDt(33000UL));
+    TEST_ASSERT_EQUAL_INT32(outputAt, outputDt);
+  }
+}
+
+static void test_pid_dt_scaling(void)
+{
+  //Integral only, Ki of 32 is a gain of 1 per second. 2 half samples integrate the same as 1 whole one
+  long input = 900, output = 0, setpoint = 1000;
+  fixedPID<PID_SHIFTS> pid(&input, &output, &setpoint, DIRECT);
+  pid.SetOutputLimits(0, 1000);
+  pid.SetSampleTime(1000);
+  pid.SetTunings(0, 32, 0);
+  pid.SetMode(AUTOMATIC);
+  TEST_ASSERT_TRUE(pid.ComputeDt(500000UL));
+  TEST_ASSERT_EQUAL_INT32(50, output);
+  TEST_ASSERT_TRUE(pid.ComputeDt(500000UL));
+  TEST_ASSERT_EQUAL_INT32(100, output);
+  TEST_ASSERT_TRUE(pid.ComputeDt(2000000UL));
+  TEST_ASSERT_EQUAL_INT32(300, output);
+
+  //Derivative only, Kd of 128 is a gain of 1 per second. The same change in half the time is twice the rate
+  long dInput = 900, dOutput = 0;
+  fixedPID<PID_SHIFTS> dPid(&dInput, &dOutput, &setpoint, DIRECT);
+  dPid.SetOutputLimits(-1000, 1000);
+  dPid.SetSampleTime(1000);
+  dPid.SetTunings(0, 0, 128);
+  dPid.SetMode(AUTOMATIC);
+  dInput = 910;
+  TEST_ASSERT_TRUE(dPid.ComputeDt(1000000UL));
+  TEST_ASSERT_EQUAL_INT32(-10, dOutput);
+  dInput = 920;
+  TEST_ASSERT_TRUE(dPid.ComputeDt(500000UL));
+  TEST_ASSERT_EQUAL_INT32(-20, dOutput);
+
+  dPid.SetMode(MANUAL);
+  TEST_ASSERT_FALSE(dPid.ComputeDt(1000000UL));
+}
+
+static void test_pid_dt_large_derivative(void)
+{
+  //A fast loop with a large Kd. The derivative scaled to a half sample is well outside 32 bits and must saturate rather than wrap
+  long input = 900, output = 0, setpoint = 900;
+  fixedPID<PID_SHIFTS> pid(&input, &output, &setpoint, DIRECT);
+  pid.SetOutputLimits(-1000, 1000);
+  pid.SetSampleTime(1);
+  pid.SetTunings(0, 0, 255);
+  pid.SetMode(AUTOMATIC);
+  input = 1000;
+  TEST_ASSERT_TRUE(pid.ComputeDt(500UL));
+  TEST_ASSERT_EQUAL_INT32(-1000, output);
+  input = 900;
+  TEST_ASSERT_TRUE(pid.ComputeDt(500UL));
+  TEST_ASSERT_EQUAL_INT32(1000, output);
+}
+
+/*
+Step responses of each loop against a simple 1st order model of what it controls.
+These check that the loop settles on the target without a large overshoot and that the output stays within its limits.
+*/
+struct step_result_t
+{
+  long finalError;
+  long overshoot;
+  uint16_t settleSample; //First sample after which the error stays within the tolerance
+};
+
+template <uint8_t FRAC_BITS, class Plant>
+static step_result_t runStep(fixedPID<FRAC_BITS> &pid, long &input, long &output, long setpoint, long tolerance, long feedForward, uint16_t sampleTime, Plant plant)
+{
+  step_result_t result = { 0, 0, 0 };
+  bool rising = (setpoint > input);
+  uint32_t now = sampleTime;
+  for(uint16_t sample = 0; sample < 600U; sample++)
+  {
+    pid.ComputeAt(now, feedForward);
+    now += sampleTime;
+    input = plant(output);
+
+    long error = setpoint - input;
+    long over = rising ? -error : error;
+    if(over > result.overshoot) { result.overshoot = over; }
+    if( (error > tolerance) || (error < -tolerance) ) { result.settleSample = sample + 1U; }
+    result.finalError = error;
+  }
+  return result;
+}
+
+static void test_pid_step_idle(void)
+{
+  //PWM closed loop idle. Output is the PWM count * 4 with a max count of 1000
+  long rpm = 700, output = 0, target = 900;
+  fixedPID<PID_SHIFTS> idlePID(&rpm, &output, &target, DIRECT);
+  idlePID.SetOutputLimits(400, 3200);
+  idlePID.SetTunings(50, 40, 10);
+  output = 1200;
+  idlePID.SetMode(AUTOMATIC);
+
+  float modelRPM = 700;
+  step_result_t result = runStep(idlePID, rpm, output, 900, 10, 0, 250, [&](long duty) {
+    TEST_ASSERT_TRUE( (duty >= 400) && (duty <= 3200) );
+    modelRPM += (((duty / 4.0f) * 2.0f + 300.0f) - modelRPM) / 4.0f; //Each % of duty is 20rpm, engine responds over ~1 second
+    return (long)modelRPM;
+  });
+  TEST_ASSERT_INT32_WITHIN(10, 0, result.finalError);
+  TEST_ASSERT_TRUE(result.overshoot < 60);
+  TEST_ASSERT_TRUE(result.settleSample < 120U); //30 seconds
+}
+
+static void test_pid_step_boost(void)
+{
+  //Closed loop boost. Output is duty % * 100, with 40% from the duty lookup table as the feed forward
+  long map = 100, output = 0, target = 180;
+  fixedPID<PID_SHIFTS> boostPID(&map, &output, &target, DIRECT);
+  boostPID.SetOutputLimits(0, 9000);
+  boostPID.SetSampleTime(30);
+  boostPID.SetTunings(120, 30, 10, 1000, 10001); //Default sensitivity
+  boostPID.SetDerivativeFilter(1);
+  boostPID.SetBackCalculation(2);
+  boostPID.SetMode(AUTOMATIC);
+
+  float modelMAP = 100;
+  step_result_t result = runStep(boostPID, map, output, 180, 3, 4000, 30, [&](long duty) {
+    TEST_ASSERT_TRUE( (duty >= 0) && (duty <= 9000) );
+    modelMAP += ((100.0f + (duty * 0.015f)) - modelMAP) / 10.0f;
+    return (long)modelMAP;
+  });
+  TEST_ASSERT_INT32_WITHIN(3, 0, result.finalError);
+  TEST_ASSERT_TRUE(result.overshoot < 15);
+  TEST_ASSERT_TRUE(result.settleSample < 300U); //9 seconds
+}
+
+static void test_pid_step_vvt(void)
+{
+  //Closed loop VVT. Output is duty in 0.5% steps, the cam moves while the duty is away from the 50% hold duty
+  long angle = 10, output = 100, target = 30;
+  fixedPID<PID_SHIFTS> vvtPID(&angle, &output, &target, DIRECT);
+  vvtPID.SetOutputLimits(40, 160);
+  vvtPID.SetSampleTime(33);
+  vvtPID.SetTunings(100, 2, 0);
+  vvtPID.SetMode(AUTOMATIC);
+
+  float modelAngle = 10;
+  step_result_t result = runStep(vvtPID, angle, output, 30, 1, 0, 33, [&](long duty) {
+    TEST_ASSERT_TRUE( (duty >= 40) && (duty <= 160) );
+    modelAngle += (duty - 100) * 0.02f;
+    if(modelAngle < 1) { modelAngle = 1; }
+    if(modelAngle > 50) { modelAngle = 50; }
+    return (long)(modelAngle + 0.5f);
+  });
+  TEST_ASSERT_INT32_WITHIN(1, 0, result.finalError);
+  TEST_ASSERT_TRUE(result.overshoot < 5);
+  TEST_ASSERT_TRUE(result.settleSample < 300U); //10 seconds
+}
+
+/*
+Fast hydraulic VVT against a model of the cam that moves continuously (Updated every 1ms) while the duty is away from the hold duty, with the oil flow lagging the duty.
+The PID is run either at 30Hz from the last measured angle, or on each cam edge with the angle measured on that edge. The gains are the same for both
+*/
+static step_result_t runVVTStep(bool edgeRate, uint32_t edgePeriod)
+{
+  step_result_t result = { 0, 0, 0 };
+  long angle = 10, output = 100, target = 30;
+  fixedPID<PID_SHIFTS> vvtPID(&angle, &output, &target, DIRECT);
+  vvtPID.SetOutputLimits(40, 160);
+  vvtPID.SetSampleTime(33);
+  vvtPID.SetTunings(255, 2, 20);
+  vvtPID.SetMode(AUTOMATIC);
+
+  float modelAngle = 10;
+  float flow = 0;
+  long measured = 10;
+  uint32_t lastEdge = 0;
+  for(uint32_t now = 1; now <= 10000U; now++) //mS
+  {
+    flow += ((output - 100) - flow) / 20.0f;
+    modelAngle += flow * 0.006f;
+    if(modelAngle < 1) { modelAngle = 1; }
+    if(modelAngle > 50) { modelAngle = 50; }
+
+    if( (now % edgePeriod) == 0U )
+    {
+      measured = (long)(modelAngle + 0.5f);
+      if(edgeRate == true)
+      {
+        angle = measured;
+        vvtPID.ComputeDt((now - lastEdge) * 1000UL);
+      }
+      lastEdge = now;
+    }
+    if( (edgeRate == false) && ((now % 33U) == 0U) )
+    {
+      angle = measured;
+      vvtPID.ComputeAt(now, 0);
+    }
+    TEST_ASSERT_TRUE( (output >= 40) && (output <= 160) );
+
+    long error = target - (long)(modelAngle + 0.5f);
+    if(-error > result.overshoot) { result.overshoot = -error; }
+    if( (error > 1) || (error < -1) ) { result.settleSample = (uint16_t)now; }
+    result.finalError = error;
+  }
+  return result;
+}
+
+static void test_pid_step_vvt_edge_rate(void)
+{
+  //4 cam edges per cycle at 3000rpm, one every 10mS
+  step_result_t fixedRate = runVVTStep(false, 10);
+  step_result_t edgeRate = runVVTStep(true, 10);
+
+  char message[96];
+  snprintf(message, sizeof(message), "VVT settle 30Hz: %u mS overshoot %ld, cam edge: %u mS overshoot %ld", fixedRate.settleSample, fixedRate.overshoot, edgeRate.settleSample, edgeRate.overshoot);
+  TEST_MESSAGE(message);
+
+  TEST_ASSERT_INT32_WITHIN(1, 0, edgeRate.finalError);
+  TEST_ASSERT_TRUE(edgeRate.overshoot < fixedRate.overshoot);
+  TEST_ASSERT_TRUE(edgeRate.settleSample < fixedRate.settleSample);
+}
+
+static void test_pid_step_ego(void)
+{
+  //Closed loop O2. Output is the fuel correction in %, REVERSE as adding fuel lowers the AFR
+  long afr = 155, output = 0, target = 147;
+  fixedPID<16> egoPID(&afr, &output, &target, REVERSE);
+  egoPID.SetOutputLimits(-15, 15);
+  egoPID.SetSampleTime(0);
+  egoPID.SetTunings(200, 60, 0, 1, 1000);
+  egoPID.SetDerivativeFilter(1);
+  egoPID.SetMode(AUTOMATIC);
+
+  float modelAFR = 155;
+  step_result_t result = runStep(egoPID, afr, output, 147, 1, 0, 1, [&](long correction) {
+    TEST_ASSERT_TRUE( (correction >= -15) && (correction <= 15) );
+    modelAFR += ((155.0f * 100.0f / (100.0f + correction)) - modelAFR) / 2.0f; //The O2 sensor lags behind the fuel change
+    return (long)(modelAFR + 0.5f);
+  });
+  TEST_ASSERT_INT32_WITHIN(1, 0, result.finalError);
+  TEST_ASSERT_TRUE(result.overshoot < 4);
+  TEST_ASSERT_TRUE(result.settleSample < 100U);
+  TEST_ASSERT_INT32_WITHIN(1, 5, output);
+}
+
+static void test_pid_benchmark(void)
+{
+  long input = 800, output = 0, setpoint = 900;
+  fixedPID<PID_SHIFTS> pid(&input, &output, &setpoint, DIRECT);
+  pid.SetOutputLimits(0, 4000);
+  pid.SetSampleTime(0);
+  pid.SetTunings(50, 40, 10);
+  pid.SetDerivativeFilter(1);
+  pid.SetBackCalculation(2);
+  pid.SetMode(AUTOMATIC);
+
+  const uint32_t runs = 1000000UL;
+  uint32_t computed = 0;
+  auto start = std::chrono::steady_clock::now();
+  for(uint32_t run = 1; run <= runs; run++)
+  {
+    input = 800 + (run & 127U);
+    if(pid.ComputeAt(run, (long)(run & 255U))) { computed++; }
+  }
+  auto elapsed = std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - start).count();
+
+  char message[64];
+  snprintf(message, sizeof(message), "fixedPID Compute: %.1f ns", (double)elapsed / runs);
+  TEST_MESSAGE(message);
+  TEST_ASSERT_EQUAL_UINT32(runs, computed);
+}
+
+int main(int argc, char **argv) {
+  UNITY_BEGIN();
+
+  RUN_TEST(test_pid_proportional_scaling);
+  RUN_TEST(test_pid_sample_time);
+  RUN_TEST(test_pid_output_and_integral_limits);
+  RUN_TEST(test_pid_no_derivative_kick);
+  RUN_TEST(test_pid_derivative_filter);
+  RUN_TEST(test_pid_back_calculation);
+  RUN_TEST(test_pid_initialize_is_bumpless);
+  RUN_TEST(test_pid_reset_integral_no_derivative_kick);
+  RUN_TEST(test_pid_dt_one_sample);
+  RUN_TEST(test_pid_dt_scaling);
+  RUN_TEST(test_pid_dt_large_derivative);
+  RUN_TEST(test_pid_step_idle);
+  RUN_TEST(test_pid_step_boost);
+  RUN_TEST(test_pid_step_vvt);
+  RUN_TEST(test_pid_step_vvt_edge_rate);
+  RUN_TEST(test_pid_step_ego);
+  RUN_TEST(test_pid_benchmark);
+
+  UNITY_END();
+
+  return 0;
+}
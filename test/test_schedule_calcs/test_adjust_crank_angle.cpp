@@ -1,6 +1,7 @@
 #include <Arduino.h>
 #include <unity.h>
 #include "schedule_calcs.h"
+#include "test_calcs_common.h"
 
 static void nullIgnCallback(void) {};
 
@@ -73,9 +74,81 @@ void test_adjust_crank_angle_running()
     TEST_ASSERT_FALSE(schedule.endScheduleSetByDecoder);
 }
 
+void test_adjust_crank_angle_running_dwell_limit()
+{
+    auto counter = decltype(+IGN4_COUNTER){0};
+    auto compare = decltype(+IGN4_COMPARE){0};
+    IgnitionSchedule schedule(counter, compare, nullIgnCallback, nullIgnCallback);
+
+    setEngineSpeed(4000, 360);
+    schedule.Status = RUNNING;
+    currentStatus.startRevolutions = 2000;
+
+    schedule.compare = 101;
+    schedule.counter = 100;
+    schedule.endCompare = 100;
+    constexpr uint16_t newCrankAngle = 180;
+    constexpr uint16_t chargeAngle = 359;
+
+    // The new end is ~7.5ms away, past the limit set when the coil started charging
+    dwellLimitTicks = uS_TO_TIMER_COMPARE(2000U);
+    schedule.dwellLimitCompare = schedule.counter + uS_TO_TIMER_COMPARE(1000U);
+    adjustCrankAngle(schedule, chargeAngle, newCrankAngle);
+    TEST_ASSERT_EQUAL(schedule.dwellLimitCompare, schedule.compare);
+
+    // A new end before the limit is not changed
+    schedule.dwellLimitCompare = schedule.counter + uS_TO_TIMER_COMPARE(10000U);
+    adjustCrankAngle(schedule, chargeAngle, newCrankAngle);
+    TEST_ASSERT_EQUAL(schedule.counter+uS_TO_TIMER_COMPARE(angleToTimeMicroSecPerDegree(chargeAngle-newCrankAngle)), schedule.compare);
+
+    // No limit when the dwell limiter is off
+    dwellLimitTicks = 0;
+    schedule.dwellLimitCompare = schedule.counter + uS_TO_TIMER_COMPARE(1000U);
+    adjustCrankAngle(schedule, chargeAngle, newCrankAngle);
+    TEST_ASSERT_EQUAL(schedule.counter+uS_TO_TIMER_COMPARE(angleToTimeMicroSecPerDegree(chargeAngle-newCrankAngle)), schedule.compare);
+}
+
+void test_ignition_start_charge_dwell_limit()
+{
+    auto counter = decltype(+IGN4_COUNTER){0};
+    auto compare = decltype(+IGN4_COMPARE){0};
+    IgnitionSchedule schedule(counter, compare, nullIgnCallback, nullIgnCallback);
+
+    schedule.counter = 100;
+    schedule.duration = 8000;
+    schedule.endScheduleSetByDecoder = false;
+
+    // Dwell shorter than the limit. The end can still be moved out to the limit while RUNNING
+    dwellLimitTicks = uS_TO_TIMER_COMPARE(10000U);
+    ignitionStartCharge(schedule);
+    TEST_ASSERT_EQUAL(schedule.counter+uS_TO_TIMER_COMPARE(8000U), schedule.endCompare);
+    TEST_ASSERT_EQUAL(schedule.counter+uS_TO_TIMER_COMPARE(10000U), schedule.dwellLimitCompare);
+
+    // Dwell longer than the limit is capped
+    dwellLimitTicks = uS_TO_TIMER_COMPARE(5000U);
+    ignitionStartCharge(schedule);
+    TEST_ASSERT_EQUAL(schedule.counter+uS_TO_TIMER_COMPARE(5000U), schedule.endCompare);
+    TEST_ASSERT_EQUAL(schedule.endCompare, schedule.dwellLimitCompare);
+
+    // So is an end set by the decoder
+    schedule.endScheduleSetByDecoder = true;
+    schedule.endCompare = schedule.counter + uS_TO_TIMER_COMPARE(7000U);
+    ignitionStartCharge(schedule);
+    TEST_ASSERT_EQUAL(schedule.counter+uS_TO_TIMER_COMPARE(5000U), schedule.endCompare);
+
+    // No limit when the dwell limiter is off
+    dwellLimitTicks = 0;
+    schedule.endScheduleSetByDecoder = false;
+    ignitionStartCharge(schedule);
+    TEST_ASSERT_EQUAL(schedule.counter+uS_TO_TIMER_COMPARE(8000U), schedule.endCompare);
+    TEST_ASSERT_EQUAL(schedule.endCompare, schedule.dwellLimitCompare);
+}
+
 void test_adjust_crank_angle()
 {
     RUN_TEST(test_adjust_crank_angle_pending_below_minrevolutions);
     RUN_TEST(test_adjust_crank_angle_pending_above_minrevolutions);
     RUN_TEST(test_adjust_crank_angle_running);
+    RUN_TEST(test_adjust_crank_angle_running_dwell_limit);
+    RUN_TEST(test_ignition_start_charge_dwell_limit);
 }
\ No newline at end of file
@@ -0,0 +1,320 @@
+#include <unity.h>
+#include <vector>
+#define USE_SOFT_PWM
+#include "../../speeduino/softPWMEdges.cpp"
+
+/*
+The edge list is run against a model of a 16 bit timer that counts 1 tick at a time and calls softPWMEdgeService() when the counter matches the compare,
+the same as the compare interrupt. Every output change is recorded with the (Unwrapped) tick it happened on.
+Setting the compare can be made to take some ticks, to check that edges the counter passes while the compare is being set are not missed.
+*/
+
+struct edge_t
+{
+  uint32_t time;
+  uint8_t channel;
+  bool on;
+};
+
+#define AUX_TACHO_CHANNEL 5U
+
+static uint32_t elapsed; //Ticks since the start of the test
+static uint16_t counterStart;
+static uint16_t compare;
+static bool timerEnabled;
+static uint8_t compareSetTicks; //Ticks that pass each time the compare is set
+static uint32_t services;
+static std::vector<edge_t> edges;
+
+uint16_t softPWMHwCounter(void) { return (uint16_t)(counterStart + elapsed); }
+void softPWMHwSetCompare(uint16_t newCompare) { compare = newCompare; elapsed += compareSetTicks; }
+void softPWMHwTimerEnable(void) { timerEnabled = true; }
+void softPWMHwTimerDisable(void) { timerEnabled = false; }
+void softPWMHwOutput(uint8_t channel, bool on) { edges.push_back({ elapsed, channel, on }); }
+
+static void resetTimer(uint16_t counter)
+{
+  for(uint8_t channel = 0; channel < SOFT_PWM_MAX_CHANNELS; channel++)
+  {
+    softPWMEdgeStop(channel);
+    softPWMEdgeSetDuty(channel, 0, 0);
+  }
+  elapsed = 0;
+  counterStart = counter;
+  compare = 0;
+  timerEnabled = false;
+  compareSetTicks = 0;
+  services = 0;
+  edges.clear();
+}
+
+static void run(uint32_t ticks)
+{
+  uint32_t end = elapsed + ticks;
+  while(elapsed < end)
+  {
+    elapsed++;
+    if( (timerEnabled == true) && (softPWMHwCounter() == compare) )
+    {
+      services++;
+      softPWMEdgeService();
+    }
+  }
+}
+
+static std::vector<edge_t> channelEdges(uint8_t channel)
+{
+  std::vector<edge_t> result;
+  for(const edge_t &edge : edges) { if(edge.channel == channel) { result.push_back(edge); } }
+  return result;
+}
+
+//Checks the channel runs the given duty from its first edge: on for onTicks then off, every periodTicks.
+//An edge can be processed up to SOFT_PWM_MIN_TICKS early along with an edge of another channel, but never late and the error must not build up
+static void assertPWM(uint8_t channel, uint16_t onTicks, uint16_t periodTicks, size_t minimumPeriods)
+{
+  std::vector<edge_t> result = channelEdges(channel);
+  TEST_ASSERT_TRUE(result.size() >= (minimumPeriods * 2U));
+  uint32_t start = result[0].time;
+  for(size_t x = 0; x < result.size(); x++)
+  {
+    uint32_t period = x / 2U;
+    bool on = ((x % 2U) == 0U);
+    TEST_ASSERT_EQUAL(on, result[x].on);
+    uint32_t expected = start + (period * periodTicks) + (on ? 0U : onTicks);
+    TEST_ASSERT_TRUE(result[x].time <= expected);
+    TEST_ASSERT_TRUE((expected - result[x].time) <= SOFT_PWM_MIN_TICKS);
+  }
+}
+
+static void test_soft_pwm_duty(void)
+{
+  resetTimer(1000);
+  softPWMEdgeSetDuty(0, 10, 40);
+  softPWMEdgeStart(0);
+  TEST_ASSERT_TRUE(timerEnabled);
+  run(400);
+  assertPWM(0, 10, 40, 9);
+  TEST_ASSERT_EQUAL_UINT32(SOFT_PWM_MIN_TICKS * 2U, edges[0].time); //First period starts straight away
+
+  softPWMEdgeStop(0);
+  TEST_ASSERT_FALSE(timerEnabled);
+  size_t count = edges.size();
+  run(100);
+  TEST_ASSERT_EQUAL_UINT32(count, edges.size());
+}
+
+static void test_soft_pwm_zero_and_full_duty(void)
+{
+  //0% and 100% never toggle, but the channel keeps running so a new duty starts at the next period
+  resetTimer(0);
+  softPWMEdgeSetDuty(0, 0, 50);
+  softPWMEdgeSetDuty(1, 50, 50);
+  softPWMEdgeStart(0);
+  softPWMEdgeStart(1);
+  run(500);
+  for(const edge_t &edge : channelEdges(0)) { TEST_ASSERT_FALSE(edge.on); }
+  for(const edge_t &edge : channelEdges(1)) { TEST_ASSERT_TRUE(edge.on); }
+  TEST_ASSERT_TRUE(channelEdges(0).size() >= 9U); //Once per period
+
+  edges.clear();
+  softPWMEdgeSetDuty(0, 20, 50);
+  softPWMEdgeSetDuty(1, 20, 50);
+  run(500);
+  assertPWM(0, 20, 50, 9);
+  assertPWM(1, 20, 50, 9);
+}
+
+static void test_soft_pwm_latching(void)
+{
+  //A duty change part way through a period only takes effect at the start of the next period
+  resetTimer(0);
+  softPWMEdgeSetDuty(0, 30, 100);
+  softPWMEdgeStart(0);
+  run(10); //Part way through the first on time
+  softPWMEdgeSetDuty(0, 60, 200);
+  run(1000);
+
+  std::vector<edge_t> result = channelEdges(0);
+  TEST_ASSERT_TRUE(result.size() >= 6U);
+  uint32_t start = result[0].time;
+  TEST_ASSERT_EQUAL_UINT32(start + 30U, result[1].time); //The pulse that had started keeps its length
+  TEST_ASSERT_EQUAL_UINT32(start + 100U, result[2].time); //And its period
+  TEST_ASSERT_TRUE(result[2].on);
+  TEST_ASSERT_EQUAL_UINT32(start + 160U, result[3].time);
+  TEST_ASSERT_EQUAL_UINT32(start + 300U, result[4].time);
+  TEST_ASSERT_EQUAL_UINT32(start + 360U, result[5].time);
+}
+
+static void test_soft_pwm_same_tick(void)
+{
+  //Channels with edges on the same tick are all processed by one interrupt, in the order they were started
+  resetTimer(0);
+  softPWMEdgeSetDuty(2, 25, 100);
+  softPWMEdgeSetDuty(0, 25, 100);
+  softPWMEdgeSetDuty(1, 50, 100);
+  softPWMEdgeStart(2);
+  softPWMEdgeStart(0);
+  softPWMEdgeStart(1);
+  run(1000);
+  assertPWM(0, 25, 100, 9);
+  assertPWM(1, 50, 100, 9);
+  assertPWM(2, 25, 100, 9);
+  TEST_ASSERT_EQUAL(2, edges[0].channel);
+  TEST_ASSERT_EQUAL(0, edges[1].channel);
+  TEST_ASSERT_EQUAL(1, edges[2].channel);
+  //Each period is 3 interrupts: all 3 on, channels 0 and 2 off, channel 1 off
+  TEST_ASSERT_TRUE(services <= 31U);
+}
+
+static void test_soft_pwm_counter_wrap(void)
+{
+  resetTimer(UINT16_MAX - 150U);
+  softPWMEdgeSetDuty(0, 7, 33);
+  softPWMEdgeSetDuty(1, 90, 120);
+  softPWMEdgeStart(0);
+  softPWMEdgeStart(1);
+  run(1000);
+  assertPWM(0, 7, 33, 29);
+  assertPWM(1, 90, 120, 8);
+}
+
+static void test_soft_pwm_stop_channel(void)
+{
+  //Removing a channel from the middle of the list leaves the others running on time
+  resetTimer(0);
+  softPWMEdgeSetDuty(0, 10, 60);
+  softPWMEdgeSetDuty(1, 20, 70);
+  softPWMEdgeSetDuty(2, 30, 80);
+  softPWMEdgeStart(0);
+  softPWMEdgeStart(1);
+  softPWMEdgeStart(2);
+  run(205);
+  softPWMEdgeStop(1);
+  TEST_ASSERT_FALSE(softPWMEdgeActive(1));
+  size_t channel1Edges = channelEdges(1).size();
+  run(1000);
+  TEST_ASSERT_EQUAL_UINT32(channel1Edges, channelEdges(1).size());
+  assertPWM(0, 10, 60, 19);
+  assertPWM(2, 30, 80, 14);
+
+  softPWMEdgeStop(0);
+  TEST_ASSERT_TRUE(timerEnabled);
+  softPWMEdgeStop(2);
+  TEST_ASSERT_FALSE(timerEnabled);
+}
+
+static void test_soft_pwm_late_compare(void)
+{
+  //Setting the compare takes longer than SOFT_PWM_MIN_TICKS, so the counter can pass the next edge before the compare is set.
+  //The edge must be processed straight away rather than after the counter wraps around
+  resetTimer(0);
+  compareSetTicks = SOFT_PWM_MIN_TICKS + 1U;
+  softPWMEdgeSetDuty(0, 3, 40); //The off edge is due as the compare for it is being set
+  softPWMEdgeStart(0);
+  run(800);
+
+  std::vector<edge_t> result = channelEdges(0);
+  TEST_ASSERT_TRUE(result.size() >= 30U);
+  for(size_t x = 1; x < result.size(); x++)
+  {
+    uint32_t expected = (result[x].on ? 37U : 3U);
+    TEST_ASSERT_UINT32_WITHIN(compareSetTicks, expected, result[x].time - result[x-1U].time);
+  }
+}
+
+static void test_soft_pwm_pulses(void)
+{
+  //Pulses requested close together are spaced a full period apart rather than merged
+  resetTimer(500);
+  softPWMEdgePulse(5, 8, 50, 1);
+  run(3);
+  softPWMEdgePulse(5, 8, 50, 1);
+  run(3);
+  softPWMEdgePulse(5, 8, 50, 1);
+  run(500);
+
+  std::vector<edge_t> result = channelEdges(5);
+  TEST_ASSERT_EQUAL_UINT32(6, result.size());
+  assertPWM(5, 8, 50, 3);
+  TEST_ASSERT_FALSE(softPWMEdgeActive(5)); //Removed once the last period has passed
+  TEST_ASSERT_FALSE(timerEnabled);
+
+  //Idle again, the next pulse starts straight away
+  edges.clear();
+  uint32_t start = elapsed;
+  softPWMEdgePulse(5, 8, 50, 2);
+  run(500);
+  result = channelEdges(5);
+  TEST_ASSERT_EQUAL_UINT32(4, result.size());
+  TEST_ASSERT_EQUAL_UINT32(start + (SOFT_PWM_MIN_TICKS * 2U), result[0].time);
+  assertPWM(5, 8, 50, 2);
+}
+
+static void test_soft_pwm_pulse_saturation(void)
+{
+  //The pulses still to output stop at 255 rather than wrapping
+  resetTimer(0);
+  softPWMEdgePulse(5, 2, 4, 200);
+  softPWMEdgePulse(5, 2, 4, 100);
+  run(4U * 300U);
+  TEST_ASSERT_EQUAL_UINT32(255U * 2U, channelEdges(5).size());
+  TEST_ASSERT_FALSE(softPWMEdgeActive(5));
+}
+
+//The tacho requests its pulses the same way as tachoPulse() in timers.cpp: 1 (Or 2 for Double) per ignition event, with the period set by updateTachoPulse()
+static void test_soft_pwm_tacho_double(void)
+{
+  //Double at an ignition event every 400 ticks. The 2 pulses of each event are evenly spaced and the pulses from one event never run into the next
+  resetTimer(60000);
+  const uint16_t eventTicks = 400;
+  const uint16_t periodTicks = eventTicks / 2U;
+  const uint16_t pulseTicks = 62; //Configured duration, less than half of the period
+  for(uint8_t event = 0; event < 20U; event++)
+  {
+    softPWMEdgePulse(AUX_TACHO_CHANNEL, pulseTicks, periodTicks, 2);
+    run(eventTicks);
+  }
+  run(eventTicks);
+
+  TEST_ASSERT_EQUAL_UINT32(20U * 2U * 2U, channelEdges(AUX_TACHO_CHANNEL).size());
+  assertPWM(AUX_TACHO_CHANNEL, pulseTicks, periodTicks, 40);
+  TEST_ASSERT_FALSE(softPWMEdgeActive(AUX_TACHO_CHANNEL));
+}
+
+static void test_soft_pwm_tacho_backlog(void)
+{
+  //Ignition events arriving faster than the current period (RPM rising before updateTachoPulse() has caught up) queue up rather than merging or being lost,
+  //and the backlog saturates rather than wrapping around to a few pulses
+  resetTimer(0);
+  for(uint16_t event = 0; event < 300U; event++)
+  {
+    softPWMEdgePulse(AUX_TACHO_CHANNEL, 10, 40, 1);
+    run(1);
+  }
+  run(40U * 300U);
+
+  //A few pulses are output while the events arrive, after that the backlog sits at 255 and the rest are dropped. Wrapping would leave far fewer than 255
+  std::vector<edge_t> result = channelEdges(AUX_TACHO_CHANNEL);
+  TEST_ASSERT_TRUE(result.size() > (255U * 2U));
+  TEST_ASSERT_TRUE(result.size() < (300U * 2U));
+  assertPWM(AUX_TACHO_CHANNEL, 10, 40, 255);
+  TEST_ASSERT_FALSE(softPWMEdgeActive(AUX_TACHO_CHANNEL));
+}
+
+int main(int argc, char **argv) {
+  UNITY_BEGIN();
+
+  RUN_TEST(test_soft_pwm_duty);
+  RUN_TEST(test_soft_pwm_zero_and_full_duty);
+  RUN_TEST(test_soft_pwm_latching);
+  RUN_TEST(test_soft_pwm_same_tick);
+  RUN_TEST(test_soft_pwm_counter_wrap);
+  RUN_TEST(test_soft_pwm_stop_channel);
+  RUN_TEST(test_soft_pwm_late_compare);
+  RUN_TEST(test_soft_pwm_pulses);
+  RUN_TEST(test_soft_pwm_pulse_saturation);
+  RUN_TEST(test_soft_pwm_tacho_double);
+  RUN_TEST(test_soft_pwm_tacho_backlog);
+  return UNITY_END();
+}
@@ -0,0 +1,233 @@
+#include <unity.h>
+#include <vector>
+#include "../../speeduino/stepGenerator.cpp"
+
+/*
+The generator is run 1mS at a time with a model of the motor and driver that records the pin changes. The model checks the pins are driven
+correctly (No step without the driver on or without a direction, the direction and enable set in an earlier tick than the step, and the step pin
+always alternates) and records the time of every step.
+*/
+
+struct motor_t
+{
+  bool enabled;
+  bool stepPin;
+  int8_t direction; //1 more air, -1 less air, 0 not set
+  int32_t position; //Steps away from the home stop
+  std::vector<uint32_t> stepTimes;
+  uint32_t now;
+  uint32_t disabledAt;
+  uint32_t setupAt; //Last tick the direction or enable pin changed
+};
+
+static motor_t motor;
+
+static void resetMotor(int32_t position)
+{
+  motor.enabled = false;
+  motor.stepPin = false;
+  motor.direction = 0;
+  motor.position = position;
+  motor.stepTimes.clear();
+  motor.now = 0;
+  motor.disabledAt = 0;
+  motor.setupAt = 0;
+}
+
+static void run(uint32_t ms)
+{
+  for(uint32_t tick = 0; tick < ms; tick++)
+  {
+    motor.now++;
+    uint8_t pins = stepperTick();
+    if(pins & STEP_BIT(STEPPER_PIN_ENABLE)) { motor.enabled = true; motor.setupAt = motor.now; }
+    if(pins & STEP_BIT(STEPPER_PIN_DISABLE)) { motor.enabled = false; motor.disabledAt = motor.now; }
+    if( (pins & STEP_BIT(STEPPER_PIN_MORE_AIR)) && (motor.direction != 1) ) { motor.direction = 1; motor.setupAt = motor.now; }
+    if( (pins & STEP_BIT(STEPPER_PIN_LESS_AIR)) && (motor.direction != -1) ) { motor.direction = -1; motor.setupAt = motor.now; }
+    if(pins & STEP_BIT(STEPPER_PIN_STEP_OFF))
+    {
+      TEST_ASSERT_TRUE(motor.stepPin);
+      motor.stepPin = false;
+    }
+    if(pins & STEP_BIT(STEPPER_PIN_STEP_ON))
+    {
+      TEST_ASSERT_FALSE(motor.stepPin);
+      TEST_ASSERT_TRUE(motor.enabled);
+      TEST_ASSERT_TRUE(motor.direction != 0);
+      TEST_ASSERT_TRUE(motor.setupAt < motor.now); //The driver must see the direction before the step edge
+      motor.stepPin = true;
+      motor.position += motor.direction;
+      if(motor.position < 0) { motor.position = 0; } //Against the home stop
+      motor.stepTimes.push_back(motor.now);
+    }
+  }
+}
+
+static void test_step_generator_homing(void)
+{
+  resetMotor(40);
+  stepperConfigure(2, 1, 0, 0, true);
+  stepperSetTarget(0);
+  stepperHome(60);
+  TEST_ASSERT_FALSE(stepperHomed());
+  TEST_ASSERT_TRUE(stepperMoving());
+
+  run((60U * 3U) + 1U); //+1 for the tick that sets the driver and direction before the first step
+  TEST_ASSERT_EQUAL_UINT32(60, motor.stepTimes.size());
+  TEST_ASSERT_EQUAL_INT32(0, motor.position);
+  TEST_ASSERT_TRUE(stepperHomed());
+  TEST_ASSERT_EQUAL_INT16(0, stepperPosition());
+
+  //Steps are exactly the step time + cool time apart
+  for(size_t step = 1; step < motor.stepTimes.size(); step++) { TEST_ASSERT_EQUAL_UINT32(3, motor.stepTimes[step] - motor.stepTimes[step - 1U]); }
+
+  run(5);
+  TEST_ASSERT_FALSE(motor.enabled); //Driver is turned off once stopped
+  TEST_ASSERT_FALSE(stepperMoving());
+}
+
+static void test_step_generator_target(void)
+{
+  resetMotor(0);
+  stepperConfigure(3, 0, 0, 2, true);
+  stepperHome(0);
+  TEST_ASSERT_TRUE(stepperHomed());
+
+  //Within the hysteresis, no move
+  stepperSetTarget(2);
+  run(50);
+  TEST_ASSERT_EQUAL_UINT32(0, motor.stepTimes.size());
+
+  //Beyond it the move goes all the way to the target. With no cool time the steps are the step time apart
+  stepperSetTarget(30);
+  run(2);
+  TEST_ASSERT_TRUE(stepperMoving());
+  run(200);
+  TEST_ASSERT_EQUAL_INT32(30, motor.position);
+  TEST_ASSERT_EQUAL_INT16(30, stepperPosition());
+  TEST_ASSERT_EQUAL_UINT32(30, motor.stepTimes.size());
+  for(size_t step = 1; step < motor.stepTimes.size(); step++) { TEST_ASSERT_EQUAL_UINT32(3, motor.stepTimes[step] - motor.stepTimes[step - 1U]); }
+
+  //The target changing during a move, including back past the position
+  stepperSetTarget(50);
+  run(20);
+  stepperSetTarget(10);
+  run(300);
+  TEST_ASSERT_EQUAL_INT32(10, motor.position);
+  TEST_ASSERT_FALSE(stepperMoving());
+  TEST_ASSERT_FALSE(motor.enabled);
+
+  //Driver left on when powered all the time
+  stepperConfigure(3, 0, 0, 2, false);
+  stepperSetTarget(20);
+  run(100);
+  TEST_ASSERT_EQUAL_INT32(20, motor.position);
+  TEST_ASSERT_TRUE(motor.enabled);
+}
+
+static void test_step_generator_ramp(void)
+{
+  resetMotor(0);
+  stepperConfigure(2, 1, 4, 0, true);
+  stepperHome(0);
+  stepperSetTarget(20);
+  run(500);
+  TEST_ASSERT_EQUAL_INT32(20, motor.position);
+  TEST_ASSERT_EQUAL_UINT32(20, motor.stepTimes.size());
+
+  //Slowest at each end, full speed (Step + cool time) in the middle
+  const uint32_t expected[19] = { 6, 5, 4, 3, 3, 3, 3, 3, 3, 3, 3, 3, 3, 3, 3, 3, 4, 5, 6 };
+  for(size_t step = 1; step < motor.stepTimes.size(); step++) { TEST_ASSERT_EQUAL_UINT32(expected[step - 1U], motor.stepTimes[step] - motor.stepTimes[step - 1U]); }
+
+  //A short move never gets up to speed
+  motor.stepTimes.clear();
+  stepperSetTarget(23);
+  run(100);
+  TEST_ASSERT_EQUAL_INT32(23, motor.position);
+  TEST_ASSERT_EQUAL_UINT32(3, motor.stepTimes.size());
+  TEST_ASSERT_EQUAL_UINT32(6, motor.stepTimes[1] - motor.stepTimes[0]);
+  TEST_ASSERT_EQUAL_UINT32(6, motor.stepTimes[2] - motor.stepTimes[1]);
+}
+
+static void test_step_generator_cool_time(void)
+{
+  //No cool time steps at the step time, 1mS of cool time is 1mS slower
+  resetMotor(0);
+  stepperConfigure(1, 0, 0, 0, true);
+  stepperHome(0);
+  stepperSetTarget(10);
+  run(50);
+  TEST_ASSERT_EQUAL_INT32(10, motor.position);
+  TEST_ASSERT_EQUAL_UINT32(2, motor.stepTimes[0]); //The first step waits 1 tick for the driver and direction
+  for(size_t step = 1; step < motor.stepTimes.size(); step++) { TEST_ASSERT_EQUAL_UINT32(1, motor.stepTimes[step] - motor.stepTimes[step - 1U]); }
+
+  motor.stepTimes.clear();
+  stepperConfigure(1, 1, 0, 0, true);
+  stepperSetTarget(20);
+  run(50);
+  TEST_ASSERT_EQUAL_INT32(20, motor.position);
+  for(size_t step = 1; step < motor.stepTimes.size(); step++) { TEST_ASSERT_EQUAL_UINT32(2, motor.stepTimes[step] - motor.stepTimes[step - 1U]); }
+}
+
+static void test_step_generator_reverse(void)
+{
+  //Reversing with no cool time. The model checks the direction changes at least 1 tick before the next step, which costs 1 tick
+  resetMotor(0);
+  stepperConfigure(2, 0, 0, 0, false);
+  stepperHome(0);
+  stepperSetTarget(10);
+  run(13);
+  TEST_ASSERT_TRUE(stepperMoving());
+  TEST_ASSERT_TRUE(motor.position < 10);
+  stepperSetTarget(0);
+  run(100);
+  TEST_ASSERT_EQUAL_INT32(0, motor.position);
+  TEST_ASSERT_EQUAL_INT16(0, stepperPosition());
+
+  size_t reverseStep = 0;
+  for(size_t step = 1; step < motor.stepTimes.size(); step++)
+  {
+    uint32_t gap = motor.stepTimes[step] - motor.stepTimes[step - 1U];
+    if(gap != 2U)
+    {
+      TEST_ASSERT_EQUAL_UINT32(3, gap);
+      TEST_ASSERT_EQUAL_UINT32(0, reverseStep);
+      reverseStep = step;
+    }
+  }
+  TEST_ASSERT_TRUE(reverseStep > 0U);
+
+  //A new move after stopping, with the driver still on and the direction already set, needs no setup tick
+  motor.stepTimes.clear();
+  uint32_t start = motor.now;
+  stepperSetTarget(-5);
+  run(20);
+  TEST_ASSERT_EQUAL_INT16(-5, stepperPosition());
+  TEST_ASSERT_EQUAL_UINT32(start + 1U, motor.stepTimes[0]);
+}
+
+static void test_step_generator_long_cool(void)
+{
+  //Cool time and ramp time together are more than 255mS
+  resetMotor(0);
+  stepperConfigure(1, 250, 200, 0, true);
+  stepperHome(0);
+  stepperSetTarget(3);
+  run(2000);
+  TEST_ASSERT_EQUAL_INT32(3, motor.position);
+  TEST_ASSERT_EQUAL_UINT32(3, motor.stepTimes.size());
+  TEST_ASSERT_EQUAL_UINT32(1U + 250U + 199U, motor.stepTimes[1] - motor.stepTimes[0]);
+  TEST_ASSERT_EQUAL_UINT32(1U + 250U + 199U, motor.stepTimes[2] - motor.stepTimes[1]);
+}
+
+int main(int argc, char **argv) {
+  UNITY_BEGIN();
+
+  RUN_TEST(test_step_generator_homing);
+  RUN_TEST(test_step_generator_target);
+  RUN_TEST(test_step_generator_ramp);
+  RUN_TEST(test_step_generator_cool_time);
+  RUN_TEST(test_step_generator_reverse);
+  RUN_TEST(test_step_generator_long_cool);
+  return UNITY_END();
+}
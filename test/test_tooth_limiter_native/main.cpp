@@ -0,0 +1,155 @@
+#include <unity.h>
+#include <math.h>
+#include "../../speeduino/toothLimiter.cpp"
+
+/*
+The limiter is driven by a synthetic 36-1 crank wheel with the engine accelerating (Or decelerating) at a constant rate. The tooth times are calculated from the
+crank angle against time, so the period of each tooth reflects the instantaneous speed as on a real engine. As the decoder does, the tooth after the gap is
+not passed to the limiter as its angle is not the normal tooth angle.
+*/
+
+#define TEST_TEETH          36U
+#define TEST_TOOTH_ANGLE    10U
+#define TEST_LIMIT          7000U
+
+struct test_run_t
+{
+  int32_t cutTooth; //Index of the tooth that started the cut, -1 if there was none
+  double cutRPM; //Instantaneous RPM at the cut
+  int32_t resumeTooth;
+  double resumeRPM;
+};
+
+static void setLimit(uint16_t limitRPM)
+{
+  toothLimiterSet(toothLimiterPeriod(limitRPM, TEST_TOOTH_ANGLE), toothLimiterPeriod(limitRPM - TOOTH_LIMITER_HYSTERESIS, TEST_TOOTH_ANGLE), TEST_TOOTH_ANGLE);
+}
+
+//Runs the wheel from startRPM changing at rpmPerSecond until the RPM reaches endRPM
+static test_run_t runWheel(double startRPM, double rpmPerSecond, double endRPM)
+{
+  test_run_t run = { -1, 0, -1, 0 };
+  double rpm = startRPM;
+  double lastTime = 0; //uS
+  double time = 0;
+  uint16_t angle = 0;
+  int32_t tooth = 0;
+
+  while( (rpmPerSecond >= 0) ? (rpm < endRPM) : (rpm > endRPM) )
+  {
+    //Advance 1 degree at a time, integrating the speed
+    double degreeTime = 166666.67 / rpm;
+    time += degreeTime;
+    rpm += rpmPerSecond * (degreeTime / 1000000.0);
+    angle++;
+    if( (angle % TEST_TOOTH_ANGLE) != 0U ) { continue; }
+
+    uint16_t toothInRev = (angle / TEST_TOOTH_ANGLE) % TEST_TEETH;
+    if(toothInRev == (TEST_TEETH - 1U)) { continue; } //The missing tooth
+
+    uint32_t gap = (uint32_t)lround(time - lastTime);
+    lastTime = time;
+    tooth++;
+    if(toothInRev == 0U) { continue; } //Tooth after the gap, the decoder flags its angle as not correct
+
+    bool wasActive = toothLimiterActive();
+    if(toothLimiterTooth(gap, TEST_TOOTH_ANGLE) == true)
+    {
+      if(run.cutTooth < 0) { run.cutTooth = tooth; run.cutRPM = 166666.67 * TEST_TOOTH_ANGLE / gap; }
+    }
+    if( (wasActive == true) && (toothLimiterActive() == false) && (run.resumeTooth < 0) ) { run.resumeTooth = tooth; run.resumeRPM = 166666.67 * TEST_TOOTH_ANGLE / gap; }
+  }
+  return run;
+}
+
+static void resetLimiter(void)
+{
+  toothLimiterSet(0, 0, 0);
+}
+
+static void test_tooth_limiter_period(void)
+{
+  TEST_ASSERT_EQUAL_UINT32(238, toothLimiterPeriod(7000, 10)); //166667 * 10 / 7000
+  TEST_ASSERT_EQUAL_UINT32(0, toothLimiterPeriod(0, 10));
+}
+
+//Below the limit there is never a cut, including on the slow tooth after the gap
+static void test_tooth_limiter_below_limit(void)
+{
+  resetLimiter();
+  setLimit(TEST_LIMIT);
+  test_run_t run = runWheel(3000, 5000, TEST_LIMIT - 50);
+  TEST_ASSERT_EQUAL_INT32(-1, run.cutTooth);
+  TEST_ASSERT_FALSE(toothLimiterActive());
+}
+
+//Fast acceleration through the limit. The cut must start within one tooth of the limit, at any acceleration
+static void test_tooth_limiter_overshoot(void)
+{
+  const double rates[] = { 2000, 10000, 30000 }; //RPM per second
+  for(uint8_t x = 0; x < 3U; x++)
+  {
+    resetLimiter();
+    setLimit(TEST_LIMIT);
+    test_run_t run = runWheel(6000, rates[x], TEST_LIMIT + 500);
+    TEST_ASSERT_TRUE(run.cutTooth >= 0);
+    TEST_ASSERT_TRUE(toothLimiterActive());
+
+    //One tooth at the limit takes 238uS, over which the RPM can rise by at most rate * 238uS. Allow for the rounding of the period to whole uS
+    double maxOvershoot = (rates[x] * 0.000238) + 35;
+    TEST_ASSERT_TRUE(run.cutRPM >= TEST_LIMIT);
+    TEST_ASSERT_TRUE(run.cutRPM <= (TEST_LIMIT + maxOvershoot));
+  }
+}
+
+//The cut is held until the RPM drops below the limit minus the hysteresis
+static void test_tooth_limiter_resume(void)
+{
+  resetLimiter();
+  setLimit(TEST_LIMIT);
+  test_run_t run = runWheel(6900, 10000, TEST_LIMIT + 200);
+  TEST_ASSERT_TRUE(toothLimiterActive());
+
+  run = runWheel(TEST_LIMIT + 200, -5000, TEST_LIMIT - 300);
+  TEST_ASSERT_TRUE(run.resumeTooth >= 0);
+  TEST_ASSERT_FALSE(toothLimiterActive());
+  TEST_ASSERT_TRUE(run.resumeRPM < (TEST_LIMIT - TOOTH_LIMITER_HYSTERESIS));
+  TEST_ASSERT_TRUE(run.resumeRPM > (TEST_LIMIT - TOOTH_LIMITER_HYSTERESIS - 50));
+}
+
+//Only 1 cut is reported while the engine stays over the limit
+static void test_tooth_limiter_single_cut(void)
+{
+  resetLimiter();
+  setLimit(TEST_LIMIT);
+  TEST_ASSERT_TRUE(toothLimiterTooth(200, TEST_TOOTH_ANGLE));
+  TEST_ASSERT_FALSE(toothLimiterTooth(200, TEST_TOOTH_ANGLE));
+  TEST_ASSERT_FALSE(toothLimiterTooth(220, TEST_TOOTH_ANGLE));
+  TEST_ASSERT_TRUE(toothLimiterActive());
+}
+
+//Teeth of a different angle are ignored, as is everything once the limiter is turned off
+static void test_tooth_limiter_ignored(void)
+{
+  resetLimiter();
+  setLimit(TEST_LIMIT);
+  TEST_ASSERT_FALSE(toothLimiterTooth(200, TEST_TOOTH_ANGLE * 2U));
+  TEST_ASSERT_FALSE(toothLimiterActive());
+
+  TEST_ASSERT_TRUE(toothLimiterTooth(200, TEST_TOOTH_ANGLE));
+  resetLimiter();
+  TEST_ASSERT_FALSE(toothLimiterActive());
+  TEST_ASSERT_FALSE(toothLimiterTooth(100, TEST_TOOTH_ANGLE));
+}
+
+int main(int argc, char **argv)
+{
+  UNITY_BEGIN();
+  RUN_TEST(test_tooth_limiter_period);
+  RUN_TEST(test_tooth_limiter_below_limit);
+  RUN_TEST(test_tooth_limiter_overshoot);
+  RUN_TEST(test_tooth_limiter_resume);
+  RUN_TEST(test_tooth_limiter_single_cut);
+  RUN_TEST(test_tooth_limiter_ignored);
+  return UNITY_END();
+}
@@ -0,0 +1,146 @@
+#!/usr/bin/env python3
+"""Validates MegaLogViewer binary (.mlg) log files written by the Speeduino SD logger.
+
+The header, every field descriptor and every data block are checked. Any problems are reported and the
+script exits with a non-zero status so it can be used in scripts. The format is described in speeduino/SD_logger.h.
+
+Usage:
+    mlg_validate.py SPD_0001.mlg
+    mlg_validate.py SPD_0001.mlg --dump 10        # Also print the first 10 records as human readable values
+"""
+import argparse
+import struct
+import sys
+
+HEADER_FORMAT = ">6sHIHIHH"
+FIELD_FORMAT = ">B34s10sBffb"
+BLOCK_TYPE_DATA = 0
+BLOCK_TYPE_MARKER = 1
+MARKER_LENGTH = 50
+
+# MLG type: (struct format, size)
+FIELD_TYPES = {0: "B", 1: "b", 2: "H", 3: "h", 4: "I", 5: "i", 6: "q", 7: "f"}
+
+
+class MLGField:
+    def __init__(self, raw):
+        field_type, name, units, style, scale, transform, digits = struct.unpack(FIELD_FORMAT, raw)
+        self.type = field_type
+        self.name = name.split(b"\0", 1)[0].decode("ascii", errors="replace")
+        self.units = units.split(b"\0", 1)[0].decode("ascii", errors="replace")
+        self.style = style
+        self.scale = scale
+        self.transform = transform
+        self.digits = digits
+
+    def value(self, raw):
+        return (raw + self.transform) * self.scale
+
+
+def validate(data, dump=0):
+    errors = []
+    header_size = struct.calcsize(HEADER_FORMAT)
+    field_size = struct.calcsize(FIELD_FORMAT)
+    if len(data) < header_size:
+        return ["File is too short to contain an MLG header"], None
+
+    magic, version, _, info_start, data_start, record_length, num_fields = struct.unpack_from(HEADER_FORMAT, data, 0)
+    if magic != b"MLVLG\0":
+        return [f"Bad magic {magic!r}"], None
+    if version != 1:
+        return [f"Unsupported MLG version {version}"], None
+
+    fields = []
+    offset = header_size
+    for index in range(num_fields):
+        if offset + field_size > len(data):
+            return [f"File ends inside the descriptor for field {index}"], None
+        field = MLGField(data[offset:offset + field_size])
+        if field.type not in FIELD_TYPES:
+            errors.append(f"Field {index} ({field.name}) has unknown type {field.type}")
+        if not field.name:
+            errors.append(f"Field {index} has no name")
+        fields.append(field)
+        offset += field_size
+    if errors:
+        return errors, None
+
+    formats = ">" + "".join(FIELD_TYPES[f.type] for f in fields)
+    if struct.calcsize(formats) != record_length:
+        errors.append(f"Record length {record_length} does not match the field descriptors ({struct.calcsize(formats)})")
+        return errors, None
+    if data_start < offset:
+        errors.append(f"Data begin index {data_start} is inside the field descriptors (Ends at {offset})")
+        return errors, None
+    if info_start != 0 and not (offset <= info_start < data_start):
+        errors.append(f"Info data start {info_start} is outside the header")
+
+    stats = {"blocks": 0, "markers": 0, "bad_crc": 0, "counter_gaps": 0, "last_time": None}
+    offset = data_start
+    last_counter = None
+    last_time = None
+    while offset < len(data):
+        block_type = data[offset]
+        if block_type == BLOCK_TYPE_MARKER:
+            offset += 4 + MARKER_LENGTH
+            stats["markers"] += 1
+            continue
+        if block_type != BLOCK_TYPE_DATA:
+            errors.append(f"Unknown block type {block_type} at offset {offset}")
+            break
+        if offset + 4 + record_length + 1 > len(data):
+            errors.append(f"Truncated data block at offset {offset}")
+            break
+
+        counter = data[offset + 1]
+        payload = data[offset + 4:offset + 4 + record_length]
+        crc = data[offset + 4 + record_length]
+        if (sum(payload) & 0xFF) != crc:
+            stats["bad_crc"] += 1
+            errors.append(f"Bad CRC in block {stats['blocks']} at offset {offset}")
+        if last_counter is not None and counter != ((last_counter + 1) & 0xFF):
+            stats["counter_gaps"] += 1
+        last_counter = counter
+
+        values = struct.unpack(formats, payload)
+        # The Speeduino logger always writes the log time as the first field
+        if fields[0].name == "Time":
+            if last_time is not None and values[0] < last_time:
+                errors.append(f"Time goes backwards in block {stats['blocks']} ({values[0]} < {last_time})")
+            last_time = values[0]
+        if stats["blocks"] < dump:
+            print(", ".join(f"{f.name}={f.value(v):.{max(f.digits, 0)}f}" for f, v in zip(fields, values)))
+
+        stats["blocks"] += 1
+        offset += 4 + record_length + 1
+
+    stats["last_time"] = last_time
+    stats["fields"] = len(fields)
+    stats["record_length"] = record_length
+    return errors, stats
+
+
+def main(argv=None):
+    parser = argparse.ArgumentParser(description=__doc__, formatter_class=argparse.RawDescriptionHelpFormatter)
+    parser.add_argument("input", help="MLG log file")
+    parser.add_argument("--dump", type=int, default=0, metavar="N", help="Print the first N records")
+    parser.add_argument("--max-errors", type=int, default=20, help="Maximum number of errors to print (Default: 20)")
+    args = parser.parse_args(argv)
+
+    with open(args.input, "rb") as f:
+        data = f.read()
+
+    errors, stats = validate(data, args.dump)
+    for error in errors[:args.max_errors]:
+        print(f"{args.input}: {error}", file=sys.stderr)
+    if len(errors) > args.max_errors:
+        print(f"{args.input}: ... {len(errors) - args.max_errors} more errors", file=sys.stderr)
+
+    if stats is not None:
+        print(f"{args.input}: {stats['fields']} fields, {stats['record_length']} bytes per record, {stats['blocks']} data blocks, "
+              f"{stats['markers']} markers, {stats['counter_gaps']} counter gaps, {stats['bad_crc']} bad CRCs")
+    return 1 if errors else 0
+
+
+if __name__ == "__main__":
+    sys.exit(main())
@@ -0,0 +1,213 @@
+#!/usr/bin/env python3
+"""Converts Speeduino binary SD card logs (SPD_xxxx.bin) to CSV or MegaLogViewer (.mlg) files.
+SD tooth logs (TTH_xxxx.bin) are also recognised and are always converted to CSV.
+
+The binary format is described in speeduino/SD_logger.h. The file header lists the name, type and
+scale of every field, so this tool does not need to be updated when fields are added to the log.
+
+Usage:
+    sdlog_convert.py SPD_0001.bin                 # Writes SPD_0001.csv
+    sdlog_convert.py SPD_0001.bin -f mlg          # Writes SPD_0001.mlg
+    sdlog_convert.py SPD_0001.bin -o out.csv
+    sdlog_convert.py TTH_0001.bin                 # Writes TTH_0001.csv
+"""
+import argparse
+import os
+import struct
+import sys
+
+MAGIC = b"SPDLOG"
+SUPPORTED_VERSION = 1
+RECORD_MARKER = 0xA5
+RECORD_OVERHEAD = 7  # Marker, counter, 4 byte timestamp, checksum
+
+TOOTH_MAGIC = b"SPDTTH"
+TOOTH_SUPPORTED_VERSION = 1
+TOOTH_OVERFLOW = 0xFF
+TOOTH_INPUTS = {0: "Crank", 1: "Cam", 2: "Cam2"}
+# Must match the COMPOSITE_LOG_* bits in globals.h
+TOOTH_FLAG_NAMES = ["Pri", "Sec", "Third", "Trig", "Sync", "Cycle"]
+
+# Must match the SD_LOG_TYPE_* and SD_LOG_SCALE_* defines in SD_logger.h
+TYPE_FORMATS = {0: "<B", 1: "<b", 2: "<H", 3: "<h"}
+SCALE_DIVISORS = {0: 1, 1: 2, 2: 10, 3: 1000}
+
+# MLG (MegaLogViewer binary format, version 1) field types
+MLG_TYPES = {0: 0, 1: 1, 2: 2, 3: 3}  # U08, S08, U16, S16 share the same codes
+
+
+class LogField:
+    def __init__(self, name, descriptor):
+        self.name = name
+        self.type = descriptor >> 4
+        self.scale = descriptor & 0x0F
+        if self.type not in TYPE_FORMATS or self.scale not in SCALE_DIVISORS:
+            raise ValueError(f"Unknown field descriptor 0x{descriptor:02X} for field '{name}'")
+        self.format = TYPE_FORMATS[self.type]
+        self.size = struct.calcsize(self.format)
+        self.divisor = SCALE_DIVISORS[self.scale]
+
+
+def read_header(data):
+    """Parses the file header. Returns (fields, record_length, offset of the first record)"""
+    if data[:len(MAGIC)] != MAGIC:
+        raise ValueError("Not a Speeduino binary log (bad magic)")
+    offset = len(MAGIC)
+    version, num_fields, record_length = struct.unpack_from("<BBH", data, offset)
+    offset += 4
+    if version != SUPPORTED_VERSION:
+        raise ValueError(f"Unsupported binary log version {version}")
+
+    fields = []
+    for _ in range(num_fields):
+        descriptor, name_length = struct.unpack_from("<BB", data, offset)
+        offset += 2
+        name = data[offset:offset + name_length].decode("ascii", errors="replace")
+        offset += name_length
+        fields.append(LogField(name, descriptor))
+
+    expected_length = RECORD_OVERHEAD + sum(f.size for f in fields)
+    if expected_length != record_length:
+        raise ValueError(f"Header record length {record_length} does not match field list ({expected_length})")
+    return fields, record_length, offset
+
+
+def read_records(data, fields, record_length, offset):
+    """Yields (timestamp_ms, [raw values]) for every valid record. Corrupt data is skipped by searching for the next marker"""
+    stats = {"records": 0, "bad_checksum": 0, "dropped": 0}
+    last_counter = None
+    while offset + record_length <= len(data):
+        record = data[offset:offset + record_length]
+        if record[0] != RECORD_MARKER:
+            offset += 1
+            continue
+        if (sum(record[:-1]) & 0xFF) != record[-1]:
+            stats["bad_checksum"] += 1
+            offset += 1
+            continue
+
+        counter = record[1]
+        if last_counter is not None:
+            stats["dropped"] += (counter - last_counter - 1) & 0xFF
+        last_counter = counter
+
+        timestamp = struct.unpack_from("<I", record, 2)[0]
+        values = []
+        field_offset = 6
+        for field in fields:
+            values.append(struct.unpack_from(field.format, record, field_offset)[0])
+            field_offset += field.size
+        stats["records"] += 1
+        offset += record_length
+        yield timestamp, values
+    read_records.stats = stats
+
+
+def format_value(raw, field):
+    if field.divisor == 1:
+        return str(raw)
+    return f"{raw / field.divisor:.3f}".rstrip("0").rstrip(".")
+
+
+def write_csv(out, fields, records):
+    out.write("Time," + ",".join(f.name for f in fields) + "\n")
+    for timestamp, values in records:
+        out.write(f"{timestamp // 1000}.{timestamp % 1000:03d},")
+        out.write(",".join(format_value(v, f) for v, f in zip(values, fields)))
+        out.write("\n")
+
+
+def write_mlg(out, fields, records):
+    """Writes a MegaLogViewer binary (MLVLG version 1) file. All MLG values are big endian"""
+    mlg_fields = [("Time", 4, 0.001, "s")] + [(f.name, MLG_TYPES[f.type], 1.0 / f.divisor, "") for f in fields]
+    record_length = 4 + sum(f.size for f in fields)  # Time is stored as a U32 in ms
+    header_size = 22 + (55 * len(mlg_fields))
+
+    out.write(b"MLVLG\0")
+    out.write(struct.pack(">HIHIHH", 1, 0, 0, header_size, record_length, len(mlg_fields)))
+    for name, mlg_type, scale, units in mlg_fields:
+        out.write(struct.pack(">B34s10sBffb", mlg_type, name.encode("ascii")[:33], units.encode("ascii")[:9], 0, scale, 0.0, 3 if scale != 1.0 else 0))
+
+    counter = 0
+    for timestamp, values in records:
+        payload = struct.pack(">I", timestamp & 0xFFFFFFFF)
+        for value, field in zip(values, fields):
+            payload += struct.pack(">" + field.format[1], value)
+        # MLG block timestamp is in 10us units and wraps at 16 bits
+        out.write(struct.pack(">BBH", 0, counter & 0xFF, (timestamp * 100) & 0xFFFF))
+        out.write(payload)
+        out.write(struct.pack(">B", sum(payload) & 0xFF))
+        counter += 1
+
+
+def convert_tooth_log(data, out):
+    """Converts an SD tooth log to CSV. Returns (edges, overflow records, edges lost to overflows)"""
+    version, record_size = struct.unpack_from("<BB", data, len(TOOTH_MAGIC))
+    if version != TOOTH_SUPPORTED_VERSION:
+        raise ValueError(f"Unsupported tooth log version {version}")
+
+    out.write("Time(us),Gap(us),Input," + ",".join(TOOTH_FLAG_NAMES) + "\n")
+    edges = overflows = lost = 0
+    last_time = None
+    offset = len(TOOTH_MAGIC) + 2
+    while offset + record_size <= len(data):
+        time, flags = struct.unpack_from("<IB", data, offset)
+        offset += record_size
+        if flags == TOOTH_OVERFLOW:
+            # Time holds the number of edges that were lost. The next gap spans the missing edges
+            overflows += 1
+            lost += time
+            out.write(f"OVERFLOW,{time},," + "," * len(TOOTH_FLAG_NAMES) + "\n")
+            last_time = None
+            continue
+        gap = "" if last_time is None else str((time - last_time) & 0xFFFFFFFF)
+        last_time = time
+        bits = ",".join(str((flags >> bit) & 1) for bit in range(len(TOOTH_FLAG_NAMES)))
+        out.write(f"{time},{gap},{TOOTH_INPUTS.get(flags >> 6, flags >> 6)},{bits}\n")
+        edges += 1
+    return edges, overflows, lost
+
+
+def main(argv=None):
+    parser = argparse.ArgumentParser(description=__doc__, formatter_class=argparse.RawDescriptionHelpFormatter)
+    parser.add_argument("input", help="Binary log file from the SD card (SPD_xxxx.bin)")
+    parser.add_argument("-f", "--format", choices=("csv", "mlg"), default="csv", help="Output format (Default: csv)")
+    parser.add_argument("-o", "--output", help="Output filename (Default: input name with the new extension)")
+    args = parser.parse_args(argv)
+
+    with open(args.input, "rb") as f:
+        data = f.read()
+
+    if data[:len(TOOTH_MAGIC)] == TOOTH_MAGIC:
+        output = args.output or (os.path.splitext(args.input)[0] + ".csv")
+        try:
+            with open(output, "w", newline="") as out:
+                edges, overflows, lost = convert_tooth_log(data, out)
+        except ValueError as e:
+            print(f"{args.input}: {e}", file=sys.stderr)
+            return 1
+        print(f"{output}: {edges} edges, {overflows} overflows ({lost} edges lost)")
+        return 0
+
+    try:
+        fields, record_length, offset = read_header(data)
+    except ValueError as e:
+        print(f"{args.input}: {e}", file=sys.stderr)
+        return 1
+
+    output = args.output or (os.path.splitext(args.input)[0] + "." + args.format)
+    records = read_records(data, fields, record_length, offset)
+    if args.format == "csv":
+        with open(output, "w", newline="") as out:
+            write_csv(out, fields, records)
+    else:
+        with open(output, "wb") as out:
+            write_mlg(out, fields, records)
+
+    stats = read_records.stats
+    print(f"{output}: {stats['records']} records, {stats['dropped']} dropped, {stats['bad_checksum']} bad checksums")
+    return 0
+
+
+if __name__ == "__main__":
+    sys.exit(main())